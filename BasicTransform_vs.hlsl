@@ -16,6 +16,8 @@ SimplePixelShaderInput main(BasicVertex modelVertex)
 {
     SimplePixelShaderInput output; // This is the data the pixel shader requires from this vertex shader
 
+    DecodeVertex(modelVertex); // Decode compressed vertices if the mesh uses them (see Common.hlsli)
+
     // Input position is x,y,z only - need a 4th element to multiply by a 4x4 matrix. Use 1 for a point (0 for a vector) - recall lectures
     float4 modelPosition = float4(modelVertex.position, 1); 
 
@@ -4,6 +4,8 @@
 // Holds position, rotation, near/far clip and field of view. These to a view and projection matrices as required
 
 #include "Camera.h"
+#include "Transform.h"
+#include "GraphicsHelpers.h"
 
 // Control the camera's position and rotation using keys provided
 void Camera::Control(float frameTime, KeyCode turnUp, KeyCode turnDown, KeyCode turnLeft, KeyCode turnRight,
@@ -59,22 +61,18 @@ void Camera::Control(float frameTime, KeyCode turnUp, KeyCode turnDown, KeyCode
 void Camera::UpdateMatrices()
 {
     // "World" matrix for the camera - treat it like a model at first
-    mWorldMatrix = MatrixRotationZ(mRotation.z) * MatrixRotationX(mRotation.x) * MatrixRotationY(mRotation.y) * MatrixTranslation(mPosition);
+    mWorldMatrix = MatrixTRS(mPosition, mRotation, { 1, 1, 1 }); // Built directly, same as MatrixRotationZ * MatrixRotationX * MatrixRotationY * MatrixTranslation
 
     // View matrix is the usual matrix used for the camera in shaders, it is the inverse of the world matrix (see lectures)
     mViewMatrix = InverseAffine(mWorldMatrix);
 
     // Projection matrix, how to flatten the 3D world onto the screen (needs field of view, near and far clip, aspect ratio)
-    float tanFOVx = std::tan(mFOVx * 0.5f);
-    float scaleX = 1.0f / tanFOVx;
-    float scaleY = mAspectRatio / tanFOVx;
-    float scaleZa = mFarClip / (mFarClip - mNearClip);
-    float scaleZb = -mNearClip * scaleZa;
-
-    mProjectionMatrix = CMatrix4x4{ scaleX,   0.0f,    0.0f,   0.0f,
-                                      0.0f, scaleY,    0.0f,   0.0f,
-                                      0.0f,   0.0f, scaleZa,   1.0f,
-                                      0.0f,   0.0f, scaleZb,   0.0f };
+    // Only depends on the camera settings, so only rebuilt when one of them has changed
+    if (!mProjectionMatrixValid)
+    {
+        mProjectionMatrix = MakeProjectionMatrix(mAspectRatio, mFOVx, mNearClip, mFarClip); // Helper function in Utility\GraphicsHelpers.h
+        mProjectionMatrixValid = true;
+    }
 
     // The view-projection matrix combines the two matrices usually used for the camera into one, which can save a multiply in the shaders (optional)
     mViewProjectionMatrix = mViewMatrix * mProjectionMatrix;
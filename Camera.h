@@ -6,6 +6,7 @@
 #include "Common.h"
 #include "CVector3.h"
 #include "CMatrix4x4.h"
+#include "Frustum.h"
 #include "MathHelpers.h"
 #include "Input.h"
 
@@ -23,7 +24,8 @@ public:
 	// Constructor - initialise all settings, sensible defaults provided for everything.
 	Camera(CVector3 position = {0,0,0}, CVector3 rotation = {0,0,0}, 
            float fov = PI/3, float aspectRatio = 4.0f / 3.0f, float nearClip = 0.1f, float farClip = 10000.0f)
-        : mPosition(position), mRotation(rotation), mFOVx(fov), mAspectRatio(aspectRatio), mNearClip(nearClip), mFarClip(farClip)
+        : mPosition(position), mRotation(rotation), mFOVx(fov), mAspectRatio(aspectRatio), mNearClip(nearClip), mFarClip(farClip),
+          mProjectionMatrixValid(false)
     {
     }
 
@@ -47,15 +49,18 @@ public:
 	float NearClip()  { return mNearClip; }
 	float FarClip()   { return mFarClip;  }
 
-	void SetFOV     (float fov     )  { mFOVx     = fov;      }
-	void SetNearClip(float nearClip)  { mNearClip = nearClip; }
-	void SetFarClip (float farClip )  { mFarClip  = farClip;  }
+	void SetFOV     (float fov     )  { mFOVx     = fov;      mProjectionMatrixValid = false; }
+	void SetNearClip(float nearClip)  { mNearClip = nearClip; mProjectionMatrixValid = false; }
+	void SetFarClip (float farClip )  { mFarClip  = farClip;  mProjectionMatrixValid = false; }
 
 	// Read only access to camera matrices, updated on request from position, rotation and camera settings
 	CMatrix4x4 ViewMatrix()            { UpdateMatrices(); return mViewMatrix;           }
 	CMatrix4x4 ProjectionMatrix()      { UpdateMatrices(); return mProjectionMatrix;     }
 	CMatrix4x4 ViewProjectionMatrix()  { UpdateMatrices(); return mViewProjectionMatrix; }
 
+	// View frustum in world space, for culling objects that are not visible to this camera
+	Frustum ViewFrustum()              { UpdateMatrices(); return Frustum(mViewProjectionMatrix); }
+
 	
 //-------------------------------------
 // Private members
@@ -82,6 +87,9 @@ private:
 	CMatrix4x4 mProjectionMatrix;     // Projection matrix holds the field of view and near/far clip distances
 	CMatrix4x4 mViewProjectionMatrix; // Combine (multiply) the view and projection matrices together, which
 	                                  // can sometimes save a matrix multiply in the shader (optional)
+
+	// The projection matrix only depends on the camera settings, so it is only rebuilt after one of them is set
+	bool mProjectionMatrixValid;
 };
 
 
@@ -10,6 +10,7 @@
 
 #include "CVector3.h"
 #include "CMatrix4x4.h"
+#include <cstddef>
 
 
 //--------------------------------------------------------------------------------------
@@ -54,7 +55,8 @@ extern std::string gLastError;
 // Data that remains constant for an entire frame, updated from C++ to the GPU shaders *once per frame*
 // We hold them together in a structure and send the whole thing to a "constant buffer" on the GPU each frame when
 // we have finished updating the scene. There is a structure in the shader code that exactly matches this one
-struct PerFrameConstants
+// Aligned to 16 bytes (like the GPU side) so the matrices can be written directly from SIMD types (see Mat4A.h)
+struct alignas(16) PerFrameConstants
 {
     // These are the matrices used to position the camera
     CMatrix4x4 viewMatrix;
@@ -87,6 +89,14 @@ struct PerFrameConstants
 	float      parallaxDepth;
 };
 
+static_assert(offsetof(PerFrameConstants, viewMatrix)             % 16 == 0 &&
+              offsetof(PerFrameConstants, projectionMatrix)       % 16 == 0 &&
+              offsetof(PerFrameConstants, viewProjectionMatrix)   % 16 == 0 &&
+              offsetof(PerFrameConstants, light1ViewMatrix)       % 16 == 0 &&
+              offsetof(PerFrameConstants, light1ProjectionMatrix) % 16 == 0 &&
+              offsetof(PerFrameConstants, light2ViewMatrix)       % 16 == 0 &&
+              offsetof(PerFrameConstants, light2ProjectionMatrix) % 16 == 0, "Constant buffer matrices must be 16-byte aligned");
+
 extern PerFrameConstants gPerFrameConstants;      // This variable holds the CPU-side constant buffer described above
 extern ID3D11Buffer*     gPerFrameConstantBuffer; // This variable controls the GPU-side constant buffer matching to the above structure
 
@@ -94,16 +104,34 @@ extern ID3D11Buffer*     gPerFrameConstantBuffer; // This variable controls the
 
 // This is the matrix that positions the next thing to be rendered in the scene. Unlike the structure above this data can be
 // updated and sent to the GPU several times every frame (once per model). However, apart from that it works in the same way.
-struct PerModelConstants
+struct alignas(16) PerModelConstants
 {
     CMatrix4x4 worldMatrix;
     CVector3   objectColour; // Allows each light model to be tinted to match the light colour they cast
     float      padding6;
 	float      Wiggle;
 	CVector3   gObjectRGB;
+
+    // Decoding for meshes with compressed vertices (see MeshCompression.h), set from the mesh by Model::Render
+    CVector3     positionOffset;
+    unsigned int compressedNormals; // 1 if normals and tangents are octahedral encoded, 0 if not
+    CVector3     positionScale;
+    float        padding7;
 };
+static_assert(offsetof(PerModelConstants, worldMatrix) % 16 == 0, "Constant buffer matrices must be 16-byte aligned");
+
 extern PerModelConstants gPerModelConstants;      // This variable holds the CPU-side constant buffer described above
 extern ID3D11Buffer*     gPerModelConstantBuffer; // This variable controls the GPU-side constant buffer related to the above structure
 
 
+// Draw calls and constant buffer updates made since the counts were last reset, counted by the Mesh render functions
+// and UpdateConstantBuffer. Shown in the window title to compare the cost of each pass
+struct RenderCounts
+{
+    unsigned int drawCalls             = 0;
+    unsigned int constantBufferUpdates = 0;
+};
+extern RenderCounts gRenderCounts;
+
+
 #endif //_COMMON_H_INCLUDED_
@@ -16,6 +16,12 @@ struct BasicVertex
     float2 uv       : uv;
 };
 
+// Vertices from a mesh's position-only stream, used by depth-only passes (see Mesh.h)
+struct PositionVertex
+{
+    float3 position : position;
+};
+
 
 // This structure describes what data the lighting pixel shader receives from the vertex shader.
 // The projected position is a required output from all vertex shaders - where the vertex is on the screen
@@ -101,13 +107,19 @@ cbuffer PerModelConstants : register(b1) // The b1 gives this constant buffer th
     float    padding6;  // See notes on padding in structure above
     float    gWiggle;
 	float3   gObjectRGB;
+
+    // Decoding for meshes with compressed vertices, see DecodeVertex below
+    float3   gPositionOffset;
+    uint     gCompressedNormals;
+    float3   gPositionScale;
+    float    padding7;
 }
 
 struct TangentVertex
 {
     float3 position : position;
     float3 normal : normal;
-    float3 tangent : tangent;
+    float4 tangent : tangent; // w is the bitangent sign, see MeshTangents.h in the C++ code
     float2 uv : uv;
 };
 
@@ -116,6 +128,53 @@ struct NormalMappingPixelShaderInput
     float4 projectedPosition : SV_Position; 
     float3 worldPosition : worldPosition; 
     float3 modelNormal : modelNormal; 
-    float3 modelTangent : modelTangent; 
+    float4 modelTangent : modelTangent; // w is the bitangent sign
     float2 uv : uv;
 };
+
+
+//--------------------------------------------------------------------------------------
+// Compressed vertices
+//--------------------------------------------------------------------------------------
+// Meshes may use a compressed vertex layout (see MeshCompression.h in the C++ code). Positions are
+// 16-bit values across the mesh bounding box, normals and tangents are octahedral encoded in two
+// values (the third component arrives as 0, tangents keep the bitangent sign in the fourth), UVs are
+// half floats and need no decoding.
+// Vertex shaders call DecodeVertex first, for uncompressed meshes it leaves the vertex unchanged
+
+// Unfold a point in the square [-1,1] x [-1,1] back onto the octahedron, then normalise
+float3 OctahedralDecode(float2 encoded)
+{
+    float3 v = float3(encoded, 1 - abs(encoded.x) - abs(encoded.y));
+    float  t = saturate(-v.z);
+    v.xy += (v.xy >= 0) ? -t : t;
+    return normalize(v);
+}
+
+float3 DecodePosition(float3 position)
+{
+    return gPositionOffset + position * gPositionScale;
+}
+
+float3 DecodeDirection(float3 direction)
+{
+    return gCompressedNormals ? OctahedralDecode(direction.xy) : direction;
+}
+
+void DecodeVertex(inout BasicVertex vertex)
+{
+    vertex.position = DecodePosition(vertex.position);
+    vertex.normal   = DecodeDirection(vertex.normal);
+}
+
+void DecodeVertex(inout PositionVertex vertex)
+{
+    vertex.position = DecodePosition(vertex.position);
+}
+
+void DecodeVertex(inout TangentVertex vertex)
+{
+    vertex.position = DecodePosition(vertex.position);
+    vertex.normal   = DecodeDirection(vertex.normal);
+    vertex.tangent.xyz = DecodeDirection(vertex.tangent.xyz);
+}
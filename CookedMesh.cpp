@@ -0,0 +1,244 @@
+//--------------------------------------------------------------------------------------
+// Cooked mesh files - imported mesh data saved in the layout used by the GPU buffers
+//--------------------------------------------------------------------------------------
+
+#include "CookedMesh.h"
+
+#include <cstdio>
+#include <cstring>
+#include <atomic>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+
+//--------------------------------------------------------------------------------------
+// Helpers
+//--------------------------------------------------------------------------------------
+
+// 64-bit FNV-1a hash of a block of memory
+uint64_t HashFNV1a(const void* data, size_t size, uint64_t hash /*= FNV1A_OFFSET_BASIS*/)
+{
+    const uint64_t FNV1A_PRIME = 1099511628211ull;
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= FNV1A_PRIME;
+    }
+    return hash;
+}
+
+
+// Return the name of the cooked file for the given source mesh file. A mesh imported with and without
+// tangents, or with and without a skin, has a cooked file for each
+std::string CookedMeshFileName(const std::string& sourceFileName, bool requireTangents, bool requireSkin /*= false*/)
+{
+    return sourceFileName + (requireTangents ? ".tangents" : "") + (requireSkin ? ".skinned" : "") + ".cooked";
+}
+
+
+// Map the given file read-only. Empty files are treated as missing, they can't be mapped
+MappedFile::MappedFile(const std::string& fileName)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)  return;
+    mFile = file;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)  return;
+
+    mMapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mMapping == nullptr)  return;
+
+    mData = static_cast<const unsigned char*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+    if (mData != nullptr)  mSize = static_cast<size_t>(size.QuadPart);
+#else
+    int file = open(fileName.c_str(), O_RDONLY);
+    if (file < 0)  return;
+
+    struct stat info;
+    if (fstat(file, &info) == 0 && info.st_size > 0)
+    {
+        void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+        if (data != MAP_FAILED)
+        {
+            mData = static_cast<const unsigned char*>(data);
+            mSize = static_cast<size_t>(info.st_size);
+        }
+    }
+    close(file); // The mapping stays valid after the file is closed
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+    if (mData)     UnmapViewOfFile(mData);
+    if (mMapping)  CloseHandle(mMapping);
+    if (mFile)     CloseHandle(mFile);
+#else
+    if (mData)  munmap(const_cast<unsigned char*>(mData), mSize);
+#endif
+}
+
+
+//--------------------------------------------------------------------------------------
+// Reading and writing
+//--------------------------------------------------------------------------------------
+
+// Vertex and index data start on 16-byte boundaries within the file
+static uint64_t AlignOffset(uint64_t offset)
+{
+    return (offset + 15) & ~uint64_t(15);
+}
+
+
+// Whether every index value in the given range is below numVertices
+static bool IndicesInRange(const uint32_t* indices, uint32_t numIndices, uint32_t numVertices)
+{
+    uint32_t maxIndex = 0;
+    for (uint32_t i = 0; i < numIndices; ++i)  maxIndex = indices[i] > maxIndex ? indices[i] : maxIndex;
+    return numIndices == 0 || maxIndex < numVertices;
+}
+
+// Open a cooked mesh file and check it matches the given source hash. Every size and offset in
+// the header is checked against the file size, and every index value against the vertices of its
+// sub-mesh, so a damaged file is rejected rather than read or drawn
+CookedMeshFile::CookedMeshFile(const std::string& cookedFileName, uint64_t sourceHash)
+    : mFile(cookedFileName)
+{
+    if (!mFile.IsOpen() || mFile.Size() < sizeof(CookedMeshHeader))  return;
+
+    auto header = reinterpret_cast<const CookedMeshHeader*>(mFile.Data());
+    if (std::memcmp(header->magic, "CMSH", 4) != 0 || header->version != COOKED_MESH_VERSION ||
+        header->sourceHash != sourceHash)  return;
+
+    uint64_t elementsEnd  = sizeof(CookedMeshHeader) + uint64_t(header->numElements) * sizeof(CookedVertexElement);
+    uint64_t subMeshesEnd = elementsEnd + uint64_t(header->numSubMeshes) * sizeof(CookedSubMesh);
+    uint64_t clustersEnd  = subMeshesEnd + uint64_t(header->numClusters) * sizeof(CookedCluster);
+    uint64_t bonesEnd     = clustersEnd + uint64_t(header->numBones) * sizeof(CookedBone);
+    uint64_t vertexBytes  = uint64_t(header->numVertices) * header->vertexSize;
+    uint64_t indexBytes   = uint64_t(header->numIndices) * sizeof(uint32_t);
+    if (header->numElements == 0 || header->numSubMeshes == 0 || header->numVertices == 0 || header->numIndices == 0 ||
+        header->vertexDataOffset < bonesEnd || header->vertexDataOffset % 16 != 0 ||
+        header->indexDataOffset < header->vertexDataOffset + vertexBytes || header->indexDataOffset % 16 != 0 ||
+        header->indexDataOffset + indexBytes > mFile.Size())  return;
+
+    mElements = reinterpret_cast<const CookedVertexElement*>(mFile.Data() + sizeof(CookedMeshHeader));
+    for (uint32_t i = 0; i < header->numElements; ++i)
+    {
+        if (std::memchr(mElements[i].semanticName, 0, sizeof(mElements[i].semanticName)) == nullptr ||
+            mElements[i].offset >= header->vertexSize)  return;
+    }
+    mSubMeshes = reinterpret_cast<const CookedSubMesh*>(mFile.Data() + elementsEnd);
+    auto indices = reinterpret_cast<const uint32_t*>(mFile.Data() + header->indexDataOffset);
+    for (uint32_t i = 0; i < header->numSubMeshes; ++i)
+    {
+        const CookedSubMesh& subMesh = mSubMeshes[i];
+        if (uint64_t(subMesh.indexStart) + subMesh.numIndices > header->numIndices ||
+            uint64_t(subMesh.baseVertex) + subMesh.numVertices > header->numVertices ||
+            subMesh.numLods == 0 || subMesh.numLods > MESH_MAX_LODS ||
+            uint64_t(subMesh.clusterStart) + subMesh.numClusters > header->numClusters)  return;
+        for (uint32_t lod = 0; lod < MESH_MAX_LODS; ++lod)
+        {
+            if (uint64_t(subMesh.lods[lod].indexStart) + subMesh.lods[lod].numIndices > header->numIndices)  return;
+        }
+
+        // Index values are relative to the sub-mesh's first vertex. Levels after numLods repeat the last one
+        if (!IndicesInRange(indices + subMesh.indexStart, subMesh.numIndices, subMesh.numVertices))  return;
+        for (uint32_t lod = 1; lod < subMesh.numLods; ++lod)
+        {
+            if (!IndicesInRange(indices + subMesh.lods[lod].indexStart, subMesh.lods[lod].numIndices, subMesh.numVertices))  return;
+        }
+    }
+    mClusters = reinterpret_cast<const CookedCluster*>(mFile.Data() + subMeshesEnd);
+    for (uint32_t i = 0; i < header->numClusters; ++i)
+    {
+        if (uint64_t(mClusters[i].indexStart) + mClusters[i].numIndices > header->numIndices)  return;
+    }
+    mBones = reinterpret_cast<const CookedBone*>(mFile.Data() + clustersEnd);
+    for (uint32_t i = 0; i < header->numBones; ++i)
+    {
+        if (std::memchr(mBones[i].name, 0, sizeof(mBones[i].name)) == nullptr ||
+            mBones[i].parent < -1 || mBones[i].parent >= static_cast<int32_t>(i))  return;
+    }
+    mHeader = header;
+}
+
+
+// Write a cooked mesh file, via a temporary file
+bool WriteCookedMesh(const std::string& cookedFileName, uint64_t sourceHash, uint64_t importMicroseconds,
+                     const CookedVertexElement* elements, unsigned int numElements,
+                     const CookedSubMesh* subMeshes, unsigned int numSubMeshes,
+                     const CookedCluster* clusters, unsigned int numClusters,
+                     const CookedBone* bones, unsigned int numBones, unsigned int vertexSize,
+                     const void* vertices, unsigned int numVertices, const uint32_t* indices, unsigned int numIndices)
+{
+    CookedMeshHeader header = {};
+    std::memcpy(header.magic, "CMSH", 4);
+    header.version            = COOKED_MESH_VERSION;
+    header.sourceHash         = sourceHash;
+    header.numElements        = numElements;
+    header.vertexSize         = vertexSize;
+    header.numVertices        = numVertices;
+    header.numIndices         = numIndices;
+    header.numSubMeshes       = numSubMeshes;
+    header.numClusters        = numClusters;
+    header.numBones           = numBones;
+    header.vertexDataOffset   = AlignOffset(sizeof(CookedMeshHeader) + uint64_t(numElements) * sizeof(CookedVertexElement) +
+                                            uint64_t(numSubMeshes) * sizeof(CookedSubMesh) + uint64_t(numClusters) * sizeof(CookedCluster) +
+                                            uint64_t(numBones) * sizeof(CookedBone));
+    header.indexDataOffset    = AlignOffset(header.vertexDataOffset + uint64_t(numVertices) * vertexSize);
+    header.importMicroseconds = importMicroseconds;
+
+    // Each write has its own temporary file, so threads or processes cooking the same mesh at once don't write
+    // into the same file. Both renames then succeed with a complete file, whichever is last is kept
+    static std::atomic<unsigned int> tempFileCount(0);
+#ifdef _WIN32
+    unsigned long processId = GetCurrentProcessId();
+#else
+    unsigned long processId = static_cast<unsigned long>(getpid());
+#endif
+    std::string tempFileName = cookedFileName + "." + std::to_string(processId) + "." + std::to_string(tempFileCount++) + ".tmp";
+    FILE* file = std::fopen(tempFileName.c_str(), "wb");
+    if (file == nullptr)  return false;
+
+    // Write each block then pad up to the next block's offset
+    const char padding[16] = {};
+    uint64_t written = 0;
+    auto writeBlock = [&](const void* data, uint64_t size)
+    {
+        if (std::fwrite(data, 1, static_cast<size_t>(size), file) != size)  return false;
+        written += size;
+        return true;
+    };
+    bool ok = writeBlock(&header, sizeof(header)) &&
+              writeBlock(elements, uint64_t(numElements) * sizeof(CookedVertexElement)) &&
+              writeBlock(subMeshes, uint64_t(numSubMeshes) * sizeof(CookedSubMesh)) &&
+              writeBlock(clusters, uint64_t(numClusters) * sizeof(CookedCluster)) &&
+              writeBlock(bones, uint64_t(numBones) * sizeof(CookedBone)) &&
+              writeBlock(padding, header.vertexDataOffset - written) &&
+              writeBlock(vertices, uint64_t(numVertices) * vertexSize) &&
+              writeBlock(padding, header.indexDataOffset - written) &&
+              writeBlock(indices, uint64_t(numIndices) * sizeof(uint32_t));
+    ok = (std::fclose(file) == 0) && ok;
+
+    if (ok)
+    {
+#ifdef _WIN32
+        ok = MoveFileExA(tempFileName.c_str(), cookedFileName.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+        ok = std::rename(tempFileName.c_str(), cookedFileName.c_str()) == 0;
+#endif
+    }
+    if (!ok)  std::remove(tempFileName.c_str());
+    return ok;
+}
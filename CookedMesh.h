@@ -0,0 +1,202 @@
+//--------------------------------------------------------------------------------------
+// Cooked mesh files - imported mesh data saved in the layout used by the GPU buffers
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+//
+// Importing a mesh with assimp is slow, it runs many processing steps over the whole mesh. So the
+// first time a mesh is imported the resulting vertex and index data is saved to a "cooked" file
+// next to the source file (e.g. Troll.x.cooked, or Troll.x.tangents.cooked if imported with
+// tangents, Troll.x.skinned.cooked if imported with a skin). Later loads memory-map the cooked file
+// and create the GPU buffers directly from the mapped bytes without copying or processing the data.
+//
+// A cooked file holds a hash of the source file contents and the import settings. If either
+// changes the hash won't match, the cooked file is ignored and is rewritten by the next import.
+//
+// Cooked file layout (little-endian):
+//     CookedMeshHeader
+//     CookedVertexElement[numElements]  - the vertex layout
+//     CookedSubMesh[numSubMeshes]       - the part of the vertex and index data used by each sub-mesh
+//     CookedCluster[numClusters]        - culling bounds for parts of each sub-mesh (see MeshClusters.h)
+//     CookedBone[numBones]              - the skeleton of a skinned mesh (see MeshSkinning.h)
+//     vertex data                       - numVertices * vertexSize bytes, 16-byte aligned
+//     index data                        - numIndices 32-bit indices, 16-byte aligned. The full detail
+//                                         indices of every sub-mesh come first, then the indices of the
+//                                         simpler levels of detail (see MeshSimplify.h)
+
+#ifndef _COOKED_MESH_H_INCLUDED_
+#define _COOKED_MESH_H_INCLUDED_
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+
+//--------------------------------------------------------------------------------------
+// File format
+//--------------------------------------------------------------------------------------
+
+// Increase when the file layout or the import process changes, so older cooked files are rebuilt
+const uint32_t COOKED_MESH_VERSION = 7;
+
+// Most levels of detail kept for each sub-mesh, including the full detail level
+const uint32_t MESH_MAX_LODS = 4;
+
+struct CookedMeshHeader
+{
+    char     magic[4];          // "CMSH"
+    uint32_t version;           // COOKED_MESH_VERSION
+    uint64_t sourceHash;        // Hash of the source file contents and import settings
+    uint32_t numElements;       // Number of CookedVertexElement following the header
+    uint32_t vertexSize;        // Size in bytes of a single vertex
+    uint32_t numVertices;
+    uint32_t numIndices;
+    uint64_t vertexDataOffset;  // Offset of the vertex data from the start of the file
+    uint64_t indexDataOffset;   // Offset of the index data from the start of the file
+    uint64_t importMicroseconds; // Time the original import took, for reporting the time saved
+    uint32_t numSubMeshes;      // Number of CookedSubMesh following the vertex elements
+    uint32_t numClusters;       // Number of CookedCluster following the sub-meshes
+    uint32_t numBones;          // Number of CookedBone following the clusters, 0 if the mesh is not skinned
+    uint32_t padding;
+};
+
+// One element of the vertex layout, e.g. the position or normal. Matches the fields used from
+// D3D11_INPUT_ELEMENT_DESC, all elements are per-vertex data in slot 0
+struct CookedVertexElement
+{
+    char     semanticName[16];
+    uint32_t semanticIndex;
+    uint32_t format;           // DXGI_FORMAT value
+    uint32_t offset;           // Offset within a vertex
+};
+
+// One level of detail of a sub-mesh - a simplified triangle list using the sub-mesh's vertices
+struct CookedLod
+{
+    uint32_t indexStart;       // First index of the level in the index data
+    uint32_t numIndices;
+    float    error;            // Estimated model space distance the surface has moved from full detail
+};
+
+// One sub-mesh - a part of a mesh file with its own material. Index values are relative to the
+// sub-mesh's first vertex, given by baseVertex. Bounds are in model space
+struct CookedSubMesh
+{
+    uint32_t indexStart;       // First index of the sub-mesh in the index data
+    uint32_t numIndices;
+    uint32_t baseVertex;       // First vertex of the sub-mesh in the vertex data
+    uint32_t numVertices;
+    float    boundsMin[3];     // Axis-aligned bounding box
+    float    boundsMax[3];
+    uint32_t transformedBefore; // Vertices transformed drawing the sub-mesh before and after the import
+    uint32_t transformedAfter;  // reordered the triangles, for reporting (see MeshOptimise.h)
+    uint32_t numLods;          // Levels of detail, 1 to MESH_MAX_LODS (see MeshSimplify.h)
+    CookedLod lods[MESH_MAX_LODS]; // lods[0] is the full detail sub-mesh above, entries from numLods on repeat the last level
+    uint32_t clusterStart;     // Clusters covering the full detail indices, in order (see MeshClusters.h)
+    uint32_t numClusters;
+};
+
+// A run of a sub-mesh's full detail triangles with bounds for culling (see MeshClusters.h). In the
+// sub-mesh's model space
+struct CookedCluster
+{
+    uint32_t indexStart;       // First index of the cluster in the index data
+    uint32_t numIndices;
+    float    centre[3];        // Bounding sphere
+    float    radius;
+    float    coneAxis[3];      // Normal cone - average direction of the triangle normals
+    float    coneCutoff;       // Sine of the largest angle from the axis to a normal, 1 if the cone can't be used
+};
+
+// One bone of a skinned mesh's skeleton in the bind pose (see MeshSkinning.h). Matrices are in the
+// element order of CMatrix4x4 (vectors are rows, multiplied on the left)
+struct CookedBone
+{
+    char     name[32];
+    int32_t  parent;           // Index of the parent bone, always less than this bone's. -1 for a root bone
+    float    bindLocal[16];    // Transform relative to the parent bone (to model space for a root)
+    float    offset[16];       // Mesh space into the bone's space
+};
+
+
+//--------------------------------------------------------------------------------------
+// Helpers
+//--------------------------------------------------------------------------------------
+
+// 64-bit FNV-1a hash of a block of memory. Pass the result of a previous call as the hash
+// parameter to hash several blocks as if they were one
+const uint64_t FNV1A_OFFSET_BASIS = 14695981039346656037ull;
+uint64_t HashFNV1a(const void* data, size_t size, uint64_t hash = FNV1A_OFFSET_BASIS);
+
+// Return the name of the cooked file for the given source mesh file. A mesh imported with and without
+// tangents, or with and without a skin, has a cooked file for each
+std::string CookedMeshFileName(const std::string& sourceFileName, bool requireTangents, bool requireSkin = false);
+
+
+// A file mapped read-only into memory. The data is available until the object is destroyed
+class MappedFile
+{
+public:
+    // Map the given file. Check IsOpen afterwards, the file may not exist
+    explicit MappedFile(const std::string& fileName);
+    ~MappedFile();
+
+    // Not copyable, the mapping belongs to a single object
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool IsOpen() const                { return mData != nullptr; }
+    const unsigned char* Data() const  { return mData; }
+    size_t Size() const                { return mSize; }
+
+private:
+    const unsigned char* mData = nullptr;
+    size_t               mSize = 0;
+    void*                mFile    = nullptr; // Operating system handles (Windows only)
+    void*                mMapping = nullptr;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Reading and writing
+//--------------------------------------------------------------------------------------
+
+// A cooked mesh file opened for reading. The pointers returned stay valid while this object exists
+class CookedMeshFile
+{
+public:
+    // Open a cooked mesh file and check it matches the given source hash. Check IsValid afterwards,
+    // the file may be missing, from a different source or settings, or damaged
+    CookedMeshFile(const std::string& cookedFileName, uint64_t sourceHash);
+
+    bool IsValid() const  { return mHeader != nullptr; }
+
+    const CookedMeshHeader&    Header() const    { return *mHeader; }
+    const CookedVertexElement* Elements() const  { return mElements; }
+    const CookedSubMesh*       SubMeshes() const { return mSubMeshes; }
+    const CookedCluster*       Clusters() const  { return mClusters; }
+    const CookedBone*          Bones() const     { return mBones; }
+    const void*                Vertices() const  { return mFile.Data() + mHeader->vertexDataOffset; }
+    const uint32_t*            Indices() const   { return reinterpret_cast<const uint32_t*>(mFile.Data() + mHeader->indexDataOffset); }
+
+private:
+    MappedFile                 mFile;
+    const CookedMeshHeader*    mHeader   = nullptr;
+    const CookedVertexElement* mElements = nullptr;
+    const CookedSubMesh*       mSubMeshes = nullptr;
+    const CookedCluster*       mClusters  = nullptr;
+    const CookedBone*          mBones     = nullptr;
+};
+
+
+// Write a cooked mesh file. Written to a temporary file first and then renamed, so a failed write
+// never leaves a partial file behind, and a file being written by another thread or process is never
+// read. Safe to call for the same file from several threads at once. Returns false on failure
+bool WriteCookedMesh(const std::string& cookedFileName, uint64_t sourceHash, uint64_t importMicroseconds,
+                     const CookedVertexElement* elements, unsigned int numElements,
+                     const CookedSubMesh* subMeshes, unsigned int numSubMeshes,
+                     const CookedCluster* clusters, unsigned int numClusters,
+                     const CookedBone* bones, unsigned int numBones, unsigned int vertexSize,
+                     const void* vertices, unsigned int numVertices, const uint32_t* indices, unsigned int numIndices);
+
+
+#endif //_COOKED_MESH_H_INCLUDED_
@@ -0,0 +1,30 @@
+//--------------------------------------------------------------------------------------
+// Depth-Only Vertex Shader
+//--------------------------------------------------------------------------------------
+// Transforms positions only - used with the depth-only pixel shader when rendering the shadow maps.
+// Reads vertices from a mesh's position-only stream, so the passes don't fetch normals or UVs
+
+#include "Common.hlsli" // Shaders can also use include files - note the extension
+
+
+//--------------------------------------------------------------------------------------
+// Shader code
+//--------------------------------------------------------------------------------------
+
+SimplePixelShaderInput main(PositionVertex modelVertex)
+{
+    SimplePixelShaderInput output;
+
+    DecodeVertex(modelVertex); // Decode compressed positions if the mesh uses them (see Common.hlsli)
+
+    // Same transformations as the basic transform vertex shader
+    float4 modelPosition     = float4(modelVertex.position, 1);
+    float4 worldPosition     = mul(gWorldMatrix,      modelPosition);
+    float4 viewPosition      = mul(gViewMatrix,       worldPosition);
+    output.projectedPosition = mul(gProjectionMatrix, viewPosition);
+
+    // The depth-only pixel shader has the same input as other pixel shaders, but there are no UVs here
+    output.uv = float2(0, 0);
+
+    return output;
+}
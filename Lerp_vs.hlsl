@@ -3,6 +3,8 @@
 LightingPixelShaderInput main(BasicVertex modelVertex)
 {
     LightingPixelShaderInput output; // This is the data the pixel shader requires from this vertex shader
+
+    DecodeVertex(modelVertex); // Decode compressed vertices if the mesh uses them (see Common.hlsli)
     
     //Wiggle was here
 
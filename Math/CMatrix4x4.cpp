@@ -3,6 +3,8 @@
 //--------------------------------------------------------------------------------------
 
 #include "CMatrix4x4.h"
+#include "SIMD.h"
+#include "MathHelpersSIMD.h"
 
 /*-----------------------------------------------------------------------------------------
     Member functions
@@ -30,47 +32,9 @@ CVector3 CMatrix4x4::GetRow(int iRow) const
 // Post-multiply this matrix by the given one
 CMatrix4x4& CMatrix4x4::operator*=(const CMatrix4x4& m)
 {
-    if (this == &m)
-    {
-        // Special case of multiplying by self - no copy optimisations so use binary version
-        *this = m * m;
-    }
-    else
-    {
-        float t0, t1, t2;
-
-        t0 = e00 * m.e00 + e01 * m.e10 + e02 * m.e20 + e03 * m.e30;
-        t1 = e00 * m.e01 + e01 * m.e11 + e02 * m.e21 + e03 * m.e31;
-        t2 = e00 * m.e02 + e01 * m.e12 + e02 * m.e22 + e03 * m.e32;
-        e03 = e00 * m.e03 + e01 * m.e13 + e02 * m.e23 + e03 * m.e33;
-        e00 = t0;
-        e01 = t1;
-        e02 = t2;
-
-        t0 = e10 * m.e00 + e11 * m.e10 + e12 * m.e20 + e13 * m.e30;
-        t1 = e10 * m.e01 + e11 * m.e11 + e12 * m.e21 + e13 * m.e31;
-        t2 = e10 * m.e02 + e11 * m.e12 + e12 * m.e22 + e13 * m.e32;
-        e13 = e10 * m.e03 + e11 * m.e13 + e12 * m.e23 + e13 * m.e33;
-        e10 = t0;
-        e11 = t1;
-        e12 = t2;
-
-        t0 = e20 * m.e00 + e21 * m.e10 + e22 * m.e20 + e23 * m.e30;
-        t1 = e20 * m.e01 + e21 * m.e11 + e22 * m.e21 + e23 * m.e31;
-        t2 = e20 * m.e02 + e21 * m.e12 + e22 * m.e22 + e23 * m.e32;
-        e23 = e20 * m.e03 + e21 * m.e13 + e22 * m.e23 + e23 * m.e33;
-        e20 = t0;
-        e21 = t1;
-        e22 = t2;
-
-        t0 = e30 * m.e00 + e31 * m.e10 + e32 * m.e20 + e33 * m.e30;
-        t1 = e30 * m.e01 + e31 * m.e11 + e32 * m.e21 + e33 * m.e31;
-        t2 = e30 * m.e02 + e31 * m.e12 + e32 * m.e22 + e33 * m.e32;
-        e33 = e30 * m.e03 + e31 * m.e13 + e32 * m.e23 + e33 * m.e33;
-        e30 = t0;
-        e31 = t1;
-        e32 = t2;
-    }
+    // The multiply functions below all read both matrices fully before writing the result,
+    // so multiplying by self needs no special case
+    MatrixMultiply(*this, m, *this);
     return *this;
 }
 
@@ -83,28 +47,107 @@ CMatrix4x4& CMatrix4x4::operator*=(const CMatrix4x4& m)
 CMatrix4x4 operator*(const CMatrix4x4& m1, const CMatrix4x4& m2)
 {
     CMatrix4x4 mOut;
+    MatrixMultiply(m1, m2, mOut);
+    return mOut;
+}
 
-    mOut.e00 = m1.e00*m2.e00 + m1.e01*m2.e10 + m1.e02*m2.e20 + m1.e03*m2.e30;
-    mOut.e01 = m1.e00*m2.e01 + m1.e01*m2.e11 + m1.e02*m2.e21 + m1.e03*m2.e31;
-    mOut.e02 = m1.e00*m2.e02 + m1.e01*m2.e12 + m1.e02*m2.e22 + m1.e03*m2.e32;
-    mOut.e03 = m1.e00*m2.e03 + m1.e01*m2.e13 + m1.e02*m2.e23 + m1.e03*m2.e33;
 
-    mOut.e10 = m1.e10*m2.e00 + m1.e11*m2.e10 + m1.e12*m2.e20 + m1.e13*m2.e30;
-    mOut.e11 = m1.e10*m2.e01 + m1.e11*m2.e11 + m1.e12*m2.e21 + m1.e13*m2.e31;
-    mOut.e12 = m1.e10*m2.e02 + m1.e11*m2.e12 + m1.e12*m2.e22 + m1.e13*m2.e32;
-    mOut.e13 = m1.e10*m2.e03 + m1.e11*m2.e13 + m1.e12*m2.e23 + m1.e13*m2.e33;
+/*-----------------------------------------------------------------------------------------
+    Matrix multiplication
+-----------------------------------------------------------------------------------------*/
+// The SIMD versions calculate each row of the result as a sum of the rows of m2 scaled by the
+// elements of the matching row of m1. Each element is then the same four products added in the
+// same order as the plain C++ version (MatrixMultiplyScalar, in the header), and with no fused
+// multiply-adds the results are bit-exact
 
-    mOut.e20 = m1.e20*m2.e00 + m1.e21*m2.e10 + m1.e22*m2.e20 + m1.e23*m2.e30;
-    mOut.e21 = m1.e20*m2.e01 + m1.e21*m2.e11 + m1.e22*m2.e21 + m1.e23*m2.e31;
-    mOut.e22 = m1.e20*m2.e02 + m1.e21*m2.e12 + m1.e22*m2.e22 + m1.e23*m2.e32;
-    mOut.e23 = m1.e20*m2.e03 + m1.e21*m2.e13 + m1.e22*m2.e23 + m1.e23*m2.e33;
+#if MATH_SIMD_X86
 
-    mOut.e30 = m1.e30*m2.e00 + m1.e31*m2.e10 + m1.e32*m2.e20 + m1.e33*m2.e30;
-    mOut.e31 = m1.e30*m2.e01 + m1.e31*m2.e11 + m1.e32*m2.e21 + m1.e33*m2.e31;
-    mOut.e32 = m1.e30*m2.e02 + m1.e31*m2.e12 + m1.e32*m2.e22 + m1.e33*m2.e32;
-    mOut.e33 = m1.e30*m2.e03 + m1.e31*m2.e13 + m1.e32*m2.e23 + m1.e33*m2.e33;
+// SSE version - one row of the result per register
+SIMD_TARGET_SSE41 static void MatrixMultiplySSE41(const CMatrix4x4& m1, const CMatrix4x4& m2, CMatrix4x4& mOut)
+{
+    const float* a = &m1.e00;
+    const float* b = &m2.e00;
+    __m128 b0 = _mm_loadu_ps(b);
+    __m128 b1 = _mm_loadu_ps(b + 4);
+    __m128 b2 = _mm_loadu_ps(b + 8);
+    __m128 b3 = _mm_loadu_ps(b + 12);
+
+    __m128 r[4];
+    for (int i = 0; i < 4; ++i)
+    {
+        __m128 row = _mm_loadu_ps(a + i * 4);
+        __m128 t =         _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(0,0,0,0)), b0);
+        t = _mm_add_ps(t,  _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(1,1,1,1)), b1));
+        t = _mm_add_ps(t,  _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(2,2,2,2)), b2));
+        r[i] = _mm_add_ps(t, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(3,3,3,3)), b3));
+    }
 
-    return mOut;
+    float* out = &mOut.e00;
+    _mm_storeu_ps(out,      r[0]);
+    _mm_storeu_ps(out + 4,  r[1]);
+    _mm_storeu_ps(out + 8,  r[2]);
+    _mm_storeu_ps(out + 12, r[3]);
+}
+
+// AVX2 version - two rows of the result per register
+SIMD_TARGET_AVX2 static void MatrixMultiplyAVX2(const CMatrix4x4& m1, const CMatrix4x4& m2, CMatrix4x4& mOut)
+{
+    const float* a = &m1.e00;
+    const float* b = &m2.e00;
+    __m256 b0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(b));
+    __m256 b1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(b + 4));
+    __m256 b2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(b + 8));
+    __m256 b3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(b + 12));
+
+    __m256 r[2];
+    for (int i = 0; i < 2; ++i)
+    {
+        __m256 rows = _mm256_loadu_ps(a + i * 8);
+        __m256 t =            _mm256_mul_ps(_mm256_permute_ps(rows, _MM_SHUFFLE(0,0,0,0)), b0);
+        t = _mm256_add_ps(t,  _mm256_mul_ps(_mm256_permute_ps(rows, _MM_SHUFFLE(1,1,1,1)), b1));
+        t = _mm256_add_ps(t,  _mm256_mul_ps(_mm256_permute_ps(rows, _MM_SHUFFLE(2,2,2,2)), b2));
+        r[i] = _mm256_add_ps(t, _mm256_mul_ps(_mm256_permute_ps(rows, _MM_SHUFFLE(3,3,3,3)), b3));
+    }
+
+    float* out = &mOut.e00;
+    _mm256_storeu_ps(out,     r[0]);
+    _mm256_storeu_ps(out + 8, r[1]);
+}
+
+// AVX-512 version - the whole result in one register
+SIMD_TARGET_AVX512 static void MatrixMultiplyAVX512(const CMatrix4x4& m1, const CMatrix4x4& m2, CMatrix4x4& mOut)
+{
+    const float* b = &m2.e00;
+    __m512 b0 = _mm512_broadcast_f32x4(_mm_loadu_ps(b));
+    __m512 b1 = _mm512_broadcast_f32x4(_mm_loadu_ps(b + 4));
+    __m512 b2 = _mm512_broadcast_f32x4(_mm_loadu_ps(b + 8));
+    __m512 b3 = _mm512_broadcast_f32x4(_mm_loadu_ps(b + 12));
+
+    __m512 rows = _mm512_loadu_ps(&m1.e00);
+    __m512 t =            _mm512_mul_ps(_mm512_permute_ps(rows, _MM_SHUFFLE(0,0,0,0)), b0);
+    t = _mm512_add_ps(t,  _mm512_mul_ps(_mm512_permute_ps(rows, _MM_SHUFFLE(1,1,1,1)), b1));
+    t = _mm512_add_ps(t,  _mm512_mul_ps(_mm512_permute_ps(rows, _MM_SHUFFLE(2,2,2,2)), b2));
+    t = _mm512_add_ps(t,  _mm512_mul_ps(_mm512_permute_ps(rows, _MM_SHUFFLE(3,3,3,3)), b3));
+
+    _mm512_storeu_ps(&mOut.e00, t);
+}
+
+#endif
+
+// Matrix-matrix multiplication into the given output matrix, which may be one of the inputs.
+// Uses the SIMD version selected for this CPU (see SIMD.h)
+void MatrixMultiply(const CMatrix4x4& m1, const CMatrix4x4& m2, CMatrix4x4& mOut)
+{
+#if MATH_SIMD_X86
+    switch (GetSimdLevel())
+    {
+        case SimdLevel::AVX512: MatrixMultiplyAVX512(m1, m2, mOut); return;
+        case SimdLevel::AVX2:   MatrixMultiplyAVX2  (m1, m2, mOut); return;
+        case SimdLevel::SSE41:  MatrixMultiplySSE41 (m1, m2, mOut); return;
+        default: break;
+    }
+#endif
+    mOut = MatrixMultiplyScalar(m1, m2);
 }
 
 
@@ -116,31 +159,13 @@ CMatrix4x4 operator*(const CMatrix4x4& m1, const CMatrix4x4& m2)
 // The following functions create a new matrix holding a particular transformation
 // They can be used as temporaries in calculations, e.g.
 //     CMatrix4x4 m = MatrixScaling( 3.0f ) * MatrixTranslation( CVector3(10.0f, -10.0f, 20.0f) );
-
-// Return an identity matrix
-CMatrix4x4 MatrixIdentity()
-{
-    return CMatrix4x4{ 1, 0, 0, 0,
-                       0, 1, 0, 0,
-                       0, 0, 1, 0,
-                       0, 0, 0, 1 };
-}
-
-// Return a translation matrix of the given vector
-CMatrix4x4 MatrixTranslation(const CVector3& t)
-{
-    return CMatrix4x4  { 1,   0,   0,  0,
-                         0,   1,   0,  0,
-                         0,   0,   1,  0,
-                       t.x, t.y, t.z,  1 };
-}
-
+// MatrixIdentity, MatrixTranslation and MatrixScaling are constexpr and defined in the header
 
 // Return an X-axis rotation matrix of the given angle (in radians)
 CMatrix4x4 MatrixRotationX(float x)
 {
-    float sX = std::sin(x);
-    float cX = std::cos(x);
+    float sX, cX;
+    SinCos(x, sX, cX);
 
     return CMatrix4x4{ 1,   0,   0,  0,
                        0,  cX,  sX,  0,
@@ -151,8 +176,8 @@ CMatrix4x4 MatrixRotationX(float x)
 // Return a Y-axis rotation matrix of the given angle (in radians)
 CMatrix4x4 MatrixRotationY(float y)
 {
-    float sY = std::sin(y);
-    float cY = std::cos(y);
+    float sY, cY;
+    SinCos(y, sY, cY);
 
     return CMatrix4x4{ cY,   0, -sY,  0,
                         0,   1,   0,  0,
@@ -163,8 +188,8 @@ CMatrix4x4 MatrixRotationY(float y)
 // Return a Z-axis rotation matrix of the given angle (in radians)
 CMatrix4x4 MatrixRotationZ(float z)
 {
-    float sZ = std::sin(z);
-    float cZ = std::cos(z);
+    float sZ, cZ;
+    SinCos(z, sZ, cZ);
 
     return CMatrix4x4{ cZ,  sZ,  0,  0,
                       -sZ,  cZ,  0,  0,
@@ -173,24 +198,6 @@ CMatrix4x4 MatrixRotationZ(float z)
 }
 
 
-// Return a matrix that is a scaling in X,Y and Z of the values in the given vector
-CMatrix4x4 MatrixScaling(const CVector3& s)
-{
-    return CMatrix4x4{ s.x,   0,   0,  0,
-                       0,   s.y,   0,  0,
-                       0,     0, s.z,  0,
-                       0,     0,   0,  1 };
-}
-
-// Return a matrix that is a uniform scaling of the given amount
-CMatrix4x4 MatrixScaling(const float s)
-{
-    return CMatrix4x4{ s, 0, 0, 0,
-                       0, s, 0, 0,
-                       0, 0, s, 0,
-                       0, 0, 0, 1 };
-}
-
 
 // Return the inverse of given matrix assuming that it is an affine matrix
 // Advanced calulation needed to get the view matrix from the camera's positioning matrix
@@ -233,6 +240,143 @@ CMatrix4x4 InverseAffine(const CMatrix4x4& m)
 }
 
 
+// Reference plain C++ general inverse. The inverse is the adjugate matrix (the transposed matrix of
+// cofactors) divided by the determinant. The cofactors are built from the twelve 2x2 determinants of
+// the top two rows (s0-s5) and bottom two rows (c0-c5). Calculations are arranged exactly as in the
+// SIMD version so results match
+CMatrix4x4 InverseScalar(const CMatrix4x4& m)
+{
+    float s0 = m.e00*m.e11 - m.e10*m.e01;
+    float s1 = m.e00*m.e12 - m.e10*m.e02;
+    float s2 = m.e00*m.e13 - m.e10*m.e03;
+    float s3 = m.e01*m.e12 - m.e11*m.e02;
+    float s4 = m.e01*m.e13 - m.e11*m.e03;
+    float s5 = m.e02*m.e13 - m.e12*m.e03;
+
+    float c0 = m.e20*m.e31 - m.e30*m.e21;
+    float c1 = m.e20*m.e32 - m.e30*m.e22;
+    float c2 = m.e20*m.e33 - m.e30*m.e23;
+    float c3 = m.e21*m.e32 - m.e31*m.e22;
+    float c4 = m.e21*m.e33 - m.e31*m.e23;
+    float c5 = m.e22*m.e33 - m.e32*m.e23;
+
+    CMatrix4x4 adj;
+    adj.e00 =  (m.e11*c5 - m.e12*c4 + m.e13*c3);
+    adj.e01 = -(m.e01*c5 - m.e02*c4 + m.e03*c3);
+    adj.e02 =  (m.e31*s5 - m.e32*s4 + m.e33*s3);
+    adj.e03 = -(m.e21*s5 - m.e22*s4 + m.e23*s3);
+
+    adj.e10 = -(m.e10*c5 - m.e12*c2 + m.e13*c1);
+    adj.e11 =  (m.e00*c5 - m.e02*c2 + m.e03*c1);
+    adj.e12 = -(m.e30*s5 - m.e32*s2 + m.e33*s1);
+    adj.e13 =  (m.e20*s5 - m.e22*s2 + m.e23*s1);
+
+    adj.e20 =  (m.e10*c4 - m.e11*c2 + m.e13*c0);
+    adj.e21 = -(m.e00*c4 - m.e01*c2 + m.e03*c0);
+    adj.e22 =  (m.e30*s4 - m.e31*s2 + m.e33*s0);
+    adj.e23 = -(m.e20*s4 - m.e21*s2 + m.e23*s0);
+
+    adj.e30 = -(m.e10*c3 - m.e11*c1 + m.e12*c0);
+    adj.e31 =  (m.e00*c3 - m.e01*c1 + m.e02*c0);
+    adj.e32 = -(m.e30*s3 - m.e31*s1 + m.e32*s0);
+    adj.e33 =  (m.e20*s3 - m.e21*s1 + m.e22*s0);
+
+    // Determinant from the first row of the adjugate and first column of the matrix
+    float det = (adj.e00*m.e00 + adj.e01*m.e10) + (adj.e02*m.e20 + adj.e03*m.e30);
+    float invDet = 1.0f / det;
+
+    CMatrix4x4 mOut;
+    const float* a = &adj.e00;
+    float* out = &mOut.e00;
+    for (int i = 0; i < 16; ++i)  out[i] = a[i] * invDet;
+    return mOut;
+}
+
+#if MATH_SIMD_X86
+
+// SSE version - one row of the result per register. Each row of the adjugate combines three columns
+// of the matrix (with elements swapped in pairs) with 2x2 determinants, see the plain C++ version
+SIMD_TARGET_SSE41 static CMatrix4x4 InverseSSE41(const CMatrix4x4& m)
+{
+    const float* p = &m.e00;
+    __m128 r0 = _mm_loadu_ps(p);
+    __m128 r1 = _mm_loadu_ps(p + 4);
+    __m128 r2 = _mm_loadu_ps(p + 8);
+    __m128 r3 = _mm_loadu_ps(p + 12);
+
+    // 2x2 determinants of the top two rows: (s0, s1, s2, s3) and (s4, s5, s4, s5), and the same for the bottom two
+    __m128 sA = _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(r0, r0, _MM_SHUFFLE(1,0,0,0)), _mm_shuffle_ps(r1, r1, _MM_SHUFFLE(2,3,2,1))),
+                           _mm_mul_ps(_mm_shuffle_ps(r1, r1, _MM_SHUFFLE(1,0,0,0)), _mm_shuffle_ps(r0, r0, _MM_SHUFFLE(2,3,2,1))));
+    __m128 sB = _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(r0, r0, _MM_SHUFFLE(2,1,2,1)), _mm_shuffle_ps(r1, r1, _MM_SHUFFLE(3,3,3,3))),
+                           _mm_mul_ps(_mm_shuffle_ps(r1, r1, _MM_SHUFFLE(2,1,2,1)), _mm_shuffle_ps(r0, r0, _MM_SHUFFLE(3,3,3,3))));
+    __m128 cA = _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(r2, r2, _MM_SHUFFLE(1,0,0,0)), _mm_shuffle_ps(r3, r3, _MM_SHUFFLE(2,3,2,1))),
+                           _mm_mul_ps(_mm_shuffle_ps(r3, r3, _MM_SHUFFLE(1,0,0,0)), _mm_shuffle_ps(r2, r2, _MM_SHUFFLE(2,3,2,1))));
+    __m128 cB = _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(r2, r2, _MM_SHUFFLE(2,1,2,1)), _mm_shuffle_ps(r3, r3, _MM_SHUFFLE(3,3,3,3))),
+                           _mm_mul_ps(_mm_shuffle_ps(r3, r3, _MM_SHUFFLE(2,1,2,1)), _mm_shuffle_ps(r2, r2, _MM_SHUFFLE(3,3,3,3))));
+
+    // kN = (cN, cN, sN, sN)
+    __m128 k0 = _mm_shuffle_ps(cA, sA, _MM_SHUFFLE(0,0,0,0));
+    __m128 k1 = _mm_shuffle_ps(cA, sA, _MM_SHUFFLE(1,1,1,1));
+    __m128 k2 = _mm_shuffle_ps(cA, sA, _MM_SHUFFLE(2,2,2,2));
+    __m128 k3 = _mm_shuffle_ps(cA, sA, _MM_SHUFFLE(3,3,3,3));
+    __m128 k4 = _mm_shuffle_ps(cB, sB, _MM_SHUFFLE(0,0,0,0));
+    __m128 k5 = _mm_shuffle_ps(cB, sB, _MM_SHUFFLE(1,1,1,1));
+
+    // Columns of the matrix with elements swapped in pairs: vN = (e1N, e0N, e3N, e2N)
+    __m128 col0 = r0, col1 = r1, col2 = r2, col3 = r3;
+    _MM_TRANSPOSE4_PS(col0, col1, col2, col3);
+    __m128 v0 = _mm_shuffle_ps(col0, col0, _MM_SHUFFLE(2,3,0,1));
+    __m128 v1 = _mm_shuffle_ps(col1, col1, _MM_SHUFFLE(2,3,0,1));
+    __m128 v2 = _mm_shuffle_ps(col2, col2, _MM_SHUFFLE(2,3,0,1));
+    __m128 v3 = _mm_shuffle_ps(col3, col3, _MM_SHUFFLE(2,3,0,1));
+
+    __m128 signA = _mm_setr_ps(0.0f, -0.0f, 0.0f, -0.0f);
+    __m128 signB = _mm_setr_ps(-0.0f, 0.0f, -0.0f, 0.0f);
+    __m128 a0 = _mm_xor_ps(_mm_add_ps(_mm_sub_ps(_mm_mul_ps(v1, k5), _mm_mul_ps(v2, k4)), _mm_mul_ps(v3, k3)), signA);
+    __m128 a1 = _mm_xor_ps(_mm_add_ps(_mm_sub_ps(_mm_mul_ps(v0, k5), _mm_mul_ps(v2, k2)), _mm_mul_ps(v3, k1)), signB);
+    __m128 a2 = _mm_xor_ps(_mm_add_ps(_mm_sub_ps(_mm_mul_ps(v0, k4), _mm_mul_ps(v1, k2)), _mm_mul_ps(v3, k0)), signA);
+    __m128 a3 = _mm_xor_ps(_mm_add_ps(_mm_sub_ps(_mm_mul_ps(v0, k3), _mm_mul_ps(v1, k1)), _mm_mul_ps(v2, k0)), signB);
+
+    // Determinant as (p0 + p1) + (p2 + p3) in every element
+    __m128 prod = _mm_mul_ps(a0, col0);
+    __m128 det  = _mm_add_ps(prod, _mm_shuffle_ps(prod, prod, _MM_SHUFFLE(2,3,0,1)));
+    det = _mm_add_ps(det, _mm_shuffle_ps(det, det, _MM_SHUFFLE(1,0,3,2)));
+    __m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+
+    CMatrix4x4 mOut;
+    float* out = &mOut.e00;
+    _mm_storeu_ps(out,      _mm_mul_ps(a0, invDet));
+    _mm_storeu_ps(out + 4,  _mm_mul_ps(a1, invDet));
+    _mm_storeu_ps(out + 8,  _mm_mul_ps(a2, invDet));
+    _mm_storeu_ps(out + 12, _mm_mul_ps(a3, invDet));
+    return mOut;
+}
+
+#endif
+
+// Return the inverse of any invertible matrix using the SIMD version selected for this CPU.
+// The wider instruction sets don't help with a single 4x4 matrix
+CMatrix4x4 Inverse(const CMatrix4x4& m)
+{
+#if MATH_SIMD_X86
+    if (GetSimdLevel() >= SimdLevel::SSE41)  return InverseSSE41(m);
+#endif
+    return InverseScalar(m);
+}
+
+
+// Return the matrix to transform normals by when points are transformed by the given affine matrix.
+// The upper-left 3x3 of InverseAffine is transposed and the translation dropped
+CMatrix4x4 InverseTranspose(const CMatrix4x4& m)
+{
+    CMatrix4x4 inv = InverseAffine(m);
+    return CMatrix4x4{ inv.e00, inv.e10, inv.e20, 0.0f,
+                       inv.e01, inv.e11, inv.e21, 0.0f,
+                       inv.e02, inv.e12, inv.e22, 0.0f,
+                          0.0f,    0.0f,    0.0f, 1.0f };
+}
+
+
 // Make this matrix an affine 3D transformation matrix to face from current position to given target (in the Z direction)
 // Will retain the matrix's current scaling
 void CMatrix4x4::FaceTarget(const CVector3& target)
@@ -255,12 +399,12 @@ void CMatrix4x4::FaceTarget(const CVector3& target)
 
 
 // Return the rotation stored in this matrix as Euler angles
-CVector3 CMatrix4x4::GetEulerAngles()
+CVector3 CMatrix4x4::GetEulerAngles() const
 {
 	// Calculate matrix scaling
-	float scaleX = sqrt( e00*e00 + e01*e01 + e02*e02 );
-	float scaleY = sqrt( e10*e10 + e11*e11 + e12*e12 );
-	float scaleZ = sqrt( e20*e20 + e21*e21 + e22*e22 );
+	float scaleX = std::sqrt( e00*e00 + e01*e01 + e02*e02 );
+	float scaleY = std::sqrt( e10*e10 + e11*e11 + e12*e12 );
+	float scaleZ = std::sqrt( e20*e20 + e21*e21 + e22*e22 );
 
 	// Calculate inverse scaling to extract rotational values only
 	float invScaleX = 1.0f / scaleX;
@@ -270,10 +414,10 @@ CVector3 CMatrix4x4::GetEulerAngles()
 	float sX, cX, sY, cY, sZ, cZ;
 
     sX = -e21 * invScaleZ;
-    cX = sqrt( 1.0f - sX*sX );
+    cX = std::sqrt( 1.0f - sX*sX );
 
     // If no gimbal lock...
-    if (abs(cX) > 0.001f)
+    if (std::abs(cX) > 0.001f)
     {
 	    float invCX = 1.0f / cX;
 	    sZ = e01 * invCX * invScaleX;
@@ -290,6 +434,19 @@ CVector3 CMatrix4x4::GetEulerAngles()
 	    cY =  e00 * invScaleX;
     }
 
-	return { atan2(sX, cX), atan2(sY, cY), atan2(sZ, cZ) };
+	return { std::atan2(sX, cX), std::atan2(sY, cY), std::atan2(sZ, cZ) };
 }
 
+
+
+/*-----------------------------------------------------------------------------------------
+    Compile-time checks
+-----------------------------------------------------------------------------------------*/
+// These fail to compile if the constexpr functions in the header cannot be evaluated by the compiler
+
+static constexpr CMatrix4x4 CHECK_SCALE_TRANSLATE = MatrixMultiplyScalar(MatrixScaling(CVector3{ 2, 3, 4 }), MatrixTranslation(CVector3{ 5, 6, 7 }));
+static_assert(MatrixIdentity().e00 == 1 && MatrixIdentity().e01 == 0 && MatrixIdentity().e33 == 1, "MatrixIdentity is not constexpr");
+static_assert(MatrixScaling(2.0f).e11 == 2 && MatrixScaling(2.0f).e33 == 1, "MatrixScaling is not constexpr");
+static_assert(CHECK_SCALE_TRANSLATE.e00 == 2 && CHECK_SCALE_TRANSLATE.e11 == 3 && CHECK_SCALE_TRANSLATE.e22 == 4 &&
+              CHECK_SCALE_TRANSLATE.e30 == 5 && CHECK_SCALE_TRANSLATE.e31 == 6 && CHECK_SCALE_TRANSLATE.e32 == 7,
+              "MatrixMultiplyScalar/MatrixTranslation are not constexpr");
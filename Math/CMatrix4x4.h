@@ -1,7 +1,7 @@
 //--------------------------------------------------------------------------------------
 // Matrix4x4 class (cut down version) to hold matrices for 3D
 //--------------------------------------------------------------------------------------
-// Code in .cpp file
+// Code in .cpp file, except for the constexpr functions which are here so they can be used at compile time
 
 #ifndef _CMATRIX4X4_H_DEFINED_
 #define _CMATRIX4X4_H_DEFINED_
@@ -39,7 +39,7 @@ public:
     CVector3 GetYAxis() const { return GetRow(1); }
     CVector3 GetZAxis() const { return GetRow(2); }
     CVector3 GetPosition() const  { return GetRow(3); }
-    CVector3 GetEulerAngles();
+    CVector3 GetEulerAngles() const;
     CVector3 GetScale() const  { return { Length(GetXAxis()), Length(GetYAxis()) , Length(GetZAxis()) }; }
 
     // Post-multiply this matrix by the given one
@@ -61,6 +61,40 @@ public:
 CMatrix4x4 operator*(const CMatrix4x4& m1, const CMatrix4x4& m2);
 
 
+/*-----------------------------------------------------------------------------------------
+  Matrix multiplication
+-----------------------------------------------------------------------------------------*/
+
+// Matrix-matrix multiplication into the given output matrix, which may be one of the inputs.
+// Uses the best SIMD version for this CPU (see SIMD.h). The operators above use this function
+void MatrixMultiply(const CMatrix4x4& m1, const CMatrix4x4& m2, CMatrix4x4& mOut);
+
+// Reference plain C++ matrix-matrix multiplication. The SIMD versions give bit-identical results.
+// Also constexpr, so use this rather than operator* to combine matrices at compile time
+constexpr CMatrix4x4 MatrixMultiplyScalar(const CMatrix4x4& m1, const CMatrix4x4& m2)
+{
+    return CMatrix4x4{ m1.e00*m2.e00 + m1.e01*m2.e10 + m1.e02*m2.e20 + m1.e03*m2.e30,
+                       m1.e00*m2.e01 + m1.e01*m2.e11 + m1.e02*m2.e21 + m1.e03*m2.e31,
+                       m1.e00*m2.e02 + m1.e01*m2.e12 + m1.e02*m2.e22 + m1.e03*m2.e32,
+                       m1.e00*m2.e03 + m1.e01*m2.e13 + m1.e02*m2.e23 + m1.e03*m2.e33,
+
+                       m1.e10*m2.e00 + m1.e11*m2.e10 + m1.e12*m2.e20 + m1.e13*m2.e30,
+                       m1.e10*m2.e01 + m1.e11*m2.e11 + m1.e12*m2.e21 + m1.e13*m2.e31,
+                       m1.e10*m2.e02 + m1.e11*m2.e12 + m1.e12*m2.e22 + m1.e13*m2.e32,
+                       m1.e10*m2.e03 + m1.e11*m2.e13 + m1.e12*m2.e23 + m1.e13*m2.e33,
+
+                       m1.e20*m2.e00 + m1.e21*m2.e10 + m1.e22*m2.e20 + m1.e23*m2.e30,
+                       m1.e20*m2.e01 + m1.e21*m2.e11 + m1.e22*m2.e21 + m1.e23*m2.e31,
+                       m1.e20*m2.e02 + m1.e21*m2.e12 + m1.e22*m2.e22 + m1.e23*m2.e32,
+                       m1.e20*m2.e03 + m1.e21*m2.e13 + m1.e22*m2.e23 + m1.e23*m2.e33,
+
+                       m1.e30*m2.e00 + m1.e31*m2.e10 + m1.e32*m2.e20 + m1.e33*m2.e30,
+                       m1.e30*m2.e01 + m1.e31*m2.e11 + m1.e32*m2.e21 + m1.e33*m2.e31,
+                       m1.e30*m2.e02 + m1.e31*m2.e12 + m1.e32*m2.e22 + m1.e33*m2.e32,
+                       m1.e30*m2.e03 + m1.e31*m2.e13 + m1.e32*m2.e23 + m1.e33*m2.e33 };
+}
+
+
 /*-----------------------------------------------------------------------------------------
   Non-member functions
 -----------------------------------------------------------------------------------------*/
@@ -70,10 +104,22 @@ CMatrix4x4 operator*(const CMatrix4x4& m1, const CMatrix4x4& m2);
 //     CMatrix4x4 m = MatrixScaling( 3.0f ) * MatrixTranslation( CVector3(10.0f, -10.0f, 20.0f) );
 
 // Return an identity matrix
-CMatrix4x4 MatrixIdentity();
+constexpr CMatrix4x4 MatrixIdentity()
+{
+    return CMatrix4x4{ 1, 0, 0, 0,
+                       0, 1, 0, 0,
+                       0, 0, 1, 0,
+                       0, 0, 0, 1 };
+}
 
 // Return a translation matrix of the given vector
-CMatrix4x4 MatrixTranslation(const CVector3& t);
+constexpr CMatrix4x4 MatrixTranslation(const CVector3& t)
+{
+    return CMatrix4x4  { 1,   0,   0,  0,
+                         0,   1,   0,  0,
+                         0,   0,   1,  0,
+                       t.x, t.y, t.z,  1 };
+}
 
 
 // Return an X-axis rotation matrix of the given angle (in radians)
@@ -87,10 +133,22 @@ CMatrix4x4 MatrixRotationZ(float z);
 
 
 // Return a matrix that is a scaling in X,Y and Z of the values in the given vector
-CMatrix4x4 MatrixScaling(const CVector3& s);
+constexpr CMatrix4x4 MatrixScaling(const CVector3& s)
+{
+    return CMatrix4x4{ s.x,   0,   0,  0,
+                       0,   s.y,   0,  0,
+                       0,     0, s.z,  0,
+                       0,     0,   0,  1 };
+}
 
 // Return a matrix that is a uniform scaling of the given amount
-CMatrix4x4 MatrixScaling(const float s);
+constexpr CMatrix4x4 MatrixScaling(const float s)
+{
+    return CMatrix4x4{ s, 0, 0, 0,
+                       0, s, 0, 0,
+                       0, 0, s, 0,
+                       0, 0, 0, 1 };
+}
 
 
 
@@ -98,5 +156,18 @@ CMatrix4x4 MatrixScaling(const float s);
 // Advanced calulation needed to get the view matrix from the camera's positioning matrix
 CMatrix4x4 InverseAffine(const CMatrix4x4& m);
 
+// Return the inverse of any invertible matrix, including projection matrices (e.g. to get from
+// screen space back to world space). Uses the best SIMD version for this CPU (see SIMD.h).
+// Prefer InverseAffine for affine matrices, it is cheaper. A singular matrix gives infinities/NaNs
+CMatrix4x4 Inverse(const CMatrix4x4& m);
+
+// Reference plain C++ general inverse. The SIMD versions give bit-identical results
+CMatrix4x4 InverseScalar(const CMatrix4x4& m);
+
+// Return the matrix to transform normals by when points are transformed by the given affine matrix.
+// This is the transpose of the inverse of the upper-left 3x3 part of the matrix, with no translation.
+// Only needed if the matrix has non-uniform scaling, otherwise the matrix itself will do
+CMatrix4x4 InverseTranspose(const CMatrix4x4& m);
+
 
 #endif // _CMATRIX4X4_H_DEFINED_
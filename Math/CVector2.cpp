@@ -6,63 +6,10 @@
 #include "CVector2.h"
 
 
-/*-----------------------------------------------------------------------------------------
-    Operators
------------------------------------------------------------------------------------------*/
-
-// Addition of another vector to this one, e.g. Position += Velocity
-CVector2& CVector2::operator+= (const CVector2& v)
-{
-    x += v.x;
-    y += v.y;
-    return *this;
-}
-
-// Subtraction of another vector from this one, e.g. Velocity -= Gravity
-CVector2& CVector2::operator-= (const CVector2& v)
-{
-    x -= v.x;
-    y -= v.y;
-    return *this;
-}
-
-// Negate this vector (e.g. Velocity = -Velocity)
-CVector2& CVector2::operator- ()
-{
-    x = -x;
-    y = -y;
-    return *this;
-}
-
-// Plus sign in front of vector - called unary positive and usually does nothing. Included for completeness (e.g. Velocity = +Velocity)
-CVector2& CVector2::operator+ ()
-{
-    return *this;
-}
-
-
-// Vector-vector addition
-CVector2 operator+ (const CVector2& v, const CVector2& w)
-{
-    return CVector2{ v.x + w.x, v.y + w.y };
-}
-
-// Vector-vector subtraction
-CVector2 operator- (const CVector2& v, const CVector2& w)
-{
-    return CVector2{ v.x - w.x, v.y - w.y };
-}
-
-
 /*-----------------------------------------------------------------------------------------
     Non-member functions
 -----------------------------------------------------------------------------------------*/
-
-// Dot product of two given vectors (order not important) - non-member version
-float Dot(const CVector2& v1, const CVector2& v2)
-{
-    return v1.x * v2.x + v1.y * v2.y;
-}
+// The constructors, operators and Dot are constexpr and defined in the header
 
 // Return unit length vector in the same direction as given one
 CVector2 Normalise(const CVector2& v)
@@ -80,3 +27,14 @@ CVector2 Normalise(const CVector2& v)
         return CVector2{ v.x * invLength, v.y * invLength };
     }
 }
+
+
+/*-----------------------------------------------------------------------------------------
+    Compile-time checks
+-----------------------------------------------------------------------------------------*/
+// These fail to compile if the constexpr functions in the header cannot be evaluated by the compiler
+
+static_assert((CVector2{ 1, 2 } + CVector2{ 3, 4 }).y == 6, "CVector2 addition is not constexpr");
+static_assert((CVector2{ 1, 2 } - CVector2{ 3, 4 }).x == -2, "CVector2 subtraction is not constexpr");
+static_assert((CVector2{ 1, 2 } -= CVector2{ 1, 1 }).y == 1, "CVector2 compound operators are not constexpr");
+static_assert(Dot(CVector2{ 1, 2 }, CVector2{ 3, 4 }) == 11, "CVector2 dot product is not constexpr");
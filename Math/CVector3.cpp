@@ -5,91 +5,10 @@
 #include "CVector3.h"
 
 
-/*-----------------------------------------------------------------------------------------
-    Operators
------------------------------------------------------------------------------------------*/
-
-// Addition of another vector to this one, e.g. Position += Velocity
-CVector3& CVector3::operator+= (const CVector3& v)
-{
-    x += v.x;
-    y += v.y;
-    z += v.z;
-    return *this;
-}
-
-// Subtraction of another vector from this one, e.g. Velocity -= Gravity
-CVector3& CVector3::operator-= (const CVector3& v)
-{
-    x -= v.x;
-    y -= v.y;
-    z -= v.z;
-    return *this;
-}
-
-// Negate this vector (e.g. Velocity = -Velocity)
-CVector3& CVector3::operator- ()
-{
-    x = -x;
-    y = -y;
-    z = -z;
-    return *this;
-}
-
-// Plus sign in front of vector - called unary positive and usually does nothing. Included for completeness (e.g. Velocity = +Velocity)
-CVector3& CVector3::operator+ ()
-{
-    return *this;
-}
-
-
-// Multiply vector by scalar (scales vector);
-CVector3& CVector3::operator*= (const float s)
-{
-    x *= s;
-    y *= s;
-    z *= s;
-    return *this;
-}
-
-
-// Vector-vector addition
-CVector3 operator+ (const CVector3& v, const CVector3& w)
-{
-    return CVector3{ v.x + w.x, v.y + w.y, v.z + w.z };
-}
-
-// Vector-vector subtraction
-CVector3 operator- (const CVector3& v, const CVector3& w)
-{
-    return CVector3{ v.x - w.x, v.y - w.y, v.z - w.z };
-}
-
-// Vector-scalar multiplication
-CVector3 operator* (const CVector3& v, float s)
-{
-    return CVector3{ v.x * s, v.y * s, v.z * s };
-}
-CVector3 operator* (float s, const CVector3& v)
-{
-    return CVector3{ v.x * s, v.y * s, v.z * s };
-}
-
 /*-----------------------------------------------------------------------------------------
     Non-member functions
 -----------------------------------------------------------------------------------------*/
-
-// Dot product of two given vectors (order not important) - non-member version
-float Dot(const CVector3& v1, const CVector3& v2)
-{
-    return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z;
-}
-
-// Cross product of two given vectors (order is important) - non-member version
-CVector3 Cross(const CVector3& v1, const CVector3& v2)
-{
-    return CVector3{ v1.y * v2.z - v1.z * v2.y, v1.z * v2.x - v1.x * v2.z, v1.x * v2.y - v1.y * v2.x };
-}
+// The constructors, operators, Dot and Cross are constexpr and defined in the header
 
 // Return unit length vector in the same direction as given one
 CVector3 Normalise(const CVector3& v)
@@ -112,5 +31,19 @@ CVector3 Normalise(const CVector3& v)
 // Returns length of a vector
 float Length(const CVector3& v)
 {
-    return sqrt(Dot(v, v));
+    return std::sqrt(Dot(v, v));
 }
+
+
+/*-----------------------------------------------------------------------------------------
+    Compile-time checks
+-----------------------------------------------------------------------------------------*/
+// These fail to compile if the constexpr functions in the header cannot be evaluated by the compiler
+
+static_assert(CVector3{ 1, 2, 3 }.x == 1 && CVector3{ 1, 2, 3 }.z == 3, "CVector3 construction is not constexpr");
+static_assert((CVector3{ 1, 2, 3 } + CVector3{ 4, 5, 6 }).y == 7, "CVector3 addition is not constexpr");
+static_assert((CVector3{ 1, 2, 3 } - CVector3{ 4, 5, 6 }).z == -3, "CVector3 subtraction is not constexpr");
+static_assert((2.0f * CVector3{ 1, 2, 3 }).z == 6 && (CVector3{ 1, 2, 3 } * 0.5f).x == 0.5f, "CVector3 scaling is not constexpr");
+static_assert((CVector3{ 1, 2, 3 } += CVector3{ 1, 1, 1 }).x == 2, "CVector3 compound operators are not constexpr");
+static_assert(Dot(CVector3{ 1, 2, 3 }, CVector3{ 4, 5, 6 }) == 32, "CVector3 dot product is not constexpr");
+static_assert(Cross(CVector3{ 1, 0, 0 }, CVector3{ 0, 1, 0 }).z == 1, "CVector3 cross product is not constexpr");
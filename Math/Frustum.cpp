@@ -0,0 +1,270 @@
+//--------------------------------------------------------------------------------------
+// Frustum class - the six planes of a view volume, for testing if objects are visible
+//--------------------------------------------------------------------------------------
+
+#include "Frustum.h"
+#include "SIMD.h"
+#include <cmath>
+#include <cstring>
+
+
+/*-----------------------------------------------------------------------------------------
+    Constructors
+-----------------------------------------------------------------------------------------*/
+
+// Construct from a view-projection matrix. A point p is projected to (x, y, z, w) = p * m, which is
+// visible if -w <= x <= w, -w <= y <= w and 0 <= z <= w. Each column of the matrix gives one of
+// x, y, z or w as a plane equation, so each of these conditions is a sum or difference of columns
+Frustum::Frustum(const CMatrix4x4& m)
+{
+    //                          x          y          z          d
+    const float planes[NumPlanes][4] =
+    {
+        { m.e03 + m.e00, m.e13 + m.e10, m.e23 + m.e20, m.e33 + m.e30 }, // Left:   w + x >= 0
+        { m.e03 - m.e00, m.e13 - m.e10, m.e23 - m.e20, m.e33 - m.e30 }, // Right:  w - x >= 0
+        { m.e03 + m.e01, m.e13 + m.e11, m.e23 + m.e21, m.e33 + m.e31 }, // Bottom: w + y >= 0
+        { m.e03 - m.e01, m.e13 - m.e11, m.e23 - m.e21, m.e33 - m.e31 }, // Top:    w - y >= 0
+        { m.e02,         m.e12,         m.e22,         m.e32         }, // Near:   z >= 0
+        { m.e03 - m.e02, m.e13 - m.e12, m.e23 - m.e22, m.e33 - m.e32 }, // Far:    w - z >= 0
+    };
+
+    // Normalise so plane equations give distances, which is needed to test against sphere radii
+    for (int i = 0; i < NumPlanes; ++i)
+    {
+        float invLength = 1.0f / std::sqrt(planes[i][0] * planes[i][0] + planes[i][1] * planes[i][1] + planes[i][2] * planes[i][2]);
+        normalX[i] = planes[i][0] * invLength;
+        normalY[i] = planes[i][1] * invLength;
+        normalZ[i] = planes[i][2] * invLength;
+        d[i]       = planes[i][3] * invLength;
+    }
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Member functions
+-----------------------------------------------------------------------------------------*/
+
+// A volume is outside if it is completely outside any one plane, and inside if it is completely
+// inside every plane. A sphere is tested using its radius, a box using the half-size of the box
+// measured along the plane normal (its "radius" in that direction). All versions below do the
+// same calculations in the same order so they give the same results
+
+CullResult Frustum::TestSphere(const CVector3& centre, float radius) const
+{
+    bool inside = true;
+    for (int i = 0; i < NumPlanes; ++i)
+    {
+        float distance = centre.x * normalX[i] + centre.y * normalY[i] + centre.z * normalZ[i] + d[i];
+        if (distance < -radius)  return CullResult::Outside;
+        inside = inside && distance >= radius;
+    }
+    return inside ? CullResult::Inside : CullResult::Intersecting;
+}
+
+CullResult Frustum::TestAABB(const CVector3& minPoint, const CVector3& maxPoint) const
+{
+    float centreX = (minPoint.x + maxPoint.x) * 0.5f, extentX = (maxPoint.x - minPoint.x) * 0.5f;
+    float centreY = (minPoint.y + maxPoint.y) * 0.5f, extentY = (maxPoint.y - minPoint.y) * 0.5f;
+    float centreZ = (minPoint.z + maxPoint.z) * 0.5f, extentZ = (maxPoint.z - minPoint.z) * 0.5f;
+
+    bool inside = true;
+    for (int i = 0; i < NumPlanes; ++i)
+    {
+        float distance = centreX * normalX[i] + centreY * normalY[i] + centreZ * normalZ[i] + d[i];
+        float radius   = extentX * std::abs(normalX[i]) + extentY * std::abs(normalY[i]) + extentZ * std::abs(normalZ[i]);
+        if (distance < -radius)  return CullResult::Outside;
+        inside = inside && distance >= radius;
+    }
+    return inside ? CullResult::Inside : CullResult::Intersecting;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Array tests
+-----------------------------------------------------------------------------------------*/
+
+static void TestSpheresScalar(const Frustum& frustum, const ConstVector3Arrays& centres, const float* radii, CullResult* results, int start, int count)
+{
+    for (int i = start; i < count; ++i)
+    {
+        results[i] = frustum.TestSphere({ centres.x[i], centres.y[i], centres.z[i] }, radii[i]);
+    }
+}
+
+static void TestAABBsScalar(const Frustum& frustum, const ConstVector3Arrays& minPoints, const ConstVector3Arrays& maxPoints, CullResult* results, int start, int count)
+{
+    for (int i = start; i < count; ++i)
+    {
+        results[i] = frustum.TestAABB({ minPoints.x[i], minPoints.y[i], minPoints.z[i] }, { maxPoints.x[i], maxPoints.y[i], maxPoints.z[i] });
+    }
+}
+
+
+#if MATH_SIMD_X86
+
+// The SIMD versions test every plane for a group of volumes, keeping a mask of volumes that are outside
+// any plane and a mask of those inside all planes. These are combined into CullResult values:
+// 0 if outside, otherwise 1 + (1 if inside). The values are then packed down to one byte each
+
+//*********************************
+// SSE4.1 - 4 volumes at a time
+
+SIMD_TARGET_SSE41 static inline void StoreResultsSSE41(__m128 outside, __m128 inside, CullResult* results)
+{
+    __m128i one    = _mm_set1_epi32(1);
+    __m128i value  = _mm_add_epi32(one, _mm_and_si128(_mm_castps_si128(inside), one));
+    value = _mm_andnot_si128(_mm_castps_si128(outside), value);
+    value = _mm_packus_epi16(_mm_packs_epi32(value, value), value);
+    int packed = _mm_cvtsi128_si32(value);
+    std::memcpy(results, &packed, 4);
+}
+
+SIMD_TARGET_SSE41 static inline void TestPlanesSSE41(const Frustum& frustum, __m128 x, __m128 y, __m128 z, __m128 rx, __m128 ry, __m128 rz,
+                                                     bool isBox, CullResult* results)
+{
+    __m128 outside = _mm_setzero_ps();
+    __m128 inside  = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    for (int i = 0; i < Frustum::NumPlanes; ++i)
+    {
+        __m128 nx = _mm_set1_ps(frustum.normalX[i]);
+        __m128 ny = _mm_set1_ps(frustum.normalY[i]);
+        __m128 nz = _mm_set1_ps(frustum.normalZ[i]);
+        __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, nx), _mm_mul_ps(y, ny)), _mm_mul_ps(z, nz)), _mm_set1_ps(frustum.d[i]));
+
+        // For spheres rx holds the radius, for boxes rx, ry, rz hold the extents
+        __m128 radius = rx;
+        if (isBox)
+        {
+            radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(rx, _mm_set1_ps(std::abs(frustum.normalX[i]))),
+                                           _mm_mul_ps(ry, _mm_set1_ps(std::abs(frustum.normalY[i])))),
+                                           _mm_mul_ps(rz, _mm_set1_ps(std::abs(frustum.normalZ[i]))));
+        }
+        outside = _mm_or_ps (outside, _mm_cmplt_ps(distance, _mm_xor_ps(radius, _mm_set1_ps(-0.0f))));
+        inside  = _mm_and_ps(inside,  _mm_cmpge_ps(distance, radius));
+    }
+    StoreResultsSSE41(outside, inside, results);
+}
+
+SIMD_TARGET_SSE41 static int TestSpheresSSE41(const Frustum& frustum, const ConstVector3Arrays& centres, const float* radii, CullResult* results, int count)
+{
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 r = _mm_loadu_ps(radii + i);
+        TestPlanesSSE41(frustum, _mm_loadu_ps(centres.x + i), _mm_loadu_ps(centres.y + i), _mm_loadu_ps(centres.z + i), r, r, r, false, results + i);
+    }
+    return i;
+}
+
+SIMD_TARGET_SSE41 static int TestAABBsSSE41(const Frustum& frustum, const ConstVector3Arrays& minPoints, const ConstVector3Arrays& maxPoints, CullResult* results, int count)
+{
+    __m128 half = _mm_set1_ps(0.5f);
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 minX = _mm_loadu_ps(minPoints.x + i), maxX = _mm_loadu_ps(maxPoints.x + i);
+        __m128 minY = _mm_loadu_ps(minPoints.y + i), maxY = _mm_loadu_ps(maxPoints.y + i);
+        __m128 minZ = _mm_loadu_ps(minPoints.z + i), maxZ = _mm_loadu_ps(maxPoints.z + i);
+        TestPlanesSSE41(frustum, _mm_mul_ps(_mm_add_ps(minX, maxX), half), _mm_mul_ps(_mm_add_ps(minY, maxY), half), _mm_mul_ps(_mm_add_ps(minZ, maxZ), half),
+                                 _mm_mul_ps(_mm_sub_ps(maxX, minX), half), _mm_mul_ps(_mm_sub_ps(maxY, minY), half), _mm_mul_ps(_mm_sub_ps(maxZ, minZ), half),
+                                 true, results + i);
+    }
+    return i;
+}
+
+
+//*********************************
+// AVX2 - 8 volumes at a time. Used for AVX-512 too, the plane loop is already short
+
+SIMD_TARGET_AVX2 static inline void TestPlanesAVX2(const Frustum& frustum, __m256 x, __m256 y, __m256 z, __m256 rx, __m256 ry, __m256 rz,
+                                                   bool isBox, CullResult* results)
+{
+    __m256 outside = _mm256_setzero_ps();
+    __m256 inside  = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    for (int i = 0; i < Frustum::NumPlanes; ++i)
+    {
+        __m256 nx = _mm256_set1_ps(frustum.normalX[i]);
+        __m256 ny = _mm256_set1_ps(frustum.normalY[i]);
+        __m256 nz = _mm256_set1_ps(frustum.normalZ[i]);
+        __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, nx), _mm256_mul_ps(y, ny)), _mm256_mul_ps(z, nz)), _mm256_set1_ps(frustum.d[i]));
+
+        __m256 radius = rx;
+        if (isBox)
+        {
+            radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(rx, _mm256_set1_ps(std::abs(frustum.normalX[i]))),
+                                                 _mm256_mul_ps(ry, _mm256_set1_ps(std::abs(frustum.normalY[i])))),
+                                                 _mm256_mul_ps(rz, _mm256_set1_ps(std::abs(frustum.normalZ[i]))));
+        }
+        outside = _mm256_or_ps (outside, _mm256_cmp_ps(distance, _mm256_xor_ps(radius, _mm256_set1_ps(-0.0f)), _CMP_LT_OQ));
+        inside  = _mm256_and_ps(inside,  _mm256_cmp_ps(distance, radius, _CMP_GE_OQ));
+    }
+
+    __m256i one   = _mm256_set1_epi32(1);
+    __m256i value = _mm256_add_epi32(one, _mm256_and_si256(_mm256_castps_si256(inside), one));
+    value = _mm256_andnot_si256(_mm256_castps_si256(outside), value);
+    __m128i packed = _mm_packs_epi32(_mm256_castsi256_si128(value), _mm256_extracti128_si256(value, 1));
+    packed = _mm_packus_epi16(packed, packed);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(results), packed);
+}
+
+SIMD_TARGET_AVX2 static int TestSpheresAVX2(const Frustum& frustum, const ConstVector3Arrays& centres, const float* radii, CullResult* results, int count)
+{
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 r = _mm256_loadu_ps(radii + i);
+        TestPlanesAVX2(frustum, _mm256_loadu_ps(centres.x + i), _mm256_loadu_ps(centres.y + i), _mm256_loadu_ps(centres.z + i), r, r, r, false, results + i);
+    }
+    return i;
+}
+
+SIMD_TARGET_AVX2 static int TestAABBsAVX2(const Frustum& frustum, const ConstVector3Arrays& minPoints, const ConstVector3Arrays& maxPoints, CullResult* results, int count)
+{
+    __m256 half = _mm256_set1_ps(0.5f);
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 minX = _mm256_loadu_ps(minPoints.x + i), maxX = _mm256_loadu_ps(maxPoints.x + i);
+        __m256 minY = _mm256_loadu_ps(minPoints.y + i), maxY = _mm256_loadu_ps(maxPoints.y + i);
+        __m256 minZ = _mm256_loadu_ps(minPoints.z + i), maxZ = _mm256_loadu_ps(maxPoints.z + i);
+        TestPlanesAVX2(frustum, _mm256_mul_ps(_mm256_add_ps(minX, maxX), half), _mm256_mul_ps(_mm256_add_ps(minY, maxY), half), _mm256_mul_ps(_mm256_add_ps(minZ, maxZ), half),
+                                _mm256_mul_ps(_mm256_sub_ps(maxX, minX), half), _mm256_mul_ps(_mm256_sub_ps(maxY, minY), half), _mm256_mul_ps(_mm256_sub_ps(maxZ, minZ), half),
+                                true, results + i);
+    }
+    return i;
+}
+
+#endif
+
+
+// Select the SIMD version for this CPU to process as much of the array as it can,
+// then finish off any remaining volumes with the plain C++ version
+void TestSpheres(const Frustum& frustum, const ConstVector3Arrays& centres, const float* radii, CullResult* results, int count)
+{
+    int done = 0;
+#if MATH_SIMD_X86
+    switch (GetSimdLevel())
+    {
+        case SimdLevel::AVX512:
+        case SimdLevel::AVX2:   done = TestSpheresAVX2 (frustum, centres, radii, results, count); break;
+        case SimdLevel::SSE41:  done = TestSpheresSSE41(frustum, centres, radii, results, count); break;
+        default: break;
+    }
+#endif
+    TestSpheresScalar(frustum, centres, radii, results, done, count);
+}
+
+void TestAABBs(const Frustum& frustum, const ConstVector3Arrays& minPoints, const ConstVector3Arrays& maxPoints, CullResult* results, int count)
+{
+    int done = 0;
+#if MATH_SIMD_X86
+    switch (GetSimdLevel())
+    {
+        case SimdLevel::AVX512:
+        case SimdLevel::AVX2:   done = TestAABBsAVX2 (frustum, minPoints, maxPoints, results, count); break;
+        case SimdLevel::SSE41:  done = TestAABBsSSE41(frustum, minPoints, maxPoints, results, count); break;
+        default: break;
+    }
+#endif
+    TestAABBsScalar(frustum, minPoints, maxPoints, results, done, count);
+}
@@ -0,0 +1,87 @@
+//--------------------------------------------------------------------------------------
+// Frustum class - the six planes of a view volume, for testing if objects are visible
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+//
+// Build a frustum from any view-projection matrix (e.g. Camera::ViewProjectionMatrix(), or a
+// light's view matrix times its projection matrix) then test bounding spheres or axis-aligned
+// bounding boxes (AABBs) against it. The volumes must be in the space the matrix transforms
+// from, usually world space.
+//
+// Tests can be made one at a time, or on whole arrays of volumes at a time, which uses SIMD
+// to test 4 or 8 volumes at once depending on the CPU (see SIMD.h). Both give identical results.
+// Box tests are conservative: a box just outside a corner of the frustum may be reported as
+// intersecting, but a visible box is never reported as outside.
+
+#ifndef _FRUSTUM_H_DEFINED_
+#define _FRUSTUM_H_DEFINED_
+
+#include "CVector3.h"
+#include "CMatrix4x4.h"
+#include "MathBatch.h"
+#include <cstdint>
+
+
+// Result of testing a volume against a frustum
+enum class CullResult : uint8_t
+{
+    Outside      = 0, // Completely outside, can be culled
+    Intersecting = 1, // Partly inside
+    Inside       = 2, // Completely inside
+};
+
+
+class Frustum
+{
+// Concrete class - public access
+public:
+    // The planes that bound the frustum, inside is the side each normal faces
+    enum Planes
+    {
+        Left, Right, Bottom, Top, Near, Far,
+        NumPlanes
+    };
+
+    // Plane normals and distances, held as separate arrays for the SIMD code. A point p is on
+    // the inside of plane i if p.x * normalX[i] + p.y * normalY[i] + p.z * normalZ[i] + d[i] >= 0.
+    // Normals are unit length so this value is also the distance from the plane
+    float normalX[NumPlanes];
+    float normalY[NumPlanes];
+    float normalZ[NumPlanes];
+    float d[NumPlanes];
+
+    /*-----------------------------------------------------------------------------------------
+        Constructors
+    -----------------------------------------------------------------------------------------*/
+
+    // Default constructor - leaves values uninitialised (for performance)
+    Frustum() {}
+
+    // Construct from a view-projection matrix, using the DirectX convention that visible points
+    // have 0 <= z <= w after projection. Works with perspective and orthographic projections
+    explicit Frustum(const CMatrix4x4& viewProjectionMatrix);
+
+
+    /*-----------------------------------------------------------------------------------------
+        Member functions
+    -----------------------------------------------------------------------------------------*/
+
+    // Test a single sphere or box against the frustum
+    CullResult TestSphere(const CVector3& centre, float radius) const;
+    CullResult TestAABB(const CVector3& minPoint, const CVector3& maxPoint) const;
+};
+
+
+/*-----------------------------------------------------------------------------------------
+    Array tests
+-----------------------------------------------------------------------------------------*/
+// Test count volumes against the frustum, writing one CullResult per volume
+
+// Spheres given by arrays of centre x, y and z values and an array of radii
+void TestSpheres(const Frustum& frustum, const ConstVector3Arrays& centres, const float* radii, CullResult* results, int count);
+
+// Boxes given by arrays of minimum and maximum corner x, y and z values
+void TestAABBs(const Frustum& frustum, const ConstVector3Arrays& minPoints, const ConstVector3Arrays& maxPoints, CullResult* results, int count);
+
+
+#endif // _FRUSTUM_H_DEFINED_
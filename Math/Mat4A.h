@@ -0,0 +1,225 @@
+//--------------------------------------------------------------------------------------
+// Mat4A class - 16-byte aligned 4x4 matrix held as four SSE rows
+//--------------------------------------------------------------------------------------
+// All code is inline in this header
+//
+// Same element order as CMatrix4x4 (row-major, vectors multiplied on the left), so converting
+// between the two is only four loads or stores. CMatrix4x4 members of the constant buffer
+// structures in Common.h are 16-byte aligned, so a Mat4A can be stored straight into them.
+// CPUs without SSE get a plain C++ version, as for Vec4A.
+
+#ifndef _MAT4A_H_DEFINED_
+#define _MAT4A_H_DEFINED_
+
+#include "Vec4A.h"
+#include "CMatrix4x4.h"
+
+#if MATH_SIMD_X86
+
+class alignas(16) Mat4A
+{
+// Concrete class - public access
+public:
+    // Matrix rows, r[3] holds the position for affine matrices
+    __m128 r[4];
+
+    /*-----------------------------------------------------------------------------------------
+        Constructors
+    -----------------------------------------------------------------------------------------*/
+
+    // Default constructor - leaves values uninitialised (for performance)
+    Mat4A() {}
+
+    // Construct from four rows
+    Mat4A(const Vec4A& r0, const Vec4A& r1, const Vec4A& r2, const Vec4A& r3)
+    {
+        r[0] = r0.v;  r[1] = r1.v;  r[2] = r2.v;  r[3] = r3.v;
+    }
+
+    // Construct from a CMatrix4x4. Explicit so mixed CMatrix4x4/Mat4A expressions are not ambiguous
+    explicit Mat4A(const CMatrix4x4& m)
+    {
+        const float* p = &m.e00;
+        r[0] = _mm_loadu_ps(p);
+        r[1] = _mm_loadu_ps(p + 4);
+        r[2] = _mm_loadu_ps(p + 8);
+        r[3] = _mm_loadu_ps(p + 12);
+    }
+
+
+    /*-----------------------------------------------------------------------------------------
+        Member functions
+    -----------------------------------------------------------------------------------------*/
+
+    // Convert to a CMatrix4x4. Also allows a Mat4A to be assigned to a CMatrix4x4, e.g. in a constant buffer
+    operator CMatrix4x4() const
+    {
+        CMatrix4x4 m;
+        Store(m);
+        return m;
+    }
+
+    // Write this matrix into an existing CMatrix4x4
+    void Store(CMatrix4x4& m) const
+    {
+        float* p = &m.e00;
+        _mm_storeu_ps(p,      r[0]);
+        _mm_storeu_ps(p + 4,  r[1]);
+        _mm_storeu_ps(p + 8,  r[2]);
+        _mm_storeu_ps(p + 12, r[3]);
+    }
+
+    // Access rows, e.g. the x, y and z axes and position of an affine matrix
+    Vec4A Row(int iRow) const             { return r[iRow]; }
+    void SetRow(int iRow, const Vec4A& v) { r[iRow] = v.v;  }
+
+    // Post-multiply this matrix by the given one
+    Mat4A& operator*= (const Mat4A& m);
+};
+
+
+/*-----------------------------------------------------------------------------------------
+    Operators
+-----------------------------------------------------------------------------------------*/
+
+// Matrix-matrix multiplication. Products are summed in the same order as CMatrix4x4 so results
+// are identical
+inline Mat4A operator* (const Mat4A& m1, const Mat4A& m2)
+{
+    Mat4A mOut;
+    for (int i = 0; i < 4; ++i)
+    {
+        __m128 row = m1.r[i];
+        __m128 t =                _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(0,0,0,0)), m2.r[0]);
+        t = _mm_add_ps(t,         _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(1,1,1,1)), m2.r[1]));
+        t = _mm_add_ps(t,         _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(2,2,2,2)), m2.r[2]));
+        mOut.r[i] = _mm_add_ps(t, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(3,3,3,3)), m2.r[3]));
+    }
+    return mOut;
+}
+
+inline Mat4A& Mat4A::operator*= (const Mat4A& m)
+{
+    *this = *this * m;
+    return *this;
+}
+
+// Vector-matrix multiplication (row vector on the left, as in the shaders). Use w = 1 in the
+// vector to transform a point, w = 0 to transform a direction
+inline Vec4A operator* (const Vec4A& v, const Mat4A& m)
+{
+    __m128 t =        _mm_mul_ps(_mm_shuffle_ps(v.v, v.v, _MM_SHUFFLE(0,0,0,0)), m.r[0]);
+    t = _mm_add_ps(t, _mm_mul_ps(_mm_shuffle_ps(v.v, v.v, _MM_SHUFFLE(1,1,1,1)), m.r[1]));
+    t = _mm_add_ps(t, _mm_mul_ps(_mm_shuffle_ps(v.v, v.v, _MM_SHUFFLE(2,2,2,2)), m.r[2]));
+    return _mm_add_ps(t, _mm_mul_ps(_mm_shuffle_ps(v.v, v.v, _MM_SHUFFLE(3,3,3,3)), m.r[3]));
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Non-member functions
+-----------------------------------------------------------------------------------------*/
+
+// Return the transpose of the given matrix
+inline Mat4A Transpose(const Mat4A& m)
+{
+    Mat4A mOut = m;
+    _MM_TRANSPOSE4_PS(mOut.r[0], mOut.r[1], mOut.r[2], mOut.r[3]);
+    return mOut;
+}
+
+
+#else // !MATH_SIMD_X86
+
+/*-----------------------------------------------------------------------------------------
+    Plain C++ version
+-----------------------------------------------------------------------------------------*/
+// Same interface as above, except the rows are Vec4A. Products are summed in the same order
+
+class alignas(16) Mat4A
+{
+// Concrete class - public access
+public:
+    // Matrix rows, r[3] holds the position for affine matrices
+    Vec4A r[4];
+
+    // Default constructor - leaves values uninitialised (for performance)
+    Mat4A() {}
+
+    // Construct from four rows
+    Mat4A(const Vec4A& r0, const Vec4A& r1, const Vec4A& r2, const Vec4A& r3)
+    {
+        r[0] = r0;  r[1] = r1;  r[2] = r2;  r[3] = r3;
+    }
+
+    // Construct from a CMatrix4x4. Explicit so mixed CMatrix4x4/Mat4A expressions are not ambiguous
+    explicit Mat4A(const CMatrix4x4& m)
+    {
+        const float* p = &m.e00;
+        for (int i = 0; i < 4; ++i)  r[i] = Vec4A::Load(p + i * 4);
+    }
+
+    // Convert to a CMatrix4x4. Also allows a Mat4A to be assigned to a CMatrix4x4, e.g. in a constant buffer
+    operator CMatrix4x4() const
+    {
+        CMatrix4x4 m;
+        Store(m);
+        return m;
+    }
+
+    // Write this matrix into an existing CMatrix4x4
+    void Store(CMatrix4x4& m) const
+    {
+        float* p = &m.e00;
+        for (int i = 0; i < 4; ++i)  r[i].Store(p + i * 4);
+    }
+
+    // Access rows, e.g. the x, y and z axes and position of an affine matrix
+    Vec4A Row(int iRow) const             { return r[iRow]; }
+    void SetRow(int iRow, const Vec4A& v) { r[iRow] = v;    }
+
+    // Post-multiply this matrix by the given one
+    Mat4A& operator*= (const Mat4A& m);
+};
+
+
+// Vector-matrix multiplication (row vector on the left, as in the shaders). Use w = 1 in the
+// vector to transform a point, w = 0 to transform a direction
+inline Vec4A operator* (const Vec4A& v, const Mat4A& m)
+{
+    return ((Vec4A::Splat(v.X()) * m.r[0] + Vec4A::Splat(v.Y()) * m.r[1]) + Vec4A::Splat(v.Z()) * m.r[2]) + Vec4A::Splat(v.W()) * m.r[3];
+}
+
+// Matrix-matrix multiplication, each row of the result is the row of m1 transformed by m2
+inline Mat4A operator* (const Mat4A& m1, const Mat4A& m2)
+{
+    return Mat4A(m1.r[0] * m2, m1.r[1] * m2, m1.r[2] * m2, m1.r[3] * m2);
+}
+
+inline Mat4A& Mat4A::operator*= (const Mat4A& m)
+{
+    *this = *this * m;
+    return *this;
+}
+
+// Return the transpose of the given matrix
+inline Mat4A Transpose(const Mat4A& m)
+{
+    Mat4A mOut;
+    for (int i = 0; i < 4; ++i)
+    {
+        for (int j = 0; j < 4; ++j)  mOut.r[i].v[j] = m.r[j].v[i];
+    }
+    return mOut;
+}
+
+#endif // MATH_SIMD_X86
+
+
+// Return an identity matrix
+inline Mat4A Mat4AIdentity()
+{
+    return Mat4A(Vec4A(1, 0, 0, 0), Vec4A(0, 1, 0, 0), Vec4A(0, 0, 1, 0), Vec4A(0, 0, 0, 1));
+}
+
+
+#endif // _MAT4A_H_DEFINED_
@@ -0,0 +1,910 @@
+//--------------------------------------------------------------------------------------
+// Batched maths functions - apply one operation to whole arrays of vectors at a time
+//--------------------------------------------------------------------------------------
+
+#include "MathBatch.h"
+#include "SIMD.h"
+#include <cfloat>
+
+
+/*-----------------------------------------------------------------------------------------
+    Vector transformation
+-----------------------------------------------------------------------------------------*/
+
+// The three kinds of vector transform share their code, selected by this template parameter
+enum class TransformMode
+{
+    Point,   // w = 1
+    Normal,  // w = 0
+    Project, // w = 1, then divide by resulting w
+};
+
+
+// Plain C++ transform of a single vector, the reference for the SIMD versions. Sums are in
+// the same order as the SIMD code (and the shaders) so results match exactly
+template <TransformMode Mode>
+static inline void TransformScalar(const CMatrix4x4& m, float x, float y, float z, float& outX, float& outY, float& outZ)
+{
+    float tx = x * m.e00 + y * m.e10 + z * m.e20;
+    float ty = x * m.e01 + y * m.e11 + z * m.e21;
+    float tz = x * m.e02 + y * m.e12 + z * m.e22;
+    if (Mode != TransformMode::Normal)
+    {
+        tx += m.e30;
+        ty += m.e31;
+        tz += m.e32;
+    }
+    if (Mode == TransformMode::Project)
+    {
+        float w = x * m.e03 + y * m.e13 + z * m.e23 + m.e33;
+        tx /= w;
+        ty /= w;
+        tz /= w;
+    }
+    outX = tx;
+    outY = ty;
+    outZ = tz;
+}
+
+// Plain C++ transform of elements [start, count) of an AoS or SoA array
+template <TransformMode Mode>
+static void TransformScalar(const CMatrix4x4& m, const CVector3* in, CVector3* out, int start, int count)
+{
+    for (int i = start; i < count; ++i)
+    {
+        CVector3 v = in[i];
+        TransformScalar<Mode>(m, v.x, v.y, v.z, out[i].x, out[i].y, out[i].z);
+    }
+}
+template <TransformMode Mode>
+static void TransformScalar(const CMatrix4x4& m, const ConstVector3Arrays& in, const Vector3Arrays& out, int start, int count)
+{
+    for (int i = start; i < count; ++i)
+    {
+        TransformScalar<Mode>(m, in.x[i], in.y[i], in.z[i], out.x[i], out.y[i], out.z[i]);
+    }
+}
+
+
+#if MATH_SIMD_X86
+
+//*********************************
+// SSE
+
+// Transform four vectors held in SoA form. e holds the 16 matrix elements each copied to all lanes
+template <TransformMode Mode>
+SIMD_TARGET_SSE41 static inline void TransformSSE41(const __m128 e[16], __m128& x, __m128& y, __m128& z)
+{
+    __m128 tx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, e[0]), _mm_mul_ps(y, e[4])), _mm_mul_ps(z, e[ 8]));
+    __m128 ty = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, e[1]), _mm_mul_ps(y, e[5])), _mm_mul_ps(z, e[ 9]));
+    __m128 tz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, e[2]), _mm_mul_ps(y, e[6])), _mm_mul_ps(z, e[10]));
+    if (Mode != TransformMode::Normal)
+    {
+        tx = _mm_add_ps(tx, e[12]);
+        ty = _mm_add_ps(ty, e[13]);
+        tz = _mm_add_ps(tz, e[14]);
+    }
+    if (Mode == TransformMode::Project)
+    {
+        __m128 w = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, e[3]), _mm_mul_ps(y, e[7])), _mm_mul_ps(z, e[11])), e[15]);
+        tx = _mm_div_ps(tx, w);
+        ty = _mm_div_ps(ty, w);
+        tz = _mm_div_ps(tz, w);
+    }
+    x = tx;
+    y = ty;
+    z = tz;
+}
+
+// Convert four CVector3 (12 floats, loaded as a, b, c) to SoA form and back again
+SIMD_TARGET_SSE41 static inline void AoSToSoASSE41(__m128 a, __m128 b, __m128 c, __m128& x, __m128& y, __m128& z)
+{
+    // a = x0 y0 z0 x1,  b = y1 z1 x2 y2,  c = z2 x3 y3 z3
+    __m128 bc = _mm_shuffle_ps(b, c, _MM_SHUFFLE(1,0,2,1)); // y1 x2 z2 x3
+    x = _mm_shuffle_ps(a, bc, _MM_SHUFFLE(3,1,3,0));
+    __m128 ab = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3,0,1,1)); // y0 y0 y1 y2
+    bc = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2,2,3,3));        // y2 y2 y3 y3
+    y = _mm_shuffle_ps(ab, bc, _MM_SHUFFLE(2,0,2,0));
+    ab = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1,1,2,2));        // z0 z0 z1 z1
+    z = _mm_shuffle_ps(ab, c, _MM_SHUFFLE(3,0,2,0));
+}
+SIMD_TARGET_SSE41 static inline void SoAToAoSSSE41(__m128 x, __m128 y, __m128 z, __m128& a, __m128& b, __m128& c)
+{
+    a = _mm_shuffle_ps(_mm_shuffle_ps(x, y, _MM_SHUFFLE(0,0,0,0)), _mm_shuffle_ps(z, x, _MM_SHUFFLE(1,1,0,0)), _MM_SHUFFLE(2,0,2,0));
+    b = _mm_shuffle_ps(_mm_shuffle_ps(y, z, _MM_SHUFFLE(1,1,1,1)), _mm_shuffle_ps(x, y, _MM_SHUFFLE(2,2,2,2)), _MM_SHUFFLE(2,0,2,0));
+    c = _mm_shuffle_ps(_mm_shuffle_ps(z, x, _MM_SHUFFLE(3,3,2,2)), _mm_shuffle_ps(y, z, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(2,0,2,0));
+}
+
+// Transform an AoS array four vectors at a time, returns the number of vectors processed
+template <TransformMode Mode>
+SIMD_TARGET_SSE41 static int TransformSSE41(const CMatrix4x4& m, const CVector3* in, CVector3* out, int count)
+{
+    __m128 e[16];
+    for (int i = 0; i < 16; ++i)  e[i] = _mm_set1_ps((&m.e00)[i]);
+
+    const float* src = &in->x;
+    float* dst = &out->x;
+    int i = 0;
+    for (; i + 4 <= count; i += 4, src += 12, dst += 12)
+    {
+        __m128 x, y, z;
+        AoSToSoASSE41(_mm_loadu_ps(src), _mm_loadu_ps(src + 4), _mm_loadu_ps(src + 8), x, y, z);
+        TransformSSE41<Mode>(e, x, y, z);
+        __m128 a, b, c;
+        SoAToAoSSSE41(x, y, z, a, b, c);
+        _mm_storeu_ps(dst,     a);
+        _mm_storeu_ps(dst + 4, b);
+        _mm_storeu_ps(dst + 8, c);
+    }
+    return i;
+}
+
+// Transform an SoA array four vectors at a time, returns the number of vectors processed
+template <TransformMode Mode>
+SIMD_TARGET_SSE41 static int TransformSSE41(const CMatrix4x4& m, const ConstVector3Arrays& in, const Vector3Arrays& out, int count)
+{
+    __m128 e[16];
+    for (int i = 0; i < 16; ++i)  e[i] = _mm_set1_ps((&m.e00)[i]);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(in.x + i);
+        __m128 y = _mm_loadu_ps(in.y + i);
+        __m128 z = _mm_loadu_ps(in.z + i);
+        TransformSSE41<Mode>(e, x, y, z);
+        _mm_storeu_ps(out.x + i, x);
+        _mm_storeu_ps(out.y + i, y);
+        _mm_storeu_ps(out.z + i, z);
+    }
+    return i;
+}
+
+
+//*********************************
+// AVX2
+
+template <TransformMode Mode>
+SIMD_TARGET_AVX2 static inline void TransformAVX2(const __m256 e[16], __m256& x, __m256& y, __m256& z)
+{
+    __m256 tx = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, e[0]), _mm256_mul_ps(y, e[4])), _mm256_mul_ps(z, e[ 8]));
+    __m256 ty = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, e[1]), _mm256_mul_ps(y, e[5])), _mm256_mul_ps(z, e[ 9]));
+    __m256 tz = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, e[2]), _mm256_mul_ps(y, e[6])), _mm256_mul_ps(z, e[10]));
+    if (Mode != TransformMode::Normal)
+    {
+        tx = _mm256_add_ps(tx, e[12]);
+        ty = _mm256_add_ps(ty, e[13]);
+        tz = _mm256_add_ps(tz, e[14]);
+    }
+    if (Mode == TransformMode::Project)
+    {
+        __m256 w = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, e[3]), _mm256_mul_ps(y, e[7])), _mm256_mul_ps(z, e[11])), e[15]);
+        tx = _mm256_div_ps(tx, w);
+        ty = _mm256_div_ps(ty, w);
+        tz = _mm256_div_ps(tz, w);
+    }
+    x = tx;
+    y = ty;
+    z = tz;
+}
+
+// AoS array eight vectors at a time. The conversion to and from SoA is done in two 128-bit halves
+template <TransformMode Mode>
+SIMD_TARGET_AVX2 static int TransformAVX2(const CMatrix4x4& m, const CVector3* in, CVector3* out, int count)
+{
+    __m256 e[16];
+    for (int i = 0; i < 16; ++i)  e[i] = _mm256_set1_ps((&m.e00)[i]);
+
+    const float* src = &in->x;
+    float* dst = &out->x;
+    int i = 0;
+    for (; i + 8 <= count; i += 8, src += 24, dst += 24)
+    {
+        __m128 x0, y0, z0, x1, y1, z1;
+        AoSToSoASSE41(_mm_loadu_ps(src),      _mm_loadu_ps(src + 4),  _mm_loadu_ps(src + 8),  x0, y0, z0);
+        AoSToSoASSE41(_mm_loadu_ps(src + 12), _mm_loadu_ps(src + 16), _mm_loadu_ps(src + 20), x1, y1, z1);
+        __m256 x = _mm256_insertf128_ps(_mm256_castps128_ps256(x0), x1, 1);
+        __m256 y = _mm256_insertf128_ps(_mm256_castps128_ps256(y0), y1, 1);
+        __m256 z = _mm256_insertf128_ps(_mm256_castps128_ps256(z0), z1, 1);
+        TransformAVX2<Mode>(e, x, y, z);
+        __m128 a, b, c;
+        SoAToAoSSSE41(_mm256_castps256_ps128(x), _mm256_castps256_ps128(y), _mm256_castps256_ps128(z), a, b, c);
+        _mm_storeu_ps(dst,      a);
+        _mm_storeu_ps(dst + 4,  b);
+        _mm_storeu_ps(dst + 8,  c);
+        SoAToAoSSSE41(_mm256_extractf128_ps(x, 1), _mm256_extractf128_ps(y, 1), _mm256_extractf128_ps(z, 1), a, b, c);
+        _mm_storeu_ps(dst + 12, a);
+        _mm_storeu_ps(dst + 16, b);
+        _mm_storeu_ps(dst + 20, c);
+    }
+    return i;
+}
+
+template <TransformMode Mode>
+SIMD_TARGET_AVX2 static int TransformAVX2(const CMatrix4x4& m, const ConstVector3Arrays& in, const Vector3Arrays& out, int count)
+{
+    __m256 e[16];
+    for (int i = 0; i < 16; ++i)  e[i] = _mm256_set1_ps((&m.e00)[i]);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 x = _mm256_loadu_ps(in.x + i);
+        __m256 y = _mm256_loadu_ps(in.y + i);
+        __m256 z = _mm256_loadu_ps(in.z + i);
+        TransformAVX2<Mode>(e, x, y, z);
+        _mm256_storeu_ps(out.x + i, x);
+        _mm256_storeu_ps(out.y + i, y);
+        _mm256_storeu_ps(out.z + i, z);
+    }
+    return i;
+}
+
+
+//*********************************
+// AVX-512 (SoA only, the AoS shuffles gain little over AVX2 at this width)
+
+template <TransformMode Mode>
+SIMD_TARGET_AVX512 static int TransformAVX512(const CMatrix4x4& m, const ConstVector3Arrays& in, const Vector3Arrays& out, int count)
+{
+    __m512 e[16];
+    for (int i = 0; i < 16; ++i)  e[i] = _mm512_set1_ps((&m.e00)[i]);
+
+    int i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __m512 x = _mm512_loadu_ps(in.x + i);
+        __m512 y = _mm512_loadu_ps(in.y + i);
+        __m512 z = _mm512_loadu_ps(in.z + i);
+        __m512 tx = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(x, e[0]), _mm512_mul_ps(y, e[4])), _mm512_mul_ps(z, e[ 8]));
+        __m512 ty = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(x, e[1]), _mm512_mul_ps(y, e[5])), _mm512_mul_ps(z, e[ 9]));
+        __m512 tz = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(x, e[2]), _mm512_mul_ps(y, e[6])), _mm512_mul_ps(z, e[10]));
+        if (Mode != TransformMode::Normal)
+        {
+            tx = _mm512_add_ps(tx, e[12]);
+            ty = _mm512_add_ps(ty, e[13]);
+            tz = _mm512_add_ps(tz, e[14]);
+        }
+        if (Mode == TransformMode::Project)
+        {
+            __m512 w = _mm512_add_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(x, e[3]), _mm512_mul_ps(y, e[7])), _mm512_mul_ps(z, e[11])), e[15]);
+            tx = _mm512_div_ps(tx, w);
+            ty = _mm512_div_ps(ty, w);
+            tz = _mm512_div_ps(tz, w);
+        }
+        _mm512_storeu_ps(out.x + i, tx);
+        _mm512_storeu_ps(out.y + i, ty);
+        _mm512_storeu_ps(out.z + i, tz);
+    }
+    return i;
+}
+
+#endif
+
+
+// Select the SIMD version for this CPU to process as much of the array as it can,
+// then finish off any remaining vectors with the plain C++ version
+template <TransformMode Mode>
+static void Transform(const CMatrix4x4& m, const CVector3* in, CVector3* out, int count)
+{
+    int done = 0;
+#if MATH_SIMD_X86
+    switch (GetSimdLevel())
+    {
+        case SimdLevel::AVX512:
+        case SimdLevel::AVX2:   done = TransformAVX2 <Mode>(m, in, out, count); break;
+        case SimdLevel::SSE41:  done = TransformSSE41<Mode>(m, in, out, count); break;
+        default: break;
+    }
+#endif
+    TransformScalar<Mode>(m, in, out, done, count);
+}
+
+template <TransformMode Mode>
+static void Transform(const CMatrix4x4& m, const ConstVector3Arrays& in, const Vector3Arrays& out, int count)
+{
+    int done = 0;
+#if MATH_SIMD_X86
+    switch (GetSimdLevel())
+    {
+        case SimdLevel::AVX512: done = TransformAVX512<Mode>(m, in, out, count); break;
+        case SimdLevel::AVX2:   done = TransformAVX2  <Mode>(m, in, out, count); break;
+        case SimdLevel::SSE41:  done = TransformSSE41 <Mode>(m, in, out, count); break;
+        default: break;
+    }
+#endif
+    TransformScalar<Mode>(m, in, out, done, count);
+}
+
+
+// Transform count points by the given matrix, including its translation (w = 1)
+void TransformPoints(const CMatrix4x4& m, const CVector3* in, CVector3* out, int count)
+{
+    Transform<TransformMode::Point>(m, in, out, count);
+}
+void TransformPoints(const CMatrix4x4& m, const ConstVector3Arrays& in, const Vector3Arrays& out, int count)
+{
+    Transform<TransformMode::Point>(m, in, out, count);
+}
+
+// Transform count direction vectors by the given matrix, ignoring its translation (w = 0)
+void TransformNormals(const CMatrix4x4& m, const CVector3* in, CVector3* out, int count)
+{
+    Transform<TransformMode::Normal>(m, in, out, count);
+}
+void TransformNormals(const CMatrix4x4& m, const ConstVector3Arrays& in, const Vector3Arrays& out, int count)
+{
+    Transform<TransformMode::Normal>(m, in, out, count);
+}
+
+// Transform count points by the given matrix including its translation, then divide x, y and z by the resulting w
+void TransformPointsProject(const CMatrix4x4& m, const CVector3* in, CVector3* out, int count)
+{
+    Transform<TransformMode::Project>(m, in, out, count);
+}
+void TransformPointsProject(const CMatrix4x4& m, const ConstVector3Arrays& in, const Vector3Arrays& out, int count)
+{
+    Transform<TransformMode::Project>(m, in, out, count);
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Normalisation and length
+-----------------------------------------------------------------------------------------*/
+
+// Plain C++ versions of elements [start, count), the reference for the SIMD versions. Always precise
+static void NormaliseScalar(const CVector3* in, CVector3* out, int start, int count)
+{
+    for (int i = start; i < count; ++i)
+    {
+        out[i] = Normalise(in[i]);
+    }
+}
+static void NormaliseScalar(const ConstVector3Arrays& in, const Vector3Arrays& out, int start, int count)
+{
+    for (int i = start; i < count; ++i)
+    {
+        CVector3 n = Normalise(CVector3{ in.x[i], in.y[i], in.z[i] });
+        out.x[i] = n.x;
+        out.y[i] = n.y;
+        out.z[i] = n.z;
+    }
+}
+
+static void LengthScalar(const CVector3* in, float* lengths, int start, int count)
+{
+    for (int i = start; i < count; ++i)
+    {
+        lengths[i] = Length(in[i]);
+    }
+}
+static void LengthScalar(const ConstVector3Arrays& in, float* lengths, int start, int count)
+{
+    for (int i = start; i < count; ++i)
+    {
+        lengths[i] = Length(CVector3{ in.x[i], in.y[i], in.z[i] });
+    }
+}
+
+
+#if MATH_SIMD_X86
+
+// The SIMD versions work on vectors in SoA form. The squared length is summed in the same order as
+// Dot, then the precise versions use a full square root and divide, which are correctly rounded, so
+// they match Normalise and Length exactly. The fast versions use the CPU's reciprocal square root
+// estimate refined by one Newton-Raphson step: r' = r * (1.5 - 0.5 * lengthSq * r * r)
+
+//*********************************
+// SSE
+
+template <SqrtPrecision Precision>
+SIMD_TARGET_SSE41 static inline __m128 InvSqrtSSE41(__m128 lengthSq)
+{
+    if (Precision == SqrtPrecision::Precise)  return _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(lengthSq));
+
+    __m128 r = _mm_rsqrt_ps(lengthSq);
+    __m128 halfLengthSq = _mm_mul_ps(_mm_set1_ps(0.5f), lengthSq);
+    return _mm_mul_ps(r, _mm_sub_ps(_mm_set1_ps(1.5f), _mm_mul_ps(halfLengthSq, _mm_mul_ps(r, r))));
+}
+
+// Normalise four vectors. Vectors with squared length below EPSILON become zero, as in Normalise
+template <SqrtPrecision Precision>
+SIMD_TARGET_SSE41 static inline void NormaliseSSE41(__m128& x, __m128& y, __m128& z)
+{
+    __m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+    __m128 nonZero = _mm_cmpnlt_ps(lengthSq, _mm_set1_ps(EPSILON));
+    __m128 invLength = _mm_and_ps(InvSqrtSSE41<Precision>(lengthSq), nonZero);
+    x = _mm_mul_ps(x, invLength);
+    y = _mm_mul_ps(y, invLength);
+    z = _mm_mul_ps(z, invLength);
+}
+
+// Length of four vectors. The fast version returns 0 for squared lengths too small for the estimate
+template <SqrtPrecision Precision>
+SIMD_TARGET_SSE41 static inline __m128 LengthSSE41(__m128 x, __m128 y, __m128 z)
+{
+    __m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+    if (Precision == SqrtPrecision::Precise)  return _mm_sqrt_ps(lengthSq);
+
+    __m128 nonZero = _mm_cmpnlt_ps(lengthSq, _mm_set1_ps(FLT_MIN));
+    return _mm_and_ps(_mm_mul_ps(lengthSq, InvSqrtSSE41<Precision>(lengthSq)), nonZero);
+}
+
+template <SqrtPrecision Precision>
+SIMD_TARGET_SSE41 static int NormaliseSSE41(const CVector3* in, CVector3* out, int count)
+{
+    const float* src = &in->x;
+    float* dst = &out->x;
+    int i = 0;
+    for (; i + 4 <= count; i += 4, src += 12, dst += 12)
+    {
+        __m128 x, y, z;
+        AoSToSoASSE41(_mm_loadu_ps(src), _mm_loadu_ps(src + 4), _mm_loadu_ps(src + 8), x, y, z);
+        NormaliseSSE41<Precision>(x, y, z);
+        __m128 a, b, c;
+        SoAToAoSSSE41(x, y, z, a, b, c);
+        _mm_storeu_ps(dst,     a);
+        _mm_storeu_ps(dst + 4, b);
+        _mm_storeu_ps(dst + 8, c);
+    }
+    return i;
+}
+
+template <SqrtPrecision Precision>
+SIMD_TARGET_SSE41 static int NormaliseSSE41(const ConstVector3Arrays& in, const Vector3Arrays& out, int count)
+{
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(in.x + i);
+        __m128 y = _mm_loadu_ps(in.y + i);
+        __m128 z = _mm_loadu_ps(in.z + i);
+        NormaliseSSE41<Precision>(x, y, z);
+        _mm_storeu_ps(out.x + i, x);
+        _mm_storeu_ps(out.y + i, y);
+        _mm_storeu_ps(out.z + i, z);
+    }
+    return i;
+}
+
+template <SqrtPrecision Precision>
+SIMD_TARGET_SSE41 static int LengthSSE41(const CVector3* in, float* lengths, int count)
+{
+    const float* src = &in->x;
+    int i = 0;
+    for (; i + 4 <= count; i += 4, src += 12)
+    {
+        __m128 x, y, z;
+        AoSToSoASSE41(_mm_loadu_ps(src), _mm_loadu_ps(src + 4), _mm_loadu_ps(src + 8), x, y, z);
+        _mm_storeu_ps(lengths + i, LengthSSE41<Precision>(x, y, z));
+    }
+    return i;
+}
+
+template <SqrtPrecision Precision>
+SIMD_TARGET_SSE41 static int LengthSSE41(const ConstVector3Arrays& in, float* lengths, int count)
+{
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        _mm_storeu_ps(lengths + i, LengthSSE41<Precision>(_mm_loadu_ps(in.x + i), _mm_loadu_ps(in.y + i), _mm_loadu_ps(in.z + i)));
+    }
+    return i;
+}
+
+
+//*********************************
+// AVX2
+
+template <SqrtPrecision Precision>
+SIMD_TARGET_AVX2 static inline __m256 InvSqrtAVX2(__m256 lengthSq)
+{
+    if (Precision == SqrtPrecision::Precise)  return _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(lengthSq));
+
+    __m256 r = _mm256_rsqrt_ps(lengthSq);
+    __m256 halfLengthSq = _mm256_mul_ps(_mm256_set1_ps(0.5f), lengthSq);
+    return _mm256_mul_ps(r, _mm256_sub_ps(_mm256_set1_ps(1.5f), _mm256_mul_ps(halfLengthSq, _mm256_mul_ps(r, r))));
+}
+
+template <SqrtPrecision Precision>
+SIMD_TARGET_AVX2 static inline void NormaliseAVX2(__m256& x, __m256& y, __m256& z)
+{
+    __m256 lengthSq = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z));
+    __m256 nonZero = _mm256_cmp_ps(lengthSq, _mm256_set1_ps(EPSILON), _CMP_NLT_UQ);
+    __m256 invLength = _mm256_and_ps(InvSqrtAVX2<Precision>(lengthSq), nonZero);
+    x = _mm256_mul_ps(x, invLength);
+    y = _mm256_mul_ps(y, invLength);
+    z = _mm256_mul_ps(z, invLength);
+}
+
+template <SqrtPrecision Precision>
+SIMD_TARGET_AVX2 static inline __m256 LengthAVX2(__m256 x, __m256 y, __m256 z)
+{
+    __m256 lengthSq = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z));
+    if (Precision == SqrtPrecision::Precise)  return _mm256_sqrt_ps(lengthSq);
+
+    __m256 nonZero = _mm256_cmp_ps(lengthSq, _mm256_set1_ps(FLT_MIN), _CMP_NLT_UQ);
+    return _mm256_and_ps(_mm256_mul_ps(lengthSq, InvSqrtAVX2<Precision>(lengthSq)), nonZero);
+}
+
+// Load eight AoS vectors into SoA registers, the conversion is done in two 128-bit halves
+SIMD_TARGET_AVX2 static inline void LoadAoSAVX2(const float* src, __m256& x, __m256& y, __m256& z)
+{
+    __m128 x0, y0, z0, x1, y1, z1;
+    AoSToSoASSE41(_mm_loadu_ps(src),      _mm_loadu_ps(src + 4),  _mm_loadu_ps(src + 8),  x0, y0, z0);
+    AoSToSoASSE41(_mm_loadu_ps(src + 12), _mm_loadu_ps(src + 16), _mm_loadu_ps(src + 20), x1, y1, z1);
+    x = _mm256_insertf128_ps(_mm256_castps128_ps256(x0), x1, 1);
+    y = _mm256_insertf128_ps(_mm256_castps128_ps256(y0), y1, 1);
+    z = _mm256_insertf128_ps(_mm256_castps128_ps256(z0), z1, 1);
+}
+
+template <SqrtPrecision Precision>
+SIMD_TARGET_AVX2 static int NormaliseAVX2(const CVector3* in, CVector3* out, int count)
+{
+    const float* src = &in->x;
+    float* dst = &out->x;
+    int i = 0;
+    for (; i + 8 <= count; i += 8, src += 24, dst += 24)
+    {
+        __m256 x, y, z;
+        LoadAoSAVX2(src, x, y, z);
+        NormaliseAVX2<Precision>(x, y, z);
+        __m128 a, b, c;
+        SoAToAoSSSE41(_mm256_castps256_ps128(x), _mm256_castps256_ps128(y), _mm256_castps256_ps128(z), a, b, c);
+        _mm_storeu_ps(dst,      a);
+        _mm_storeu_ps(dst + 4,  b);
+        _mm_storeu_ps(dst + 8,  c);
+        SoAToAoSSSE41(_mm256_extractf128_ps(x, 1), _mm256_extractf128_ps(y, 1), _mm256_extractf128_ps(z, 1), a, b, c);
+        _mm_storeu_ps(dst + 12, a);
+        _mm_storeu_ps(dst + 16, b);
+        _mm_storeu_ps(dst + 20, c);
+    }
+    return i;
+}
+
+template <SqrtPrecision Precision>
+SIMD_TARGET_AVX2 static int NormaliseAVX2(const ConstVector3Arrays& in, const Vector3Arrays& out, int count)
+{
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 x = _mm256_loadu_ps(in.x + i);
+        __m256 y = _mm256_loadu_ps(in.y + i);
+        __m256 z = _mm256_loadu_ps(in.z + i);
+        NormaliseAVX2<Precision>(x, y, z);
+        _mm256_storeu_ps(out.x + i, x);
+        _mm256_storeu_ps(out.y + i, y);
+        _mm256_storeu_ps(out.z + i, z);
+    }
+    return i;
+}
+
+template <SqrtPrecision Precision>
+SIMD_TARGET_AVX2 static int LengthAVX2(const CVector3* in, float* lengths, int count)
+{
+    const float* src = &in->x;
+    int i = 0;
+    for (; i + 8 <= count; i += 8, src += 24)
+    {
+        __m256 x, y, z;
+        LoadAoSAVX2(src, x, y, z);
+        _mm256_storeu_ps(lengths + i, LengthAVX2<Precision>(x, y, z));
+    }
+    return i;
+}
+
+template <SqrtPrecision Precision>
+SIMD_TARGET_AVX2 static int LengthAVX2(const ConstVector3Arrays& in, float* lengths, int count)
+{
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        _mm256_storeu_ps(lengths + i, LengthAVX2<Precision>(_mm256_loadu_ps(in.x + i), _mm256_loadu_ps(in.y + i), _mm256_loadu_ps(in.z + i)));
+    }
+    return i;
+}
+
+
+//*********************************
+// AVX-512 (SoA only, as for the transforms). The fast version uses the more accurate 14-bit estimate
+
+template <SqrtPrecision Precision>
+SIMD_TARGET_AVX512 static inline __m512 InvSqrtAVX512(__m512 lengthSq)
+{
+    if (Precision == SqrtPrecision::Precise)  return _mm512_div_ps(_mm512_set1_ps(1.0f), _mm512_sqrt_ps(lengthSq));
+
+    __m512 r = _mm512_rsqrt14_ps(lengthSq);
+    __m512 halfLengthSq = _mm512_mul_ps(_mm512_set1_ps(0.5f), lengthSq);
+    return _mm512_mul_ps(r, _mm512_sub_ps(_mm512_set1_ps(1.5f), _mm512_mul_ps(halfLengthSq, _mm512_mul_ps(r, r))));
+}
+
+template <SqrtPrecision Precision>
+SIMD_TARGET_AVX512 static int NormaliseAVX512(const ConstVector3Arrays& in, const Vector3Arrays& out, int count)
+{
+    int i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __m512 x = _mm512_loadu_ps(in.x + i);
+        __m512 y = _mm512_loadu_ps(in.y + i);
+        __m512 z = _mm512_loadu_ps(in.z + i);
+        __m512 lengthSq = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(x, x), _mm512_mul_ps(y, y)), _mm512_mul_ps(z, z));
+        __mmask16 nonZero = _mm512_cmp_ps_mask(lengthSq, _mm512_set1_ps(EPSILON), _CMP_NLT_UQ);
+        __m512 invLength = _mm512_maskz_mov_ps(nonZero, InvSqrtAVX512<Precision>(lengthSq));
+        _mm512_storeu_ps(out.x + i, _mm512_mul_ps(x, invLength));
+        _mm512_storeu_ps(out.y + i, _mm512_mul_ps(y, invLength));
+        _mm512_storeu_ps(out.z + i, _mm512_mul_ps(z, invLength));
+    }
+    return i;
+}
+
+template <SqrtPrecision Precision>
+SIMD_TARGET_AVX512 static int LengthAVX512(const ConstVector3Arrays& in, float* lengths, int count)
+{
+    int i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __m512 x = _mm512_loadu_ps(in.x + i);
+        __m512 y = _mm512_loadu_ps(in.y + i);
+        __m512 z = _mm512_loadu_ps(in.z + i);
+        __m512 lengthSq = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(x, x), _mm512_mul_ps(y, y)), _mm512_mul_ps(z, z));
+        if (Precision == SqrtPrecision::Precise)
+        {
+            _mm512_storeu_ps(lengths + i, _mm512_sqrt_ps(lengthSq));
+        }
+        else
+        {
+            __mmask16 nonZero = _mm512_cmp_ps_mask(lengthSq, _mm512_set1_ps(FLT_MIN), _CMP_NLT_UQ);
+            _mm512_storeu_ps(lengths + i, _mm512_maskz_mul_ps(nonZero, lengthSq, InvSqrtAVX512<Precision>(lengthSq)));
+        }
+    }
+    return i;
+}
+
+#endif
+
+
+// Select the SIMD version for this CPU, then finish off any remaining vectors with the plain C++ version
+template <SqrtPrecision Precision>
+static void NormaliseArray(const CVector3* in, CVector3* out, int count)
+{
+    int done = 0;
+#if MATH_SIMD_X86
+    switch (GetSimdLevel())
+    {
+        case SimdLevel::AVX512:
+        case SimdLevel::AVX2:   done = NormaliseAVX2 <Precision>(in, out, count); break;
+        case SimdLevel::SSE41:  done = NormaliseSSE41<Precision>(in, out, count); break;
+        default: break;
+    }
+#endif
+    NormaliseScalar(in, out, done, count);
+}
+
+template <SqrtPrecision Precision>
+static void NormaliseArray(const ConstVector3Arrays& in, const Vector3Arrays& out, int count)
+{
+    int done = 0;
+#if MATH_SIMD_X86
+    switch (GetSimdLevel())
+    {
+        case SimdLevel::AVX512: done = NormaliseAVX512<Precision>(in, out, count); break;
+        case SimdLevel::AVX2:   done = NormaliseAVX2  <Precision>(in, out, count); break;
+        case SimdLevel::SSE41:  done = NormaliseSSE41 <Precision>(in, out, count); break;
+        default: break;
+    }
+#endif
+    NormaliseScalar(in, out, done, count);
+}
+
+template <SqrtPrecision Precision>
+static void LengthArray(const CVector3* in, float* lengths, int count)
+{
+    int done = 0;
+#if MATH_SIMD_X86
+    switch (GetSimdLevel())
+    {
+        case SimdLevel::AVX512:
+        case SimdLevel::AVX2:   done = LengthAVX2 <Precision>(in, lengths, count); break;
+        case SimdLevel::SSE41:  done = LengthSSE41<Precision>(in, lengths, count); break;
+        default: break;
+    }
+#endif
+    LengthScalar(in, lengths, done, count);
+}
+
+template <SqrtPrecision Precision>
+static void LengthArray(const ConstVector3Arrays& in, float* lengths, int count)
+{
+    int done = 0;
+#if MATH_SIMD_X86
+    switch (GetSimdLevel())
+    {
+        case SimdLevel::AVX512: done = LengthAVX512<Precision>(in, lengths, count); break;
+        case SimdLevel::AVX2:   done = LengthAVX2  <Precision>(in, lengths, count); break;
+        case SimdLevel::SSE41:  done = LengthSSE41 <Precision>(in, lengths, count); break;
+        default: break;
+    }
+#endif
+    LengthScalar(in, lengths, done, count);
+}
+
+
+// Normalise count vectors, zero length vectors give zero vectors as with Normalise
+void NormaliseMany(const CVector3* in, CVector3* out, int count, SqrtPrecision precision /*= SqrtPrecision::Fast*/)
+{
+    if (precision == SqrtPrecision::Fast)  NormaliseArray<SqrtPrecision::Fast   >(in, out, count);
+    else                                   NormaliseArray<SqrtPrecision::Precise>(in, out, count);
+}
+void NormaliseMany(const ConstVector3Arrays& in, const Vector3Arrays& out, int count, SqrtPrecision precision /*= SqrtPrecision::Fast*/)
+{
+    if (precision == SqrtPrecision::Fast)  NormaliseArray<SqrtPrecision::Fast   >(in, out, count);
+    else                                   NormaliseArray<SqrtPrecision::Precise>(in, out, count);
+}
+
+// Calculate the lengths of count vectors
+void LengthMany(const CVector3* in, float* lengths, int count, SqrtPrecision precision /*= SqrtPrecision::Fast*/)
+{
+    if (precision == SqrtPrecision::Fast)  LengthArray<SqrtPrecision::Fast   >(in, lengths, count);
+    else                                   LengthArray<SqrtPrecision::Precise>(in, lengths, count);
+}
+void LengthMany(const ConstVector3Arrays& in, float* lengths, int count, SqrtPrecision precision /*= SqrtPrecision::Fast*/)
+{
+    if (precision == SqrtPrecision::Fast)  LengthArray<SqrtPrecision::Fast   >(in, lengths, count);
+    else                                   LengthArray<SqrtPrecision::Precise>(in, lengths, count);
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Matrix inversion
+-----------------------------------------------------------------------------------------*/
+
+#if MATH_SIMD_X86
+
+// The SIMD versions work on several matrices at once, with one matrix per SIMD lane. The matrices
+// are transposed on loading so each register holds the same element from each matrix, then the
+// calculation is the same as InverseAffine (in the same order, so results match exactly)
+
+//*********************************
+// SSE4.1 - 4 matrices at a time
+
+SIMD_TARGET_SSE41 static int InverseAffineSSE41(const CMatrix4x4* in, CMatrix4x4* out, int count)
+{
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        // e[row][column] holds that element from each of the four matrices
+        __m128 e[4][4];
+        for (int row = 0; row < 4; ++row)
+        {
+            for (int m = 0; m < 4; ++m)  e[row][m] = _mm_loadu_ps(&in[i + m].e00 + row * 4);
+            _MM_TRANSPOSE4_PS(e[row][0], e[row][1], e[row][2], e[row][3]);
+        }
+
+        __m128 det0 = _mm_sub_ps(_mm_mul_ps(e[1][1], e[2][2]), _mm_mul_ps(e[1][2], e[2][1]));
+        __m128 det1 = _mm_sub_ps(_mm_mul_ps(e[1][2], e[2][0]), _mm_mul_ps(e[1][0], e[2][2]));
+        __m128 det2 = _mm_sub_ps(_mm_mul_ps(e[1][0], e[2][1]), _mm_mul_ps(e[1][1], e[2][0]));
+        __m128 det  = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e[0][0], det0), _mm_mul_ps(e[0][1], det1)), _mm_mul_ps(e[0][2], det2));
+        __m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+
+        __m128 o[4][4];
+        o[0][0] = _mm_mul_ps(invDet, det0);
+        o[1][0] = _mm_mul_ps(invDet, det1);
+        o[2][0] = _mm_mul_ps(invDet, det2);
+        o[0][1] = _mm_mul_ps(invDet, _mm_sub_ps(_mm_mul_ps(e[2][1], e[0][2]), _mm_mul_ps(e[2][2], e[0][1])));
+        o[1][1] = _mm_mul_ps(invDet, _mm_sub_ps(_mm_mul_ps(e[2][2], e[0][0]), _mm_mul_ps(e[2][0], e[0][2])));
+        o[2][1] = _mm_mul_ps(invDet, _mm_sub_ps(_mm_mul_ps(e[2][0], e[0][1]), _mm_mul_ps(e[2][1], e[0][0])));
+        o[0][2] = _mm_mul_ps(invDet, _mm_sub_ps(_mm_mul_ps(e[0][1], e[1][2]), _mm_mul_ps(e[0][2], e[1][1])));
+        o[1][2] = _mm_mul_ps(invDet, _mm_sub_ps(_mm_mul_ps(e[0][2], e[1][0]), _mm_mul_ps(e[0][0], e[1][2])));
+        o[2][2] = _mm_mul_ps(invDet, _mm_sub_ps(_mm_mul_ps(e[0][0], e[1][1]), _mm_mul_ps(e[0][1], e[1][0])));
+
+        __m128 negX = _mm_xor_ps(e[3][0], _mm_set1_ps(-0.0f));
+        for (int col = 0; col < 3; ++col)
+        {
+            o[3][col] = _mm_sub_ps(_mm_sub_ps(_mm_mul_ps(negX, o[0][col]), _mm_mul_ps(e[3][1], o[1][col])), _mm_mul_ps(e[3][2], o[2][col]));
+        }
+        o[0][3] = o[1][3] = o[2][3] = _mm_setzero_ps();
+        o[3][3] = _mm_set1_ps(1.0f);
+
+        // Transpose back to one row per register and store. Inputs have all been read, so out may equal in
+        for (int row = 0; row < 4; ++row)
+        {
+            _MM_TRANSPOSE4_PS(o[row][0], o[row][1], o[row][2], o[row][3]);
+            for (int m = 0; m < 4; ++m)  _mm_storeu_ps(&out[i + m].e00 + row * 4, o[row][m]);
+        }
+    }
+    return i;
+}
+
+
+//*********************************
+// AVX2 - 8 matrices at a time, matrices i to i+3 in the lower half of each register and i+4 to i+7
+// in the upper half. Used for AVX-512 too
+
+SIMD_TARGET_AVX2 static inline void Transpose4x4AVX2(__m256& r0, __m256& r1, __m256& r2, __m256& r3)
+{
+    // Transposes each 128-bit half separately, same steps as _MM_TRANSPOSE4_PS
+    __m256 t0 = _mm256_unpacklo_ps(r0, r1);
+    __m256 t1 = _mm256_unpacklo_ps(r2, r3);
+    __m256 t2 = _mm256_unpackhi_ps(r0, r1);
+    __m256 t3 = _mm256_unpackhi_ps(r2, r3);
+    r0 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1,0,1,0));
+    r1 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3,2,3,2));
+    r2 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1,0,1,0));
+    r3 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3,2,3,2));
+}
+
+SIMD_TARGET_AVX2 static int InverseAffineAVX2(const CMatrix4x4* in, CMatrix4x4* out, int count)
+{
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 e[4][4];
+        for (int row = 0; row < 4; ++row)
+        {
+            for (int m = 0; m < 4; ++m)
+            {
+                e[row][m] = _mm256_set_m128(_mm_loadu_ps(&in[i + m + 4].e00 + row * 4), _mm_loadu_ps(&in[i + m].e00 + row * 4));
+            }
+            Transpose4x4AVX2(e[row][0], e[row][1], e[row][2], e[row][3]);
+        }
+
+        __m256 det0 = _mm256_sub_ps(_mm256_mul_ps(e[1][1], e[2][2]), _mm256_mul_ps(e[1][2], e[2][1]));
+        __m256 det1 = _mm256_sub_ps(_mm256_mul_ps(e[1][2], e[2][0]), _mm256_mul_ps(e[1][0], e[2][2]));
+        __m256 det2 = _mm256_sub_ps(_mm256_mul_ps(e[1][0], e[2][1]), _mm256_mul_ps(e[1][1], e[2][0]));
+        __m256 det  = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e[0][0], det0), _mm256_mul_ps(e[0][1], det1)), _mm256_mul_ps(e[0][2], det2));
+        __m256 invDet = _mm256_div_ps(_mm256_set1_ps(1.0f), det);
+
+        __m256 o[4][4];
+        o[0][0] = _mm256_mul_ps(invDet, det0);
+        o[1][0] = _mm256_mul_ps(invDet, det1);
+        o[2][0] = _mm256_mul_ps(invDet, det2);
+        o[0][1] = _mm256_mul_ps(invDet, _mm256_sub_ps(_mm256_mul_ps(e[2][1], e[0][2]), _mm256_mul_ps(e[2][2], e[0][1])));
+        o[1][1] = _mm256_mul_ps(invDet, _mm256_sub_ps(_mm256_mul_ps(e[2][2], e[0][0]), _mm256_mul_ps(e[2][0], e[0][2])));
+        o[2][1] = _mm256_mul_ps(invDet, _mm256_sub_ps(_mm256_mul_ps(e[2][0], e[0][1]), _mm256_mul_ps(e[2][1], e[0][0])));
+        o[0][2] = _mm256_mul_ps(invDet, _mm256_sub_ps(_mm256_mul_ps(e[0][1], e[1][2]), _mm256_mul_ps(e[0][2], e[1][1])));
+        o[1][2] = _mm256_mul_ps(invDet, _mm256_sub_ps(_mm256_mul_ps(e[0][2], e[1][0]), _mm256_mul_ps(e[0][0], e[1][2])));
+        o[2][2] = _mm256_mul_ps(invDet, _mm256_sub_ps(_mm256_mul_ps(e[0][0], e[1][1]), _mm256_mul_ps(e[0][1], e[1][0])));
+
+        __m256 negX = _mm256_xor_ps(e[3][0], _mm256_set1_ps(-0.0f));
+        for (int col = 0; col < 3; ++col)
+        {
+            o[3][col] = _mm256_sub_ps(_mm256_sub_ps(_mm256_mul_ps(negX, o[0][col]), _mm256_mul_ps(e[3][1], o[1][col])), _mm256_mul_ps(e[3][2], o[2][col]));
+        }
+        o[0][3] = o[1][3] = o[2][3] = _mm256_setzero_ps();
+        o[3][3] = _mm256_set1_ps(1.0f);
+
+        for (int row = 0; row < 4; ++row)
+        {
+            Transpose4x4AVX2(o[row][0], o[row][1], o[row][2], o[row][3]);
+            for (int m = 0; m < 4; ++m)
+            {
+                _mm_storeu_ps(&out[i + m].e00     + row * 4, _mm256_castps256_ps128(o[row][m]));
+                _mm_storeu_ps(&out[i + m + 4].e00 + row * 4, _mm256_extractf128_ps(o[row][m], 1));
+            }
+        }
+    }
+    return i;
+}
+
+#endif
+
+
+// Invert count affine matrices, each result the same as InverseAffine would give. Use to get the
+// view matrices for many cameras or lights at once
+void InverseAffineMany(const CMatrix4x4* in, CMatrix4x4* out, int count)
+{
+    int done = 0;
+#if MATH_SIMD_X86
+    switch (GetSimdLevel())
+    {
+        case SimdLevel::AVX512:
+        case SimdLevel::AVX2:   done = InverseAffineAVX2 (in, out, count); break;
+        case SimdLevel::SSE41:  done = InverseAffineSSE41(in, out, count); break;
+        default: break;
+    }
+#endif
+    for (int i = done; i < count; ++i)
+    {
+        out[i] = InverseAffine(in[i]);
+    }
+}
@@ -0,0 +1,99 @@
+//--------------------------------------------------------------------------------------
+// Batched maths functions - apply one operation to whole arrays of vectors at a time
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+//
+// Each function has a plain C++ version and SIMD versions selected for the current CPU
+// (see SIMD.h). The caller provides the output arrays. Unless stated otherwise the output
+// may be the same array as the input, but must not partly overlap it.
+//
+// Vectors can be passed as an array of CVector3 (AoS - array of structures) or as three
+// separate arrays of x, y and z values (SoA - structure of arrays). SoA is faster for SIMD,
+// AoS matches the layout used by meshes and most other code.
+
+#ifndef _MATH_BATCH_H_DEFINED_
+#define _MATH_BATCH_H_DEFINED_
+
+#include "CVector3.h"
+#include "CMatrix4x4.h"
+
+
+// Three separate arrays of x, y and z values for a set of 3D vectors (SoA layout)
+struct Vector3Arrays
+{
+    float* x;
+    float* y;
+    float* z;
+};
+
+// Read-only version of the above. Can be initialised from a Vector3Arrays
+struct ConstVector3Arrays
+{
+    const float* x;
+    const float* y;
+    const float* z;
+
+    ConstVector3Arrays(const float* xIn, const float* yIn, const float* zIn) : x(xIn), y(yIn), z(zIn) {}
+    ConstVector3Arrays(const Vector3Arrays& v) : x(v.x), y(v.y), z(v.z) {}
+};
+
+
+/*-----------------------------------------------------------------------------------------
+    Vector transformation
+-----------------------------------------------------------------------------------------*/
+// Vectors are treated as rows multiplied by the matrix on the right, as elsewhere in this
+// code, so they are transformed in the same way as the shaders transform vertices.
+// All the SIMD versions give bit-identical results to the plain C++ versions.
+
+// Transform count points by the given matrix, including its translation (w = 1)
+void TransformPoints(const CMatrix4x4& m, const CVector3* in, CVector3* out, int count);
+void TransformPoints(const CMatrix4x4& m, const ConstVector3Arrays& in, const Vector3Arrays& out, int count);
+
+// Transform count direction vectors by the given matrix, ignoring its translation (w = 0).
+// To transform normals by a matrix with non-uniform scaling pass the inverse transpose of
+// that matrix. Results are not renormalised
+void TransformNormals(const CMatrix4x4& m, const CVector3* in, CVector3* out, int count);
+void TransformNormals(const CMatrix4x4& m, const ConstVector3Arrays& in, const Vector3Arrays& out, int count);
+
+// Transform count points by the given matrix including its translation, then divide x, y and z
+// by the resulting w. Used with projection matrices, e.g. to get points in screen space
+void TransformPointsProject(const CMatrix4x4& m, const CVector3* in, CVector3* out, int count);
+void TransformPointsProject(const CMatrix4x4& m, const ConstVector3Arrays& in, const Vector3Arrays& out, int count);
+
+
+/*-----------------------------------------------------------------------------------------
+    Normalisation and length
+-----------------------------------------------------------------------------------------*/
+
+// Accuracy of the batched normalise and length functions
+enum class SqrtPrecision
+{
+    // Reciprocal square root estimate refined by one Newton-Raphson step, several times faster.
+    // Relative error below 5e-7 (about 4 ulp), plenty for normals, directions and lighting.
+    // The plain C++ code and the last few vectors of an array always use the precise version
+    Fast,
+
+    // Full square root and divide, results bit-identical to Normalise and Length
+    Precise,
+};
+
+// Normalise count vectors. Vectors that are too short to normalise become zero, as with Normalise
+void NormaliseMany(const CVector3* in, CVector3* out, int count, SqrtPrecision precision = SqrtPrecision::Fast);
+void NormaliseMany(const ConstVector3Arrays& in, const Vector3Arrays& out, int count, SqrtPrecision precision = SqrtPrecision::Fast);
+
+// Calculate the lengths of count vectors into the given array. The fast version returns 0 for
+// lengths below about 1e-19
+void LengthMany(const CVector3* in, float* lengths, int count, SqrtPrecision precision = SqrtPrecision::Fast);
+void LengthMany(const ConstVector3Arrays& in, float* lengths, int count, SqrtPrecision precision = SqrtPrecision::Fast);
+
+
+/*-----------------------------------------------------------------------------------------
+    Matrix inversion
+-----------------------------------------------------------------------------------------*/
+
+// Invert count affine matrices, e.g. to get view matrices from the world matrices of many lights.
+// Results are bit-identical to calling InverseAffine on each matrix
+void InverseAffineMany(const CMatrix4x4* in, CMatrix4x4* out, int count);
+
+
+#endif // _MATH_BATCH_H_DEFINED_
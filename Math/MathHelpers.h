@@ -9,13 +9,13 @@
 
 
 // Surprisingly, pi is not *officially* defined anywhere in C++
-const float PI = 3.14159265359f;
+constexpr float PI = 3.14159265359f;
 
 
 
 // Test if a float value is approximately 0
 // Epsilon value is the range around zero that is considered equal to zero
-const float EPSILON = 0.5e-6f; // For 32-bit floats, requires zero to 6 decimal places
+constexpr float EPSILON = 0.5e-6f; // For 32-bit floats, requires zero to 6 decimal places
 inline bool IsZero(const float x)
 {
     return std::abs(x) < EPSILON;
@@ -30,16 +30,59 @@ inline float InvSqrt(const float x)
 
 
 // Pass an angle in degrees, returns the angle in radians
-inline float ToRadians(float d)
+constexpr float ToRadians(float d)
 {
     return  d * PI / 180.0f;
 }
 
 // Pass an angle in radians, returns the angle in degrees
-inline float ToDegrees(float r)
+constexpr float ToDegrees(float r)
 {
     return  r * 180.0f / PI;
 }
 
 
+
+// Sine, cosine and tangent that can be evaluated at compile time, e.g. to build the projection matrix
+// of a camera with a fixed field of view. Uses a Taylor series in double precision after reducing the
+// angle to the range -pi to pi, which is accurate to well beyond float precision. Much slower than
+// std::sin etc., so only use these in constant expressions or where the result is cached
+constexpr double ConstexprSin(double x)
+{
+    constexpr double pi = 3.14159265358979323846;
+    while (x >  pi)  x -= 2 * pi;
+    while (x < -pi)  x += 2 * pi;
+
+    double term = x;
+    double sum  = x;
+    for (int n = 1; n < 14; ++n)
+    {
+        term *= -x * x / ((2 * n) * (2 * n + 1));
+        sum  += term;
+    }
+    return sum;
+}
+
+constexpr double ConstexprCos(double x)
+{
+    constexpr double pi = 3.14159265358979323846;
+    while (x >  pi)  x -= 2 * pi;
+    while (x < -pi)  x += 2 * pi;
+
+    double term = 1;
+    double sum  = 1;
+    for (int n = 1; n < 14; ++n)
+    {
+        term *= -x * x / ((2 * n - 1) * (2 * n));
+        sum  += term;
+    }
+    return sum;
+}
+
+constexpr double ConstexprTan(double x)
+{
+    return ConstexprSin(x) / ConstexprCos(x);
+}
+
+
 #endif // _MATH_HELPERS_H_DEFINED_
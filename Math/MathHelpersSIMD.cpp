@@ -0,0 +1,752 @@
+//--------------------------------------------------------------------------------------
+// Fast sin, cos, tan, atan2 and exp - single values, four at a time, or whole arrays
+//--------------------------------------------------------------------------------------
+// Each function is written once in plain C++ and once per SIMD width, all following the same
+// steps, so look at the plain C++ versions first to see how they work.
+
+#include "MathHelpersSIMD.h"
+#include "SIMD.h"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+
+// Constants shared by all versions
+
+// pi/2 split into three parts, the first two with enough trailing zero bits that multiplying them by
+// a quadrant number (up to about 2^16) is exact. Subtracting the parts in turn removes whole quadrants
+// from an angle with much less rounding error than a single multiply by pi/2
+static const float TWO_OVER_PI = 0.636619772367581f;
+static const float PIO2_1 = 1.5703125f;
+static const float PIO2_2 = 4.837512969970703125e-4f;
+static const float PIO2_3 = 7.54978995489188216e-8f;
+
+// Above this the reduction using the parts above loses accuracy, so larger angles (and NaNs) are reduced
+// one at a time by ReduceQuadrantLarge using the bits of 2/pi below, 32 at a time after the binary point
+static const float REDUCE_MAX = 8192.0f;
+static const uint32_t TWO_OVER_PI_BITS[] = { 0xA2F9836E, 0x4E441529, 0xFC2757D1, 0xF534DDC0,
+                                             0xDB629599, 0x3C439041, 0xFE5163AB, 0xDEBBC561 };
+
+// Polynomials for sin and cos on [-pi/4, pi/4]
+static const float SIN_P0 = -1.9515295891e-4f;
+static const float SIN_P1 =  8.3321608736e-3f;
+static const float SIN_P2 = -1.6666654611e-1f;
+static const float COS_P0 =  2.443315711809948e-5f;
+static const float COS_P1 = -1.388731625493765e-3f;
+static const float COS_P2 =  4.166664568298827e-2f;
+
+// Polynomial for tan on [-pi/4, pi/4]
+static const float TAN_P0 = 9.38540185543e-3f;
+static const float TAN_P1 = 3.11992232697e-3f;
+static const float TAN_P2 = 2.44301354525e-2f;
+static const float TAN_P3 = 5.34112807005e-2f;
+static const float TAN_P4 = 1.33387994085e-1f;
+static const float TAN_P5 = 3.33331568548e-1f;
+
+// Polynomial for atan on [-tan(pi/8), tan(pi/8)]
+static const float TAN_PI_OVER_8 = 0.414213562373095f;
+static const float ATAN_P0 =  8.05374449538e-2f;
+static const float ATAN_P1 = -1.38776856032e-1f;
+static const float ATAN_P2 =  1.99777106478e-1f;
+static const float ATAN_P3 = -3.33329491539e-1f;
+static const float PI_OVER_4 = 0.785398163397448f;
+static const float PI_OVER_2 = 1.570796326794897f;
+static const float PI_F      = 3.141592653589793f;
+
+// Exp is calculated as 2^n * e^r, where n is a whole number. ln(2) is split in two as for pi/2 above.
+// Input range is limited so 2^n is a normal float
+static const float EXP_MAX = 88.3762626647949f;
+static const float EXP_MIN = -87.3365447504f;
+static const float LOG2_E  = 1.44269504088896341f;
+static const float LN2_1   = 0.693359375f;
+static const float LN2_2   = -2.12194440e-4f;
+static const float EXP_P0  = 1.9875691500e-4f;
+static const float EXP_P1  = 1.3981999507e-3f;
+static const float EXP_P2  = 8.3334519073e-3f;
+static const float EXP_P3  = 4.1665795894e-2f;
+static const float EXP_P4  = 1.6666665459e-1f;
+static const float EXP_P5  = 5.0000001201e-1f;
+
+
+/*-----------------------------------------------------------------------------------------
+    Large angles
+-----------------------------------------------------------------------------------------*/
+
+// 32 bits of 2/pi starting at the given bit, where bit 1 is worth 1/2. Bits before the binary point are 0
+static uint32_t TwoOverPiBits(int first)
+{
+    int start = first - 1; // Position in TWO_OVER_PI_BITS
+    if (start <= -32)  return 0;
+    if (start < 0)     return TWO_OVER_PI_BITS[0] >> -start;
+    uint64_t pair = (static_cast<uint64_t>(TWO_OVER_PI_BITS[start / 32]) << 32) | TWO_OVER_PI_BITS[start / 32 + 1];
+    return static_cast<uint32_t>(pair >> (32 - start % 32));
+}
+
+// Remove whole quarter turns from an angle of any size, as ReduceQuadrant below. Only the number of quarter
+// turns modulo 4 is returned. |x| is m * 2^e for a 24-bit whole number m, so the bits of 2/pi worth 2^(2-e)
+// or more only add multiples of 4 quarter turns to x * 2/pi and are skipped (Payne-Hanek reduction). The
+// product with the next 96 bits is exact in integers, leaving more than enough bits for a float result.
+// Infinities and NaNs give a NaN
+static int ReduceQuadrantLarge(float x, float& r)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    int exponent = static_cast<int>((bits >> 23) & 0xff);
+    if (exponent == 0xff)
+    {
+        r = x - x;
+        return 0;
+    }
+    uint64_t m = (bits & 0x7fffff) | (exponent != 0 ? 0x800000 : 0);
+    int e = (exponent != 0 ? exponent : 1) - 150;
+
+    // m times the 96 bits of 2/pi from bit e - 1, in 32-bit parts. The product is x * 2/pi * 2^94, so bits 94
+    // and 95 are the quarter turns (modulo 4) and the bits below are the fraction of a quarter turn
+    uint64_t low  = m * TwoOverPiBits(e + 63);
+    uint64_t mid  = m * TwoOverPiBits(e + 31) + (low >> 32);
+    uint64_t high = m * TwoOverPiBits(e - 1)  + (mid >> 32);
+    int q = static_cast<int>((high >> 30) & 3);
+    uint64_t fraction = (high << 34) | ((mid & 0xffffffff) << 2) | ((low & 0xffffffff) >> 30);
+
+    // Round to the nearest quarter turn, leaving a fraction in [-1/2, 1/2]
+    double sign = 1.0;
+    if (fraction >> 63)
+    {
+        fraction = ~fraction + 1;
+        sign = -1.0;
+        q = (q + 1) & 3;
+    }
+    double turns = sign * std::ldexp(static_cast<double>(fraction), -64);
+    r = static_cast<float>(turns * 1.5707963267948966);
+
+    if (bits >> 31)
+    {
+        r = -r;
+        q = (4 - q) & 3;
+    }
+    return q;
+}
+
+// Reduce the lanes of a SIMD vector picked by the bits of mask with ReduceQuadrantLarge, replacing their r and q
+static void ReduceLanesLarge(const float* x, float* r, int32_t* q, unsigned int mask)
+{
+    for (int i = 0; mask != 0; ++i, mask >>= 1)
+    {
+        if (mask & 1)  q[i] = ReduceQuadrantLarge(x[i], r[i]);
+    }
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Single values
+-----------------------------------------------------------------------------------------*/
+
+// Remove whole quarter turns from x leaving an angle in [-pi/4, pi/4]. Returns the number of quarter turns,
+// which for large angles is only correct modulo 4 (all that the callers use)
+static inline int ReduceQuadrant(float x, float& r)
+{
+    if (!(std::abs(x) <= REDUCE_MAX))  return ReduceQuadrantLarge(x, r); // Also NaNs
+
+    int qi = static_cast<int>(x * TWO_OVER_PI + std::copysign(0.5f, x)); // Round to nearest
+    float q = static_cast<float>(qi);
+    r = ((x - q * PIO2_1) - q * PIO2_2) - q * PIO2_3;
+    return qi;
+}
+
+// Sine and cosine of the same angle (radians)
+void SinCos(float x, float& s, float& c)
+{
+    float r;
+    int q = ReduceQuadrant(x, r);
+
+    // Polynomial approximations near 0
+    float z = r * r;
+    float sr = ((SIN_P0 * z + SIN_P1) * z + SIN_P2) * z * r + r;
+    float cr = ((COS_P0 * z + COS_P1) * z + COS_P2) * z * z - 0.5f * z + 1.0f;
+
+    // Odd quadrants swap sin and cos, and the sign of each depends on the quadrant. Written without
+    // branches, which mispredict badly when angles vary
+    float swap    = static_cast<float>(q & 1);             // 0 or 1
+    float sinSign = static_cast<float>(1 - (q & 2));       // 1 or -1
+    float cosSign = static_cast<float>(1 - ((q + 1) & 2));
+    float keep    = 1.0f - swap;
+    s = (sr * keep + cr * swap) * sinSign; // One of the products is always zero, so this is exact
+    c = (cr * keep + sr * swap) * cosSign;
+}
+
+float FastSin(float x)
+{
+    float s, c;
+    SinCos(x, s, c);
+    return s;
+}
+
+float FastCos(float x)
+{
+    float s, c;
+    SinCos(x, s, c);
+    return c;
+}
+
+float FastTan(float x)
+{
+    float r;
+    int q = ReduceQuadrant(x, r);
+
+    float z = r * r;
+    float t = (((((TAN_P0 * z + TAN_P1) * z + TAN_P2) * z + TAN_P3) * z + TAN_P4) * z + TAN_P5) * z * r + r;
+
+    // tan(r + pi/2) = -1 / tan(r)
+    return (q & 1) ? -1.0f / t : t;
+}
+
+float FastAtan2(float y, float x)
+{
+    // Find the angle in the first octant from the smaller of |x| and |y| over the larger
+    float ax = std::abs(x), ay = std::abs(y);
+    float mn = ax < ay ? ax : ay;
+    float mx = ax < ay ? ay : ax;
+    float t = mx > 0.0f ? mn / mx : 0.0f;
+
+    // Shift into the range of the polynomial using atan(t) = pi/4 + atan((t-1)/(t+1))
+    float offset = 0.0f;
+    if (t > TAN_PI_OVER_8)
+    {
+        t = (t - 1.0f) / (t + 1.0f);
+        offset = PI_OVER_4;
+    }
+    float z = t * t;
+    float a = offset + (((ATAN_P0 * z + ATAN_P1) * z + ATAN_P2) * z + ATAN_P3) * z * t + t;
+
+    // Reflect the result into the correct octant
+    if (ay > ax)    a = PI_OVER_2 - a;
+    if (x < 0.0f)   a = PI_F - a;
+    return y < 0.0f ? -a : a;
+}
+
+float FastExp(float x)
+{
+    x = x > EXP_MAX ? EXP_MAX : (x < EXP_MIN ? EXP_MIN : x);
+
+    int ni = static_cast<int>(x * LOG2_E + std::copysign(0.5f, x));
+    float n = static_cast<float>(ni);
+    float r = (x - n * LN2_1) - n * LN2_2;
+
+    float z = r * r;
+    float e = (((((EXP_P0 * r + EXP_P1) * r + EXP_P2) * r + EXP_P3) * r + EXP_P4) * r + EXP_P5) * z + r + 1.0f;
+
+    // Multiply by 2^n by building the float directly
+    uint32_t bits = static_cast<uint32_t>(ni + 127) << 23;
+    float pow2n;
+    std::memcpy(&pow2n, &bits, sizeof(pow2n));
+    return e * pow2n;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Four values at a time (SSE2)
+-----------------------------------------------------------------------------------------*/
+// Choices are made with masks instead of branches: comparisons give all bits set in lanes
+// where they are true, then and/andnot/or pick between two results
+
+#if MATH_SIMD_X86
+
+static inline __m128 Select(__m128 mask, __m128 a, __m128 b) // mask ? a : b
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static inline __m128i ReduceQuadrant(__m128 x, __m128& r)
+{
+    __m128i qi = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(TWO_OVER_PI))); // Rounds to nearest
+    __m128  q  = _mm_cvtepi32_ps(qi);
+    r = _mm_sub_ps(x, _mm_mul_ps(q, _mm_set1_ps(PIO2_1)));
+    r = _mm_sub_ps(r, _mm_mul_ps(q, _mm_set1_ps(PIO2_2)));
+    r = _mm_sub_ps(r, _mm_mul_ps(q, _mm_set1_ps(PIO2_3)));
+
+    // Large angles and NaNs are rare, so are reduced one lane at a time
+    __m128 absX = _mm_andnot_ps(_mm_set1_ps(-0.0f), x);
+    int large = _mm_movemask_ps(_mm_cmpnle_ps(absX, _mm_set1_ps(REDUCE_MAX)));
+    if (large != 0)
+    {
+        alignas(16) float   xLanes[4], rLanes[4];
+        alignas(16) int32_t qLanes[4];
+        _mm_store_ps(xLanes, x);
+        _mm_store_ps(rLanes, r);
+        _mm_store_si128(reinterpret_cast<__m128i*>(qLanes), qi);
+        ReduceLanesLarge(xLanes, rLanes, qLanes, large);
+        r  = _mm_load_ps(rLanes);
+        qi = _mm_load_si128(reinterpret_cast<const __m128i*>(qLanes));
+    }
+    return qi;
+}
+
+void SinCos(const Vec4A& x, Vec4A& s, Vec4A& c)
+{
+    __m128 r;
+    __m128i q = ReduceQuadrant(x.v, r);
+
+    __m128 z  = _mm_mul_ps(r, r);
+    __m128 sr = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(SIN_P0), z), _mm_set1_ps(SIN_P1)), z), _mm_set1_ps(SIN_P2)), z), r), r);
+    __m128 cr = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(COS_P0), z), _mm_set1_ps(COS_P1)), z), _mm_set1_ps(COS_P2)), _mm_mul_ps(z, z));
+    cr = _mm_add_ps(_mm_sub_ps(cr, _mm_mul_ps(_mm_set1_ps(0.5f), z)), _mm_set1_ps(1.0f));
+
+    __m128 swap     = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+    __m128 sinSign  = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(q, _mm_set1_epi32(2)), 30));
+    __m128 cosSign  = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(q, _mm_set1_epi32(1)), _mm_set1_epi32(2)), 30));
+    s.v = _mm_xor_ps(Select(swap, cr, sr), sinSign);
+    c.v = _mm_xor_ps(Select(swap, sr, cr), cosSign);
+}
+
+Vec4A Sin(const Vec4A& x)
+{
+    Vec4A s, c;
+    SinCos(x, s, c);
+    return s;
+}
+
+Vec4A Cos(const Vec4A& x)
+{
+    Vec4A s, c;
+    SinCos(x, s, c);
+    return c;
+}
+
+Vec4A Tan(const Vec4A& x)
+{
+    __m128 r;
+    __m128i q = ReduceQuadrant(x.v, r);
+
+    __m128 z = _mm_mul_ps(r, r);
+    __m128 t = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(TAN_P0), z), _mm_set1_ps(TAN_P1));
+    t = _mm_add_ps(_mm_mul_ps(t, z), _mm_set1_ps(TAN_P2));
+    t = _mm_add_ps(_mm_mul_ps(t, z), _mm_set1_ps(TAN_P3));
+    t = _mm_add_ps(_mm_mul_ps(t, z), _mm_set1_ps(TAN_P4));
+    t = _mm_add_ps(_mm_mul_ps(t, z), _mm_set1_ps(TAN_P5));
+    t = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(t, z), r), r);
+
+    __m128 odd = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+    return Select(odd, _mm_div_ps(_mm_set1_ps(-1.0f), t), t);
+}
+
+Vec4A Atan2(const Vec4A& y, const Vec4A& x)
+{
+    __m128 signMask = _mm_set1_ps(-0.0f);
+    __m128 ax = _mm_andnot_ps(signMask, x.v);
+    __m128 ay = _mm_andnot_ps(signMask, y.v);
+    __m128 mn = _mm_min_ps(ax, ay);
+    __m128 mx = _mm_max_ps(ax, ay);
+    __m128 t  = _mm_and_ps(_mm_div_ps(mn, mx), _mm_cmpgt_ps(mx, _mm_setzero_ps())); // 0/0 gives 0
+
+    __m128 big    = _mm_cmpgt_ps(t, _mm_set1_ps(TAN_PI_OVER_8));
+    __m128 one    = _mm_set1_ps(1.0f);
+    t = Select(big, _mm_div_ps(_mm_sub_ps(t, one), _mm_add_ps(t, one)), t);
+    __m128 offset = _mm_and_ps(big, _mm_set1_ps(PI_OVER_4));
+
+    __m128 z = _mm_mul_ps(t, t);
+    __m128 a = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(ATAN_P0), z), _mm_set1_ps(ATAN_P1));
+    a = _mm_add_ps(_mm_mul_ps(a, z), _mm_set1_ps(ATAN_P2));
+    a = _mm_add_ps(_mm_mul_ps(a, z), _mm_set1_ps(ATAN_P3));
+    a = _mm_add_ps(offset, _mm_add_ps(_mm_mul_ps(_mm_mul_ps(a, z), t), t));
+
+    a = Select(_mm_cmpgt_ps(ay, ax), _mm_sub_ps(_mm_set1_ps(PI_OVER_2), a), a);
+    a = Select(_mm_cmplt_ps(x.v, _mm_setzero_ps()), _mm_sub_ps(_mm_set1_ps(PI_F), a), a);
+    return _mm_or_ps(a, _mm_and_ps(_mm_cmplt_ps(y.v, _mm_setzero_ps()), signMask));
+}
+
+Vec4A Exp(const Vec4A& xIn)
+{
+    __m128 x = _mm_min_ps(_mm_max_ps(xIn.v, _mm_set1_ps(EXP_MIN)), _mm_set1_ps(EXP_MAX));
+
+    __m128i ni = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(LOG2_E)));
+    __m128  n  = _mm_cvtepi32_ps(ni);
+    __m128  r  = _mm_sub_ps(_mm_sub_ps(x, _mm_mul_ps(n, _mm_set1_ps(LN2_1))), _mm_mul_ps(n, _mm_set1_ps(LN2_2)));
+
+    __m128 z = _mm_mul_ps(r, r);
+    __m128 e = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(EXP_P0), r), _mm_set1_ps(EXP_P1));
+    e = _mm_add_ps(_mm_mul_ps(e, r), _mm_set1_ps(EXP_P2));
+    e = _mm_add_ps(_mm_mul_ps(e, r), _mm_set1_ps(EXP_P3));
+    e = _mm_add_ps(_mm_mul_ps(e, r), _mm_set1_ps(EXP_P4));
+    e = _mm_add_ps(_mm_mul_ps(e, r), _mm_set1_ps(EXP_P5));
+    e = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e, z), r), _mm_set1_ps(1.0f));
+
+    __m128 pow2n = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(ni, _mm_set1_epi32(127)), 23));
+    return _mm_mul_ps(e, pow2n);
+}
+
+#else // !MATH_SIMD_X86
+
+// CPUs without SSE use the single value versions on each component in turn
+
+void SinCos(const Vec4A& x, Vec4A& s, Vec4A& c)
+{
+    for (int i = 0; i < 4; ++i)  SinCos(x.v[i], s.v[i], c.v[i]);
+}
+
+Vec4A Sin(const Vec4A& x)  { return Vec4A(FastSin(x.v[0]), FastSin(x.v[1]), FastSin(x.v[2]), FastSin(x.v[3])); }
+Vec4A Cos(const Vec4A& x)  { return Vec4A(FastCos(x.v[0]), FastCos(x.v[1]), FastCos(x.v[2]), FastCos(x.v[3])); }
+Vec4A Tan(const Vec4A& x)  { return Vec4A(FastTan(x.v[0]), FastTan(x.v[1]), FastTan(x.v[2]), FastTan(x.v[3])); }
+Vec4A Exp(const Vec4A& x)  { return Vec4A(FastExp(x.v[0]), FastExp(x.v[1]), FastExp(x.v[2]), FastExp(x.v[3])); }
+
+Vec4A Atan2(const Vec4A& y, const Vec4A& x)
+{
+    return Vec4A(FastAtan2(y.v[0], x.v[0]), FastAtan2(y.v[1], x.v[1]), FastAtan2(y.v[2], x.v[2]), FastAtan2(y.v[3], x.v[3]));
+}
+
+#endif // MATH_SIMD_X86
+
+
+/*-----------------------------------------------------------------------------------------
+    Wider SIMD versions
+-----------------------------------------------------------------------------------------*/
+// Same steps as the four-wide versions above. These use fused multiply-add so may differ from
+// the other versions in the last bit
+
+#if MATH_SIMD_X86
+
+//*********************************
+// AVX2 - 8 at a time
+
+SIMD_TARGET_AVX2_FMA static inline __m256i ReduceQuadrantAVX2(__m256 x, __m256& r)
+{
+    __m256i qi = _mm256_cvtps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(TWO_OVER_PI)));
+    __m256  q  = _mm256_cvtepi32_ps(qi);
+    r = _mm256_fnmadd_ps(q, _mm256_set1_ps(PIO2_1), x);
+    r = _mm256_fnmadd_ps(q, _mm256_set1_ps(PIO2_2), r);
+    r = _mm256_fnmadd_ps(q, _mm256_set1_ps(PIO2_3), r);
+
+    __m256 absX = _mm256_andnot_ps(_mm256_set1_ps(-0.0f), x);
+    int large = _mm256_movemask_ps(_mm256_cmp_ps(absX, _mm256_set1_ps(REDUCE_MAX), _CMP_NLE_UQ));
+    if (large != 0)
+    {
+        alignas(32) float   xLanes[8], rLanes[8];
+        alignas(32) int32_t qLanes[8];
+        _mm256_store_ps(xLanes, x);
+        _mm256_store_ps(rLanes, r);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(qLanes), qi);
+        ReduceLanesLarge(xLanes, rLanes, qLanes, large);
+        r  = _mm256_load_ps(rLanes);
+        qi = _mm256_load_si256(reinterpret_cast<const __m256i*>(qLanes));
+    }
+    return qi;
+}
+
+SIMD_TARGET_AVX2_FMA static inline void SinCosAVX2(__m256 x, __m256& s, __m256& c)
+{
+    __m256 r;
+    __m256i q = ReduceQuadrantAVX2(x, r);
+
+    __m256 z  = _mm256_mul_ps(r, r);
+    __m256 sr = _mm256_fmadd_ps(_mm256_set1_ps(SIN_P0), z, _mm256_set1_ps(SIN_P1));
+    sr = _mm256_fmadd_ps(sr, z, _mm256_set1_ps(SIN_P2));
+    sr = _mm256_fmadd_ps(_mm256_mul_ps(sr, z), r, r);
+    __m256 cr = _mm256_fmadd_ps(_mm256_set1_ps(COS_P0), z, _mm256_set1_ps(COS_P1));
+    cr = _mm256_fmadd_ps(cr, z, _mm256_set1_ps(COS_P2));
+    cr = _mm256_fnmadd_ps(_mm256_set1_ps(0.5f), z, _mm256_mul_ps(cr, _mm256_mul_ps(z, z)));
+    cr = _mm256_add_ps(cr, _mm256_set1_ps(1.0f));
+
+    __m256 swap    = _mm256_castsi256_ps(_mm256_slli_epi32(q, 31));
+    __m256 sinSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(q, _mm256_set1_epi32(2)), 30));
+    __m256 cosSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(_mm256_add_epi32(q, _mm256_set1_epi32(1)), _mm256_set1_epi32(2)), 30));
+    s = _mm256_xor_ps(_mm256_blendv_ps(sr, cr, swap), sinSign); // blendv only looks at the top bit
+    c = _mm256_xor_ps(_mm256_blendv_ps(cr, sr, swap), cosSign);
+}
+
+SIMD_TARGET_AVX2_FMA static inline __m256 TanAVX2(__m256 x)
+{
+    __m256 r;
+    __m256i q = ReduceQuadrantAVX2(x, r);
+
+    __m256 z = _mm256_mul_ps(r, r);
+    __m256 t = _mm256_fmadd_ps(_mm256_set1_ps(TAN_P0), z, _mm256_set1_ps(TAN_P1));
+    t = _mm256_fmadd_ps(t, z, _mm256_set1_ps(TAN_P2));
+    t = _mm256_fmadd_ps(t, z, _mm256_set1_ps(TAN_P3));
+    t = _mm256_fmadd_ps(t, z, _mm256_set1_ps(TAN_P4));
+    t = _mm256_fmadd_ps(t, z, _mm256_set1_ps(TAN_P5));
+    t = _mm256_fmadd_ps(_mm256_mul_ps(t, z), r, r);
+
+    __m256 odd = _mm256_castsi256_ps(_mm256_slli_epi32(q, 31));
+    return _mm256_blendv_ps(t, _mm256_div_ps(_mm256_set1_ps(-1.0f), t), odd);
+}
+
+SIMD_TARGET_AVX2_FMA static inline __m256 Atan2AVX2(__m256 y, __m256 x)
+{
+    __m256 signMask = _mm256_set1_ps(-0.0f);
+    __m256 ax = _mm256_andnot_ps(signMask, x);
+    __m256 ay = _mm256_andnot_ps(signMask, y);
+    __m256 mn = _mm256_min_ps(ax, ay);
+    __m256 mx = _mm256_max_ps(ax, ay);
+    __m256 t  = _mm256_and_ps(_mm256_div_ps(mn, mx), _mm256_cmp_ps(mx, _mm256_setzero_ps(), _CMP_GT_OQ));
+
+    __m256 big = _mm256_cmp_ps(t, _mm256_set1_ps(TAN_PI_OVER_8), _CMP_GT_OQ);
+    __m256 one = _mm256_set1_ps(1.0f);
+    t = _mm256_blendv_ps(t, _mm256_div_ps(_mm256_sub_ps(t, one), _mm256_add_ps(t, one)), big);
+    __m256 offset = _mm256_and_ps(big, _mm256_set1_ps(PI_OVER_4));
+
+    __m256 z = _mm256_mul_ps(t, t);
+    __m256 a = _mm256_fmadd_ps(_mm256_set1_ps(ATAN_P0), z, _mm256_set1_ps(ATAN_P1));
+    a = _mm256_fmadd_ps(a, z, _mm256_set1_ps(ATAN_P2));
+    a = _mm256_fmadd_ps(a, z, _mm256_set1_ps(ATAN_P3));
+    a = _mm256_add_ps(offset, _mm256_fmadd_ps(_mm256_mul_ps(a, z), t, t));
+
+    a = _mm256_blendv_ps(a, _mm256_sub_ps(_mm256_set1_ps(PI_OVER_2), a), _mm256_cmp_ps(ay, ax, _CMP_GT_OQ));
+    a = _mm256_blendv_ps(a, _mm256_sub_ps(_mm256_set1_ps(PI_F), a), _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_LT_OQ));
+    return _mm256_or_ps(a, _mm256_and_ps(_mm256_cmp_ps(y, _mm256_setzero_ps(), _CMP_LT_OQ), signMask));
+}
+
+SIMD_TARGET_AVX2_FMA static inline __m256 ExpAVX2(__m256 x)
+{
+    x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(EXP_MIN)), _mm256_set1_ps(EXP_MAX));
+
+    __m256i ni = _mm256_cvtps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(LOG2_E)));
+    __m256  n  = _mm256_cvtepi32_ps(ni);
+    __m256  r  = _mm256_fnmadd_ps(n, _mm256_set1_ps(LN2_2), _mm256_fnmadd_ps(n, _mm256_set1_ps(LN2_1), x));
+
+    __m256 z = _mm256_mul_ps(r, r);
+    __m256 e = _mm256_fmadd_ps(_mm256_set1_ps(EXP_P0), r, _mm256_set1_ps(EXP_P1));
+    e = _mm256_fmadd_ps(e, r, _mm256_set1_ps(EXP_P2));
+    e = _mm256_fmadd_ps(e, r, _mm256_set1_ps(EXP_P3));
+    e = _mm256_fmadd_ps(e, r, _mm256_set1_ps(EXP_P4));
+    e = _mm256_fmadd_ps(e, r, _mm256_set1_ps(EXP_P5));
+    e = _mm256_add_ps(_mm256_fmadd_ps(e, z, r), _mm256_set1_ps(1.0f));
+
+    __m256 pow2n = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(ni, _mm256_set1_epi32(127)), 23));
+    return _mm256_mul_ps(e, pow2n);
+}
+
+
+//*********************************
+// AVX-512 - 16 at a time. Comparisons give mask registers rather than vectors of bits
+
+SIMD_TARGET_AVX512_FMA static inline __m512i ReduceQuadrantAVX512(__m512 x, __m512& r)
+{
+    __m512i qi = _mm512_cvtps_epi32(_mm512_mul_ps(x, _mm512_set1_ps(TWO_OVER_PI)));
+    __m512  q  = _mm512_cvtepi32_ps(qi);
+    r = _mm512_fnmadd_ps(q, _mm512_set1_ps(PIO2_1), x);
+    r = _mm512_fnmadd_ps(q, _mm512_set1_ps(PIO2_2), r);
+    r = _mm512_fnmadd_ps(q, _mm512_set1_ps(PIO2_3), r);
+
+    __mmask16 large = _mm512_cmp_ps_mask(_mm512_abs_ps(x), _mm512_set1_ps(REDUCE_MAX), _CMP_NLE_UQ);
+    if (large != 0)
+    {
+        alignas(64) float   xLanes[16], rLanes[16];
+        alignas(64) int32_t qLanes[16];
+        _mm512_store_ps(xLanes, x);
+        _mm512_store_ps(rLanes, r);
+        _mm512_store_si512(qLanes, qi);
+        ReduceLanesLarge(xLanes, rLanes, qLanes, large);
+        r  = _mm512_load_ps(rLanes);
+        qi = _mm512_load_si512(qLanes);
+    }
+    return qi;
+}
+
+SIMD_TARGET_AVX512_FMA static inline void SinCosAVX512(__m512 x, __m512& s, __m512& c)
+{
+    __m512 r;
+    __m512i q = ReduceQuadrantAVX512(x, r);
+
+    __m512 z  = _mm512_mul_ps(r, r);
+    __m512 sr = _mm512_fmadd_ps(_mm512_set1_ps(SIN_P0), z, _mm512_set1_ps(SIN_P1));
+    sr = _mm512_fmadd_ps(sr, z, _mm512_set1_ps(SIN_P2));
+    sr = _mm512_fmadd_ps(_mm512_mul_ps(sr, z), r, r);
+    __m512 cr = _mm512_fmadd_ps(_mm512_set1_ps(COS_P0), z, _mm512_set1_ps(COS_P1));
+    cr = _mm512_fmadd_ps(cr, z, _mm512_set1_ps(COS_P2));
+    cr = _mm512_fnmadd_ps(_mm512_set1_ps(0.5f), z, _mm512_mul_ps(cr, _mm512_mul_ps(z, z)));
+    cr = _mm512_add_ps(cr, _mm512_set1_ps(1.0f));
+
+    __mmask16 swap = _mm512_test_epi32_mask(q, _mm512_set1_epi32(1));
+    __m512i sinSign = _mm512_slli_epi32(_mm512_and_si512(q, _mm512_set1_epi32(2)), 30);
+    __m512i cosSign = _mm512_slli_epi32(_mm512_and_si512(_mm512_add_epi32(q, _mm512_set1_epi32(1)), _mm512_set1_epi32(2)), 30);
+    s = _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(_mm512_mask_blend_ps(swap, sr, cr)), sinSign));
+    c = _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(_mm512_mask_blend_ps(swap, cr, sr)), cosSign));
+}
+
+SIMD_TARGET_AVX512_FMA static inline __m512 TanAVX512(__m512 x)
+{
+    __m512 r;
+    __m512i q = ReduceQuadrantAVX512(x, r);
+
+    __m512 z = _mm512_mul_ps(r, r);
+    __m512 t = _mm512_fmadd_ps(_mm512_set1_ps(TAN_P0), z, _mm512_set1_ps(TAN_P1));
+    t = _mm512_fmadd_ps(t, z, _mm512_set1_ps(TAN_P2));
+    t = _mm512_fmadd_ps(t, z, _mm512_set1_ps(TAN_P3));
+    t = _mm512_fmadd_ps(t, z, _mm512_set1_ps(TAN_P4));
+    t = _mm512_fmadd_ps(t, z, _mm512_set1_ps(TAN_P5));
+    t = _mm512_fmadd_ps(_mm512_mul_ps(t, z), r, r);
+
+    __mmask16 odd = _mm512_test_epi32_mask(q, _mm512_set1_epi32(1));
+    return _mm512_mask_div_ps(t, odd, _mm512_set1_ps(-1.0f), t);
+}
+
+SIMD_TARGET_AVX512_FMA static inline __m512 Atan2AVX512(__m512 y, __m512 x)
+{
+    __m512 ax = _mm512_abs_ps(x);
+    __m512 ay = _mm512_abs_ps(y);
+    __m512 mn = _mm512_min_ps(ax, ay);
+    __m512 mx = _mm512_max_ps(ax, ay);
+    __m512 t  = _mm512_maskz_div_ps(_mm512_cmp_ps_mask(mx, _mm512_setzero_ps(), _CMP_GT_OQ), mn, mx);
+
+    __mmask16 big = _mm512_cmp_ps_mask(t, _mm512_set1_ps(TAN_PI_OVER_8), _CMP_GT_OQ);
+    __m512 one = _mm512_set1_ps(1.0f);
+    t = _mm512_mask_div_ps(t, big, _mm512_sub_ps(t, one), _mm512_add_ps(t, one));
+    __m512 offset = _mm512_maskz_mov_ps(big, _mm512_set1_ps(PI_OVER_4));
+
+    __m512 z = _mm512_mul_ps(t, t);
+    __m512 a = _mm512_fmadd_ps(_mm512_set1_ps(ATAN_P0), z, _mm512_set1_ps(ATAN_P1));
+    a = _mm512_fmadd_ps(a, z, _mm512_set1_ps(ATAN_P2));
+    a = _mm512_fmadd_ps(a, z, _mm512_set1_ps(ATAN_P3));
+    a = _mm512_add_ps(offset, _mm512_fmadd_ps(_mm512_mul_ps(a, z), t, t));
+
+    a = _mm512_mask_sub_ps(a, _mm512_cmp_ps_mask(ay, ax, _CMP_GT_OQ), _mm512_set1_ps(PI_OVER_2), a);
+    a = _mm512_mask_sub_ps(a, _mm512_cmp_ps_mask(x, _mm512_setzero_ps(), _CMP_LT_OQ), _mm512_set1_ps(PI_F), a);
+    return _mm512_mask_sub_ps(a, _mm512_cmp_ps_mask(y, _mm512_setzero_ps(), _CMP_LT_OQ), _mm512_setzero_ps(), a);
+}
+
+SIMD_TARGET_AVX512_FMA static inline __m512 ExpAVX512(__m512 x)
+{
+    x = _mm512_min_ps(_mm512_max_ps(x, _mm512_set1_ps(EXP_MIN)), _mm512_set1_ps(EXP_MAX));
+
+    __m512i ni = _mm512_cvtps_epi32(_mm512_mul_ps(x, _mm512_set1_ps(LOG2_E)));
+    __m512  n  = _mm512_cvtepi32_ps(ni);
+    __m512  r  = _mm512_fnmadd_ps(n, _mm512_set1_ps(LN2_2), _mm512_fnmadd_ps(n, _mm512_set1_ps(LN2_1), x));
+
+    __m512 z = _mm512_mul_ps(r, r);
+    __m512 e = _mm512_fmadd_ps(_mm512_set1_ps(EXP_P0), r, _mm512_set1_ps(EXP_P1));
+    e = _mm512_fmadd_ps(e, r, _mm512_set1_ps(EXP_P2));
+    e = _mm512_fmadd_ps(e, r, _mm512_set1_ps(EXP_P3));
+    e = _mm512_fmadd_ps(e, r, _mm512_set1_ps(EXP_P4));
+    e = _mm512_fmadd_ps(e, r, _mm512_set1_ps(EXP_P5));
+    e = _mm512_add_ps(_mm512_fmadd_ps(e, z, r), _mm512_set1_ps(1.0f));
+
+    return _mm512_scalef_ps(e, n); // e * 2^n
+}
+
+#endif
+
+
+/*-----------------------------------------------------------------------------------------
+    Arrays
+-----------------------------------------------------------------------------------------*/
+// Each array function runs the widest version the CPU supports over whole blocks of values,
+// then finishes the remaining values with the single value version
+
+// The array operations, selected by template parameter so the loops can be shared
+enum class ArrayOp
+{
+    SinCos,
+    Sin,
+    Cos,
+    Tan,
+    Atan2,
+    Exp,
+};
+
+// in2 is only used by Atan2 (it holds x, in1 holds y), out2 is only used by SinCos (cos values)
+template <ArrayOp Op>
+static void ArrayScalar(const float* in1, const float* in2, float* out1, float* out2, int start, int count)
+{
+    for (int i = start; i < count; ++i)
+    {
+        switch (Op)
+        {
+            case ArrayOp::SinCos: SinCos(in1[i], out1[i], out2[i]);  break;
+            case ArrayOp::Sin:    out1[i] = FastSin(in1[i]);         break;
+            case ArrayOp::Cos:    out1[i] = FastCos(in1[i]);         break;
+            case ArrayOp::Tan:    out1[i] = FastTan(in1[i]);         break;
+            case ArrayOp::Atan2:  out1[i] = FastAtan2(in1[i], in2[i]); break;
+            case ArrayOp::Exp:    out1[i] = FastExp(in1[i]);         break;
+        }
+    }
+}
+
+#if MATH_SIMD_X86
+
+template <ArrayOp Op>
+static int ArraySSE(const float* in1, const float* in2, float* out1, float* out2, int count)
+{
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        Vec4A x = Vec4A::Load(in1 + i);
+        Vec4A s, c;
+        switch (Op)
+        {
+            case ArrayOp::SinCos: SinCos(x, s, c);  s.Store(out1 + i);  c.Store(out2 + i);   break;
+            case ArrayOp::Sin:    Sin(x).Store(out1 + i);                                     break;
+            case ArrayOp::Cos:    Cos(x).Store(out1 + i);                                     break;
+            case ArrayOp::Tan:    Tan(x).Store(out1 + i);                                     break;
+            case ArrayOp::Atan2:  Atan2(x, Vec4A::Load(in2 + i)).Store(out1 + i);             break;
+            case ArrayOp::Exp:    Exp(x).Store(out1 + i);                                     break;
+        }
+    }
+    return i;
+}
+
+template <ArrayOp Op>
+SIMD_TARGET_AVX2_FMA static int ArrayAVX2(const float* in1, const float* in2, float* out1, float* out2, int count)
+{
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 x = _mm256_loadu_ps(in1 + i);
+        __m256 s, c;
+        switch (Op)
+        {
+            case ArrayOp::SinCos: SinCosAVX2(x, s, c);  _mm256_storeu_ps(out1 + i, s);  _mm256_storeu_ps(out2 + i, c);  break;
+            case ArrayOp::Sin:    SinCosAVX2(x, s, c);  _mm256_storeu_ps(out1 + i, s);  break;
+            case ArrayOp::Cos:    SinCosAVX2(x, s, c);  _mm256_storeu_ps(out1 + i, c);  break;
+            case ArrayOp::Tan:    _mm256_storeu_ps(out1 + i, TanAVX2(x));                              break;
+            case ArrayOp::Atan2:  _mm256_storeu_ps(out1 + i, Atan2AVX2(x, _mm256_loadu_ps(in2 + i))); break;
+            case ArrayOp::Exp:    _mm256_storeu_ps(out1 + i, ExpAVX2(x));                              break;
+        }
+    }
+    return i;
+}
+
+template <ArrayOp Op>
+SIMD_TARGET_AVX512_FMA static int ArrayAVX512(const float* in1, const float* in2, float* out1, float* out2, int count)
+{
+    int i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __m512 x = _mm512_loadu_ps(in1 + i);
+        __m512 s, c;
+        switch (Op)
+        {
+            case ArrayOp::SinCos: SinCosAVX512(x, s, c);  _mm512_storeu_ps(out1 + i, s);  _mm512_storeu_ps(out2 + i, c);  break;
+            case ArrayOp::Sin:    SinCosAVX512(x, s, c);  _mm512_storeu_ps(out1 + i, s);  break;
+            case ArrayOp::Cos:    SinCosAVX512(x, s, c);  _mm512_storeu_ps(out1 + i, c);  break;
+            case ArrayOp::Tan:    _mm512_storeu_ps(out1 + i, TanAVX512(x));                              break;
+            case ArrayOp::Atan2:  _mm512_storeu_ps(out1 + i, Atan2AVX512(x, _mm512_loadu_ps(in2 + i))); break;
+            case ArrayOp::Exp:    _mm512_storeu_ps(out1 + i, ExpAVX512(x));                              break;
+        }
+    }
+    return i;
+}
+
+#endif
+
+template <ArrayOp Op>
+static void Array(const float* in1, const float* in2, float* out1, float* out2, int count)
+{
+    int done = 0;
+#if MATH_SIMD_X86
+    switch (GetSimdLevel())
+    {
+        case SimdLevel::AVX512: done = ArrayAVX512<Op>(in1, in2, out1, out2, count); break;
+        case SimdLevel::AVX2:   done = ArrayAVX2  <Op>(in1, in2, out1, out2, count); break;
+        case SimdLevel::SSE41:  done = ArraySSE   <Op>(in1, in2, out1, out2, count); break;
+        default: break;
+    }
+#endif
+    ArrayScalar<Op>(in1, in2, out1, out2, done, count);
+}
+
+
+void SinCosMany(const float* x, float* s, float* c, int count)          { Array<ArrayOp::SinCos>(x, nullptr, s, c, count);      }
+void SinMany(const float* x, float* out, int count)                    { Array<ArrayOp::Sin>   (x, nullptr, out, nullptr, count); }
+void CosMany(const float* x, float* out, int count)                    { Array<ArrayOp::Cos>   (x, nullptr, out, nullptr, count); }
+void TanMany(const float* x, float* out, int count)                    { Array<ArrayOp::Tan>   (x, nullptr, out, nullptr, count); }
+void Atan2Many(const float* y, const float* x, float* out, int count)  { Array<ArrayOp::Atan2> (y, x, out, nullptr, count);       }
+void ExpMany(const float* x, float* out, int count)                    { Array<ArrayOp::Exp>   (x, nullptr, out, nullptr, count); }
@@ -0,0 +1,68 @@
+//--------------------------------------------------------------------------------------
+// Fast sin, cos, tan, atan2 and exp - single values, four at a time, or whole arrays
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+//
+// Polynomial approximations (based on the Cephes maths library) that are faster than the
+// standard library functions, especially when many values are calculated together. All
+// versions use the same method so results agree closely whichever is used. The array
+// functions process 4, 8 or 16 values per instruction depending on the CPU (see SIMD.h).
+//
+// Maximum errors, measured against double precision results over the ranges given:
+//   Sin, Cos, SinCos  any finite x     absolute error 8e-8 (about one unit in the last place near 1)
+//   Tan               any finite x     relative error 2e-7, away from the poles at odd multiples of pi/2
+//   Atan2             any finite x, y  absolute error 3e-7 radians
+//   Exp               -87 <= x <= 88   relative error 1e-7. Inputs outside this range are clamped
+// Angles larger than 8192 are reduced exactly by a much slower method, one value at a time, so keep
+// angles small where speed matters (e.g. wrap them with fmod when accumulating them over time).
+// Sin, cos and tan of infinities and NaNs are NaN, otherwise infinities and NaNs are not handled
+// specially and give meaningless results. Atan2 does not distinguish +0 and -0 in x.
+
+#ifndef _MATH_HELPERS_SIMD_H_DEFINED_
+#define _MATH_HELPERS_SIMD_H_DEFINED_
+
+#include "Vec4A.h"
+
+
+/*-----------------------------------------------------------------------------------------
+    Single values
+-----------------------------------------------------------------------------------------*/
+
+// Sine and cosine of the same angle (radians), costs little more than one of them alone
+void SinCos(float x, float& s, float& c);
+
+float FastSin(float x);
+float FastCos(float x);
+float FastTan(float x);
+float FastAtan2(float y, float x);
+float FastExp(float x);
+
+
+/*-----------------------------------------------------------------------------------------
+    Four values at a time
+-----------------------------------------------------------------------------------------*/
+// Only need SSE2, which all x64 CPUs support
+
+void  SinCos(const Vec4A& x, Vec4A& s, Vec4A& c);
+Vec4A Sin(const Vec4A& x);
+Vec4A Cos(const Vec4A& x);
+Vec4A Tan(const Vec4A& x);
+Vec4A Atan2(const Vec4A& y, const Vec4A& x);
+Vec4A Exp(const Vec4A& x);
+
+
+/*-----------------------------------------------------------------------------------------
+    Arrays
+-----------------------------------------------------------------------------------------*/
+// Process count values using the best SIMD version for this CPU. Outputs may be the same
+// array as an input, but must not partly overlap it
+
+void SinCosMany(const float* x, float* s, float* c, int count);
+void SinMany(const float* x, float* out, int count);
+void CosMany(const float* x, float* out, int count);
+void TanMany(const float* x, float* out, int count);
+void Atan2Many(const float* y, const float* x, float* out, int count);
+void ExpMany(const float* x, float* out, int count);
+
+
+#endif // _MATH_HELPERS_SIMD_H_DEFINED_
@@ -0,0 +1,229 @@
+//--------------------------------------------------------------------------------------
+// Quaternion class (cut down version) to hold rotations for 3D
+//--------------------------------------------------------------------------------------
+
+#include "Quaternion.h"
+#include "MathHelpers.h"
+
+
+/*-----------------------------------------------------------------------------------------
+    Operators
+-----------------------------------------------------------------------------------------*/
+
+// Combine two rotations, q1 is applied first then q2 (same order as matrix multiplication).
+// This is the standard quaternion product q2q1, written out in full
+Quaternion operator* (const Quaternion& q1, const Quaternion& q2)
+{
+    return Quaternion{ q2.w*q1.x + q2.x*q1.w + q2.y*q1.z - q2.z*q1.y,
+                       q2.w*q1.y - q2.x*q1.z + q2.y*q1.w + q2.z*q1.x,
+                       q2.w*q1.z + q2.x*q1.y - q2.y*q1.x + q2.z*q1.w,
+                       q2.w*q1.w - q2.x*q1.x - q2.y*q1.y - q2.z*q1.z };
+}
+
+// Rotate this quaternion by the given one (i.e. this rotation followed by q)
+Quaternion& Quaternion::operator*= (const Quaternion& q)
+{
+    *this = *this * q;
+    return *this;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Member functions
+-----------------------------------------------------------------------------------------*/
+
+// Return the rotation as Euler angles in radians, in the same form as Model and Camera use.
+// Uses the same method as CMatrix4x4::GetEulerAngles, but only calculates the five matrix
+// elements that are needed
+CVector3 Quaternion::ToEulerAngles() const
+{
+    float e21 = 2.0f * (y*z - x*w);
+    float sX = -e21;
+    float cX = std::sqrt(1.0f - sX*sX);
+
+    // If no gimbal lock...
+    if (std::abs(cX) > 0.001f)
+    {
+        float e01 = 2.0f * (x*y + z*w);
+        float e11 = 1.0f - 2.0f * (x*x + z*z);
+        float e20 = 2.0f * (x*z + y*w);
+        float e22 = 1.0f - 2.0f * (x*x + y*y);
+        return { std::atan2(sX, cX), std::atan2(e20, e22), std::atan2(e01, e11) };
+    }
+    else
+    {
+        // Gimbal lock - force Z angle to 0
+        float e00 = 1.0f - 2.0f * (y*y + z*z);
+        float e02 = 2.0f * (x*z - y*w);
+        return { std::atan2(sX, cX), std::atan2(-e02, e00), 0.0f };
+    }
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Non-member functions
+-----------------------------------------------------------------------------------------*/
+
+// Return a rotation of the given angle (radians) around the given axis. The axis must be unit length
+Quaternion QuaternionFromAxisAngle(const CVector3& axis, float angle)
+{
+    float s = std::sin(angle * 0.5f);
+    float c = std::cos(angle * 0.5f);
+    return Quaternion{ axis.x * s, axis.y * s, axis.z * s, c };
+}
+
+
+// Return a rotation matching the given Euler angles in radians, as used by Model and Camera
+// (rotation Z first, then X, then Y). Equivalent to combining the three single axis rotations
+// but with the zero terms removed
+Quaternion QuaternionFromEulerAngles(const CVector3& angles)
+{
+    float sX = std::sin(angles.x * 0.5f), cX = std::cos(angles.x * 0.5f);
+    float sY = std::sin(angles.y * 0.5f), cY = std::cos(angles.y * 0.5f);
+    float sZ = std::sin(angles.z * 0.5f), cZ = std::cos(angles.z * 0.5f);
+
+    return Quaternion{ cY*sX*cZ + sY*cX*sZ,
+                       sY*cX*cZ - cY*sX*sZ,
+                       cY*cX*sZ - sY*sX*cZ,
+                       cY*cX*cZ + sY*sX*sZ };
+}
+
+
+// Return the rotation part of the given matrix, which may contain scaling but no shear
+Quaternion QuaternionFromMatrix(const CMatrix4x4& m)
+{
+    // Remove scaling from the rotation part of the matrix
+    CVector3 axisX = Normalise(m.GetXAxis());
+    CVector3 axisY = Normalise(m.GetYAxis());
+    CVector3 axisZ = Normalise(m.GetZAxis());
+    float e00 = axisX.x, e01 = axisX.y, e02 = axisX.z;
+    float e10 = axisY.x, e11 = axisY.y, e12 = axisY.z;
+    float e20 = axisZ.x, e21 = axisZ.y, e22 = axisZ.z;
+
+    // Calculate from the largest of w, x, y or z to avoid dividing by a small number
+    Quaternion q;
+    float trace = e00 + e11 + e22;
+    if (trace > 0.0f)
+    {
+        float s = 2.0f * std::sqrt(trace + 1.0f);
+        q = { (e12 - e21) / s, (e20 - e02) / s, (e01 - e10) / s, 0.25f * s };
+    }
+    else if (e00 > e11 && e00 > e22)
+    {
+        float s = 2.0f * std::sqrt(1.0f + e00 - e11 - e22);
+        q = { 0.25f * s, (e01 + e10) / s, (e20 + e02) / s, (e12 - e21) / s };
+    }
+    else if (e11 > e22)
+    {
+        float s = 2.0f * std::sqrt(1.0f + e11 - e00 - e22);
+        q = { (e01 + e10) / s, 0.25f * s, (e12 + e21) / s, (e20 - e02) / s };
+    }
+    else
+    {
+        float s = 2.0f * std::sqrt(1.0f + e22 - e00 - e11);
+        q = { (e20 + e02) / s, (e12 + e21) / s, 0.25f * s, (e01 - e10) / s };
+    }
+    return Normalise(q);
+}
+
+
+// Return a rotation that turns the Z axis to face in the given direction, keeping the X axis
+// horizontal with respect to the given up vector. Returns the identity if the direction is
+// zero or parallel to up
+Quaternion QuaternionLookRotation(const CVector3& direction, const CVector3& up /*= { 0, 1, 0 }*/)
+{
+    // Same method as CMatrix4x4::FaceTarget
+    CVector3 axisZ = Normalise(direction);
+    if (IsZero(Length(axisZ)))  return QuaternionIdentity();
+    CVector3 axisX = Normalise(Cross(up, axisZ));
+    if (IsZero(Length(axisX)))  return QuaternionIdentity();
+    CVector3 axisY = Cross(axisZ, axisX);
+
+    CMatrix4x4 m = MatrixIdentity();
+    m.SetRow(0, axisX);
+    m.SetRow(1, axisY);
+    m.SetRow(2, axisZ);
+    return QuaternionFromMatrix(m);
+}
+
+
+// Return the rotation matrix for a unit quaternion
+CMatrix4x4 ToMatrix(const Quaternion& q)
+{
+    float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+    float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+    float xw = q.x * q.w, yw = q.y * q.w, zw = q.z * q.w;
+
+    return CMatrix4x4{ 1.0f - 2.0f * (yy + zz),         2.0f * (xy + zw),         2.0f * (xz - yw), 0.0f,
+                              2.0f * (xy - zw),  1.0f - 2.0f * (xx + zz),         2.0f * (yz + xw), 0.0f,
+                              2.0f * (xz + yw),         2.0f * (yz - xw),  1.0f - 2.0f * (xx + yy), 0.0f,
+                                          0.0f,                     0.0f,                     0.0f, 1.0f };
+}
+
+
+// Rotate a vector by a unit quaternion. Uses the form v + 2w(u x v) + 2u x (u x v), where u is
+// the x, y, z part of the quaternion, which is cheaper than building the matrix
+CVector3 Rotate(const CVector3& v, const Quaternion& q)
+{
+    CVector3 u = { q.x, q.y, q.z };
+    CVector3 t = 2.0f * Cross(u, v);
+    return v + q.w * t + Cross(u, t);
+}
+
+
+// Dot product of two quaternions
+float Dot(const Quaternion& q1, const Quaternion& q2)
+{
+    return q1.x*q2.x + q1.y*q2.y + q1.z*q2.z + q1.w*q2.w;
+}
+
+
+// Return unit length quaternion in the same direction as given one (identity if zero length)
+Quaternion Normalise(const Quaternion& q)
+{
+    float lengthSq = Dot(q, q);
+
+    // Ensure vector is not zero length (use function from MathHelpers.h)
+    if (IsZero(lengthSq))
+    {
+        return QuaternionIdentity();
+    }
+    else
+    {
+        float invLength = InvSqrt(lengthSq);
+        return Quaternion{ q.x * invLength, q.y * invLength, q.z * invLength, q.w * invLength };
+    }
+}
+
+
+// Spherical linear interpolation between two unit quaternions, t from 0 to 1
+Quaternion Slerp(const Quaternion& q1, const Quaternion& q2, float t)
+{
+    // q and -q are the same rotation, pick the one nearest to q1 to take the shortest path
+    float cosAngle = Dot(q1, q2);
+    float sign = 1.0f;
+    if (cosAngle < 0.0f)
+    {
+        cosAngle = -cosAngle;
+        sign = -1.0f;
+    }
+
+    float t1, t2;
+    if (cosAngle > 0.9995f)
+    {
+        // Nearly the same rotation, sin(angle) is too small to divide by. Linear interpolation
+        // (normalised below) is accurate enough here
+        t1 = 1.0f - t;
+        t2 = t;
+    }
+    else
+    {
+        float angle = std::acos(cosAngle);
+        float invSin = 1.0f / std::sin(angle);
+        t1 = std::sin((1.0f - t) * angle) * invSin;
+        t2 = std::sin(t * angle) * invSin;
+    }
+    t2 *= sign;
+
+    return Normalise(Quaternion{ t1*q1.x + t2*q2.x, t1*q1.y + t2*q2.y, t1*q1.z + t2*q2.z, t1*q1.w + t2*q2.w });
+}
@@ -0,0 +1,108 @@
+//--------------------------------------------------------------------------------------
+// Quaternion class (cut down version) to hold rotations for 3D
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+//
+// Quaternions follow the same conventions as the rest of the maths code: rotations are
+// left-handed (clockwise looking down the axis, as with MatrixRotationX etc.) and combining
+// quaternions with * applies the left hand one first, just like multiplying matrices.
+// So ToMatrix(q1 * q2) == ToMatrix(q1) * ToMatrix(q2).
+
+#ifndef _QUATERNION_H_DEFINED_
+#define _QUATERNION_H_DEFINED_
+
+#include "CVector3.h"
+#include "CMatrix4x4.h"
+#include <cmath>
+
+class Quaternion
+{
+// Concrete class - public access
+public:
+    // Quaternion components, w is the "real" part
+    float x;
+    float y;
+    float z;
+    float w;
+
+    /*-----------------------------------------------------------------------------------------
+        Constructors
+    -----------------------------------------------------------------------------------------*/
+
+    // Default constructor - leaves values uninitialised (for performance)
+    Quaternion() {}
+
+    // Construct with 4 values
+    Quaternion(const float xIn, const float yIn, const float zIn, const float wIn)
+    {
+        x = xIn;
+        y = yIn;
+        z = zIn;
+        w = wIn;
+    }
+
+
+    /*-----------------------------------------------------------------------------------------
+        Member functions
+    -----------------------------------------------------------------------------------------*/
+
+    // Rotate this quaternion by the given one (i.e. this rotation followed by q)
+    Quaternion& operator*= (const Quaternion& q);
+
+    // Return the rotation as Euler angles in radians, in the same form as Model and Camera use
+    // (i.e. the rotation is Z first, then X, then Y)
+    CVector3 ToEulerAngles() const;
+};
+
+
+/*-----------------------------------------------------------------------------------------
+    Operators
+-----------------------------------------------------------------------------------------*/
+
+// Combine two rotations, q1 is applied first then q2 (same order as matrix multiplication)
+Quaternion operator* (const Quaternion& q1, const Quaternion& q2);
+
+
+/*-----------------------------------------------------------------------------------------
+    Non-member functions
+-----------------------------------------------------------------------------------------*/
+
+// Return the identity quaternion (no rotation)
+inline Quaternion QuaternionIdentity()  { return Quaternion{ 0, 0, 0, 1 }; }
+
+// Return a rotation of the given angle (radians) around the given axis. The axis must be unit length
+Quaternion QuaternionFromAxisAngle(const CVector3& axis, float angle);
+
+// Return a rotation matching the given Euler angles in radians, as used by Model and Camera
+// (rotation Z first, then X, then Y - same as MatrixRotationZ(z) * MatrixRotationX(x) * MatrixRotationY(y))
+Quaternion QuaternionFromEulerAngles(const CVector3& angles);
+
+// Return the rotation part of the given matrix, which may contain scaling but no shear
+Quaternion QuaternionFromMatrix(const CMatrix4x4& m);
+
+// Return a rotation that turns the Z axis to face in the given direction, keeping the X axis
+// horizontal with respect to the given up vector (same as CMatrix4x4::FaceTarget).
+// Returns the identity if the direction is zero or parallel to up
+Quaternion QuaternionLookRotation(const CVector3& direction, const CVector3& up = { 0, 1, 0 });
+
+// Return the rotation matrix for a unit quaternion
+CMatrix4x4 ToMatrix(const Quaternion& q);
+
+// Rotate a vector by a unit quaternion
+CVector3 Rotate(const CVector3& v, const Quaternion& q);
+
+// Dot product of two quaternions
+float Dot(const Quaternion& q1, const Quaternion& q2);
+
+// Return the inverse rotation of a unit quaternion
+inline Quaternion Conjugate(const Quaternion& q)  { return Quaternion{ -q.x, -q.y, -q.z, q.w }; }
+
+// Return unit length quaternion in the same direction as given one (identity if zero length)
+Quaternion Normalise(const Quaternion& q);
+
+// Spherical linear interpolation between two unit quaternions, t from 0 to 1. Takes the
+// shortest path, and falls back to normalised linear interpolation for nearly equal rotations
+Quaternion Slerp(const Quaternion& q1, const Quaternion& q2, float t);
+
+
+#endif // _QUATERNION_H_DEFINED_
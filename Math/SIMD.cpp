@@ -0,0 +1,135 @@
+//--------------------------------------------------------------------------------------
+// SIMD support - CPU feature detection and helpers for writing SIMD code paths
+//--------------------------------------------------------------------------------------
+
+#include "SIMD.h"
+
+#include <atomic>
+
+#if MATH_SIMD_X86
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #else
+        #include <cpuid.h>
+    #endif
+#endif
+
+
+/*-----------------------------------------------------------------------------------------
+    CPU feature detection
+-----------------------------------------------------------------------------------------*/
+
+#if MATH_SIMD_X86
+
+// Fill regs with the EAX, EBX, ECX, EDX results of the cpuid instruction for the given leaf
+static void CpuId(int leaf, int subLeaf, unsigned int regs[4])
+{
+#if defined(_MSC_VER)
+    int r[4];
+    __cpuidex(r, leaf, subLeaf);
+    for (int i = 0; i < 4; ++i)  regs[i] = static_cast<unsigned int>(r[i]);
+#else
+    __cpuid_count(leaf, subLeaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// Return the operating system's extended register state flags (XCR0). Only valid if OSXSAVE is set
+static unsigned long long GetXCR0()
+{
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    unsigned int eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+}
+
+// Detect the best SIMD level that both the CPU and operating system support. AVX registers
+// are only usable if the OS saves them on context switches, which is checked through XCR0
+static SimdLevel DetectSimdLevel()
+{
+    unsigned int regs[4];
+    CpuId(0, 0, regs);
+    unsigned int maxLeaf = regs[0];
+    if (maxLeaf < 1)  return SimdLevel::None;
+
+    CpuId(1, 0, regs);
+    bool sse41   = (regs[2] & (1u << 19)) != 0;
+    bool fma     = (regs[2] & (1u << 12)) != 0;
+    bool osxsave = (regs[2] & (1u << 27)) != 0;
+    bool avx     = (regs[2] & (1u << 28)) != 0;
+    if (!sse41)  return SimdLevel::None;
+    if (!osxsave || !avx || !fma || maxLeaf < 7)  return SimdLevel::SSE41;
+
+    unsigned long long xcr0 = GetXCR0();
+    if ((xcr0 & 0x6) != 0x6)  return SimdLevel::SSE41; // XMM and YMM state
+
+    CpuId(7, 0, regs);
+    bool avx2    = (regs[1] & (1u <<  5)) != 0;
+    bool avx512f = (regs[1] & (1u << 16)) != 0;
+    if (!avx2)  return SimdLevel::SSE41;
+
+    if (!avx512f || (xcr0 & 0xe0) != 0xe0)  return SimdLevel::AVX2; // Opmask and ZMM state
+    return SimdLevel::AVX512;
+}
+
+#else
+
+static SimdLevel DetectSimdLevel()
+{
+    return SimdLevel::None;
+}
+
+#endif
+
+
+/*-----------------------------------------------------------------------------------------
+    SIMD level selection
+-----------------------------------------------------------------------------------------*/
+
+// Level in use, detected on first use. Stored as an int to allow the "not yet detected" value.
+// Atomic as the maths functions are called from worker threads while the main thread may change it
+static std::atomic<int> gSimdLevel(-1);
+
+// Return the best SIMD level supported by this CPU and operating system
+SimdLevel GetSupportedSimdLevel()
+{
+    static SimdLevel supported = DetectSimdLevel();
+    return supported;
+}
+
+// Return the SIMD level currently used by the maths functions. The first call detects the
+// best level supported by the CPU and operating system, which is then used unless changed
+SimdLevel GetSimdLevel()
+{
+    int level = gSimdLevel.load(std::memory_order_relaxed);
+    if (level < 0)
+    {
+        // Don't overwrite a level selected by another thread in the meantime
+        int detected = static_cast<int>(GetSupportedSimdLevel());
+        gSimdLevel.compare_exchange_strong(level, detected, std::memory_order_relaxed);
+        level = gSimdLevel.load(std::memory_order_relaxed);
+    }
+    return static_cast<SimdLevel>(level);
+}
+
+// Select the SIMD level used by the maths functions. Levels higher than the CPU supports are
+// reduced to the supported level. Pass SimdLevel::None to use the plain C++ reference code
+void SetSimdLevel(SimdLevel level)
+{
+    SimdLevel supported = GetSupportedSimdLevel();
+    gSimdLevel.store(static_cast<int>(level < supported ? level : supported), std::memory_order_relaxed);
+}
+
+// Return a readable name for a SIMD level, e.g. "AVX2"
+const char* SimdLevelName(SimdLevel level)
+{
+    switch (level)
+    {
+        case SimdLevel::SSE41:  return "SSE4.1";
+        case SimdLevel::AVX2:   return "AVX2";
+        case SimdLevel::AVX512: return "AVX-512";
+        default:                return "None";
+    }
+}
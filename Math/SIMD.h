@@ -0,0 +1,75 @@
+//--------------------------------------------------------------------------------------
+// SIMD support - CPU feature detection and helpers for writing SIMD code paths
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+//
+// Maths functions that have SIMD versions keep a plain C++ version as the reference and
+// select the best version for the current CPU when called, using GetSimdLevel below.
+// The SIMD versions are written with intrinsics and compiled for their instruction set
+// function-by-function (using the SIMD_TARGET_ macros), so the project itself needs no
+// special compiler settings and the app still runs on older CPUs.
+
+#ifndef _SIMD_H_DEFINED_
+#define _SIMD_H_DEFINED_
+
+// SIMD code is only available on x86/x64 CPUs, other platforms use the plain C++ versions
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+    #define MATH_SIMD_X86 1
+    #include <immintrin.h>
+#else
+    #define MATH_SIMD_X86 0
+#endif
+
+// Mark a function as compiled for a particular instruction set. Visual Studio allows any
+// intrinsic in any function so needs nothing, gcc/clang need to be told per-function.
+// The _FMA versions also allow fused multiply-add, which gcc will use even for separate multiply
+// and add intrinsics. Use the plain versions where results must match the plain C++ code exactly
+#if MATH_SIMD_X86 && defined(__clang__)
+    #define SIMD_TARGET_SSE41      __attribute__((target("sse4.1")))
+    #define SIMD_TARGET_AVX2       __attribute__((target("avx2")))
+    #define SIMD_TARGET_AVX2_FMA   __attribute__((target("avx2,fma")))
+    #define SIMD_TARGET_AVX512     __attribute__((target("avx512f")))
+    #define SIMD_TARGET_AVX512_FMA __attribute__((target("avx512f,fma")))
+#elif MATH_SIMD_X86 && defined(__GNUC__)
+    // AVX-512F implies FMA in gcc, so contraction must be switched off explicitly
+    #define SIMD_TARGET_SSE41      __attribute__((target("sse4.1")))
+    #define SIMD_TARGET_AVX2       __attribute__((target("avx2")))
+    #define SIMD_TARGET_AVX2_FMA   __attribute__((target("avx2,fma")))
+    #define SIMD_TARGET_AVX512     __attribute__((target("avx512f"), optimize("fp-contract=off")))
+    #define SIMD_TARGET_AVX512_FMA __attribute__((target("avx512f,fma")))
+#else
+    #define SIMD_TARGET_SSE41
+    #define SIMD_TARGET_AVX2
+    #define SIMD_TARGET_AVX2_FMA
+    #define SIMD_TARGET_AVX512
+    #define SIMD_TARGET_AVX512_FMA
+#endif
+
+
+// Instruction sets supported by the SIMD code paths, in increasing order of capability.
+// Each level implies support for all the levels below it
+enum class SimdLevel
+{
+    None,   // Plain C++ only - this is the reference implementation for all SIMD functions
+    SSE41,  // 4 floats per instruction
+    AVX2,   // 8 floats per instruction (FMA is also guaranteed at this level)
+    AVX512, // 16 floats per instruction (AVX-512F)
+};
+
+
+// Return the SIMD level currently used by the maths functions. The first call detects the
+// best level supported by the CPU and operating system, which is then used unless changed below
+SimdLevel GetSimdLevel();
+
+// Return the best SIMD level supported by this CPU and operating system
+SimdLevel GetSupportedSimdLevel();
+
+// Select the SIMD level used by the maths functions. Levels higher than the CPU supports are
+// reduced to the supported level. Pass SimdLevel::None to use the plain C++ reference code
+void SetSimdLevel(SimdLevel level);
+
+// Return a readable name for a SIMD level, e.g. "AVX2"
+const char* SimdLevelName(SimdLevel level);
+
+
+#endif // _SIMD_H_DEFINED_
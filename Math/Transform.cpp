@@ -0,0 +1,118 @@
+//--------------------------------------------------------------------------------------
+// Transform class - position, rotation and scale of an object, and fast world matrix construction
+//--------------------------------------------------------------------------------------
+
+#include "Transform.h"
+#include "MathHelpers.h"
+#include "MathHelpersSIMD.h"
+#include <cmath>
+
+
+/*-----------------------------------------------------------------------------------------
+    Member functions
+-----------------------------------------------------------------------------------------*/
+
+// Return the matrix for this transform, e.g. a world matrix
+CMatrix4x4 Transform::Matrix() const
+{
+    return MatrixTRS(position, rotation, scale);
+}
+
+
+// Return the inverse of the matrix for this transform. The inverse of scale * rotation * translation
+// is the opposite translation, then the transposed rotation, then the inverse scale
+CMatrix4x4 Transform::InverseMatrix() const
+{
+    CMatrix4x4 r = ToMatrix(rotation);
+    CVector3 invScale = { 1.0f / scale.x, 1.0f / scale.y, 1.0f / scale.z };
+    CVector3 axisX = r.GetXAxis() * invScale.x;
+    CVector3 axisY = r.GetYAxis() * invScale.y;
+    CVector3 axisZ = r.GetZAxis() * invScale.z;
+
+    return CMatrix4x4{ axisX.x, axisY.x, axisZ.x, 0.0f,
+                       axisX.y, axisY.y, axisZ.y, 0.0f,
+                       axisX.z, axisY.z, axisZ.z, 0.0f,
+                       -Dot(position, axisX), -Dot(position, axisY), -Dot(position, axisZ), 1.0f };
+}
+
+
+// Transform a point (including position) or a direction (excluding position)
+CVector3 Transform::TransformPoint(const CVector3& p) const
+{
+    return TransformDirection(p) + position;
+}
+
+CVector3 Transform::TransformDirection(const CVector3& v) const
+{
+    return Rotate({ v.x * scale.x, v.y * scale.y, v.z * scale.z }, rotation);
+}
+
+
+// Rotate so the Z axis faces the given target point. Nothing changes if the target is at our position
+// or directly above/below
+void Transform::FaceTarget(const CVector3& target, const CVector3& up /*= { 0, 1, 0 }*/)
+{
+    CVector3 direction = target - position;
+    if (IsZero(Length(direction)) || IsZero(Length(Cross(up, Normalise(direction)))))  return;
+    rotation = QuaternionLookRotation(direction, up);
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Operators
+-----------------------------------------------------------------------------------------*/
+
+// Combine two transforms, child is applied first then parent
+Transform operator* (const Transform& child, const Transform& parent)
+{
+    CVector3 scaledPosition = { child.position.x * parent.scale.x, child.position.y * parent.scale.y, child.position.z * parent.scale.z };
+    return Transform{ Rotate(scaledPosition, parent.rotation) + parent.position,
+                      child.rotation * parent.rotation,
+                      { child.scale.x * parent.scale.x, child.scale.y * parent.scale.y, child.scale.z * parent.scale.z } };
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Non-member functions
+-----------------------------------------------------------------------------------------*/
+
+// Linear interpolation of position and scale, spherical interpolation of rotation, t from 0 to 1
+Transform Interpolate(const Transform& t1, const Transform& t2, float t)
+{
+    return Transform{ t1.position + t * (t2.position - t1.position),
+                      Slerp(t1.rotation, t2.rotation, t),
+                      t1.scale + t * (t2.scale - t1.scale) };
+}
+
+
+// Return the matrix MatrixScaling(scale) * ToMatrix(rotation) * MatrixTranslation(position).
+// The rotation matrix rows are scaled and the position goes in the bottom row
+CMatrix4x4 MatrixTRS(const CVector3& position, const Quaternion& q, const CVector3& scale)
+{
+    float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+    float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+    float xw = q.x * q.w, yw = q.y * q.w, zw = q.z * q.w;
+
+    float sx2 = 2.0f * scale.x, sy2 = 2.0f * scale.y, sz2 = 2.0f * scale.z;
+    return CMatrix4x4{ scale.x - sx2 * (yy + zz),             sx2 * (xy + zw),             sx2 * (xz - yw), 0.0f,
+                                 sy2 * (xy - zw),   scale.y - sy2 * (xx + zz),             sy2 * (yz + xw), 0.0f,
+                                 sz2 * (xz + yw),             sz2 * (yz - xw),   scale.z - sz2 * (xx + yy), 0.0f,
+                                      position.x,                  position.y,                  position.z, 1.0f };
+}
+
+
+// Return the world matrix for a model with the given Euler angles. The product of the three rotation
+// matrices is written out in full, which only needs the sine and cosine of each angle
+CMatrix4x4 MatrixTRS(const CVector3& position, const CVector3& rotation, const CVector3& scale)
+{
+    float sX, cX, sY, cY, sZ, cZ;
+    SinCos(rotation.x, sX, cX);
+    SinCos(rotation.y, sY, cY);
+    SinCos(rotation.z, sZ, cZ);
+
+    float sXsY = sX * sY, sXcY = sX * cY;
+    return CMatrix4x4{ scale.x * (cZ * cY + sZ * sXsY),  scale.x * sZ * cX,  scale.x * (sZ * sXcY - cZ * sY), 0.0f,
+                       scale.y * (cZ * sXsY - sZ * cY),  scale.y * cZ * cX,  scale.y * (sZ * sY + cZ * sXcY), 0.0f,
+                       scale.z * cX * sY,               -scale.z * sX,       scale.z * cX * cY,               0.0f,
+                       position.x,                       position.y,         position.z,                      1.0f };
+}
@@ -0,0 +1,86 @@
+//--------------------------------------------------------------------------------------
+// Transform class - position, rotation and scale of an object, and fast world matrix construction
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+//
+// A transform represents the matrix MatrixScaling(scale) * ToMatrix(rotation) * MatrixTranslation(position),
+// i.e. scale first, then rotate, then move - the same order used for models. The matrix functions
+// here write out that product directly rather than multiplying full 4x4 matrices together.
+
+#ifndef _TRANSFORM_H_DEFINED_
+#define _TRANSFORM_H_DEFINED_
+
+#include "CVector3.h"
+#include "CMatrix4x4.h"
+#include "Quaternion.h"
+
+class Transform
+{
+// Concrete class - public access
+public:
+    CVector3   position;
+    Quaternion rotation;
+    CVector3   scale;
+
+    /*-----------------------------------------------------------------------------------------
+        Constructors
+    -----------------------------------------------------------------------------------------*/
+
+    // Default constructor - leaves values uninitialised (for performance)
+    Transform() {}
+
+    // Construct from position, rotation and scale
+    Transform(const CVector3& positionIn, const Quaternion& rotationIn = QuaternionIdentity(), const CVector3& scaleIn = { 1, 1, 1 })
+        : position(positionIn), rotation(rotationIn), scale(scaleIn) {}
+
+
+    /*-----------------------------------------------------------------------------------------
+        Member functions
+    -----------------------------------------------------------------------------------------*/
+
+    // Return the matrix for this transform, e.g. a world matrix
+    CMatrix4x4 Matrix() const;
+
+    // Return the inverse of the matrix for this transform, e.g. a view matrix from a camera's transform.
+    // Scale must not be zero
+    CMatrix4x4 InverseMatrix() const;
+
+    // Transform a point (including position) or a direction (excluding position)
+    CVector3 TransformPoint(const CVector3& p) const;
+    CVector3 TransformDirection(const CVector3& v) const;
+
+    // Rotate so the Z axis faces the given target point, keeping the X axis horizontal with
+    // respect to the up vector. Nothing changes if the target is at our position or directly
+    // above/below. Scale and position are unchanged
+    void FaceTarget(const CVector3& target, const CVector3& up = { 0, 1, 0 });
+};
+
+
+/*-----------------------------------------------------------------------------------------
+    Operators
+-----------------------------------------------------------------------------------------*/
+
+// Combine two transforms, child is applied first then parent (same order as matrix multiplication),
+// e.g. worldTransform = localTransform * parentWorldTransform. The result is exact unless the parent
+// has non-uniform scaling and the child is rotated relative to it, which would need shear
+Transform operator* (const Transform& child, const Transform& parent);
+
+
+/*-----------------------------------------------------------------------------------------
+    Non-member functions
+-----------------------------------------------------------------------------------------*/
+
+// Linear interpolation of position and scale, spherical interpolation of rotation, t from 0 to 1
+Transform Interpolate(const Transform& t1, const Transform& t2, float t);
+
+// Return the matrix MatrixScaling(scale) * ToMatrix(rotation) * MatrixTranslation(position).
+// Rotation must be a unit quaternion
+CMatrix4x4 MatrixTRS(const CVector3& position, const Quaternion& rotation, const CVector3& scale);
+
+// Return the matrix MatrixScaling(scale) * MatrixRotationZ(rotation.z) * MatrixRotationX(rotation.x) *
+// MatrixRotationY(rotation.y) * MatrixTranslation(position), i.e. the world matrix for a model with the
+// given Euler angles in radians
+CMatrix4x4 MatrixTRS(const CVector3& position, const CVector3& rotation, const CVector3& scale);
+
+
+#endif // _TRANSFORM_H_DEFINED_
@@ -0,0 +1,270 @@
+//--------------------------------------------------------------------------------------
+// Vec4A class - 16-byte aligned 4D vector held in an SSE register
+//--------------------------------------------------------------------------------------
+// All code is inline in this header
+//
+// Intended for hot code paths that do a lot of vector maths. Load from CVector3 at the start,
+// do the maths in Vec4A, then convert back to CVector3 at the end. Only needs SSE/SSE2, which
+// all x64 CPUs support, so no runtime CPU check is needed. Other CPUs get a plain C++ version
+// with the same interface (see SIMD.h), which gives the same results but is not fast.
+
+#ifndef _VEC4A_H_DEFINED_
+#define _VEC4A_H_DEFINED_
+
+#include "CVector3.h"
+#include "SIMD.h"
+
+#if MATH_SIMD_X86
+
+#include <xmmintrin.h>
+#include <emmintrin.h>
+
+class alignas(16) Vec4A
+{
+// Concrete class - public access
+public:
+    // Vector components as a single SSE register (x in the lowest lane)
+    __m128 v;
+
+    /*-----------------------------------------------------------------------------------------
+        Constructors
+    -----------------------------------------------------------------------------------------*/
+
+    // Default constructor - leaves values uninitialised (for performance)
+    Vec4A() {}
+
+    // Construct with 4 values
+    Vec4A(const float x, const float y, const float z, const float w) : v(_mm_setr_ps(x, y, z, w)) {}
+
+    // Construct from an SSE register
+    Vec4A(const __m128 vIn) : v(vIn) {}
+
+    // Construct from a CVector3 with the given w. Use w = 1 for points, w = 0 for directions
+    explicit Vec4A(const CVector3& v3, const float w = 0.0f) : v(_mm_setr_ps(v3.x, v3.y, v3.z, w)) {}
+
+    // Construct with all four components set to the same value
+    static Vec4A Splat(const float s)  { return Vec4A(_mm_set1_ps(s)); }
+
+    // Load/store 4 floats from/to memory. The aligned versions need a 16-byte aligned address
+    static Vec4A Load(const float* p)         { return Vec4A(_mm_loadu_ps(p)); }
+    static Vec4A LoadAligned(const float* p)  { return Vec4A(_mm_load_ps(p));  }
+    void Store(float* p) const                { _mm_storeu_ps(p, v); }
+    void StoreAligned(float* p) const         { _mm_store_ps(p, v);  }
+
+
+    /*-----------------------------------------------------------------------------------------
+        Member functions
+    -----------------------------------------------------------------------------------------*/
+
+    // Component access. Extracting single values is slower than working on whole vectors
+    float X() const  { return _mm_cvtss_f32(v); }
+    float Y() const  { return _mm_cvtss_f32(_mm_shuffle_ps(v, v, _MM_SHUFFLE(1,1,1,1))); }
+    float Z() const  { return _mm_cvtss_f32(_mm_shuffle_ps(v, v, _MM_SHUFFLE(2,2,2,2))); }
+    float W() const  { return _mm_cvtss_f32(_mm_shuffle_ps(v, v, _MM_SHUFFLE(3,3,3,3))); }
+
+    // Convert to a CVector3, dropping w
+    CVector3 ToCVector3() const
+    {
+        alignas(16) float f[4];
+        _mm_store_ps(f, v);
+        return CVector3(f[0], f[1], f[2]);
+    }
+
+    Vec4A& operator+= (const Vec4A& w)  { v = _mm_add_ps(v, w.v); return *this; }
+    Vec4A& operator-= (const Vec4A& w)  { v = _mm_sub_ps(v, w.v); return *this; }
+    Vec4A& operator*= (const Vec4A& w)  { v = _mm_mul_ps(v, w.v); return *this; }
+    Vec4A& operator/= (const Vec4A& w)  { v = _mm_div_ps(v, w.v); return *this; }
+    Vec4A& operator*= (const float s)   { v = _mm_mul_ps(v, _mm_set1_ps(s)); return *this; }
+    Vec4A& operator/= (const float s)   { v = _mm_div_ps(v, _mm_set1_ps(s)); return *this; }
+};
+
+
+/*-----------------------------------------------------------------------------------------
+    Non-member operators
+-----------------------------------------------------------------------------------------*/
+
+// Component-wise arithmetic
+inline Vec4A operator+ (const Vec4A& v, const Vec4A& w)  { return _mm_add_ps(v.v, w.v); }
+inline Vec4A operator- (const Vec4A& v, const Vec4A& w)  { return _mm_sub_ps(v.v, w.v); }
+inline Vec4A operator* (const Vec4A& v, const Vec4A& w)  { return _mm_mul_ps(v.v, w.v); }
+inline Vec4A operator/ (const Vec4A& v, const Vec4A& w)  { return _mm_div_ps(v.v, w.v); }
+
+// Negation and unary plus
+inline Vec4A operator- (const Vec4A& v)  { return _mm_xor_ps(v.v, _mm_set1_ps(-0.0f)); }
+inline Vec4A operator+ (const Vec4A& v)  { return v; }
+
+// Vector-scalar multiplication and division
+inline Vec4A operator* (const Vec4A& v, float s)  { return _mm_mul_ps(v.v, _mm_set1_ps(s)); }
+inline Vec4A operator* (float s, const Vec4A& v)  { return _mm_mul_ps(v.v, _mm_set1_ps(s)); }
+inline Vec4A operator/ (const Vec4A& v, float s)  { return _mm_div_ps(v.v, _mm_set1_ps(s)); }
+
+
+/*-----------------------------------------------------------------------------------------
+    Non-member functions
+-----------------------------------------------------------------------------------------*/
+
+// Component-wise minimum and maximum
+inline Vec4A Min(const Vec4A& v1, const Vec4A& v2)  { return _mm_min_ps(v1.v, v2.v); }
+inline Vec4A Max(const Vec4A& v1, const Vec4A& v2)  { return _mm_max_ps(v1.v, v2.v); }
+
+// Dot product of all four components, and of x, y and z only. Result in all four components
+inline Vec4A Dot4Splat(const Vec4A& v1, const Vec4A& v2)
+{
+    __m128 m = _mm_mul_ps(v1.v, v2.v);
+    __m128 s = _mm_add_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2,3,0,1))); // xy xy zw zw
+    return _mm_add_ps(s, _mm_shuffle_ps(s, s, _MM_SHUFFLE(1,0,3,2)));
+}
+inline Vec4A Dot3Splat(const Vec4A& v1, const Vec4A& v2)
+{
+    __m128 m = _mm_mul_ps(v1.v, v2.v);
+    __m128 x = _mm_shuffle_ps(m, m, _MM_SHUFFLE(0,0,0,0));
+    __m128 y = _mm_shuffle_ps(m, m, _MM_SHUFFLE(1,1,1,1));
+    __m128 z = _mm_shuffle_ps(m, m, _MM_SHUFFLE(2,2,2,2));
+    return _mm_add_ps(_mm_add_ps(x, y), z);
+}
+
+// Dot product of all four components, and of x, y and z only
+inline float Dot4(const Vec4A& v1, const Vec4A& v2)  { return _mm_cvtss_f32(Dot4Splat(v1, v2).v); }
+inline float Dot3(const Vec4A& v1, const Vec4A& v2)  { return _mm_cvtss_f32(Dot3Splat(v1, v2).v); }
+
+// Cross product of the x, y and z components (order is important). Result has w = 0
+inline Vec4A Cross3(const Vec4A& v1, const Vec4A& v2)
+{
+    __m128 a = _mm_shuffle_ps(v1.v, v1.v, _MM_SHUFFLE(3,0,2,1)); // y z x w
+    __m128 b = _mm_shuffle_ps(v2.v, v2.v, _MM_SHUFFLE(3,0,2,1));
+    __m128 c = _mm_sub_ps(_mm_mul_ps(v1.v, b), _mm_mul_ps(a, v2.v)); // z x y 0
+    return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3,0,2,1));
+}
+
+// Length of the x, y, z part of the vector
+inline float Length3(const Vec4A& v)  { return _mm_cvtss_f32(_mm_sqrt_ss(Dot3Splat(v, v).v)); }
+
+// Return the vector scaled so its x, y, z part is unit length (w is scaled too).
+// Zero length vectors are returned as zero, as with CVector3 Normalise
+inline Vec4A Normalise3(const Vec4A& v)
+{
+    __m128 lengthSq = Dot3Splat(v, v).v;
+    __m128 nonZero  = _mm_cmpge_ps(lengthSq, _mm_set1_ps(EPSILON));
+    return _mm_and_ps(_mm_div_ps(v.v, _mm_sqrt_ps(lengthSq)), nonZero);
+}
+
+
+#else // !MATH_SIMD_X86
+
+/*-----------------------------------------------------------------------------------------
+    Plain C++ version
+-----------------------------------------------------------------------------------------*/
+// Same interface as above, except the components are a float array. Calculations are done in the
+// same order as the SSE version so results are identical
+
+class alignas(16) Vec4A
+{
+// Concrete class - public access
+public:
+    // Vector components, x first
+    float v[4];
+
+    // Default constructor - leaves values uninitialised (for performance)
+    Vec4A() {}
+
+    // Construct with 4 values
+    Vec4A(const float x, const float y, const float z, const float w) : v{ x, y, z, w } {}
+
+    // Construct from a CVector3 with the given w. Use w = 1 for points, w = 0 for directions
+    explicit Vec4A(const CVector3& v3, const float w = 0.0f) : v{ v3.x, v3.y, v3.z, w } {}
+
+    // Construct with all four components set to the same value
+    static Vec4A Splat(const float s)  { return Vec4A(s, s, s, s); }
+
+    // Load/store 4 floats from/to memory
+    static Vec4A Load(const float* p)         { return Vec4A(p[0], p[1], p[2], p[3]); }
+    static Vec4A LoadAligned(const float* p)  { return Load(p); }
+    void Store(float* p) const                { p[0] = v[0];  p[1] = v[1];  p[2] = v[2];  p[3] = v[3]; }
+    void StoreAligned(float* p) const         { Store(p); }
+
+    // Component access
+    float X() const  { return v[0]; }
+    float Y() const  { return v[1]; }
+    float Z() const  { return v[2]; }
+    float W() const  { return v[3]; }
+
+    // Convert to a CVector3, dropping w
+    CVector3 ToCVector3() const  { return CVector3(v[0], v[1], v[2]); }
+
+    Vec4A& operator+= (const Vec4A& w)  { for (int i = 0; i < 4; ++i)  v[i] += w.v[i];  return *this; }
+    Vec4A& operator-= (const Vec4A& w)  { for (int i = 0; i < 4; ++i)  v[i] -= w.v[i];  return *this; }
+    Vec4A& operator*= (const Vec4A& w)  { for (int i = 0; i < 4; ++i)  v[i] *= w.v[i];  return *this; }
+    Vec4A& operator/= (const Vec4A& w)  { for (int i = 0; i < 4; ++i)  v[i] /= w.v[i];  return *this; }
+    Vec4A& operator*= (const float s)   { for (int i = 0; i < 4; ++i)  v[i] *= s;       return *this; }
+    Vec4A& operator/= (const float s)   { for (int i = 0; i < 4; ++i)  v[i] /= s;       return *this; }
+};
+
+
+// Component-wise arithmetic
+inline Vec4A operator+ (const Vec4A& v, const Vec4A& w)  { Vec4A r = v;  return r += w; }
+inline Vec4A operator- (const Vec4A& v, const Vec4A& w)  { Vec4A r = v;  return r -= w; }
+inline Vec4A operator* (const Vec4A& v, const Vec4A& w)  { Vec4A r = v;  return r *= w; }
+inline Vec4A operator/ (const Vec4A& v, const Vec4A& w)  { Vec4A r = v;  return r /= w; }
+
+// Negation and unary plus
+inline Vec4A operator- (const Vec4A& v)  { return Vec4A(-v.v[0], -v.v[1], -v.v[2], -v.v[3]); }
+inline Vec4A operator+ (const Vec4A& v)  { return v; }
+
+// Vector-scalar multiplication and division
+inline Vec4A operator* (const Vec4A& v, float s)  { Vec4A r = v;  return r *= s; }
+inline Vec4A operator* (float s, const Vec4A& v)  { Vec4A r = v;  return r *= s; }
+inline Vec4A operator/ (const Vec4A& v, float s)  { Vec4A r = v;  return r /= s; }
+
+
+// Component-wise minimum and maximum. The second value is returned if either is NaN, as with SSE
+inline Vec4A Min(const Vec4A& v1, const Vec4A& v2)
+{
+    Vec4A r;
+    for (int i = 0; i < 4; ++i)  r.v[i] = v1.v[i] < v2.v[i] ? v1.v[i] : v2.v[i];
+    return r;
+}
+inline Vec4A Max(const Vec4A& v1, const Vec4A& v2)
+{
+    Vec4A r;
+    for (int i = 0; i < 4; ++i)  r.v[i] = v1.v[i] > v2.v[i] ? v1.v[i] : v2.v[i];
+    return r;
+}
+
+// Dot product of all four components, and of x, y and z only
+inline float Dot4(const Vec4A& v1, const Vec4A& v2)
+{
+    return (v1.v[0] * v2.v[0] + v1.v[1] * v2.v[1]) + (v1.v[2] * v2.v[2] + v1.v[3] * v2.v[3]);
+}
+inline float Dot3(const Vec4A& v1, const Vec4A& v2)
+{
+    return (v1.v[0] * v2.v[0] + v1.v[1] * v2.v[1]) + v1.v[2] * v2.v[2];
+}
+
+// As above, with the result in all four components
+inline Vec4A Dot4Splat(const Vec4A& v1, const Vec4A& v2)  { return Vec4A::Splat(Dot4(v1, v2)); }
+inline Vec4A Dot3Splat(const Vec4A& v1, const Vec4A& v2)  { return Vec4A::Splat(Dot3(v1, v2)); }
+
+// Cross product of the x, y and z components (order is important). Result has w = 0
+inline Vec4A Cross3(const Vec4A& v1, const Vec4A& v2)
+{
+    return Vec4A(v1.v[1] * v2.v[2] - v1.v[2] * v2.v[1],
+                 v1.v[2] * v2.v[0] - v1.v[0] * v2.v[2],
+                 v1.v[0] * v2.v[1] - v1.v[1] * v2.v[0], 0.0f);
+}
+
+// Length of the x, y, z part of the vector
+inline float Length3(const Vec4A& v)  { return std::sqrt(Dot3(v, v)); }
+
+// Return the vector scaled so its x, y, z part is unit length (w is scaled too).
+// Zero length vectors are returned as zero, as with CVector3 Normalise
+inline Vec4A Normalise3(const Vec4A& v)
+{
+    float lengthSq = Dot3(v, v);
+    if (!(lengthSq >= EPSILON))  return Vec4A(0, 0, 0, 0);
+    return v / std::sqrt(lengthSq);
+}
+
+#endif // MATH_SIMD_X86
+
+
+#endif // _VEC4A_H_DEFINED_
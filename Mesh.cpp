@@ -1,212 +1,405 @@
 //--------------------------------------------------------------------------------------
 // Class encapsulating a mesh
 //--------------------------------------------------------------------------------------
-// The mesh class splits the mesh into sub-meshes that only use one texture each.
-// ** THIS VERSION WILL ONLY KEEP THE FIRST SUB-MESH OTHER PARTS WILL BE MISSING **
-// ** DO NOT USE THIS VERSION FOR PROJECTS **
+// The mesh class splits the mesh into sub-meshes that only use one texture each. All the sub-meshes
+// share one vertex buffer and one index buffer, with a table giving the part of the buffers used by
+// each sub-mesh. So the whole mesh, or any one sub-mesh, is drawn with a single set of buffer binds.
+// Each sub-mesh also has simpler levels of detail (LODs) built by the import (see MeshSimplify.h).
+// They use the same vertices so are just further parts of the index buffer. The full detail triangles
+// are also split into clusters with their own bounds, so parts of the mesh outside the view or facing
+// away can be skipped (see MeshClusters.h).
+// Alongside the full vertices the mesh keeps a second vertex buffer holding only the positions, tightly
+// packed in the same vertex order so the same index buffer and sub-mesh table draw from either one.
+// Depth-only passes such as shadow maps draw from it so they don't fetch normals, tangents and UVs.
+// A skinned mesh also keeps its skeleton and a CPU copy of its vertices. Each animated instance skins
+// those vertices into its own dynamic vertex buffer (see MeshSkinning.h), which the render functions
+// can draw from in place of the mesh's own vertices.
+// A mesh with morph targets keeps them with a CPU copy of its vertices in the same way. Each instance
+// morphs its own copy of the vertices (see MeshMorph.h) and uploads the parts that changed to its own
+// vertex buffer, which the render functions can also draw from.
 // The class also doesn't load textures, filters or shaders as the outer code is
 // expected to select these things. A later lab will introduce a more robust loader.
 
 #include "Mesh.h"
 #include "Shader.h" // Needed for helper function CreateSignatureForVertexLayout
-#include "CVector2.h" 
-#include "CVector3.h" 
+#include "Timer.h"
+#include "MeshInterleave.h"
 
-#include <assimp/Importer.hpp>
 #include <assimp/DefaultLogger.hpp>
-#include <assimp/postprocess.h>
-#include <assimp/scene.h>
 
-#include <memory>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
 
 
-// Pass the name of the mesh file to load. Uses assimp (http://www.assimp.org/) to support many file types
-// Optionally request tangents to be calculated (for normal and parallax mapping - see later lab)
-// Will throw a std::runtime_error exception on failure (since constructors can't return errors).
-Mesh::Mesh(const std::string& fileName, bool requireTangents /*= false*/)
+// Convert vertex elements from a cooked file or import into the DirectX description. The semantic
+// names are not copied, the given elements must exist while the result is used
+static std::vector<D3D11_INPUT_ELEMENT_DESC> InputElements(const CookedVertexElement* elements, unsigned int numElements)
 {
-    Assimp::Importer importer;
-
-    // Flags for processing the mesh. Assimp provides a huge amount of control - right click any of these
-    // and "Peek Definition" to see documention above each constant
-    unsigned int assimpFlags = aiProcess_MakeLeftHanded |
-                               aiProcess_GenSmoothNormals |
-                               aiProcess_FixInfacingNormals |
-                               aiProcess_GenUVCoords | 
-                               aiProcess_TransformUVCoords |
-                               aiProcess_FlipUVs |
-                               aiProcess_FlipWindingOrder |
-                               aiProcess_Triangulate |
-                               aiProcess_PreTransformVertices |
-                               aiProcess_JoinIdenticalVertices |
-                               aiProcess_ImproveCacheLocality |
-                               aiProcess_SortByPType |
-                               aiProcess_FindInvalidData | 
-                               aiProcess_OptimizeMeshes |
-                               aiProcess_FindInstances |
-                               aiProcess_FindDegenerates |
-                               aiProcess_RemoveRedundantMaterials |
-                               aiProcess_Debone |
-                               aiProcess_RemoveComponent;
-
-    // Flags to specify what mesh data to ignore
-    int removeComponents = aiComponent_LIGHTS | aiComponent_CAMERAS | aiComponent_TEXTURES | aiComponent_COLORS | 
-                           aiComponent_BONEWEIGHTS | aiComponent_ANIMATIONS | aiComponent_MATERIALS;
-
-    // Add / remove tangents as required by user
-    if (requireTangents)
-    {
-        assimpFlags |= aiProcess_CalcTangentSpace;
-    }
-    else
+    std::vector<D3D11_INPUT_ELEMENT_DESC> vertexElements;
+    for (unsigned int i = 0; i < numElements; ++i)
     {
-        removeComponents |= aiComponent_TANGENTS_AND_BITANGENTS;
+        vertexElements.push_back( { elements[i].semanticName, elements[i].semanticIndex, static_cast<DXGI_FORMAT>(elements[i].format), 0,
+                                    elements[i].offset, D3D11_INPUT_PER_VERTEX_DATA, 0 } );
     }
+    return vertexElements;
+}
 
-    // Other miscellaneous settings
-    importer.SetPropertyFloat(AI_CONFIG_PP_GSN_MAX_SMOOTHING_ANGLE, 80.0f); // Smoothing angle for normals
-    importer.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE, aiPrimitiveType_POINT | aiPrimitiveType_LINE);  // Remove points and lines (keep triangles only)
-    importer.SetPropertyBool(AI_CONFIG_PP_FD_REMOVE, true);                 // Remove degenerate triangles
-    importer.SetPropertyBool(AI_CONFIG_PP_DB_ALL_OR_NONE, true);            // Default to removing bones/weights from meshes that don't need skinning
-  
-    importer.SetPropertyInteger(AI_CONFIG_PP_RVC_FLAGS, removeComponents);
-
-    // Import mesh with assimp given above requirements - log output
-    Assimp::DefaultLogger::create("", Assimp::DefaultLogger::VERBOSE);
-    const aiScene* scene = importer.ReadFile(fileName, assimpFlags);
-    Assimp::DefaultLogger::kill();
-    if (scene == nullptr)  throw std::runtime_error("Error loading mesh (" + fileName + "). " + importer.GetErrorString());
-    if (scene->mNumMeshes == 0)  throw std::runtime_error("No usable geometry in mesh: " + fileName);
 
+// Find the vertex element with the given semantic name. Returns nullptr if there isn't one, or if it
+// doesn't have the given format
+static const CookedVertexElement* FindElement(const CookedVertexElement* elements, unsigned int numElements,
+                                              const char* semanticName, uint32_t format)
+{
+    for (unsigned int i = 0; i < numElements; ++i)
+    {
+        if (std::strncmp(elements[i].semanticName, semanticName, sizeof(elements[i].semanticName)) == 0)
+        {
+            return elements[i].format == format ? &elements[i] : nullptr;
+        }
+    }
+    return nullptr;
+}
 
-    //-----------------------------------
 
-    // Only importing first submesh - significant limitation - do not use this importer for your own projects
-    aiMesh* assimpMesh = scene->mMeshes[0];
-    std::string subMeshName = assimpMesh->mName.C_Str();
+// Convert the sub-mesh table from a cooked file or import
+static Mesh::SubMesh ToSubMesh(const CookedSubMesh& cooked)
+{
+    Mesh::SubMesh subMesh;
+    subMesh.indexStart  = cooked.indexStart;
+    subMesh.numIndices  = cooked.numIndices;
+    subMesh.baseVertex  = cooked.baseVertex;
+    subMesh.numVertices = cooked.numVertices;
+    subMesh.boundsMin   = CVector3(cooked.boundsMin);
+    subMesh.boundsMax   = CVector3(cooked.boundsMax);
+    subMesh.numLods     = cooked.numLods;
+    for (unsigned int lod = 0; lod < MESH_MAX_LODS; ++lod)
+    {
+        subMesh.lods[lod] = { cooked.lods[lod].indexStart, cooked.lods[lod].numIndices, cooked.lods[lod].error };
+    }
+    subMesh.clusterStart = cooked.clusterStart;
+    subMesh.numClusters  = cooked.numClusters;
+    return subMesh;
+}
 
-    
-    //-----------------------------------
 
-    // Check for presence of position and normal data. Tangents and UVs are optional.
-    std::vector<D3D11_INPUT_ELEMENT_DESC> vertexElements;
-    unsigned int offset = 0;
-    
-    if (!assimpMesh->HasPositions())  throw std::runtime_error("No position data for sub-mesh " + subMeshName + " in " + fileName);
-    unsigned int positionOffset = offset;
-    vertexElements.push_back( { "Position", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, positionOffset, D3D11_INPUT_PER_VERTEX_DATA, 0 } );
-    offset += 12;
-
-    if (!assimpMesh->HasNormals())  throw std::runtime_error("No normal data for sub-mesh " + subMeshName + " in " + fileName);
-    unsigned int normalOffset = offset;
-    vertexElements.push_back( { "Normal", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, normalOffset, D3D11_INPUT_PER_VERTEX_DATA, 0 } );
-    offset += 12;
-
-    unsigned int tangentOffset = offset;
-    if (requireTangents)
+// Do the CPU-side part of loading a mesh, see Mesh.h. Will throw a std::runtime_error exception on failure
+PreparedMesh PrepareMesh(const std::string& fileName, bool requireTangents /*= false*/, bool compressVertices /*= false*/,
+                         bool requireSkin /*= false*/, bool requireMorphs /*= false*/)
+{
+    Timer prepareTimer;
+    PreparedMesh prepared;
+    prepared.fileName = fileName;
+
+    // If this file has been imported before with the same settings there will be a cooked file holding
+    // the result, use that instead of importing again (see CookedMesh.h)
+    uint64_t sourceHash = MeshSourceHash(fileName, requireTangents, requireSkin);
+    std::string cookedFileName = CookedMeshFileName(fileName, requireTangents, requireSkin);
+    if (sourceHash != 0)
     {
-        if (!assimpMesh->HasTangentsAndBitangents())  throw std::runtime_error("No tangent data for sub-mesh " + subMeshName + " in " + fileName);
-        vertexElements.push_back( { "Tangent", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, tangentOffset, D3D11_INPUT_PER_VERTEX_DATA, 0 } );
-        offset += 12;
+        prepared.cooked = std::make_unique<CookedMeshFile>(cookedFileName, sourceHash);
+        if (!prepared.cooked->IsValid())  prepared.cooked.reset();
     }
-    
-    unsigned int uvOffset = offset;
-    if (assimpMesh->GetNumUVChannels() > 0 && assimpMesh->HasTextureCoords(0))
+
+    // Otherwise import mesh with assimp (see MeshData.h), then save the imported data to a cooked file to
+    // speed up later loads. Not an error if saving fails, the file will be imported again next time
+    if (!prepared.cooked)
     {
-        if (assimpMesh->mNumUVComponents[0] != 2)  throw std::runtime_error("Unsupported texture coordinates in " + subMeshName + " in " + fileName);
-        vertexElements.push_back( { "UV", 0, DXGI_FORMAT_R32G32_FLOAT, 0, uvOffset, D3D11_INPUT_PER_VERTEX_DATA, 0 } );
-        offset += 8;
+        prepared.imported = ImportMeshData(fileName, requireTangents, sourceHash, requireSkin);
+        prepared.cookedFileWritten = WriteCookedMesh(cookedFileName, prepared.imported);
     }
 
-    mVertexSize = offset;
+    // The cooked file keeps full precision data, so the compressed layout is built on each load. It is
+    // quick compared to an import (see MeshCompression.h). Skinning and morphing work on full precision vertices
+    if (compressVertices && !requireSkin && !requireMorphs)
+    {
+        if (prepared.cooked)
+        {
+            const CookedMeshHeader& header = prepared.cooked->Header();
+            prepared.compressed = std::make_unique<CompressedMeshData>(
+                CompressMesh(prepared.cooked->Elements(), header.numElements, header.vertexSize,
+                             prepared.cooked->Vertices(), header.numVertices, prepared.cooked->Indices(), header.numIndices));
+        }
+        else
+        {
+            const MeshData& mesh = prepared.imported;
+            prepared.compressed = std::make_unique<CompressedMeshData>(
+                CompressMesh(mesh.vertexElements.data(), static_cast<unsigned int>(mesh.vertexElements.size()), mesh.vertexSize,
+                             mesh.vertices.get(), mesh.numVertices, mesh.indices.get(), mesh.numIndices));
+        }
+    }
 
+    // Mesh files have no morph targets that can be imported, so the targets are built here from the vertices
+    // (see MeshMorph.h). They are quick to build so are not kept in the cooked file
+    if (requireMorphs)
+    {
+        const CookedVertexElement* elements;
+        unsigned int numElements, vertexSize, numVertices;
+        const void* vertices;
+        if (prepared.cooked)
+        {
+            const CookedMeshHeader& header = prepared.cooked->Header();
+            elements = prepared.cooked->Elements();
+            numElements = header.numElements;
+            vertexSize  = header.vertexSize;
+            numVertices = header.numVertices;
+            vertices = prepared.cooked->Vertices();
+        }
+        else
+        {
+            const MeshData& mesh = prepared.imported;
+            elements = mesh.vertexElements.data();
+            numElements = static_cast<unsigned int>(mesh.vertexElements.size());
+            vertexSize  = mesh.vertexSize;
+            numVertices = mesh.numVertices;
+            vertices = mesh.vertices.get();
+        }
+        const CookedVertexElement* position = FindElement(elements, numElements, "Position", MESH_FORMAT_R32G32B32_FLOAT);
+        const CookedVertexElement* normal   = FindElement(elements, numElements, "Normal",   MESH_FORMAT_R32G32B32_FLOAT);
+        if (!position || !normal)  throw std::runtime_error("Unsupported morph vertex layout in " + fileName);
+
+        prepared.morphLayout.vertexSize     = vertexSize;
+        prepared.morphLayout.positionOffset = position->offset;
+        prepared.morphLayout.normalOffset   = normal->offset;
+        BuildBulgeTargets(vertices, prepared.morphLayout, numVertices, MORPH_BULGE_TARGETS, prepared.morphTargets);
+    }
 
-    // Create a "vertex layout" to describe to DirectX what is data in each vertex of this mesh
-    auto shaderSignature = CreateSignatureForVertexLayout(vertexElements.data(), static_cast<int>(vertexElements.size()));
-    HRESULT hr = gD3DDevice->CreateInputLayout(vertexElements.data(), static_cast<UINT>(vertexElements.size()),
-                                               shaderSignature->GetBufferPointer(), shaderSignature->GetBufferSize(),
-                                               &mVertexLayout);
-    if (shaderSignature)  shaderSignature->Release();
-    if (FAILED(hr))  throw std::runtime_error("Failure creating input layout for " + fileName);
+    prepared.prepareSeconds = prepareTimer.GetTime();
+    return prepared;
+}
 
 
+// Pass the name of the mesh file to load. Uses assimp (http://www.assimp.org/) to support many file types
+// Optionally request tangents to be calculated (for normal and parallax mapping - see later lab)
+// Will throw a std::runtime_error exception on failure (since constructors can't return errors).
+Mesh::Mesh(const std::string& fileName, bool requireTangents /*= false*/, bool compressVertices /*= false*/, bool requireSkin /*= false*/,
+           bool requireMorphs /*= false*/)
+{
+    // Log assimp output while importing. The assimp logger is global so this is only done when loading a single mesh
+    Assimp::DefaultLogger::create("", Assimp::DefaultLogger::VERBOSE);
+    PreparedMesh prepared;
+    try
+    {
+        prepared = PrepareMesh(fileName, requireTangents, compressVertices, requireSkin, requireMorphs);
+    }
+    catch (...)
+    {
+        Assimp::DefaultLogger::kill();
+        throw;
+    }
+    Assimp::DefaultLogger::kill();
 
-    //-----------------------------------
+    Init(prepared);
+}
 
-    // Create CPU-side buffers to hold current mesh data - exact content is flexible so can't use a structure for a vertex - so just a block of bytes
-    // Note: for large arrays a unique_ptr is better than a vector because vectors default-initialise all the values which is a waste of time.
-    mNumVertices = assimpMesh->mNumVertices;
-    mNumIndices  = assimpMesh->mNumFaces * 3;
-    auto vertices = std::make_unique<unsigned char[]>(mNumVertices * mVertexSize);
-    auto indices  = std::make_unique<unsigned char[]>(mNumIndices * 4); // Using 32 bit indexes (4 bytes) for each indeex
 
+// Create the mesh from the result of PrepareMesh, see Mesh.h
+Mesh::Mesh(const PreparedMesh& prepared)
+{
+    Init(prepared);
+}
 
-    //-----------------------------------
+// Create the mesh from the result of PrepareMesh and keep its full precision data, see Mesh.h
+Mesh::Mesh(std::shared_ptr<PreparedMesh> prepared)
+{
+    Init(*prepared);
+    prepared->compressed.reset();
+    mPrepared = std::move(prepared);
+}
 
-    // Copy mesh data from assimp to our CPU-side vertex buffer
 
-    CVector3* assimpPosition = reinterpret_cast<CVector3*>(assimpMesh->mVertices);
-    unsigned char* position = vertices.get() + positionOffset;
-    unsigned char* positionEnd = position + mNumVertices * mVertexSize;
-    while (position != positionEnd)
+// Create the GPU-side parts of the mesh from the result of PrepareMesh
+void Mesh::Init(const PreparedMesh& prepared)
+{
+    Timer createTimer;
+    const std::string& fileName = prepared.fileName;
+    char message[512];
+
+    // The data for the GPU buffers - the compressed data if there is any, otherwise the mapped cooked file, or the imported data
+    const CookedVertexElement* elements;
+    unsigned int numElements;
+    const CookedSubMesh* subMeshes;
+    const CookedCluster* clusters;
+    unsigned int numClusters;
+    const CookedBone* bones;
+    unsigned int numBones;
+    const void* vertices;
+    const void* indices;
+    if (prepared.cooked)
     {
-        *(CVector3*)position = *assimpPosition;
-        position += mVertexSize;
-        ++assimpPosition;
+        const CookedMeshHeader& header = prepared.cooked->Header();
+        mVertexSize  = header.vertexSize;
+        mNumVertices = header.numVertices;
+        mNumIndices  = header.numIndices;
+        subMeshes = prepared.cooked->SubMeshes();
+        for (unsigned int i = 0; i < header.numSubMeshes; ++i)  mSubMeshes.push_back(ToSubMesh(subMeshes[i]));
+        clusters = prepared.cooked->Clusters();
+        numClusters = header.numClusters;
+        bones = prepared.cooked->Bones();
+        numBones = header.numBones;
+        elements = prepared.cooked->Elements();
+        numElements = header.numElements;
+        vertices = prepared.cooked->Vertices();
+        indices  = prepared.cooked->Indices();
     }
-
-    CVector3* assimpNormal = reinterpret_cast<CVector3*>(assimpMesh->mNormals);
-    unsigned char* normal = vertices.get() + normalOffset;
-    unsigned char* normalEnd = normal + mNumVertices * mVertexSize;
-    while (normal != normalEnd)
+    else
     {
-        *(CVector3*)normal = *assimpNormal;
-        normal += mVertexSize;
-        ++assimpNormal;
+        const MeshData& mesh = prepared.imported;
+        mVertexSize  = mesh.vertexSize;
+        mNumVertices = mesh.numVertices;
+        mNumIndices  = mesh.numIndices;
+        subMeshes = mesh.subMeshes.data();
+        for (auto& subMesh : mesh.subMeshes)  mSubMeshes.push_back(ToSubMesh(subMesh));
+        clusters = mesh.clusters.data();
+        numClusters = static_cast<unsigned int>(mesh.clusters.size());
+        bones = mesh.bones.data();
+        numBones = static_cast<unsigned int>(mesh.bones.size());
+        elements = mesh.vertexElements.data();
+        numElements = static_cast<unsigned int>(mesh.vertexElements.size());
+        vertices = mesh.vertices.get();
+        indices  = mesh.indices.get();
     }
 
-    if (requireTangents)
+    mFileName = fileName;
+    mHasTangents = FindElement(elements, numElements, "Tangent", MESH_FORMAT_R32G32B32A32_FLOAT) != nullptr;
+
+    const CompressedMeshData* compressed = prepared.compressed.get();
+    if (compressed)
     {
-      CVector3* assimpTangent = reinterpret_cast<CVector3*>(assimpMesh->mTangents);
-      unsigned char* tangent =  vertices.get() + tangentOffset;
-      unsigned char* tangentEnd = tangent + mNumVertices * mVertexSize;
-      while (tangent != tangentEnd)
-      {
-        *(CVector3*)tangent = *assimpTangent;
-        tangent += mVertexSize;
-        ++assimpTangent;
-      }
+        mVertexSize  = compressed->vertexSize;
+        mIndexFormat = (compressed->indexSize == 2) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+        mCompressedVertices = true;
+        mPositionOffset = CVector3(compressed->positionOffset);
+        mPositionScale  = CVector3(compressed->positionScale);
+        elements = compressed->vertexElements.data();
+        numElements = static_cast<unsigned int>(compressed->vertexElements.size());
+        vertices = compressed->vertices.get();
+        indices  = compressed->indices.get();
     }
 
-    if (assimpMesh->GetNumUVChannels() > 0 && assimpMesh->HasTextureCoords(0))
+    auto vertexElements = InputElements(elements, numElements);
+    CreateBuffers(fileName, vertexElements.data(), numElements, vertices, indices);
+    CreatePositionStream(fileName, elements, numElements, vertices);
+    if (numBones > 0)  CreateSkinStream(fileName, elements, numElements, vertices, bones, numBones);
+    if (!prepared.morphTargets.empty())  CreateMorphStream(vertices, prepared.morphTargets, prepared.morphLayout);
+
+    // Bounding sphere of the whole mesh and the number of levels of detail, for choosing a level to draw
+    CVector3 boundsMin = mSubMeshes[0].boundsMin;
+    CVector3 boundsMax = mSubMeshes[0].boundsMax;
+    for (auto& subMesh : mSubMeshes)
     {
-        aiVector3D* assimpUV = assimpMesh->mTextureCoords[0];
-        unsigned char* uv = vertices.get() + uvOffset;
-        unsigned char* uvEnd = uv + mNumVertices * mVertexSize;
-        while (uv != uvEnd)
+        for (int axis = 0; axis < 3; ++axis)
         {
-            *(CVector2*)uv = CVector2(assimpUV->x, assimpUV->y);
-            uv += mVertexSize;
-            ++assimpUV;
+            (&boundsMin.x)[axis] = std::min((&boundsMin.x)[axis], (&subMesh.boundsMin.x)[axis]);
+            (&boundsMax.x)[axis] = std::max((&boundsMax.x)[axis], (&subMesh.boundsMax.x)[axis]);
         }
+        mNumLods = std::max(mNumLods, subMesh.numLods);
     }
+    mBoundsCentre = (boundsMin + boundsMax) * 0.5f;
+    mBoundsRadius = Length(boundsMax - boundsMin) * 0.5f;
 
+    // Keep the clusters for culling, the bounding spheres are copied into separate arrays for Frustum's SIMD tests
+    mClusters.assign(clusters, clusters + numClusters);
+    for (auto& cluster : mClusters)
+    {
+        mClusterX.push_back(cluster.centre[0]);
+        mClusterY.push_back(cluster.centre[1]);
+        mClusterZ.push_back(cluster.centre[2]);
+        mClusterRadius.push_back(cluster.radius);
+    }
+    mClusterResults.resize(numClusters);
 
-    //-----------------------------------
 
-    // Copy face data from assimp to our CPU-side index buffer
-    if (!assimpMesh->HasFaces())  throw std::runtime_error("No face data in " + subMeshName + " in " + fileName);
+    // Report where the mesh came from and how long it took
+    float time = (prepared.prepareSeconds + createTimer.GetTime()) * 1000.0f;
+    if (prepared.built)
+    {
+        std::snprintf(message, sizeof(message), "Mesh %s (%u sub-meshes): built in %.2f ms\n", fileName.c_str(), NumSubMeshes(), time);
+    }
+    else if (prepared.cooked)
+    {
+        float importTime = prepared.cooked->Header().importMicroseconds / 1000.0f;
+        std::snprintf(message, sizeof(message), "Mesh %s (%u sub-meshes): loaded from cooked file in %.2f ms (assimp import took %.2f ms, %.0fx faster)\n",
+                      fileName.c_str(), NumSubMeshes(), time, importTime, time > 0 ? importTime / time : 0.0f);
+    }
+    else
+    {
+        const MeshImportStats& stats = prepared.imported.stats;
+        std::snprintf(message, sizeof(message), "Mesh %s (%u sub-meshes): imported with assimp in %.2f ms (hash %.2f, import %.2f, extract %.2f, index %.2f, tangents %.2f, optimise %.2f, simplify %.2f)%s\n",
+                      fileName.c_str(), NumSubMeshes(), time, stats.hashSeconds * 1000,
+                      stats.importSeconds * 1000, stats.extractSeconds * 1000, stats.indexSeconds * 1000, stats.tangentSeconds * 1000, stats.optimiseSeconds * 1000,
+                      stats.simplifySeconds * 1000,
+                      prepared.cookedFileWritten ? ", cooked file written" : ", cooked file NOT written");
+    }
+    OutputDebugStringA(message);
+
+    // Vertex cache use before and after the import reordered the triangles (see MeshOptimise.h)
+    MeshCacheStats cacheBefore = MeshCacheTotals(subMeshes, NumSubMeshes(), false);
+    MeshCacheStats cacheAfter  = MeshCacheTotals(subMeshes, NumSubMeshes(), true);
+    std::snprintf(message, sizeof(message), "    vertex cache (%u entry FIFO): ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", VERTEX_CACHE_FIFO_SIZE,
+                  cacheBefore.ACMR(), cacheAfter.ACMR(), cacheBefore.ATVR(), cacheAfter.ATVR());
+    OutputDebugStringA(message);
+    if (cacheAfter.numTriangles > 0)  mACMR = cacheAfter.ACMR();
+
+    std::snprintf(message, sizeof(message), "    vertex streams: full %u bytes per vertex, position only %u bytes (%.0f%% of the fetch for depth-only passes)\n",
+                  mVertexSize, mPositionSize, 100.0f * mPositionSize / mVertexSize);
+    OutputDebugStringA(message);
+
+    // Triangles and estimated error of each level of detail (see MeshSimplify.h)
+    std::string lods = "    levels of detail:";
+    for (unsigned int lod = 0; lod < mNumLods; ++lod)
+    {
+        std::snprintf(message, sizeof(message), "%s %u triangles (error %.4f)", lod > 0 ? "," : "", NumTriangles(lod), LodError(lod));
+        lods += message;
+    }
+    OutputDebugStringA((lods + "\n").c_str());
+    std::snprintf(message, sizeof(message), "    %u clusters for culling, %.1f triangles each\n", NumClusters(),
+                  NumClusters() > 0 ? static_cast<float>(NumTriangles()) / NumClusters() : 0.0f);
+    OutputDebugStringA(message);
+
+    if (HasSkin())
+    {
+        std::snprintf(message, sizeof(message), "    skinned: %u bones, %u bytes per vertex skinned into %u byte dynamic vertices\n",
+                      NumBones(), mSkinLayout.sourceSize, mSkinLayout.skinnedSize);
+        OutputDebugStringA(message);
+    }
+
+    if (HasMorphTargets())
+    {
+        size_t numDeltas = 0;
+        for (const MorphTarget& target : mMorphTargets)  numDeltas += target.deltas.size();
+        std::snprintf(message, sizeof(message), "    morph targets: %u, %.1f deltas each (%.1f%% of the vertices)\n", NumMorphTargets(),
+                      static_cast<float>(numDeltas) / NumMorphTargets(), 100.0f * numDeltas / NumMorphTargets() / std::max(mNumVertices, 1u));
+        OutputDebugStringA(message);
+    }
 
-    DWORD* index = reinterpret_cast<DWORD*>(indices.get());
-    for (unsigned int face = 0; face < assimpMesh->mNumFaces; ++face)
+    if (compressed)
     {
-        *index++ = assimpMesh->mFaces[face].mIndices[0];
-        *index++ = assimpMesh->mFaces[face].mIndices[1];
-        *index++ = assimpMesh->mFaces[face].mIndices[2];
+        const MeshCompressionStats& stats = compressed->stats;
+        std::snprintf(message, sizeof(message), "    compressed in %.2f ms: vertices %u -> %u bytes, indices %u -> %u bytes (%.0f%% saved). "
+                      "Max error: position %.5f, normal %.3f deg, tangent %.3f deg, uv %.5f\n",
+                      stats.seconds * 1000, stats.vertexBytesBefore, stats.vertexBytesAfter, stats.indexBytesBefore, stats.indexBytesAfter,
+                      stats.BytesBefore() > 0 ? 100.0f * (stats.BytesBefore() - stats.BytesAfter()) / stats.BytesBefore() : 0.0f,
+                      stats.maxPositionError, stats.maxNormalError, stats.maxTangentError, stats.maxUVError);
+        OutputDebugStringA(message);
     }
+}
 
 
-    //-----------------------------------
+// Create the input layout and the GPU-side vertex and index buffers from the given data. The vertex
+// size, vertex/index counts and index format must have been set already
+void Mesh::CreateBuffers(const std::string& fileName, const D3D11_INPUT_ELEMENT_DESC* vertexElements, unsigned int numElements,
+                         const void* vertices, const void* indices)
+{
+    // Create a "vertex layout" to describe to DirectX what is data in each vertex of this mesh
+    auto shaderSignature = CreateSignatureForVertexLayout(vertexElements, static_cast<int>(numElements));
+    HRESULT hr = gD3DDevice->CreateInputLayout(vertexElements, numElements,
+                                               shaderSignature->GetBufferPointer(), shaderSignature->GetBufferSize(),
+                                               &mVertexLayout);
+    if (shaderSignature)  shaderSignature->Release();
+    if (FAILED(hr))  throw std::runtime_error("Failure creating input layout for " + fileName);
+
 
     D3D11_BUFFER_DESC bufferDesc;
     D3D11_SUBRESOURCE_DATA initData;
@@ -217,7 +410,7 @@ Mesh::Mesh(const std::string& fileName, bool requireTangents /*= false*/)
     bufferDesc.ByteWidth = mNumVertices * mVertexSize; // Size of the buffer in bytes
     bufferDesc.CPUAccessFlags = 0;
     bufferDesc.MiscFlags = 0;
-    initData.pSysMem = vertices.get(); // Fill the new vertex buffer with data loaded by assimp
+    initData.pSysMem = vertices; // Fill the new vertex buffer with the given data
     
     hr = gD3DDevice->CreateBuffer(&bufferDesc, &initData, &mVertexBuffer);
     if (FAILED(hr))  throw std::runtime_error("Failure creating vertex buffer for " + fileName);
@@ -226,42 +419,320 @@ Mesh::Mesh(const std::string& fileName, bool requireTangents /*= false*/)
     // Create GPU-side index buffer and copy the vertices imported by assimp into it
     bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER; // Indicate it is an index buffer
     bufferDesc.Usage = D3D11_USAGE_DEFAULT;         // Default usage for this buffer - we'll see other usages later
-    bufferDesc.ByteWidth = mNumIndices * sizeof(DWORD); // Size of the buffer in bytes
+    bufferDesc.ByteWidth = mNumIndices * (mIndexFormat == DXGI_FORMAT_R16_UINT ? 2 : 4); // Size of the buffer in bytes
     bufferDesc.CPUAccessFlags = 0;
     bufferDesc.MiscFlags = 0;
-    initData.pSysMem = indices.get(); // Fill the new index buffer with data loaded by assimp
+    initData.pSysMem = indices; // Fill the new index buffer with the given data
 
     hr = gD3DDevice->CreateBuffer(&bufferDesc, &initData, &mIndexBuffer);
     if (FAILED(hr))  throw std::runtime_error("Failure creating index buffer for " + fileName);
 }
 
 
+// Copy the position element out of the given vertices into the position-only stream and create its input
+// layout and vertex buffer. The vertex size and count must have been set already
+void Mesh::CreatePositionStream(const std::string& fileName, const CookedVertexElement* elements, unsigned int numElements,
+                                const void* vertices)
+{
+    // Full precision positions are 3 floats, compressed ones 4 x 16 bits (see MeshCompression.h)
+    const CookedVertexElement* position = nullptr;
+    for (unsigned int i = 0; i < numElements && !position; ++i)
+    {
+        if (std::strncmp(elements[i].semanticName, "Position", sizeof(elements[i].semanticName)) == 0)  position = &elements[i];
+    }
+    if (!position)  throw std::runtime_error("No position data in " + fileName);
+    if      (position->format == MESH_FORMAT_R32G32B32_FLOAT)     mPositionSize = 12;
+    else if (position->format == MESH_FORMAT_R16G16B16A16_UNORM)  mPositionSize = 8;
+    else throw std::runtime_error("Unsupported position format in " + fileName);
+
+    // Same vertex order as the full vertices, so the index buffer is shared
+    std::unique_ptr<unsigned char[]> positions(new unsigned char[mNumVertices * mPositionSize]);
+    VertexStream stream = { static_cast<const unsigned char*>(vertices) + position->offset, mVertexSize, mPositionSize, 0 };
+    InterleaveVertices(&stream, 1, positions.get(), mPositionSize, mNumVertices);
+
+    D3D11_INPUT_ELEMENT_DESC positionElement = { position->semanticName, position->semanticIndex, static_cast<DXGI_FORMAT>(position->format),
+                                                 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 };
+    auto shaderSignature = CreateSignatureForVertexLayout(&positionElement, 1);
+    HRESULT hr = gD3DDevice->CreateInputLayout(&positionElement, 1, shaderSignature->GetBufferPointer(), shaderSignature->GetBufferSize(),
+                                               &mPositionLayout);
+    if (shaderSignature)  shaderSignature->Release();
+    if (FAILED(hr))  throw std::runtime_error("Failure creating position input layout for " + fileName);
+
+    D3D11_BUFFER_DESC bufferDesc;
+    bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+    bufferDesc.Usage = D3D11_USAGE_IMMUTABLE; // Never changes after creation
+    bufferDesc.ByteWidth = mNumVertices * mPositionSize;
+    bufferDesc.CPUAccessFlags = 0;
+    bufferDesc.MiscFlags = 0;
+    D3D11_SUBRESOURCE_DATA initData = { positions.get() };
+    hr = gD3DDevice->CreateBuffer(&bufferDesc, &initData, &mPositionBuffer);
+    if (FAILED(hr))  throw std::runtime_error("Failure creating position vertex buffer for " + fileName);
+}
+
+
+// Keep a CPU copy of the given vertices for skinning, find the skinned elements and create the skinned stream's
+// input layout. The vertex size and count must have been set already
+void Mesh::CreateSkinStream(const std::string& fileName, const CookedVertexElement* elements, unsigned int numElements,
+                            const void* vertices, const CookedBone* bones, unsigned int numBones)
+{
+    mBones.assign(bones, bones + numBones);
+
+    // The layout SkinVertices needs, with the blend elements after the rest of the vertex (see MeshSkinning.h)
+    const CookedVertexElement* position     = FindElement(elements, numElements, "Position",     MESH_FORMAT_R32G32B32_FLOAT);
+    const CookedVertexElement* normal       = FindElement(elements, numElements, "Normal",       MESH_FORMAT_R32G32B32_FLOAT);
+    const CookedVertexElement* tangent      = FindElement(elements, numElements, "Tangent",      MESH_FORMAT_R32G32B32A32_FLOAT);
+    const CookedVertexElement* blendIndices = FindElement(elements, numElements, "BlendIndices", MESH_FORMAT_R8G8B8A8_UINT);
+    const CookedVertexElement* blendWeights = FindElement(elements, numElements, "BlendWeights", MESH_FORMAT_R8G8B8A8_UNORM);
+    if (!position || !normal || !blendIndices || !blendWeights)  throw std::runtime_error("Unsupported skin vertex layout in " + fileName);
+
+    mSkinLayout.sourceSize         = mVertexSize;
+    mSkinLayout.skinnedSize        = std::min(blendIndices->offset, blendWeights->offset);
+    mSkinLayout.positionOffset     = position->offset;
+    mSkinLayout.normalOffset       = normal->offset;
+    mSkinLayout.tangentOffset      = tangent ? tangent->offset : SKIN_NO_ELEMENT;
+    mSkinLayout.blendIndicesOffset = blendIndices->offset;
+    mSkinLayout.blendWeightsOffset = blendWeights->offset;
+
+    // SkinVertices never reads the vertices while drawing, so the mapped cooked file needn't be kept
+    mSkinVertices.reset(new unsigned char[mNumVertices * mVertexSize]);
+    std::memcpy(mSkinVertices.get(), vertices, mNumVertices * mVertexSize);
+
+    // The skinned vertices are the full vertices without the blend elements
+    std::vector<D3D11_INPUT_ELEMENT_DESC> skinnedElements;
+    for (const D3D11_INPUT_ELEMENT_DESC& element : InputElements(elements, numElements))
+    {
+        if (element.AlignedByteOffset < mSkinLayout.skinnedSize)  skinnedElements.push_back(element);
+    }
+    auto shaderSignature = CreateSignatureForVertexLayout(skinnedElements.data(), static_cast<int>(skinnedElements.size()));
+    HRESULT hr = gD3DDevice->CreateInputLayout(skinnedElements.data(), static_cast<UINT>(skinnedElements.size()),
+                                               shaderSignature->GetBufferPointer(), shaderSignature->GetBufferSize(), &mSkinnedLayout);
+    if (shaderSignature)  shaderSignature->Release();
+    if (FAILED(hr))  throw std::runtime_error("Failure creating skinned input layout for " + fileName);
+}
+
+
+// Create a dynamic vertex buffer to hold one instance's skinned vertices, see header
+ID3D11Buffer* Mesh::CreateSkinnedVertexBuffer()
+{
+    if (!HasSkin())  throw std::runtime_error("Creating skinned vertex buffer for a mesh without a skin");
+
+    D3D11_BUFFER_DESC bufferDesc;
+    bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+    bufferDesc.Usage = D3D11_USAGE_DYNAMIC;             // Rewritten by the CPU every frame
+    bufferDesc.ByteWidth = mNumVertices * mSkinLayout.skinnedSize;
+    bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+    bufferDesc.MiscFlags = 0;
+    ID3D11Buffer* buffer = nullptr;
+    if (FAILED(gD3DDevice->CreateBuffer(&bufferDesc, nullptr, &buffer)))  throw std::runtime_error("Failure creating skinned vertex buffer");
+    return buffer;
+}
+
+
+// Keep the given morph targets and a CPU copy of the vertices they apply to. The vertex size and count must
+// have been set already
+void Mesh::CreateMorphStream(const void* vertices, const std::vector<MorphTarget>& targets, const MorphVertexLayout& layout)
+{
+    mMorphTargets = targets;
+    mMorphLayout  = layout;
+
+    // Each instance's MorphedVertices reads these, so the mapped cooked file needn't be kept
+    mMorphVertices.reset(new unsigned char[mNumVertices * mVertexSize]);
+    std::memcpy(mMorphVertices.get(), vertices, mNumVertices * mVertexSize);
+}
+
+
+// Create a vertex buffer to hold one instance's morphed vertices, see header
+ID3D11Buffer* Mesh::CreateMorphedVertexBuffer()
+{
+    if (!HasMorphTargets())  throw std::runtime_error("Creating morphed vertex buffer for a mesh without morph targets");
+
+    // Only the parts of the vertices that change are uploaded (with UpdateSubresource), which a dynamic buffer
+    // can't do as mapping it discards the whole buffer
+    D3D11_BUFFER_DESC bufferDesc;
+    bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+    bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+    bufferDesc.ByteWidth = mNumVertices * mVertexSize;
+    bufferDesc.CPUAccessFlags = 0;
+    bufferDesc.MiscFlags = 0;
+    D3D11_SUBRESOURCE_DATA initData = { mMorphVertices.get() };
+    ID3D11Buffer* buffer = nullptr;
+    if (FAILED(gD3DDevice->CreateBuffer(&bufferDesc, &initData, &buffer)))  throw std::runtime_error("Failure creating morphed vertex buffer");
+    return buffer;
+}
+
+
+// Copy the given vertex ranges of an instance's morphed vertices to its vertex buffer, see header
+unsigned int Mesh::UploadMorphedVertices(ID3D11Buffer* buffer, const MorphedVertices& morphed, const std::vector<MorphRange>& ranges)
+{
+    const unsigned char* vertices = static_cast<const unsigned char*>(morphed.Vertices());
+    unsigned int bytes = 0;
+    for (const MorphRange& range : ranges)
+    {
+        // For buffers the box is in bytes, and the source data is the start of the box's data
+        D3D11_BOX box = { range.firstVertex * mVertexSize, 0, 0, range.endVertex * mVertexSize, 1, 1 };
+        gD3DContext->UpdateSubresource(buffer, 0, &box, vertices + box.left, 0, 0);
+        bytes += box.right - box.left;
+    }
+    return bytes;
+}
+
+
 Mesh::~Mesh()
 {
-    if (mIndexBuffer)   mIndexBuffer ->Release();
-    if (mVertexBuffer)  mVertexBuffer->Release();
-    if (mVertexLayout)  mVertexLayout->Release();
+    if (mIndexBuffer)     mIndexBuffer   ->Release();
+    if (mSkinnedLayout)   mSkinnedLayout ->Release();
+    if (mPositionBuffer)  mPositionBuffer->Release();
+    if (mPositionLayout)  mPositionLayout->Release();
+    if (mVertexBuffer)    mVertexBuffer  ->Release();
+    if (mVertexLayout)    mVertexLayout  ->Release();
 }
 
 
-// The render function assumes shaders, matrices, textures, samplers etc. have been set up already.
-// It simply draws this mesh with whatever settings the GPU is currently using.
-void Mesh::Render()
+// Set the vertex buffer and layout of the given stream, and the index buffer and topology of this mesh on the GPU
+void Mesh::SetBuffers(Stream stream, ID3D11Buffer* instanceVertices /*= nullptr*/)
 {
+    // Without an instance's vertex buffer draw the mesh's own vertices
+    if ((stream == Stream::Skinned || stream == Stream::Morphed) && !instanceVertices)  stream = Stream::Full;
+
     // Set vertex buffer as next data source for GPU
-    UINT stride = mVertexSize;
+    ID3D11Buffer* vertexBuffer = mVertexBuffer;
+    ID3D11InputLayout* vertexLayout = mVertexLayout;
+    if      (stream == Stream::Position) { vertexBuffer = mPositionBuffer;  vertexLayout = mPositionLayout; }
+    else if (stream == Stream::Skinned)  { vertexBuffer = instanceVertices; vertexLayout = mSkinnedLayout; }
+    else if (stream == Stream::Morphed)  { vertexBuffer = instanceVertices; }
+    UINT stride = VertexSize(stream);
     UINT offset = 0;
-    gD3DContext->IASetVertexBuffers(0, 1, &mVertexBuffer, &stride, &offset);
+    gD3DContext->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
 
     // Indicate the layout of vertex buffer
-    gD3DContext->IASetInputLayout(mVertexLayout);
+    gD3DContext->IASetInputLayout(vertexLayout);
 
-    // Set index buffer as next data source for GPU, indicate it uses 32-bit integers
-    gD3DContext->IASetIndexBuffer(mIndexBuffer, DXGI_FORMAT_R32_UINT, 0);
+    // Set index buffer as next data source for GPU, indicate whether it uses 16 or 32-bit integers
+    gD3DContext->IASetIndexBuffer(mIndexBuffer, mIndexFormat, 0);
 
     // Using triangle lists only in this class
     gD3DContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+}
 
-    // Render mesh
-    gD3DContext->DrawIndexed(mNumIndices, 0, 0);
+
+// Draw from the buffers set on the GPU, counting the call for reporting (see RenderCounts in Common.h)
+static void DrawIndexed(unsigned int numIndices, unsigned int indexStart, unsigned int baseVertex)
+{
+    gD3DContext->DrawIndexed(numIndices, indexStart, baseVertex);
+    ++gRenderCounts.drawCalls;
+}
+
+
+// The render functions assume shaders, matrices, textures, samplers etc. have been set up already.
+// They simply draw this mesh with whatever settings the GPU is currently using.
+// Draw all the sub-meshes
+void Mesh::Render(Stream stream /*= Stream::Full*/, ID3D11Buffer* instanceVertices /*= nullptr*/)
+{
+    SetBuffers(stream, instanceVertices);
+
+    // Render each sub-mesh from its part of the shared buffers. Sub-meshes that follow each other in the index
+    // buffer and share a base vertex, such as the materials of a static batch (see MeshBatch.h), are drawn together
+    unsigned int runStart = 0, runIndices = 0, runBaseVertex = 0;
+    for (auto& subMesh : mSubMeshes)
+    {
+        if (runIndices > 0 && (runStart + runIndices != subMesh.indexStart || runBaseVertex != subMesh.baseVertex))
+        {
+            DrawIndexed(runIndices, runStart, runBaseVertex);
+            runIndices = 0;
+        }
+        if (runIndices == 0)
+        {
+            runStart = subMesh.indexStart;
+            runBaseVertex = subMesh.baseVertex;
+        }
+        runIndices += subMesh.numIndices;
+    }
+    if (runIndices > 0)  DrawIndexed(runIndices, runStart, runBaseVertex);
+}
+
+
+// Draw a single sub-mesh
+void Mesh::Render(unsigned int subMesh, Stream stream /*= Stream::Full*/, ID3D11Buffer* instanceVertices /*= nullptr*/)
+{
+    SetBuffers(stream, instanceVertices);
+
+    const SubMesh& part = mSubMeshes[subMesh];
+    DrawIndexed(part.numIndices, part.indexStart, part.baseVertex);
+}
+
+
+// Draw all the sub-meshes at the given level of detail
+void Mesh::RenderLod(unsigned int lod, Stream stream /*= Stream::Full*/, ID3D11Buffer* instanceVertices /*= nullptr*/)
+{
+    SetBuffers(stream, instanceVertices);
+
+    lod = std::min(lod, MESH_MAX_LODS - 1);
+    for (auto& subMesh : mSubMeshes)
+    {
+        DrawIndexed(subMesh.lods[lod].numIndices, subMesh.lods[lod].indexStart, subMesh.baseVertex);
+    }
+}
+
+
+// Draw all the sub-meshes at full detail, skipping the clusters outside the given frustum and, if cullBackFacing
+// is set, those facing away from the viewpoint. Returns the number of triangles skipped
+unsigned int Mesh::RenderClusters(const Frustum& frustum, CVector3 viewpoint, bool cullBackFacing, Stream stream /*= Stream::Full*/)
+{
+    SetBuffers(stream);
+
+    // Test all the bounding spheres at once (SIMD)
+    TestSpheres(frustum, { mClusterX.data(), mClusterY.data(), mClusterZ.data() }, mClusterRadius.data(),
+                mClusterResults.data(), static_cast<int>(mClusters.size()));
+
+    unsigned int numCulled = 0;
+    for (auto& subMesh : mSubMeshes)
+    {
+        // Draw each run of visible clusters with one call
+        unsigned int runStart = subMesh.indexStart, runIndices = 0;
+        for (unsigned int c = subMesh.clusterStart; c < subMesh.clusterStart + subMesh.numClusters; ++c)
+        {
+            const CookedCluster& cluster = mClusters[c];
+            if (mClusterResults[c] == CullResult::Outside || (cullBackFacing && IsClusterBackFacing(cluster, &viewpoint.x)))
+            {
+                numCulled += cluster.numIndices / 3;
+                continue;
+            }
+
+            if (runIndices > 0 && runStart + runIndices != cluster.indexStart)
+            {
+                DrawIndexed(runIndices, runStart, subMesh.baseVertex);
+                runIndices = 0;
+            }
+            if (runIndices == 0)  runStart = cluster.indexStart;
+            runIndices += cluster.numIndices;
+        }
+        if (subMesh.numClusters == 0)  runIndices = subMesh.numIndices; // No clusters, draw it all
+        if (runIndices > 0)  DrawIndexed(runIndices, runStart, subMesh.baseVertex);
+    }
+    return numCulled;
+}
+
+
+// Largest error of any sub-mesh at the given level of detail
+float Mesh::LodError(unsigned int lod) const
+{
+    lod = std::min(lod, MESH_MAX_LODS - 1);
+    float error = 0;
+    for (auto& subMesh : mSubMeshes)  error = std::max(error, subMesh.lods[lod].error);
+    return error;
+}
+
+// Triangles drawn for the given level of detail over all sub-meshes
+unsigned int Mesh::NumTriangles(unsigned int lod /*= 0*/) const
+{
+    lod = std::min(lod, MESH_MAX_LODS - 1);
+    unsigned int numTriangles = 0;
+    for (auto& subMesh : mSubMeshes)  numTriangles += subMesh.lods[lod].numIndices / 3;
+    return numTriangles;
+}
+
+// Estimate of the vertex data read drawing the given number of triangles from a stream, see header
+unsigned long long Mesh::VertexFetchBytes(unsigned int numTriangles, Stream stream) const
+{
+    return static_cast<unsigned long long>(static_cast<double>(numTriangles) * mACMR * VertexSize(stream) + 0.5);
 }
@@ -1,34 +1,250 @@
 //--------------------------------------------------------------------------------------
 // Class encapsulating a mesh
 //--------------------------------------------------------------------------------------
-// The mesh class splits the mesh into sub-meshes that only use one texture each.
-// ** THIS VERSION WILL ONLY KEEP THE FIRST SUB-MESH OTHER PARTS WILL BE MISSING **
-// ** DO NOT USE THIS VERSION FOR PROJECTS **
+// The mesh class splits the mesh into sub-meshes that only use one texture each. All the sub-meshes
+// share one vertex buffer and one index buffer, with a table giving the part of the buffers used by
+// each sub-mesh. So the whole mesh, or any one sub-mesh, is drawn with a single set of buffer binds.
+// Each sub-mesh also has simpler levels of detail (LODs) built by the import (see MeshSimplify.h).
+// They use the same vertices so are just further parts of the index buffer. The full detail triangles
+// are also split into clusters with their own bounds, so parts of the mesh outside the view or facing
+// away can be skipped (see MeshClusters.h).
+// Alongside the full vertices the mesh keeps a second vertex buffer holding only the positions, tightly
+// packed in the same vertex order so the same index buffer and sub-mesh table draw from either one.
+// Depth-only passes such as shadow maps draw from it so they don't fetch normals, tangents and UVs.
+// A skinned mesh also keeps its skeleton and a CPU copy of its vertices. Each animated instance skins
+// those vertices into its own dynamic vertex buffer (see MeshSkinning.h), which the render functions
+// can draw from in place of the mesh's own vertices.
+// A mesh with morph targets keeps them with a CPU copy of its vertices in the same way. Each instance
+// morphs its own copy of the vertices (see MeshMorph.h) and uploads the parts that changed to its own
+// vertex buffer, which the render functions can also draw from.
 // The class also doesn't load textures, filters or shaders as the outer code is
 // expected to select these things. A later lab will introduce a more robust loader.
 
 #include "common.h"
+#include "MeshData.h"
+#include "CookedMesh.h"
+#include "MeshCompression.h"
+#include "MeshClusters.h"
+#include "MeshSkinning.h"
+#include "MeshMorph.h"
+#include "CVector3.h"
+#include "Frustum.h"
 
 #include <string>
+#include <vector>
+#include <memory>
 
 #ifndef _MESH_H_INCLUDED_
 #define _MESH_H_INCLUDED_
 
+// The CPU-side part of loading a mesh - the mapped cooked file, or the data imported by assimp if there
+// was no up to date cooked file. Reading, importing and cooking don't use the device so PrepareMesh can be
+// called on any thread, then the result passed to the Mesh constructor on the device thread.
+// The assimp logger isn't set up by PrepareMesh as it is global and not safe to share between threads
+struct PreparedMesh
+{
+    std::string                         fileName;
+    std::unique_ptr<CookedMeshFile>     cooked;                    // Set if loading from a cooked file...
+    MeshData                            imported;                  // ...otherwise the imported data
+    bool                                cookedFileWritten = false; // Whether the imported data was saved to a cooked file
+    std::unique_ptr<CompressedMeshData> compressed;                // Set if compressing, the vertex and index data to use
+    std::vector<MorphTarget>            morphTargets;              // Set if morph targets are required...
+    MorphVertexLayout                   morphLayout;               // ...and where they apply in the vertices
+    bool                                built = false;             // Whether the imported data was built in memory rather than imported, e.g. a static batch (see MeshBatch.h)
+    float                               prepareSeconds    = 0;
+};
+
+// Do the CPU-side part of loading a mesh. Parameters as for the Mesh constructor.
+// Will throw a std::runtime_error exception on failure
+PreparedMesh PrepareMesh(const std::string& fileName, bool requireTangents = false, bool compressVertices = false,
+                         bool requireSkin = false, bool requireMorphs = false);
+
+
 class Mesh
 {
 public:
     // Pass the name of the mesh file to load. Uses assimp (http://www.assimp.org/) to support many file types
     // Optionally request tangents to be calculated (for normal and parallax mapping - see later lab)
     // Will throw a std::runtime_error exception on failure (since constructors can't return errors).
-    Mesh(const std::string& fileName, bool requireTangents = false);
+    // The imported data is saved to a cooked file next to the mesh file, which is used instead of
+    // importing next time, unless the mesh file has changed (see CookedMesh.h)
+    // Optionally use the compressed vertex layout on the GPU (see MeshCompression.h). The cooked file
+    // always holds full precision data
+    // Optionally keep the skeleton and bone weights for skinning on the CPU (see MeshSkinning.h). Skinned
+    // meshes are never compressed
+    // Optionally give the mesh morph targets (see MeshMorph.h). Meshes with morph targets are never compressed
+    Mesh(const std::string& fileName, bool requireTangents = false, bool compressVertices = false, bool requireSkin = false,
+         bool requireMorphs = false);
+
+    // Create the mesh from the result of PrepareMesh, which may have been called on another thread.
+    // Will throw a std::runtime_error exception on failure
+    explicit Mesh(const PreparedMesh& prepared);
+
+    // As above, then keep the prepared data's full precision vertices and indices for later use on the CPU
+    // (see PreparedData). Any compressed data is released as the GPU buffers hold it
+    explicit Mesh(std::shared_ptr<PreparedMesh> prepared);
     ~Mesh();
 
-    // The render function assumes shaders, matrices, textures, samplers etc. have been set up already.
-    // It simply draws this mesh with whatever settings the GPU is currently using.
-    void Render();
+    // The part of the index buffer used by one level of detail of a sub-mesh. The error is an estimate
+    // of the model space distance the surface has moved from full detail
+    struct Lod
+    {
+        unsigned int indexStart;
+        unsigned int numIndices;
+        float        error;
+    };
+
+    // The part of the vertex and index buffers used by a sub-mesh. Index values are relative to the
+    // sub-mesh's first vertex. Bounds are in model space. lods[0] is the full detail indices given
+    // by indexStart and numIndices, entries from numLods on repeat the last level. The clusters cover the
+    // full detail indices in order
+    struct SubMesh
+    {
+        unsigned int indexStart;
+        unsigned int numIndices;
+        unsigned int baseVertex;
+        unsigned int numVertices;
+        CVector3     boundsMin;
+        CVector3     boundsMax;
+        unsigned int numLods;
+        Lod          lods[MESH_MAX_LODS];
+        unsigned int clusterStart;
+        unsigned int numClusters;
+    };
+
+    // Whether the vertices use the compressed layout, see MeshCompression.h. Model space positions are
+    // PositionOffset() + stored position * PositionScale(), which is an identity for uncompressed meshes
+    bool           HasCompressedVertices() const     { return mCompressedVertices; }
+    CVector3       PositionOffset() const            { return mPositionOffset; }
+    CVector3       PositionScale() const             { return mPositionScale; }
+
+    unsigned int   NumSubMeshes() const              { return static_cast<unsigned int>(mSubMeshes.size()); }
+    const SubMesh& GetSubMesh(unsigned int i) const  { return mSubMeshes[i]; }
+
+    // The file the mesh was loaded from, and whether it was loaded with tangents
+    const std::string& FileName() const              { return mFileName; }
+    bool           HasTangents() const               { return mHasTangents; }
+
+    // The full precision data the mesh was created from - the mapped cooked file or the imported data - if it
+    // was kept (see constructor), otherwise nullptr. E.g. to merge the mesh into a static batch (see StaticBatch.h)
+    const PreparedMesh* PreparedData() const         { return mPrepared.get(); }
+
+    // Sphere around the whole mesh in model space
+    CVector3       BoundsCentre() const              { return mBoundsCentre; }
+    float          BoundsRadius() const              { return mBoundsRadius; }
+
+    // Levels of detail of the whole mesh - the most of any sub-mesh, 0 is full detail. The error of a
+    // level is the largest of its sub-meshes and the triangles are the total drawn for the level
+    unsigned int   NumLods() const                   { return mNumLods; }
+    float          LodError(unsigned int lod) const;
+    unsigned int   NumTriangles(unsigned int lod = 0) const;
+
+    // Clusters of all the sub-meshes, see MeshClusters.h
+    unsigned int   NumClusters() const               { return static_cast<unsigned int>(mClusters.size()); }
+
+    // Skeleton and vertices for skinning, see MeshSkinning.h. The source vertices are a CPU copy of the full
+    // vertices, and the layout skins them into the skinned stream's vertices
+    bool                    HasSkin() const              { return !mBones.empty(); }
+    unsigned int            NumBones() const             { return static_cast<unsigned int>(mBones.size()); }
+    const CookedBone*       Bones() const                { return mBones.data(); }
+    const SkinVertexLayout& SkinLayout() const           { return mSkinLayout; }
+    const void*             SkinSourceVertices() const   { return mSkinVertices.get(); }
+    unsigned int            NumVertices() const          { return mNumVertices; }
+
+    // Create a dynamic vertex buffer to hold one instance's skinned vertices, to be mapped with
+    // D3D11_MAP_WRITE_DISCARD and filled each frame. The caller releases it. Will throw a std::runtime_error
+    // exception on failure or if the mesh has no skin
+    ID3D11Buffer*           CreateSkinnedVertexBuffer();
+
+    // Morph targets and the vertices they apply to, see MeshMorph.h. The vertices are a CPU copy of the full vertices
+    bool                     HasMorphTargets() const      { return !mMorphTargets.empty(); }
+    unsigned int             NumMorphTargets() const      { return static_cast<unsigned int>(mMorphTargets.size()); }
+    const MorphTarget*       MorphTargets() const         { return mMorphTargets.data(); }
+    const MorphVertexLayout& MorphLayout() const          { return mMorphLayout; }
+    const void*              MorphSourceVertices() const  { return mMorphVertices.get(); }
+
+    // Create a vertex buffer to hold one instance's morphed vertices, starting as the mesh's own vertices. The
+    // caller releases it. Will throw a std::runtime_error exception on failure or if the mesh has no morph targets
+    ID3D11Buffer*            CreateMorphedVertexBuffer();
+
+    // Copy the given vertex ranges of an instance's morphed vertices (see MorphedVertices::Update) to its
+    // vertex buffer. Returns the number of bytes uploaded
+    unsigned int             UploadMorphedVertices(ID3D11Buffer* buffer, const MorphedVertices& morphed, const std::vector<MorphRange>& ranges);
+
+
+    // The vertex buffer the render functions draw from. The position stream suits depth-only passes, its
+    // vertices only hold the position element so the vertex shader must not read anything else
+    enum class Stream
+    {
+        Full,     // All vertex elements
+        Position, // Position only
+        Skinned,  // The full vertices without the blend elements, from an instance's skinned vertex buffer
+        Morphed,  // The full vertices, from an instance's morphed vertex buffer
+    };
+
+    // Size in bytes of one vertex in the given stream
+    unsigned int   VertexSize(Stream stream) const
+    {
+        return stream == Stream::Position ? mPositionSize : (stream == Stream::Skinned ? mSkinLayout.skinnedSize : mVertexSize);
+    }
+
+    // Estimate of the vertex data the GPU reads drawing the given number of triangles from a stream. Uses
+    // the vertices transformed per triangle after the import's reordering (ACMR, see MeshOptimise.h)
+    unsigned long long VertexFetchBytes(unsigned int numTriangles, Stream stream) const;
+
+
+    // The render functions assume shaders, matrices, textures, samplers etc. have been set up already.
+    // They simply draw this mesh with whatever settings the GPU is currently using.
+    // Each draws from the given vertex stream, the full vertices by default. The skinned and morphed streams
+    // draw from the given instance's vertex buffer (see CreateSkinnedVertexBuffer and CreateMorphedVertexBuffer)
+    // Draw all the sub-meshes at full detail. Sub-meshes that follow each other in the buffers with the same base
+    // vertex are drawn with one call, so all the materials of a static batch (see MeshBatch.h) are one draw
+    void Render(Stream stream = Stream::Full, ID3D11Buffer* instanceVertices = nullptr);
+
+    // Draw a single sub-mesh at full detail
+    void Render(unsigned int subMesh, Stream stream = Stream::Full, ID3D11Buffer* instanceVertices = nullptr);
+
+    // Draw all the sub-meshes at the given level of detail
+    void RenderLod(unsigned int lod, Stream stream = Stream::Full, ID3D11Buffer* instanceVertices = nullptr);
+
+    // Draw all the sub-meshes at full detail, skipping the clusters outside the given frustum and, if
+    // cullBackFacing is set, those facing away from the viewpoint. The frustum and viewpoint must be in
+    // model space. Clusters that are drawn and next to each other are drawn together. Returns the number
+    // of triangles skipped. Cluster bounds are for the mesh's own vertices, so not for use with the skinned or
+    // morphed streams
+    unsigned int RenderClusters(const Frustum& frustum, CVector3 viewpoint, bool cullBackFacing, Stream stream = Stream::Full);
 
 
 private:
+    // Set the vertex buffer and layout of the given stream, and the index buffer and topology of this mesh on the GPU
+    void SetBuffers(Stream stream, ID3D11Buffer* instanceVertices = nullptr);
+
+    // Create the GPU-side parts of the mesh from the result of PrepareMesh
+    void Init(const PreparedMesh& prepared);
+
+    // Create the input layout and the GPU-side vertex and index buffers from the given data. The vertex
+    // size, vertex/index counts and index format must have been set already
+    void CreateBuffers(const std::string& fileName, const D3D11_INPUT_ELEMENT_DESC* vertexElements, unsigned int numElements,
+                       const void* vertices, const void* indices);
+
+    // Copy the position element out of the given vertices into the position-only stream and create its
+    // input layout and vertex buffer. The vertex size and count must have been set already
+    void CreatePositionStream(const std::string& fileName, const CookedVertexElement* elements, unsigned int numElements,
+                              const void* vertices);
+
+    // Keep a CPU copy of the given vertices for skinning, find the skinned elements and create the skinned
+    // stream's input layout. The vertex size and count must have been set already
+    void CreateSkinStream(const std::string& fileName, const CookedVertexElement* elements, unsigned int numElements,
+                          const void* vertices, const CookedBone* bones, unsigned int numBones);
+
+    // Keep the given morph targets and a CPU copy of the vertices they apply to. The vertex size and count
+    // must have been set already
+    void CreateMorphStream(const void* vertices, const std::vector<MorphTarget>& targets, const MorphVertexLayout& layout);
+
+    std::string        mFileName;
+    bool               mHasTangents = false;
+    std::shared_ptr<const PreparedMesh> mPrepared; // Only if kept, see PreparedData
+
     unsigned int       mVertexSize;             // Size in bytes of a single vertex (depends on what it contains, uvs, tangents etc.)
     ID3D11InputLayout* mVertexLayout = nullptr; // DirectX specification of data held in a single vertex
 
@@ -36,8 +252,42 @@ private:
     unsigned int       mNumVertices;
     ID3D11Buffer*      mVertexBuffer = nullptr;
 
+    // Position-only stream, the same vertices holding just the position element
+    unsigned int       mPositionSize   = 0;
+    ID3D11InputLayout* mPositionLayout = nullptr;
+    ID3D11Buffer*      mPositionBuffer = nullptr;
+
+    // Skinning, the skinned stream's vertex buffers belong to each instance
+    std::vector<CookedBone>          mBones;
+    std::unique_ptr<unsigned char[]> mSkinVertices;
+    SkinVertexLayout                 mSkinLayout;
+    ID3D11InputLayout*               mSkinnedLayout = nullptr;
+
+    // Morph targets, the morphed stream's vertex buffers belong to each instance
+    std::vector<MorphTarget>         mMorphTargets;
+    MorphVertexLayout                mMorphLayout;
+    std::unique_ptr<unsigned char[]> mMorphVertices;
+
     unsigned int       mNumIndices;
+    DXGI_FORMAT        mIndexFormat  = DXGI_FORMAT_R32_UINT; // 16-bit indices are used by compressed meshes where possible
     ID3D11Buffer*      mIndexBuffer  = nullptr;
+
+    // Decoding for compressed vertices, see HasCompressedVertices
+    bool               mCompressedVertices = false;
+    CVector3           mPositionOffset     = { 0, 0, 0 };
+    CVector3           mPositionScale      = { 1, 1, 1 };
+
+    std::vector<SubMesh> mSubMeshes;
+    unsigned int         mNumLods      = 1;
+    float                mACMR         = 3; // Vertices transformed per triangle, for VertexFetchBytes
+
+    // Clusters, with copies of their bounding spheres in separate arrays for Frustum's SIMD tests
+    std::vector<CookedCluster> mClusters;
+    std::vector<float>         mClusterX, mClusterY, mClusterZ, mClusterRadius;
+    std::vector<CullResult>    mClusterResults;
+
+    CVector3             mBoundsCentre = { 0, 0, 0 };
+    float                mBoundsRadius = 0;
 };
 
 
@@ -0,0 +1,233 @@
+//--------------------------------------------------------------------------------------
+// Static batches - meshes that never move merged into one set of world space vertices
+//--------------------------------------------------------------------------------------
+
+#include "MeshBatch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+
+//-----------------------------------
+// Helpers
+//-----------------------------------
+
+// Find the vertex element with the given semantic name, nullptr if there isn't one. Throws if it doesn't have the given format
+static const CookedVertexElement* FindBatchElement(const CookedVertexElement* elements, unsigned int numElements,
+                                                   const char* semanticName, uint32_t format)
+{
+    for (unsigned int i = 0; i < numElements; ++i)
+    {
+        if (std::strncmp(elements[i].semanticName, semanticName, sizeof(elements[i].semanticName)) == 0)
+        {
+            if (elements[i].format != format)  throw std::runtime_error(std::string("Cannot batch vertex element ") + semanticName + " in this format");
+            return &elements[i];
+        }
+    }
+    return nullptr;
+}
+
+// Find the element of an instance with the same semantic and format as the given one, nullptr if there isn't one
+static const CookedVertexElement* FindMatchingElement(const BatchInstance& instance, const CookedVertexElement& element)
+{
+    for (unsigned int i = 0; i < instance.numElements; ++i)
+    {
+        const CookedVertexElement& other = instance.elements[i];
+        if (std::strncmp(other.semanticName, element.semanticName, sizeof(element.semanticName)) == 0 &&
+            other.semanticIndex == element.semanticIndex && other.format == element.format)
+        {
+            return &other;
+        }
+    }
+    return nullptr;
+}
+
+// Size in bytes of a vertex element in one of the formats in MeshData.h
+static unsigned int FormatSize(uint32_t format)
+{
+    switch (format)
+    {
+        case MESH_FORMAT_R32G32B32A32_FLOAT:  return 16;
+        case MESH_FORMAT_R32G32B32_FLOAT:     return 12;
+        case MESH_FORMAT_R16G16B16A16_UNORM:
+        case MESH_FORMAT_R16G16B16A16_SNORM:
+        case MESH_FORMAT_R32G32_FLOAT:        return 8;
+        case MESH_FORMAT_R8G8B8A8_UNORM:
+        case MESH_FORMAT_R8G8B8A8_UINT:
+        case MESH_FORMAT_R16G16_FLOAT:
+        case MESH_FORMAT_R16G16_SNORM:        return 4;
+    }
+    throw std::runtime_error("Cannot batch a vertex element in this format");
+}
+
+// Transform a direction by the rotation and scaling of a matrix, then renormalise it. Directions that
+// collapse to zero are left as zero
+static void TransformDirection(const CMatrix4x4& m, const float* in, float* out)
+{
+    float x = in[0] * m.e00 + in[1] * m.e10 + in[2] * m.e20;
+    float y = in[0] * m.e01 + in[1] * m.e11 + in[2] * m.e21;
+    float z = in[0] * m.e02 + in[1] * m.e12 + in[2] * m.e22;
+    float length = std::sqrt(x * x + y * y + z * z);
+    if (length > 0)  { x /= length;  y /= length;  z /= length; }
+    out[0] = x;  out[1] = y;  out[2] = z;
+}
+
+
+//-----------------------------------
+// Building batches
+//-----------------------------------
+
+// Merge the given instances into one mesh in world space, see header
+MeshData BuildStaticBatch(const BatchInstance* instances, unsigned int numInstances)
+{
+    MeshData batch;
+    if (numInstances == 0)  return batch;
+
+    // The instances are merged one material at a time, keeping their order within each material
+    std::vector<unsigned int> order(numInstances);
+    for (unsigned int i = 0; i < numInstances; ++i)  order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) { return instances[a].material < instances[b].material; });
+
+    // The batch has the elements of the first instance that every instance has, packed in the same order. The
+    // others are dropped, e.g. the tangents of a mesh shared with a request that needed them (see MeshCache.h)
+    const BatchInstance& first = instances[0];
+    std::vector<std::vector<unsigned int>> sourceOffsets(numInstances); // Offset of each batch element in each instance's vertices
+    unsigned int vertexSize = 0;
+    for (unsigned int e = 0; e < first.numElements; ++e)
+    {
+        unsigned int i = 1;
+        while (i < numInstances && FindMatchingElement(instances[i], first.elements[e]))  ++i;
+        if (i < numInstances)  continue;
+
+        CookedVertexElement element = first.elements[e];
+        element.offset = vertexSize;
+        vertexSize += FormatSize(element.format);
+        batch.vertexElements.push_back(element);
+        for (i = 0; i < numInstances; ++i)  sourceOffsets[i].push_back(FindMatchingElement(instances[i], element)->offset);
+    }
+    batch.vertexSize = vertexSize;
+
+    const CookedVertexElement* elements = batch.vertexElements.data();
+    unsigned int numElements = static_cast<unsigned int>(batch.vertexElements.size());
+    const CookedVertexElement* position = FindBatchElement(elements, numElements, "Position", MESH_FORMAT_R32G32B32_FLOAT);
+    const CookedVertexElement* normal   = FindBatchElement(elements, numElements, "Normal",   MESH_FORMAT_R32G32B32_FLOAT);
+    const CookedVertexElement* tangent  = FindBatchElement(elements, numElements, "Tangent",  MESH_FORMAT_R32G32B32A32_FLOAT);
+    if (!position)  throw std::runtime_error("Cannot batch meshes that don't all have positions");
+
+    for (unsigned int i = 0; i < numInstances; ++i)
+    {
+        batch.numVertices += instances[i].numVertices;
+        for (unsigned int s = 0; s < instances[i].numSubMeshes; ++s)  batch.numIndices += instances[i].subMeshes[s].numIndices;
+    }
+    batch.vertices.reset(new unsigned char[static_cast<size_t>(batch.numVertices) * vertexSize]);
+    batch.indices.reset(new uint32_t[batch.numIndices]);
+
+
+    //-----------------------------------
+
+    // Copy each instance's vertices into the batch's layout in world space and its full detail indices after
+    // them, starting a new sub-mesh at each change of material
+    unsigned int vertexStart = 0;
+    unsigned int indexStart  = 0;
+    for (unsigned int i = 0; i < numInstances; ++i)
+    {
+        const BatchInstance& instance = instances[order[i]];
+        if (i == 0 || instance.material != instances[order[i - 1]].material)
+        {
+            CookedSubMesh subMesh = {};
+            subMesh.indexStart = indexStart;
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                subMesh.boundsMin[axis] =  3e38f;
+                subMesh.boundsMax[axis] = -3e38f;
+            }
+            subMesh.numLods = 1;
+            batch.subMeshes.push_back(subMesh);
+        }
+        CookedSubMesh& subMesh = batch.subMeshes.back();
+
+        const CMatrix4x4& world = instance.worldMatrix;
+        CMatrix4x4 normalMatrix = InverseTranspose(world);
+        float determinant = world.e00 * (world.e11 * world.e22 - world.e12 * world.e21) -
+                            world.e01 * (world.e10 * world.e22 - world.e12 * world.e20) +
+                            world.e02 * (world.e10 * world.e21 - world.e11 * world.e20);
+        bool mirrored = determinant < 0;
+
+        const std::vector<unsigned int>& offsets = sourceOffsets[order[i]];
+        const unsigned char* in = static_cast<const unsigned char*>(instance.vertices);
+        unsigned char* out = batch.vertices.get() + static_cast<size_t>(vertexStart) * vertexSize;
+        for (unsigned int v = 0; v < instance.numVertices; ++v)
+        {
+            const unsigned char* source = in + static_cast<size_t>(v) * instance.vertexSize;
+            unsigned char* vertex = out + static_cast<size_t>(v) * vertexSize;
+            for (unsigned int e = 0; e < numElements; ++e)
+            {
+                std::memcpy(vertex + elements[e].offset, source + offsets[e], FormatSize(elements[e].format));
+            }
+
+            const float* p = reinterpret_cast<const float*>(source + offsets[position - elements]);
+            float* worldPosition = reinterpret_cast<float*>(vertex + position->offset);
+            worldPosition[0] = p[0] * world.e00 + p[1] * world.e10 + p[2] * world.e20 + world.e30;
+            worldPosition[1] = p[0] * world.e01 + p[1] * world.e11 + p[2] * world.e21 + world.e31;
+            worldPosition[2] = p[0] * world.e02 + p[1] * world.e12 + p[2] * world.e22 + world.e32;
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                subMesh.boundsMin[axis] = std::min(subMesh.boundsMin[axis], worldPosition[axis]);
+                subMesh.boundsMax[axis] = std::max(subMesh.boundsMax[axis], worldPosition[axis]);
+            }
+
+            if (normal)
+            {
+                const float* n = reinterpret_cast<const float*>(source + offsets[normal - elements]);
+                TransformDirection(normalMatrix, n, reinterpret_cast<float*>(vertex + normal->offset));
+            }
+            if (tangent)
+            {
+                // A mirrored tangent space changes hand
+                const float* t = reinterpret_cast<const float*>(source + offsets[tangent - elements]);
+                float* worldTangent = reinterpret_cast<float*>(vertex + tangent->offset);
+                TransformDirection(world, t, worldTangent);
+                worldTangent[3] = mirrored ? -t[3] : t[3];
+            }
+        }
+
+        // Index values become absolute, mirrored triangles are turned round so they still face outwards
+        for (unsigned int s = 0; s < instance.numSubMeshes; ++s)
+        {
+            const CookedSubMesh& source = instance.subMeshes[s];
+            const uint32_t* sourceIndices = instance.indices + source.indexStart;
+            uint32_t* indices = batch.indices.get() + indexStart;
+            uint32_t base = vertexStart + source.baseVertex;
+            for (unsigned int index = 0; index < source.numIndices; index += 3)
+            {
+                indices[index]     = base + sourceIndices[index];
+                indices[index + 1] = base + sourceIndices[mirrored ? index + 2 : index + 1];
+                indices[index + 2] = base + sourceIndices[mirrored ? index + 1 : index + 2];
+            }
+            indexStart += source.numIndices;
+            subMesh.numIndices        += source.numIndices;
+            subMesh.transformedBefore += source.transformedBefore;
+            subMesh.transformedAfter  += source.transformedAfter;
+        }
+        subMesh.numVertices += instance.numVertices;
+        vertexStart += instance.numVertices;
+    }
+
+
+    //-----------------------------------
+
+    // Each sub-mesh is its own only level of detail, and gets clusters for culling (see MeshClusters.h)
+    for (CookedSubMesh& subMesh : batch.subMeshes)
+    {
+        for (unsigned int lod = 0; lod < MESH_MAX_LODS; ++lod)  subMesh.lods[lod] = { subMesh.indexStart, subMesh.numIndices, 0.0f };
+        subMesh.clusterStart = static_cast<uint32_t>(batch.clusters.size());
+        BuildMeshClusters(batch.indices.get() + subMesh.indexStart, subMesh.numIndices, batch.vertices.get(), vertexSize,
+                          position->offset, batch.numVertices, subMesh.indexStart, batch.clusters);
+        subMesh.numClusters = static_cast<uint32_t>(batch.clusters.size()) - subMesh.clusterStart;
+    }
+
+    return batch;
+}
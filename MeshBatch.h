@@ -0,0 +1,56 @@
+//--------------------------------------------------------------------------------------
+// Static batches - meshes that never move merged into one set of world space vertices
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+//
+// Every model drawn costs a constant buffer update for its world matrix and a draw call for each part of
+// its mesh, even if it never moves. Models that never move can instead have their meshes' vertices
+// transformed into world space once, when the scene is built, and merged into a single mesh. The merged
+// mesh is drawn with an identity world matrix, so one constant buffer update covers all of it.
+//
+// The merged mesh has one sub-mesh per material - whatever the caller needs to change between draws, such
+// as the pixel shader and textures. Its index values are absolute (every sub-mesh has a base vertex of 0)
+// and the sub-meshes follow each other in the index data, so a pass that doesn't change anything between
+// materials, like a depth-only pass, can draw the whole mesh with one call (see Mesh::Render).
+//
+// Only full detail indices are merged, so the merged mesh has no simpler levels of detail. It is given
+// its own culling clusters (see MeshClusters.h). Nothing here uses DirectX or Windows.
+
+#ifndef _MESH_BATCH_H_INCLUDED_
+#define _MESH_BATCH_H_INCLUDED_
+
+#include "MeshData.h"
+#include "CMatrix4x4.h"
+
+
+// One mesh placed in the world to be merged into a batch. The vertex layout, sub-meshes and 32-bit indices
+// are as in a cooked file (see CookedMesh.h). Positions must be 3 floats, normals 3 floats and tangents
+// 4 floats (the w component is the handedness), other elements are copied unchanged
+struct BatchInstance
+{
+    const CookedVertexElement* elements     = nullptr;
+    unsigned int               numElements  = 0;
+    unsigned int               vertexSize   = 0;
+    const void*                vertices     = nullptr;
+    unsigned int               numVertices  = 0;
+    const CookedSubMesh*       subMeshes    = nullptr;
+    unsigned int               numSubMeshes = 0;
+    const uint32_t*            indices      = nullptr;
+
+    CMatrix4x4                 worldMatrix  = MatrixIdentity();
+    unsigned int               material     = 0; // Instances with the same material are drawn together
+};
+
+
+// Merge the given instances into one mesh in world space. Positions are transformed by each instance's
+// world matrix, normals by its inverse transpose and tangents by its rotation and scaling, normals and
+// tangents are renormalised. Triangles of instances whose matrix mirrors them are turned round.
+// The result has one sub-mesh for each material used, in increasing order of material. Its vertices have
+// the elements of the first instance that all the instances have (same semantic and format), so meshes
+// loaded with extra elements such as tangents can be batched with those without. Will throw a
+// std::runtime_error exception if the position, normal or tangent elements have an unsupported format or
+// the instances don't all have positions
+MeshData BuildStaticBatch(const BatchInstance* instances, unsigned int numInstances);
+
+
+#endif //_MESH_BATCH_H_INCLUDED_
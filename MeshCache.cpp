@@ -0,0 +1,104 @@
+//--------------------------------------------------------------------------------------
+// Cache of loaded meshes, so each mesh file is only imported and uploaded to the GPU once
+//--------------------------------------------------------------------------------------
+
+#include "MeshCache.h"
+#include "Mesh.h"
+#include "StartupLoader.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+
+
+// Key for a file name and vertex layout - lower case with forward slashes, then the layout
+std::string MeshCache::Key(const std::string& fileName, bool compressVertices)
+{
+    std::string key = fileName;
+    for (char& c : key)
+    {
+        c = (c == '\\') ? '/' : static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return key + (compressVertices ? "|compressed" : "|full");
+}
+
+
+// Request a mesh to be loaded by a StartupLoader
+void MeshCache::Request(const std::string& fileName, bool requireTangents, std::shared_ptr<Mesh>* mesh,
+                        bool keepPreparedData /*= false*/)
+{
+    ++mNumRequests;
+    std::string key = Key(fileName, mCompressVertices);
+
+    // Use a loaded mesh if it has everything needed
+    auto entry = mMeshes.find(key);
+    if (entry != mMeshes.end() && (entry->second.hasTangents || !requireTangents) &&
+                                  (entry->second.hasPreparedData || !keepPreparedData))
+    {
+        *mesh = entry->second.mesh.lock();
+        if (*mesh)  return;
+    }
+
+    // Otherwise combine with any other request for the same file
+    auto pending = std::find_if(mPending.begin(), mPending.end(), [&](const PendingMesh& p) { return p.key == key; });
+    if (pending == mPending.end())
+    {
+        mPending.push_back({ key, fileName, requireTangents, mCompressVertices, keepPreparedData, {} });
+        pending = mPending.end() - 1;
+    }
+    pending->requireTangents  = pending->requireTangents  || requireTangents;
+    pending->keepPreparedData = pending->keepPreparedData || keepPreparedData;
+    pending->handles.push_back(mesh);
+}
+
+
+// Add one mesh for each file requested since the last call to the given loader
+void MeshCache::AddToLoader(StartupLoader& loader)
+{
+    for (const PendingMesh& pending : mPending)
+    {
+        ++mNumLoads;
+        loader.AddMesh(pending.fileName, pending.requireTangents, pending.compressVertices, [this, pending](std::shared_ptr<Mesh> mesh)
+        {
+            mMeshes[pending.key] = { mesh, pending.requireTangents, pending.keepPreparedData };
+            for (std::shared_ptr<Mesh>* handle : pending.handles)  *handle = mesh;
+        }, pending.keepPreparedData);
+    }
+    mPending.clear();
+}
+
+
+// Return a mesh straight away, loading it if there is no suitable mesh loaded already
+std::shared_ptr<Mesh> MeshCache::Get(const std::string& fileName, bool requireTangents /*= false*/)
+{
+    ++mNumRequests;
+    std::string key = Key(fileName, mCompressVertices);
+
+    auto entry = mMeshes.find(key);
+    if (entry != mMeshes.end() && (entry->second.hasTangents || !requireTangents))
+    {
+        std::shared_ptr<Mesh> mesh = entry->second.mesh.lock();
+        if (mesh)  return mesh;
+    }
+
+    ++mNumLoads;
+    auto mesh = std::make_shared<Mesh>(fileName, requireTangents, mCompressVertices);
+    mMeshes[key] = { mesh, requireTangents, false };
+    return mesh;
+}
+
+
+// Send the number of requests made and the number of meshes actually loaded to the debugger output
+void MeshCache::ReportUse() const
+{
+    int numResident = 0;
+    for (auto& entry : mMeshes)
+    {
+        if (!entry.second.mesh.expired())  ++numResident;
+    }
+
+    char message[256];
+    std::snprintf(message, sizeof(message), "Mesh cache: %d requests, %d meshes loaded, %d meshes resident\n",
+                  mNumRequests, mNumLoads, numResident);
+    OutputDebugStringA(message);
+}
@@ -0,0 +1,97 @@
+//--------------------------------------------------------------------------------------
+// Cache of loaded meshes, so each mesh file is only imported and uploaded to the GPU once
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+//
+// Meshes are returned as shared_ptr handles. The cache only keeps weak references, so a mesh is
+// released when the last handle to it is released, and would be loaded again if requested later.
+//
+// Requests for the same file share one mesh even if they ask for different vertex layouts. The mesh
+// gets the superset of the layouts asked for, e.g. a mesh requested both with and without tangents is
+// loaded once with tangents. Shaders that don't use tangents ignore them.
+//
+// A request can ask for the mesh to keep its full precision data on the CPU (see Mesh::PreparedData), e.g.
+// to merge it into a static batch. The mesh shared with other requests for the file keeps it too.
+//
+// Meshes can be loaded with the compressed vertex layout (see MeshCompression.h), which is a setting
+// for the whole cache rather than each request, since the vertex shaders handle either layout. Meshes are
+// keyed by file and layout, so a file requested with and without compression is two meshes.
+//
+// Not thread-safe, use from the thread that creates DirectX objects (the StartupLoader create steps
+// run on that thread so are fine).
+
+#ifndef _MESH_CACHE_H_INCLUDED_
+#define _MESH_CACHE_H_INCLUDED_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+
+class Mesh;
+class StartupLoader;
+
+
+class MeshCache
+{
+public:
+    // Request a mesh to be loaded by a StartupLoader. The handle is filled in straight away if a
+    // suitable mesh is already loaded, otherwise when the loader runs. Make all the requests, then call
+    // AddToLoader before running the loader. Requests for the same file are combined into one mesh.
+    // Set keepPreparedData if the mesh's full precision data is needed on the CPU (see Mesh::PreparedData)
+    void Request(const std::string& fileName, bool requireTangents, std::shared_ptr<Mesh>* mesh, bool keepPreparedData = false);
+
+    // Add one mesh for each file requested since the last call to the given loader
+    void AddToLoader(StartupLoader& loader);
+
+
+    // Return a mesh straight away, loading it if there is no suitable mesh loaded already.
+    // Will throw a std::runtime_error exception on failure (see Mesh constructor).
+    // If the file is loaded without tangents and tangents are requested, it is loaded again with
+    // tangents. The old mesh stays in use by existing handles until they are released
+    std::shared_ptr<Mesh> Get(const std::string& fileName, bool requireTangents = false);
+
+
+    // Load meshes with the compressed vertex layout (see MeshCompression.h). Affects meshes loaded after
+    // the call, existing meshes are unchanged. Off by default
+    void SetCompressVertices(bool compressVertices)  { mCompressVertices = compressVertices; }
+
+
+    // Send the number of requests made and the number of meshes actually loaded to the debugger output
+    void ReportUse() const;
+
+
+private:
+    // Key for a file name and vertex layout - the name in lower case with forward slashes, since Windows file
+    // names aren't case sensitive, and whether the layout is compressed. Tangents aren't part of the key as
+    // meshes with them can be shared with requests without them (see Entry)
+    static std::string Key(const std::string& fileName, bool compressVertices);
+
+    struct Entry
+    {
+        std::weak_ptr<Mesh> mesh;
+        bool                hasTangents;
+        bool                hasPreparedData;
+    };
+    std::map<std::string, Entry> mMeshes; // Keyed by Key(fileName, compressed)
+
+    // Requests waiting for AddToLoader, in the order first requested
+    struct PendingMesh
+    {
+        std::string                         key;
+        std::string                         fileName;
+        bool                                requireTangents; // True if any of the requests needs tangents
+        bool                                compressVertices;
+        bool                                keepPreparedData; // True if any of the requests needs the full precision data
+        std::vector<std::shared_ptr<Mesh>*> handles;
+    };
+    std::vector<PendingMesh> mPending;
+
+    bool mCompressVertices = false;
+
+    int mNumRequests = 0;
+    int mNumLoads    = 0;
+};
+
+
+#endif //_MESH_CACHE_H_INCLUDED_
@@ -0,0 +1,136 @@
+//--------------------------------------------------------------------------------------
+// Mesh clusters - small groups of triangles that can be culled separately
+//--------------------------------------------------------------------------------------
+
+#include "MeshClusters.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+// Calculate the bounding sphere and normal cone of the triangles from firstIndex to endIndex
+static void ClusterBounds(CookedCluster& cluster, const uint32_t* indices, unsigned int firstIndex, unsigned int endIndex,
+                          const void* vertices, unsigned int vertexSize, unsigned int positionOffset)
+{
+    auto position = [&](uint32_t vertex)
+    {
+        return reinterpret_cast<const float*>(static_cast<const unsigned char*>(vertices) + vertex * vertexSize + positionOffset);
+    };
+
+    // Sphere around the centre of the bounding box
+    float boundsMin[3], boundsMax[3];
+    for (int axis = 0; axis < 3; ++axis)  boundsMin[axis] = boundsMax[axis] = position(indices[firstIndex])[axis];
+    for (unsigned int i = firstIndex; i < endIndex; ++i)
+    {
+        const float* p = position(indices[i]);
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            boundsMin[axis] = std::min(boundsMin[axis], p[axis]);
+            boundsMax[axis] = std::max(boundsMax[axis], p[axis]);
+        }
+    }
+    for (int axis = 0; axis < 3; ++axis)  cluster.centre[axis] = (boundsMin[axis] + boundsMax[axis]) * 0.5f;
+    float radiusSquared = 0;
+    for (unsigned int i = firstIndex; i < endIndex; ++i)
+    {
+        const float* p = position(indices[i]);
+        float d[3] = { p[0] - cluster.centre[0], p[1] - cluster.centre[1], p[2] - cluster.centre[2] };
+        radiusSquared = std::max(radiusSquared, d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+    }
+    cluster.radius = std::sqrt(radiusSquared);
+
+    // Unit normal of each triangle. Triangles are clockwise from the front, which in left-handed
+    // coordinates means the cross product faces outward
+    std::vector<float> normals;
+    normals.reserve(endIndex - firstIndex);
+    float normalSum[3] = { 0, 0, 0 };
+    for (unsigned int i = firstIndex; i < endIndex; i += 3)
+    {
+        const float* p0 = position(indices[i]);
+        const float* p1 = position(indices[i + 1]);
+        const float* p2 = position(indices[i + 2]);
+        float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+        float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+        float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+        float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length == 0)  continue; // Degenerate triangles are never drawn so don't affect the cone
+
+        for (int a = 0; a < 3; ++a)
+        {
+            normals.push_back(n[a] / length);
+            normalSum[a] += n[a] / length;
+        }
+    }
+
+    // Cone axis is the average normal. The cone can't be used if the normals spread over 90 degrees or
+    // more, or cancel each other out
+    cluster.coneAxis[0] = cluster.coneAxis[1] = cluster.coneAxis[2] = 0;
+    cluster.coneCutoff = 1;
+    float sumLength = std::sqrt(normalSum[0] * normalSum[0] + normalSum[1] * normalSum[1] + normalSum[2] * normalSum[2]);
+    if (normals.empty() || sumLength < 1e-6f)  return;
+
+    for (int a = 0; a < 3; ++a)  cluster.coneAxis[a] = normalSum[a] / sumLength;
+    float minCos = 1;
+    for (size_t n = 0; n < normals.size(); n += 3)
+    {
+        minCos = std::min(minCos, normals[n] * cluster.coneAxis[0] + normals[n + 1] * cluster.coneAxis[1] + normals[n + 2] * cluster.coneAxis[2]);
+    }
+    if (minCos <= 0)  return;
+
+    // sin(a) from cos(a), rounded up slightly so float error never culls a visible triangle
+    cluster.coneCutoff = std::min(std::sqrt(1 - minCos * minCos) + 1e-3f, 1.0f);
+}
+
+
+// Split a triangle list into clusters, see header
+void BuildMeshClusters(const uint32_t* indices, unsigned int numIndices, const void* vertices, unsigned int vertexSize,
+                       unsigned int positionOffset, unsigned int numVertices, unsigned int indexStart,
+                       std::vector<CookedCluster>& clusters)
+{
+    // Each vertex holds the number of the cluster that last used it, so the vertices in the current
+    // cluster can be counted without clearing anything between clusters
+    std::vector<unsigned int> vertexCluster(numVertices, 0);
+    unsigned int clusterNumber = 1;
+
+    unsigned int clusterStart = 0, clusterVertices = 0;
+    for (unsigned int i = 0; i < numIndices; i += 3)
+    {
+        unsigned int newVertices = 0;
+        for (int corner = 0; corner < 3; ++corner)
+        {
+            if (vertexCluster[indices[i + corner]] != clusterNumber)  ++newVertices;
+        }
+
+        // End the current cluster if this triangle doesn't fit
+        if (i > clusterStart && (clusterVertices + newVertices > CLUSTER_MAX_VERTICES || (i - clusterStart) / 3 == CLUSTER_MAX_TRIANGLES))
+        {
+            CookedCluster cluster = {};
+            cluster.indexStart = indexStart + clusterStart;
+            cluster.numIndices = i - clusterStart;
+            ClusterBounds(cluster, indices, clusterStart, i, vertices, vertexSize, positionOffset);
+            clusters.push_back(cluster);
+
+            ++clusterNumber;
+            clusterStart = i;
+            clusterVertices = 0;
+        }
+
+        for (int corner = 0; corner < 3; ++corner)
+        {
+            if (vertexCluster[indices[i + corner]] != clusterNumber)
+            {
+                vertexCluster[indices[i + corner]] = clusterNumber;
+                ++clusterVertices;
+            }
+        }
+    }
+
+    if (numIndices > clusterStart)
+    {
+        CookedCluster cluster = {};
+        cluster.indexStart = indexStart + clusterStart;
+        cluster.numIndices = numIndices - clusterStart;
+        ClusterBounds(cluster, indices, clusterStart, numIndices, vertices, vertexSize, positionOffset);
+        clusters.push_back(cluster);
+    }
+}
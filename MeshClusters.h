@@ -0,0 +1,52 @@
+//--------------------------------------------------------------------------------------
+// Mesh clusters - small groups of triangles that can be culled separately
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+//
+// Culling whole models means a large mesh is drawn completely even if most of it is off-screen or
+// facing away. So the import splits each sub-mesh's full detail triangles into clusters of up to
+// CLUSTER_MAX_VERTICES vertices and CLUSTER_MAX_TRIANGLES triangles (the usual "meshlet" sizes), each
+// with bounds that are tested before drawing (see Mesh::RenderClusters):
+//     Bounding sphere - the cluster is skipped if the sphere is outside the view frustum
+//     Normal cone     - an axis and the spread of the triangle normals around it. The cluster is
+//                       skipped if every triangle in it faces away from the viewpoint
+//
+// Clusters are consecutive runs of the triangle order chosen by MeshOptimise.h, so building them
+// doesn't reorder anything and each one is a single range of the index buffer. Clusters that
+// survive culling next to each other are drawn together. Nothing here uses DirectX or Windows.
+
+#ifndef _MESH_CLUSTERS_H_INCLUDED_
+#define _MESH_CLUSTERS_H_INCLUDED_
+
+#include "CookedMesh.h"
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+
+
+// Most vertices and triangles in one cluster
+const unsigned int CLUSTER_MAX_VERTICES  = 64;
+const unsigned int CLUSTER_MAX_TRIANGLES = 124;
+
+// Split a triangle list (index values less than numVertices, positions are 3 floats at the given offset
+// in each vertex) into clusters, adding them to the given vector. indexStart is the position of the
+// triangle list in the mesh's index data, which is added to the clusters' index starts
+void BuildMeshClusters(const uint32_t* indices, unsigned int numIndices, const void* vertices, unsigned int vertexSize,
+                       unsigned int positionOffset, unsigned int numVertices, unsigned int indexStart,
+                       std::vector<CookedCluster>& clusters);
+
+// Whether every triangle of a cluster faces away from the given viewpoint, which must be in the same
+// space as the cluster (usually model space). The triangle normals are within an angle a of the cone
+// axis and coneCutoff is sin(a), so every triangle faces away if the direction from the viewpoint to
+// any point of the bounding sphere is within 90 - a degrees of the axis
+inline bool IsClusterBackFacing(const CookedCluster& cluster, const float viewpoint[3])
+{
+    float toCentre[3] = { cluster.centre[0] - viewpoint[0], cluster.centre[1] - viewpoint[1], cluster.centre[2] - viewpoint[2] };
+    float distance = std::sqrt(toCentre[0] * toCentre[0] + toCentre[1] * toCentre[1] + toCentre[2] * toCentre[2]);
+    float dot = toCentre[0] * cluster.coneAxis[0] + toCentre[1] * cluster.coneAxis[1] + toCentre[2] * cluster.coneAxis[2];
+    return cluster.coneCutoff < 1 && dot >= cluster.coneCutoff * distance + cluster.radius;
+}
+
+
+#endif //_MESH_CLUSTERS_H_INCLUDED_
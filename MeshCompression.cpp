@@ -0,0 +1,308 @@
+//--------------------------------------------------------------------------------------
+// Compressed vertex layout for meshes
+//--------------------------------------------------------------------------------------
+
+#include "MeshCompression.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+
+//--------------------------------------------------------------------------------------
+// Encoding helpers
+//--------------------------------------------------------------------------------------
+
+// Convert a float to a half float, rounding to nearest even
+uint16_t FloatToHalf(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    uint16_t sign    = static_cast<uint16_t>((bits >> 16) & 0x8000);
+    uint32_t absBits = bits & 0x7fffffff;
+
+    if (absBits >  0x7f800000)  return sign | 0x7e00; // NaN
+    if (absBits >= 0x477ff000)  return sign | 0x7c00; // Infinity, or too large for a half (rounds to infinity)
+
+    if (absBits < 0x38800000)
+    {
+        // Too small for a normalised half - use a denormal (or zero)
+        if (absBits < 0x33000000)  return sign;
+        uint32_t exponent  = absBits >> 23;
+        uint32_t mantissa  = (absBits & 0x7fffff) | 0x800000;
+        uint32_t shift     = 126 - exponent;
+        uint32_t half      = mantissa >> shift;
+        uint32_t remainder = mantissa & ((1u << shift) - 1);
+        uint32_t halfway   = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (half & 1)))  ++half;
+        return sign | static_cast<uint16_t>(half);
+    }
+
+    // Rebias the exponent and drop 13 bits of mantissa. Rounding up may carry into the exponent, which is correct
+    uint32_t half      = (absBits - 0x38000000) >> 13;
+    uint32_t remainder = absBits & 0x1fff;
+    if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))  ++half;
+    return sign | static_cast<uint16_t>(half);
+}
+
+float HalfToFloat(uint16_t half)
+{
+    uint32_t sign     = static_cast<uint32_t>(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1f;
+    uint32_t mantissa = half & 0x3ff;
+
+    if (exponent == 0)
+    {
+        float value = std::ldexp(static_cast<float>(mantissa), -24);
+        return sign ? -value : value;
+    }
+
+    uint32_t bits = sign | ((exponent == 31) ? 0x7f800000 : ((exponent + 112) << 23)) | (mantissa << 13);
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+
+static int16_t ToSnorm16(float value)
+{
+    value = std::min(std::max(value, -1.0f), 1.0f);
+    return static_cast<int16_t>(std::lround(value * 32767.0f));
+}
+
+static float FromSnorm16(int16_t value)
+{
+    return std::max(value / 32767.0f, -1.0f); // Same as the GPU conversion
+}
+
+static float SignNotZero(float value)
+{
+    return (value >= 0) ? 1.0f : -1.0f;
+}
+
+
+// Project the unit vector onto the octahedron |x|+|y|+|z| = 1, then fold the lower half (z < 0) over
+// the upper half to give a point in the square [-1,1] x [-1,1]
+void OctahedralEncode(const float vector[3], int16_t encoded[2])
+{
+    float length = std::abs(vector[0]) + std::abs(vector[1]) + std::abs(vector[2]);
+    if (length == 0)
+    {
+        encoded[0] = encoded[1] = 0;
+        return;
+    }
+
+    float x = vector[0] / length;
+    float y = vector[1] / length;
+    if (vector[2] < 0)
+    {
+        float foldedX = (1 - std::abs(y)) * SignNotZero(x);
+        float foldedY = (1 - std::abs(x)) * SignNotZero(y);
+        x = foldedX;
+        y = foldedY;
+    }
+    encoded[0] = ToSnorm16(x);
+    encoded[1] = ToSnorm16(y);
+}
+
+// Same as OctahedralDecode in Common.hlsli
+void OctahedralDecode(const int16_t encoded[2], float vector[3])
+{
+    float x = FromSnorm16(encoded[0]);
+    float y = FromSnorm16(encoded[1]);
+    float z = 1 - std::abs(x) - std::abs(y);
+    float t = std::max(-z, 0.0f);
+    x += (x >= 0) ? -t : t;
+    y += (y >= 0) ? -t : t;
+
+    float length = std::sqrt(x * x + y * y + z * z);
+    vector[0] = x / length;
+    vector[1] = y / length;
+    vector[2] = z / length;
+}
+
+
+// Angle in degrees between a unit vector and a vector that is approximately unit length
+static float AngleDegrees(const float a[3], const float b[3])
+{
+    float lengthA = std::sqrt(a[0] * a[0] + a[1] * a[1] + a[2] * a[2]);
+    if (lengthA == 0)  return 0;
+    float cosAngle = (a[0] * b[0] + a[1] * b[1] + a[2] * b[2]) / lengthA;
+    return std::acos(std::min(std::max(cosAngle, -1.0f), 1.0f)) * (180.0f / 3.14159265f);
+}
+
+
+//--------------------------------------------------------------------------------------
+// Compression
+//--------------------------------------------------------------------------------------
+
+// Convert full precision vertex and index data into the compressed layout, see header
+CompressedMeshData CompressMesh(const CookedVertexElement* elements, unsigned int numElements, unsigned int vertexSize,
+                                const void* vertices, unsigned int numVertices, const uint32_t* indices, unsigned int numIndices)
+{
+    auto start = std::chrono::steady_clock::now();
+    CompressedMeshData mesh;
+    mesh.numVertices = numVertices;
+    mesh.numIndices  = numIndices;
+    mesh.stats.vertexBytesBefore = numVertices * vertexSize;
+    mesh.stats.indexBytesBefore  = numIndices * sizeof(uint32_t);
+
+
+    //-----------------------------------
+
+    // Find the elements to compress and build the compressed layout, keeping the same order
+    const CookedVertexElement* position = nullptr;
+    const CookedVertexElement* normal   = nullptr;
+    const CookedVertexElement* tangent  = nullptr;
+    const CookedVertexElement* uv       = nullptr;
+    unsigned int positionOffset = 0, normalOffset = 0, tangentOffset = 0, uvOffset = 0;
+    unsigned int offset = 0;
+    for (unsigned int i = 0; i < numElements; ++i)
+    {
+        CookedVertexElement element = elements[i];
+        std::string semanticName(element.semanticName, strnlen(element.semanticName, sizeof(element.semanticName)));
+        if (semanticName == "Position" && element.format == MESH_FORMAT_R32G32B32_FLOAT && !position)
+        {
+            position = &elements[i];
+            positionOffset = offset;
+            element.format = MESH_FORMAT_R16G16B16A16_UNORM;
+            element.offset = offset;
+            offset += 8;
+        }
+        else if (semanticName == "Normal" && element.format == MESH_FORMAT_R32G32B32_FLOAT && !normal)
+        {
+            normal = &elements[i];
+            normalOffset = offset;
+            element.format = MESH_FORMAT_R16G16_SNORM;
+            element.offset = offset;
+            offset += 4;
+        }
+        else if (semanticName == "Tangent" && element.format == MESH_FORMAT_R32G32B32A32_FLOAT && !tangent)
+        {
+            tangent = &elements[i];
+            tangentOffset = offset;
+            element.format = MESH_FORMAT_R16G16B16A16_SNORM;
+            element.offset = offset;
+            offset += 8;
+        }
+        else if (semanticName == "UV" && element.format == MESH_FORMAT_R32G32_FLOAT && !uv)
+        {
+            uv = &elements[i];
+            uvOffset = offset;
+            element.format = MESH_FORMAT_R16G16_FLOAT;
+            element.offset = offset;
+            offset += 4;
+        }
+        else
+        {
+            throw std::runtime_error("Cannot compress vertex element " + semanticName);
+        }
+        mesh.vertexElements.push_back(element);
+    }
+    if (!position)  throw std::runtime_error("Cannot compress a mesh without positions");
+    mesh.vertexSize = offset;
+
+    const unsigned char* source = static_cast<const unsigned char*>(vertices);
+    auto sourceFloats = [&](unsigned int vertex, const CookedVertexElement* element)
+    {
+        return reinterpret_cast<const float*>(source + vertex * vertexSize + element->offset);
+    };
+
+
+    //-----------------------------------
+
+    // Positions are quantised across the bounding box of the whole mesh
+    float boundsMin[3] = {}, boundsMax[3] = {};
+    for (unsigned int vertex = 0; vertex < numVertices; ++vertex)
+    {
+        const float* p = sourceFloats(vertex, position);
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            if (vertex == 0 || p[axis] < boundsMin[axis])  boundsMin[axis] = p[axis];
+            if (vertex == 0 || p[axis] > boundsMax[axis])  boundsMax[axis] = p[axis];
+        }
+    }
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        mesh.positionOffset[axis] = boundsMin[axis];
+        mesh.positionScale[axis]  = boundsMax[axis] - boundsMin[axis];
+    }
+
+
+    //-----------------------------------
+
+    // Write the compressed vertices, decoding each value again to measure the error
+    mesh.vertices.reset(new unsigned char[numVertices * mesh.vertexSize]);
+    MeshCompressionStats& stats = mesh.stats;
+    for (unsigned int vertex = 0; vertex < numVertices; ++vertex)
+    {
+        unsigned char* compressed = mesh.vertices.get() + vertex * mesh.vertexSize;
+
+        const float* p = sourceFloats(vertex, position);
+        uint16_t quantised[4] = {};
+        float positionError = 0;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            float scale = mesh.positionScale[axis];
+            float unorm = (scale > 0) ? (p[axis] - mesh.positionOffset[axis]) / scale : 0;
+            quantised[axis] = static_cast<uint16_t>(std::lround(std::min(std::max(unorm, 0.0f), 1.0f) * 65535.0f));
+            float decoded = mesh.positionOffset[axis] + (quantised[axis] / 65535.0f) * scale;
+            positionError += (decoded - p[axis]) * (decoded - p[axis]);
+        }
+        std::memcpy(compressed + positionOffset, quantised, sizeof(quantised));
+        stats.maxPositionError = std::max(stats.maxPositionError, std::sqrt(positionError));
+
+        float decoded[3];
+        if (normal)
+        {
+            int16_t encoded[2];
+            OctahedralEncode(sourceFloats(vertex, normal), encoded);
+            std::memcpy(compressed + normalOffset, encoded, sizeof(encoded));
+            OctahedralDecode(encoded, decoded);
+            stats.maxNormalError = std::max(stats.maxNormalError, AngleDegrees(sourceFloats(vertex, normal), decoded));
+        }
+        if (tangent)
+        {
+            int16_t encoded[4] = {};
+            OctahedralEncode(sourceFloats(vertex, tangent), encoded);
+            encoded[3] = (sourceFloats(vertex, tangent)[3] < 0) ? -32767 : 32767; // Bitangent sign, exactly -1 or 1 as snorm
+            std::memcpy(compressed + tangentOffset, encoded, sizeof(encoded));
+            OctahedralDecode(encoded, decoded);
+            stats.maxTangentError = std::max(stats.maxTangentError, AngleDegrees(sourceFloats(vertex, tangent), decoded));
+        }
+        if (uv)
+        {
+            const float* sourceUV = sourceFloats(vertex, uv);
+            uint16_t halfUV[2] = { FloatToHalf(sourceUV[0]), FloatToHalf(sourceUV[1]) };
+            std::memcpy(compressed + uvOffset, halfUV, sizeof(halfUV));
+            stats.maxUVError = std::max(stats.maxUVError, std::max(std::abs(HalfToFloat(halfUV[0]) - sourceUV[0]),
+                                                                   std::abs(HalfToFloat(halfUV[1]) - sourceUV[1])));
+        }
+    }
+
+
+    //-----------------------------------
+
+    // Use 16-bit indices if every index value fits
+    uint32_t maxIndex = 0;
+    for (unsigned int i = 0; i < numIndices; ++i)  maxIndex = std::max(maxIndex, indices[i]);
+    mesh.indexSize = (maxIndex <= 0xffff) ? 2 : 4;
+    mesh.indices.reset(new unsigned char[numIndices * mesh.indexSize]);
+    if (mesh.indexSize == 2)
+    {
+        uint16_t* index16 = reinterpret_cast<uint16_t*>(mesh.indices.get());
+        for (unsigned int i = 0; i < numIndices; ++i)  index16[i] = static_cast<uint16_t>(indices[i]);
+    }
+    else
+    {
+        std::memcpy(mesh.indices.get(), indices, numIndices * sizeof(uint32_t));
+    }
+
+    stats.vertexBytesAfter = numVertices * mesh.vertexSize;
+    stats.indexBytesAfter  = numIndices * mesh.indexSize;
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return mesh;
+}
@@ -0,0 +1,92 @@
+//--------------------------------------------------------------------------------------
+// Compressed vertex layout for meshes
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+//
+// Converts the full precision vertex data from an import or cooked file (see MeshData.h) into a
+// smaller layout, to reduce the memory bandwidth used fetching vertices:
+//     Position - 16-bit unorm per axis, quantised across the bounding box of the whole mesh.
+//                The vertex shader maps it back with a per-model scale and offset
+//     Normal   - octahedral encoding in 2 x 16-bit snorm, decoded in the vertex shader
+//     Tangent  - as normal in the first two of 4 x 16-bit snorm, the 4th holds the bitangent sign
+//                (see MeshTangents.h)
+//     UV       - 2 x 16-bit half float, no decode needed
+// Indices are converted to 16 bits when every index value fits, which is the case whenever no
+// sub-mesh has more than 65536 vertices (index values are relative to each sub-mesh).
+// The vertex shaders use the DecodeVertex functions in Common.hlsli, which do nothing for meshes
+// that are not compressed. Nothing here uses DirectX or Windows.
+
+#ifndef _MESH_COMPRESSION_H_INCLUDED_
+#define _MESH_COMPRESSION_H_INCLUDED_
+
+#include "MeshData.h"
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+
+//--------------------------------------------------------------------------------------
+// Compressed mesh data
+//--------------------------------------------------------------------------------------
+
+// Sizes before and after compression and the largest error introduced, measured by decoding every
+// compressed vertex and comparing against the original
+struct MeshCompressionStats
+{
+    unsigned int vertexBytesBefore = 0;
+    unsigned int vertexBytesAfter  = 0;
+    unsigned int indexBytesBefore  = 0;
+    unsigned int indexBytesAfter   = 0;
+
+    float maxPositionError = 0; // Model space distance
+    float maxNormalError   = 0; // Degrees
+    float maxTangentError  = 0; // Degrees
+    float maxUVError       = 0; // Texture coordinate units
+
+    double seconds = 0;         // Time taken to compress
+
+    unsigned int BytesBefore() const  { return vertexBytesBefore + indexBytesBefore; }
+    unsigned int BytesAfter()  const  { return vertexBytesAfter  + indexBytesAfter;  }
+};
+
+struct CompressedMeshData
+{
+    std::vector<CookedVertexElement> vertexElements;
+    unsigned int                     vertexSize  = 0;
+    unsigned int                     numVertices = 0;
+    unsigned int                     numIndices  = 0;
+    unsigned int                     indexSize   = 0; // 2 or 4 bytes
+
+    // Decoded model space position = positionOffset + stored position * positionScale
+    float                            positionOffset[3] = {};
+    float                            positionScale[3]  = {};
+
+    std::unique_ptr<unsigned char[]> vertices;
+    std::unique_ptr<unsigned char[]> indices;
+
+    MeshCompressionStats             stats;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Compression
+//--------------------------------------------------------------------------------------
+
+// Convert full precision vertex and index data (layout as described by the vertex elements, 32-bit
+// floats only) into the compressed layout. Will throw a std::runtime_error exception if the layout
+// has an element that can't be compressed
+CompressedMeshData CompressMesh(const CookedVertexElement* elements, unsigned int numElements, unsigned int vertexSize,
+                                const void* vertices, unsigned int numVertices, const uint32_t* indices, unsigned int numIndices);
+
+
+// Encoding helpers, exposed so tools can check them
+uint16_t FloatToHalf(float value);
+float    HalfToFloat(uint16_t half);
+
+// Octahedral encoding of a unit vector into two snorm values, and back
+void OctahedralEncode(const float vector[3], int16_t encoded[2]);
+void OctahedralDecode(const int16_t encoded[2], float vector[3]);
+
+
+#endif //_MESH_COMPRESSION_H_INCLUDED_
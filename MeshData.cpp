@@ -0,0 +1,595 @@
+//--------------------------------------------------------------------------------------
+// Mesh import without a device - the geometry half of the Mesh class
+//--------------------------------------------------------------------------------------
+
+#include "MeshData.h"
+#include "MeshInterleave.h"
+#include "MeshTangents.h"
+#include "MeshSkinning.h"
+
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+
+//--------------------------------------------------------------------------------------
+// Import settings
+//--------------------------------------------------------------------------------------
+
+// Tangents are calculated by GenerateTangents (see MeshTangents.h), which is multi-threaded and follows
+// MikkTSpace. Set this to use assimp's single-threaded aiProcess_CalcTangentSpace instead
+const bool USE_ASSIMP_TANGENTS = false;
+
+// Flags for processing the mesh. Assimp provides a huge amount of control - right click any of these
+// and "Peek Definition" to see documention above each constant
+static unsigned int AssimpFlags(bool requireTangents, bool requireSkin)
+{
+    unsigned int assimpFlags = aiProcess_MakeLeftHanded |
+                               aiProcess_GenSmoothNormals |
+                               aiProcess_FixInfacingNormals |
+                               aiProcess_GenUVCoords |
+                               aiProcess_TransformUVCoords |
+                               aiProcess_FlipUVs |
+                               aiProcess_FlipWindingOrder |
+                               aiProcess_Triangulate |
+                               aiProcess_PreTransformVertices |
+                               aiProcess_JoinIdenticalVertices |
+                               aiProcess_ImproveCacheLocality |
+                               aiProcess_SortByPType |
+                               aiProcess_FindInvalidData |
+                               aiProcess_OptimizeMeshes |
+                               aiProcess_FindInstances |
+                               aiProcess_FindDegenerates |
+                               aiProcess_RemoveRedundantMaterials |
+                               aiProcess_Debone |
+                               aiProcess_RemoveComponent;
+
+    // Add tangents as required by user, if assimp is calculating them
+    if (requireTangents && USE_ASSIMP_TANGENTS)  assimpFlags |= aiProcess_CalcTangentSpace;
+
+    // Skinning needs the node hierarchy and every bone, and at most 4 bones per vertex
+    if (requireSkin)
+    {
+        assimpFlags &= ~(aiProcess_PreTransformVertices | aiProcess_Debone);
+        assimpFlags |= aiProcess_LimitBoneWeights;
+    }
+    return assimpFlags;
+}
+
+// Flags to specify what mesh data to ignore
+static int RemoveComponents(bool requireTangents, bool requireSkin)
+{
+    int removeComponents = aiComponent_LIGHTS | aiComponent_CAMERAS | aiComponent_TEXTURES | aiComponent_COLORS |
+                           aiComponent_BONEWEIGHTS | aiComponent_ANIMATIONS | aiComponent_MATERIALS;
+
+    // Remove tangents unless required by user and calculated by assimp
+    if (!requireTangents || !USE_ASSIMP_TANGENTS)  removeComponents |= aiComponent_TANGENTS_AND_BITANGENTS;
+
+    // Keep bone weights if skinning. The bind pose comes from the nodes, animations are not used
+    if (requireSkin)  removeComponents &= ~aiComponent_BONEWEIGHTS;
+    return removeComponents;
+}
+
+
+// A simpler level of detail must have at most this fraction of the indices of the level before it
+const float LOD_MIN_REDUCTION = 0.8f;
+
+
+//--------------------------------------------------------------------------------------
+// Skeleton
+//--------------------------------------------------------------------------------------
+
+// Assimp matrices transform column vectors and CMatrix4x4 row vectors, so cooked bones hold the transpose
+static void StoreBoneMatrix(const aiMatrix4x4& m, float out[16])
+{
+    aiMatrix4x4 transposed = m;
+    transposed.Transpose();
+    std::memcpy(out, &transposed.a1, sizeof(float) * 16);
+}
+
+// Builds the skeleton of a skinned import from the bones of every sub-mesh and the node hierarchy
+struct SkeletonBuilder
+{
+    std::map<std::string, const aiBone*> bonesByName; // First aiBone of each name, for its offset matrix
+    std::map<std::string, unsigned int>  boneIndices;
+    std::vector<CookedBone>              bones;
+
+    // Each sub-mesh's node transform into model space and the nearest bone at or above the node, -1 if none.
+    // A mesh used by several nodes (instancing) only gets the first
+    std::vector<aiMatrix4x4> meshTransforms;
+    std::vector<int>         meshParentBones;
+    std::vector<bool>        meshFound;
+
+    // Visit the nodes depth first so that bones are added after their parents. The parent of a bone is the
+    // bone of its nearest ancestor node, and the transforms of any nodes in between are folded into its bind
+    // pose transform. sinceBone is the transform from the space of the nearest bone above (or model space)
+    void Visit(const aiNode* node, const aiMatrix4x4& parentGlobal, const aiMatrix4x4& parentSinceBone, int parentBone)
+    {
+        aiMatrix4x4 global = parentGlobal * node->mTransformation;
+        aiMatrix4x4 sinceBone = parentSinceBone * node->mTransformation;
+        std::string name = node->mName.C_Str();
+        auto bone = bonesByName.find(name);
+        if (bone != bonesByName.end() && boneIndices.count(name) == 0)
+        {
+            if (bones.size() >= SKIN_MAX_BONES)  throw std::runtime_error("More than " + std::to_string(SKIN_MAX_BONES) + " bones");
+            CookedBone cooked = {};
+            std::strncpy(cooked.name, name.c_str(), sizeof(cooked.name) - 1);
+            cooked.parent = parentBone;
+            StoreBoneMatrix(sinceBone, cooked.bindLocal);
+            StoreBoneMatrix(bone->second->mOffsetMatrix, cooked.offset);
+            parentBone = static_cast<int>(bones.size());
+            boneIndices[name] = parentBone;
+            bones.push_back(cooked);
+            sinceBone = aiMatrix4x4();
+        }
+
+        for (unsigned int i = 0; i < node->mNumMeshes; ++i)
+        {
+            unsigned int mesh = node->mMeshes[i];
+            if (mesh >= meshFound.size() || meshFound[mesh])  continue;
+            meshFound[mesh] = true;
+            meshTransforms[mesh] = global;
+            meshParentBones[mesh] = parentBone;
+        }
+        for (unsigned int i = 0; i < node->mNumChildren; ++i)  Visit(node->mChildren[i], global, sinceBone, parentBone);
+    }
+
+    void Build(const aiScene* scene)
+    {
+        for (unsigned int i = 0; i < scene->mNumMeshes; ++i)
+        {
+            const aiMesh* assimpMesh = scene->mMeshes[i];
+            for (unsigned int b = 0; b < assimpMesh->mNumBones; ++b)
+            {
+                bonesByName.insert({ assimpMesh->mBones[b]->mName.C_Str(), assimpMesh->mBones[b] });
+            }
+        }
+
+        meshTransforms.assign(scene->mNumMeshes, aiMatrix4x4());
+        meshParentBones.assign(scene->mNumMeshes, -1);
+        meshFound.assign(scene->mNumMeshes, false);
+        if (scene->mRootNode != nullptr)  Visit(scene->mRootNode, aiMatrix4x4(), aiMatrix4x4(), -1);
+        for (auto& bone : bonesByName)
+        {
+            if (boneIndices.count(bone.first) == 0)  throw std::runtime_error("No node for bone " + bone.first);
+        }
+    }
+};
+
+
+// Seconds passed since the given time point, then reset the time point to now
+static double LapSeconds(std::chrono::steady_clock::time_point& start)
+{
+    auto now = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(now - start).count();
+    start = now;
+    return seconds;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Importing
+//--------------------------------------------------------------------------------------
+
+// Return the hash identifying a cooked file for the given mesh file and import settings. Returns 0
+// if the file can't be read
+uint64_t MeshSourceHash(const std::string& fileName, bool requireTangents, bool requireSkin /*= false*/)
+{
+    MappedFile source(fileName);
+    if (!source.IsOpen())  return 0;
+
+    unsigned int assimpFlags = AssimpFlags(requireTangents, requireSkin);
+    int removeComponents = RemoveComponents(requireTangents, requireSkin);
+    uint64_t hash = HashFNV1a(source.Data(), source.Size());
+    hash = HashFNV1a(&assimpFlags,      sizeof(assimpFlags),      hash);
+    hash = HashFNV1a(&removeComponents, sizeof(removeComponents), hash);
+    hash = HashFNV1a(&requireTangents,  sizeof(requireTangents),  hash);
+    hash = HashFNV1a(&requireSkin,      sizeof(requireSkin),      hash);
+    return hash;
+}
+
+
+// Import the given mesh file. Will throw a std::runtime_error exception on failure
+MeshData ImportMeshData(const std::string& fileName, bool requireTangents, uint64_t sourceHash /*= 0*/, bool requireSkin /*= false*/)
+{
+    MeshData mesh;
+    auto stageStart = std::chrono::steady_clock::now();
+
+    mesh.sourceHash = (sourceHash != 0) ? sourceHash : MeshSourceHash(fileName, requireTangents, requireSkin);
+    mesh.stats.hashSeconds = LapSeconds(stageStart);
+
+
+    //-----------------------------------
+
+    // Other miscellaneous settings
+    Assimp::Importer importer;
+    importer.SetPropertyFloat(AI_CONFIG_PP_GSN_MAX_SMOOTHING_ANGLE, 80.0f); // Smoothing angle for normals
+    importer.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE, aiPrimitiveType_POINT | aiPrimitiveType_LINE);  // Remove points and lines (keep triangles only)
+    importer.SetPropertyBool(AI_CONFIG_PP_FD_REMOVE, true);                 // Remove degenerate triangles
+    importer.SetPropertyBool(AI_CONFIG_PP_DB_ALL_OR_NONE, true);            // Default to removing bones/weights from meshes that don't need skinning
+
+    importer.SetPropertyInteger(AI_CONFIG_PP_RVC_FLAGS, RemoveComponents(requireTangents, requireSkin));
+
+    // Import mesh with assimp given above requirements
+    const aiScene* scene = importer.ReadFile(fileName, AssimpFlags(requireTangents, requireSkin));
+    if (scene == nullptr)  throw std::runtime_error("Error loading mesh (" + fileName + "). " + importer.GetErrorString());
+    if (scene->mNumMeshes == 0)  throw std::runtime_error("No usable geometry in mesh: " + fileName);
+    mesh.stats.importSeconds = LapSeconds(stageStart);
+
+
+    //-----------------------------------
+
+    // Check for presence of position and normal data in every sub-mesh. Tangents and UVs are optional.
+    // All sub-meshes share one vertex layout, so UVs are included if any sub-mesh has them (zero for the others)
+    bool hasUVs = false;
+    for (unsigned int i = 0; i < scene->mNumMeshes; ++i)
+    {
+        aiMesh* assimpMesh = scene->mMeshes[i];
+        std::string subMeshName = assimpMesh->mName.C_Str();
+        if (!assimpMesh->HasPositions())  throw std::runtime_error("No position data for sub-mesh " + subMeshName + " in " + fileName);
+        if (!assimpMesh->HasNormals())  throw std::runtime_error("No normal data for sub-mesh " + subMeshName + " in " + fileName);
+        if (!assimpMesh->HasFaces())  throw std::runtime_error("No face data in " + subMeshName + " in " + fileName);
+        if (requireTangents && USE_ASSIMP_TANGENTS && !assimpMesh->HasTangentsAndBitangents())  throw std::runtime_error("No tangent data for sub-mesh " + subMeshName + " in " + fileName);
+        if (requireTangents && !(assimpMesh->GetNumUVChannels() > 0 && assimpMesh->HasTextureCoords(0)))  throw std::runtime_error("No texture coordinates to calculate tangents for sub-mesh " + subMeshName + " in " + fileName);
+        if (assimpMesh->GetNumUVChannels() > 0 && assimpMesh->HasTextureCoords(0))
+        {
+            if (assimpMesh->mNumUVComponents[0] != 2)  throw std::runtime_error("Unsupported texture coordinates in " + subMeshName + " in " + fileName);
+            hasUVs = true;
+        }
+    }
+
+    std::vector<CookedVertexElement>& vertexElements = mesh.vertexElements;
+    unsigned int offset = 0;
+    auto addElement = [&](const char* semanticName, uint32_t format, unsigned int elementOffset)
+    {
+        CookedVertexElement element = {};
+        std::strncpy(element.semanticName, semanticName, sizeof(element.semanticName) - 1);
+        element.format = format;
+        element.offset = elementOffset;
+        vertexElements.push_back(element);
+    };
+
+    unsigned int positionOffset = offset;
+    addElement("Position", MESH_FORMAT_R32G32B32_FLOAT, positionOffset);
+    offset += 12;
+
+    unsigned int normalOffset = offset;
+    addElement("Normal", MESH_FORMAT_R32G32B32_FLOAT, normalOffset);
+    offset += 12;
+
+    unsigned int tangentOffset = offset;
+    if (requireTangents)
+    {
+        addElement("Tangent", MESH_FORMAT_R32G32B32A32_FLOAT, tangentOffset); // 4th value is the bitangent sign, see MeshTangents.h
+        offset += 16;
+    }
+
+    unsigned int uvOffset = offset;
+    if (hasUVs)
+    {
+        addElement("UV", MESH_FORMAT_R32G32_FLOAT, uvOffset);
+        offset += 8;
+    }
+
+    // Blend elements go last so the skinned vertex is the rest of the vertex (see MeshSkinning.h)
+    unsigned int blendIndicesOffset = offset;
+    unsigned int blendWeightsOffset = offset + 4;
+    if (requireSkin)
+    {
+        addElement("BlendIndices", MESH_FORMAT_R8G8B8A8_UINT,  blendIndicesOffset);
+        addElement("BlendWeights", MESH_FORMAT_R8G8B8A8_UNORM, blendWeightsOffset);
+        offset += 8;
+    }
+
+    mesh.vertexSize = offset;
+    unsigned int vertexSize = mesh.vertexSize;
+
+
+    //-----------------------------------
+
+    // Lay out the sub-meshes one after another in the vertex and index data
+    mesh.subMeshes.resize(scene->mNumMeshes);
+    for (unsigned int i = 0; i < scene->mNumMeshes; ++i)
+    {
+        CookedSubMesh& subMesh = mesh.subMeshes[i];
+        subMesh = {};
+        subMesh.indexStart  = mesh.numIndices;
+        subMesh.numIndices  = scene->mMeshes[i]->mNumFaces * 3;
+        subMesh.baseVertex  = mesh.numVertices;
+        subMesh.numVertices = scene->mMeshes[i]->mNumVertices;
+        mesh.numIndices  += subMesh.numIndices;
+        mesh.numVertices += subMesh.numVertices;
+    }
+
+    // Create CPU-side buffers to hold current mesh data - exact content is flexible so can't use a structure for a vertex - so just a block of bytes
+    mesh.vertices.reset(new unsigned char[mesh.numVertices * vertexSize]);
+    mesh.indices.reset(new uint32_t[mesh.numIndices]); // Using 32 bit indexes (4 bytes) for each index
+
+
+    //-----------------------------------
+
+    // Interleave the vertex attributes from assimp's separate arrays into our CPU-side vertex buffer in a
+    // single pass (see MeshInterleave.h), and find the bounds of each sub-mesh. Ordinary stores are used
+    // because the optimise stage reads the vertices straight away
+    static const float noUV[2] = { 0, 0 };
+    SkeletonBuilder skeleton;
+    if (requireSkin)  skeleton.Build(scene);
+    for (unsigned int i = 0; i < scene->mNumMeshes; ++i)
+    {
+        aiMesh* assimpMesh = scene->mMeshes[i];
+        CookedSubMesh& subMesh = mesh.subMeshes[i];
+
+        VertexStream streams[4];
+        unsigned int numStreams = 0;
+        streams[numStreams++] = { assimpMesh->mVertices, sizeof(aiVector3D), 12, positionOffset };
+        streams[numStreams++] = { assimpMesh->mNormals,  sizeof(aiVector3D), 12, normalOffset };
+        if (requireTangents && USE_ASSIMP_TANGENTS)
+        {
+            streams[numStreams++] = { assimpMesh->mTangents, sizeof(aiVector3D), 12, tangentOffset };
+        }
+        if (hasUVs)
+        {
+            // Sub-meshes without UVs get zero UVs when other sub-meshes have them
+            bool subMeshHasUVs = assimpMesh->GetNumUVChannels() > 0 && assimpMesh->HasTextureCoords(0);
+            if (subMeshHasUVs)  streams[numStreams++] = { assimpMesh->mTextureCoords[0], sizeof(aiVector3D), 8, uvOffset };
+            else                streams[numStreams++] = { noUV, 0, 8, uvOffset };
+        }
+        InterleaveVertices(streams, numStreams, mesh.vertices.get() + subMesh.baseVertex * vertexSize, vertexSize, subMesh.numVertices);
+
+        // Assimp's tangents come with bitangents, keep just their sign relative to cross(normal, tangent)
+        if (requireTangents && USE_ASSIMP_TANGENTS)
+        {
+            for (unsigned int vertex = 0; vertex < subMesh.numVertices; ++vertex)
+            {
+                const aiVector3D& n = assimpMesh->mNormals[vertex];
+                const aiVector3D& t = assimpMesh->mTangents[vertex];
+                const aiVector3D& b = assimpMesh->mBitangents[vertex];
+                aiVector3D nCrossT(n.y * t.z - n.z * t.y, n.z * t.x - n.x * t.z, n.x * t.y - n.y * t.x);
+                float sign = (nCrossT.x * b.x + nCrossT.y * b.y + nCrossT.z * b.z < 0) ? -1.0f : 1.0f;
+                std::memcpy(mesh.vertices.get() + (subMesh.baseVertex + vertex) * vertexSize + tangentOffset + 12, &sign, sizeof(sign));
+            }
+        }
+
+        // Without pre-transformed vertices, sub-meshes without bones are moved into model space here.
+        // Sub-meshes with bones stay in mesh space, which their bones' offset matrices start from
+        unsigned char* subMeshVertices = mesh.vertices.get() + subMesh.baseVertex * vertexSize;
+        if (requireSkin && assimpMesh->mNumBones == 0)
+        {
+            const aiMatrix4x4& transform = skeleton.meshTransforms[i];
+            aiMatrix3x3 normalTransform = aiMatrix3x3(transform).Inverse().Transpose();
+            for (unsigned int vertex = 0; vertex < subMesh.numVertices; ++vertex)
+            {
+                float* position = reinterpret_cast<float*>(subMeshVertices + vertex * vertexSize + positionOffset);
+                float* normal   = reinterpret_cast<float*>(subMeshVertices + vertex * vertexSize + normalOffset);
+                aiVector3D p = transform * aiVector3D(position[0], position[1], position[2]);
+                aiVector3D n = (normalTransform * aiVector3D(normal[0], normal[1], normal[2])).NormalizeSafe();
+                position[0] = p.x;  position[1] = p.y;  position[2] = p.z;
+                normal[0]   = n.x;  normal[1]   = n.y;  normal[2]   = n.z;
+            }
+        }
+
+        const float* firstPosition = reinterpret_cast<const float*>(subMeshVertices + positionOffset);
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            subMesh.boundsMin[axis] = subMesh.boundsMax[axis] = firstPosition[axis];
+        }
+        for (unsigned int vertex = 0; vertex < subMesh.numVertices; ++vertex)
+        {
+            const float* position = reinterpret_cast<const float*>(subMeshVertices + vertex * vertexSize + positionOffset);
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                float value = position[axis];
+                if (value < subMesh.boundsMin[axis])  subMesh.boundsMin[axis] = value;
+                if (value > subMesh.boundsMax[axis])  subMesh.boundsMax[axis] = value;
+            }
+        }
+    }
+
+    // Reduce each vertex's bone weights to the largest 4 as bytes (see MeshSkinning.h). Sub-meshes without
+    // bones follow the bone above their node, or the first bone. Files with no bones at all get a chain
+    if (requireSkin)
+    {
+        mesh.bones = skeleton.bones;
+        if (mesh.bones.empty())
+        {
+            BuildChainSkin(mesh.vertices.get(), vertexSize, mesh.numVertices, positionOffset, blendIndicesOffset,
+                           blendWeightsOffset, SKIN_CHAIN_BONES, mesh.bones);
+        }
+        else
+        {
+            std::vector<unsigned int> influenceStart;
+            std::vector<uint32_t> influenceBones;
+            std::vector<float> influenceWeights;
+            for (unsigned int i = 0; i < scene->mNumMeshes; ++i)
+            {
+                const aiMesh* assimpMesh = scene->mMeshes[i];
+                const CookedSubMesh& subMesh = mesh.subMeshes[i];
+                unsigned char* subMeshVertices = mesh.vertices.get() + subMesh.baseVertex * vertexSize;
+
+                // List the influences on each vertex, grouped by vertex
+                influenceStart.assign(subMesh.numVertices + 1, 0);
+                for (unsigned int b = 0; b < assimpMesh->mNumBones; ++b)
+                {
+                    const aiBone* bone = assimpMesh->mBones[b];
+                    for (unsigned int w = 0; w < bone->mNumWeights; ++w)  ++influenceStart[bone->mWeights[w].mVertexId + 1];
+                }
+                for (unsigned int vertex = 0; vertex < subMesh.numVertices; ++vertex)  influenceStart[vertex + 1] += influenceStart[vertex];
+                influenceBones.resize(influenceStart[subMesh.numVertices]);
+                influenceWeights.resize(influenceStart[subMesh.numVertices]);
+                std::vector<unsigned int> next(influenceStart.begin(), influenceStart.end() - 1);
+                for (unsigned int b = 0; b < assimpMesh->mNumBones; ++b)
+                {
+                    const aiBone* bone = assimpMesh->mBones[b];
+                    uint32_t boneIndex = skeleton.boneIndices[bone->mName.C_Str()];
+                    for (unsigned int w = 0; w < bone->mNumWeights; ++w)
+                    {
+                        unsigned int slot = next[bone->mWeights[w].mVertexId]++;
+                        influenceBones[slot]   = boneIndex;
+                        influenceWeights[slot] = bone->mWeights[w].mWeight;
+                    }
+                }
+
+                uint32_t rigidBone = static_cast<uint32_t>(std::max(skeleton.meshParentBones[i], 0));
+                float rigidWeight = 1.0f;
+                for (unsigned int vertex = 0; vertex < subMesh.numVertices; ++vertex)
+                {
+                    unsigned char* out = subMeshVertices + vertex * vertexSize;
+                    unsigned int start = influenceStart[vertex], count = influenceStart[vertex + 1] - start;
+                    if (count > 0)  QuantiseSkinWeights(&influenceBones[start], &influenceWeights[start], count, out + blendIndicesOffset, out + blendWeightsOffset);
+                    else            QuantiseSkinWeights(&rigidBone, &rigidWeight, 1, out + blendIndicesOffset, out + blendWeightsOffset);
+                }
+            }
+        }
+    }
+    mesh.stats.extractSeconds = LapSeconds(stageStart);
+
+
+    //-----------------------------------
+
+    // Copy face data from assimp to our CPU-side index buffer. Index values are relative to the
+    // sub-mesh's base vertex
+    uint32_t* index = mesh.indices.get();
+    for (unsigned int i = 0; i < scene->mNumMeshes; ++i)
+    {
+        aiMesh* assimpMesh = scene->mMeshes[i];
+        for (unsigned int face = 0; face < assimpMesh->mNumFaces; ++face)
+        {
+            *index++ = assimpMesh->mFaces[face].mIndices[0];
+            *index++ = assimpMesh->mFaces[face].mIndices[1];
+            *index++ = assimpMesh->mFaces[face].mIndices[2];
+        }
+    }
+    mesh.stats.indexSeconds = LapSeconds(stageStart);
+
+
+    //-----------------------------------
+
+    // Calculate the tangents of each sub-mesh, split over all the CPU cores (see MeshTangents.h)
+    if (requireTangents && !USE_ASSIMP_TANGENTS)
+    {
+        for (CookedSubMesh& subMesh : mesh.subMeshes)
+        {
+            GenerateTangents(mesh.indices.get() + subMesh.indexStart, subMesh.numIndices, mesh.vertices.get() + subMesh.baseVertex * vertexSize,
+                             vertexSize, subMesh.numVertices, positionOffset, normalOffset, uvOffset, tangentOffset);
+        }
+    }
+    mesh.stats.tangentSeconds = LapSeconds(stageStart);
+
+
+    //-----------------------------------
+
+    // Assimp's aiProcess_ImproveCacheLocality only reorders for the vertex cache. Reorder each sub-mesh
+    // again for the vertex cache, then for overdraw and vertex fetch (see MeshOptimise.h), measuring the
+    // cache use before and after
+    for (CookedSubMesh& subMesh : mesh.subMeshes)
+    {
+        uint32_t* subMeshIndices = mesh.indices.get() + subMesh.indexStart;
+        unsigned char* subMeshVertices = mesh.vertices.get() + subMesh.baseVertex * vertexSize;
+        subMesh.transformedBefore = CountTransformedVertices(subMeshIndices, subMesh.numIndices, subMesh.numVertices);
+
+        OptimiseVertexCache(subMeshIndices, subMesh.numIndices, subMesh.numVertices);
+        OptimiseOverdraw(subMeshIndices, subMesh.numIndices, subMeshVertices, vertexSize, positionOffset, subMesh.numVertices);
+        OptimiseVertexFetch(subMeshVertices, vertexSize, subMesh.numVertices, subMeshIndices, subMesh.numIndices);
+
+        subMesh.transformedAfter = CountTransformedVertices(subMeshIndices, subMesh.numIndices, subMesh.numVertices);
+    }
+    mesh.stats.optimiseSeconds = LapSeconds(stageStart);
+
+
+    //-----------------------------------
+
+    // Build simpler levels of detail for each sub-mesh, each with about half the triangles of the last
+    // (see MeshSimplify.h). They use the sub-mesh's vertices, so only their indices are added, after the
+    // full detail indices. A level that doesn't remove enough triangles to be worth drawing ends the chain
+    std::vector<std::vector<uint32_t>> lodIndices;
+    unsigned int lodIndexStart = mesh.numIndices;
+    for (CookedSubMesh& subMesh : mesh.subMeshes)
+    {
+        subMesh.numLods = 1;
+        subMesh.lods[0] = { subMesh.indexStart, subMesh.numIndices, 0.0f };
+
+        unsigned int targets[MESH_MAX_LODS - 1];
+        for (unsigned int lod = 1; lod < MESH_MAX_LODS; ++lod)  targets[lod - 1] = (subMesh.numIndices / 3 >> lod) * 3;
+        const uint32_t* subMeshIndices = mesh.indices.get() + subMesh.indexStart;
+        const unsigned char* subMeshVertices = mesh.vertices.get() + subMesh.baseVertex * vertexSize;
+        std::vector<SimplifiedMesh> simplified = SimplifyMesh(subMeshIndices, subMesh.numIndices, subMeshVertices, vertexSize,
+                                                              positionOffset, subMesh.numVertices, targets, MESH_MAX_LODS - 1);
+        for (SimplifiedMesh& level : simplified)
+        {
+            const CookedLod& previous = subMesh.lods[subMesh.numLods - 1];
+            unsigned int numIndices = static_cast<unsigned int>(level.indices.size());
+            if (numIndices == 0 || numIndices > previous.numIndices * LOD_MIN_REDUCTION)  break;
+
+            OptimiseVertexCache(level.indices.data(), numIndices, subMesh.numVertices);
+            subMesh.lods[subMesh.numLods++] = { lodIndexStart, numIndices, level.error };
+            lodIndexStart += numIndices;
+            lodIndices.push_back(std::move(level.indices));
+        }
+        for (unsigned int lod = subMesh.numLods; lod < MESH_MAX_LODS; ++lod)  subMesh.lods[lod] = subMesh.lods[lod - 1];
+    }
+
+    if (!lodIndices.empty())
+    {
+        std::unique_ptr<uint32_t[]> allIndices(new uint32_t[lodIndexStart]);
+        std::memcpy(allIndices.get(), mesh.indices.get(), mesh.numIndices * sizeof(uint32_t));
+        uint32_t* lodIndex = allIndices.get() + mesh.numIndices;
+        for (auto& level : lodIndices)
+        {
+            std::memcpy(lodIndex, level.data(), level.size() * sizeof(uint32_t));
+            lodIndex += level.size();
+        }
+        mesh.indices = std::move(allIndices);
+        mesh.numIndices = lodIndexStart;
+    }
+    mesh.stats.simplifySeconds = LapSeconds(stageStart);
+
+
+    //-----------------------------------
+
+    // Split each sub-mesh's full detail triangles into clusters that can be culled separately (see MeshClusters.h)
+    for (CookedSubMesh& subMesh : mesh.subMeshes)
+    {
+        subMesh.clusterStart = static_cast<uint32_t>(mesh.clusters.size());
+        BuildMeshClusters(mesh.indices.get() + subMesh.indexStart, subMesh.numIndices, mesh.vertices.get() + subMesh.baseVertex * vertexSize,
+                          vertexSize, positionOffset, subMesh.numVertices, subMesh.indexStart, mesh.clusters);
+        subMesh.numClusters = static_cast<uint32_t>(mesh.clusters.size()) - subMesh.clusterStart;
+    }
+    mesh.stats.clusterSeconds = LapSeconds(stageStart);
+
+    return mesh;
+}
+
+
+// Vertex cache use of all the given sub-meshes, before or after the import reordered the triangles
+MeshCacheStats MeshCacheTotals(const CookedSubMesh* subMeshes, unsigned int numSubMeshes, bool optimised)
+{
+    MeshCacheStats total;
+    for (unsigned int i = 0; i < numSubMeshes; ++i)
+    {
+        total.numTriangles   += subMeshes[i].numIndices / 3;
+        total.numVertices    += subMeshes[i].numVertices;
+        total.numTransformed += optimised ? subMeshes[i].transformedAfter : subMeshes[i].transformedBefore;
+    }
+    return total;
+}
+
+
+// Write imported mesh data to a cooked file. Returns false on failure, or if the data has no source hash
+bool WriteCookedMesh(const std::string& cookedFileName, const MeshData& mesh)
+{
+    if (mesh.sourceHash == 0)  return false;
+
+    return WriteCookedMesh(cookedFileName, mesh.sourceHash, static_cast<uint64_t>(mesh.stats.Total() * 1e6),
+                           mesh.vertexElements.data(), static_cast<unsigned int>(mesh.vertexElements.size()),
+                           mesh.subMeshes.data(), static_cast<unsigned int>(mesh.subMeshes.size()),
+                           mesh.clusters.data(), static_cast<unsigned int>(mesh.clusters.size()),
+                           mesh.bones.data(), static_cast<unsigned int>(mesh.bones.size()), mesh.vertexSize,
+                           mesh.vertices.get(), mesh.numVertices, mesh.indices.get(), mesh.numIndices);
+}
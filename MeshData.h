@@ -0,0 +1,107 @@
+//--------------------------------------------------------------------------------------
+// Mesh import without a device - the geometry half of the Mesh class
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+//
+// Imports a mesh file with assimp and builds the interleaved vertex data and 32-bit index data
+// that the Mesh class puts into GPU buffers. Nothing here uses DirectX or Windows, so the same
+// import can run in command line tools (see Tools/MeshBake.cpp) as well as in the app.
+//
+// A skinned import also keeps each vertex's bone weights and the skeleton's bind pose for CPU
+// skinning (see MeshSkinning.h). It doesn't pre-transform the vertices with the scene's nodes, instead
+// node transforms go into the bind pose, or are applied to the vertices of sub-meshes without bones.
+
+#ifndef _MESH_DATA_H_INCLUDED_
+#define _MESH_DATA_H_INCLUDED_
+
+#include "CookedMesh.h"
+#include "MeshOptimise.h"
+#include "MeshSimplify.h"
+#include "MeshClusters.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+
+//--------------------------------------------------------------------------------------
+// Imported mesh data
+//--------------------------------------------------------------------------------------
+
+// Formats used for vertex elements. The values match DXGI_FORMAT so they can be passed to DirectX
+// unchanged, but without needing the DirectX headers
+const uint32_t MESH_FORMAT_R32G32B32A32_FLOAT = 2;
+const uint32_t MESH_FORMAT_R32G32B32_FLOAT    = 6;
+const uint32_t MESH_FORMAT_R16G16B16A16_UNORM = 11; // Compressed formats, see MeshCompression.h
+const uint32_t MESH_FORMAT_R16G16B16A16_SNORM = 13;
+const uint32_t MESH_FORMAT_R32G32_FLOAT       = 16;
+const uint32_t MESH_FORMAT_R8G8B8A8_UNORM     = 28; // Skinning blend weights, see MeshSkinning.h
+const uint32_t MESH_FORMAT_R8G8B8A8_UINT      = 30; // Skinning blend indices
+const uint32_t MESH_FORMAT_R16G16_FLOAT       = 34;
+const uint32_t MESH_FORMAT_R16G16_SNORM       = 37;
+
+// Time taken by each stage of an import, in seconds
+struct MeshImportStats
+{
+    double hashSeconds     = 0; // Reading and hashing the source file
+    double importSeconds   = 0; // Assimp import and processing
+    double extractSeconds  = 0; // Extracting vertex attributes from assimp into interleaved vertices, and the skin if required
+    double indexSeconds    = 0; // Building the index data
+    double tangentSeconds  = 0; // Calculating tangents (see MeshTangents.h)
+    double optimiseSeconds = 0; // Reordering triangles and vertices (see MeshOptimise.h)
+    double simplifySeconds = 0; // Building the levels of detail (see MeshSimplify.h)
+    double clusterSeconds  = 0; // Building the culling clusters (see MeshClusters.h)
+
+    double Total() const  { return hashSeconds + importSeconds + extractSeconds + indexSeconds + tangentSeconds + optimiseSeconds + simplifySeconds + clusterSeconds; }
+};
+
+// The result of an import. Vertex elements use the same description as cooked files
+struct MeshData
+{
+    uint64_t                         sourceHash = 0; // See MeshSourceHash, 0 if not known
+    std::vector<CookedVertexElement> vertexElements;
+    unsigned int                     vertexSize  = 0;
+    unsigned int                     numVertices = 0;
+    unsigned int                     numIndices  = 0;
+    std::vector<CookedSubMesh>       subMeshes;      // Each part of the mesh file, in order in the vertex and index data
+    std::vector<CookedCluster>       clusters;       // Culling bounds for runs of each sub-mesh's triangles
+    std::vector<CookedBone>          bones;          // Skeleton of a skinned import, parents before children
+
+    // For large arrays a unique_ptr is better than a vector because vectors default-initialise all
+    // the values which is a waste of time
+    std::unique_ptr<unsigned char[]> vertices;
+    std::unique_ptr<uint32_t[]>      indices;
+
+    MeshImportStats                  stats;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Importing
+//--------------------------------------------------------------------------------------
+
+// Return the hash identifying a cooked file for the given mesh file and import settings, covering
+// the contents of the file and the settings used to import it. Returns 0 if the file can't be read
+uint64_t MeshSourceHash(const std::string& fileName, bool requireTangents, bool requireSkin = false);
+
+// Import the given mesh file. Optionally calculate tangents (for normal and parallax mapping).
+// Optionally keep the skeleton and bone weights for skinning, adding "BlendIndices" and "BlendWeights"
+// elements at the end of each vertex (see MeshSkinning.h). Files without bones are given a chain of bones.
+// Pass the result of MeshSourceHash if already calculated, otherwise it is calculated here.
+// Will throw a std::runtime_error exception on failure.
+// All sub-meshes in the file are kept, packed one after another in the vertex and index data, followed
+// by the index data for each sub-mesh's simpler levels of detail.
+// Assimp logging is not set up here, the assimp logger is global so only create it around an
+// import if no other thread is importing
+MeshData ImportMeshData(const std::string& fileName, bool requireTangents, uint64_t sourceHash = 0, bool requireSkin = false);
+
+// Vertex cache use of all the given sub-meshes, before or after the import reordered the triangles
+MeshCacheStats MeshCacheTotals(const CookedSubMesh* subMeshes, unsigned int numSubMeshes, bool optimised);
+
+// Write imported mesh data to a cooked file (see CookedMesh.h). Returns false on failure, or if the
+// data has no source hash
+bool WriteCookedMesh(const std::string& cookedFileName, const MeshData& mesh);
+
+
+#endif //_MESH_DATA_H_INCLUDED_
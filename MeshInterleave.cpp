@@ -0,0 +1,163 @@
+//--------------------------------------------------------------------------------------
+// Vertex interleaving - building interleaved vertices from separate attribute arrays
+//--------------------------------------------------------------------------------------
+
+#include "MeshInterleave.h"
+#include "SIMD.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+
+// Vertices are built in blocks of about this many bytes, small enough that a block stays in the L1
+// cache while each attribute is copied into it
+static const unsigned int INTERLEAVE_BLOCK_BYTES = 4096;
+
+// Vertices in each block, a multiple of 4 so every block of the destination has the same 16 byte alignment as the first
+static unsigned int BlockVertices(unsigned int vertexSize)
+{
+    return std::max((INTERLEAVE_BLOCK_BYTES / vertexSize) & ~3u, 4u);
+}
+
+// Copy one attribute of one vertex, size is a multiple of 4
+static inline void CopyAttribute(unsigned char* out, const unsigned char* in, unsigned int size)
+{
+    for (; size >= 8; size -= 8, in += 8, out += 8)  std::memcpy(out, in, 8);
+    if (size > 0)  std::memcpy(out, in, 4);
+}
+
+
+//-----------------------------------
+// Plain C++ version
+//-----------------------------------
+
+// Copy each attribute in turn into a block of vertices, so each block of the destination is finished
+// while in the cache and the destination is only written in one pass. Reference version
+static void InterleaveVerticesPlain(const VertexStream* streams, unsigned int numStreams, unsigned char* destination,
+                                    unsigned int vertexSize, unsigned int numVertices)
+{
+    unsigned int blockVertices = BlockVertices(vertexSize);
+    for (unsigned int firstVertex = 0; firstVertex < numVertices; firstVertex += blockVertices)
+    {
+        unsigned int blockCount = std::min(blockVertices, numVertices - firstVertex);
+        unsigned char* block = destination + static_cast<size_t>(firstVertex) * vertexSize;
+        for (unsigned int s = 0; s < numStreams; ++s)
+        {
+            const VertexStream& stream = streams[s];
+            const unsigned char* in = static_cast<const unsigned char*>(stream.source) + static_cast<size_t>(firstVertex) * stream.sourceStride;
+            unsigned char* out = block + stream.offset;
+            for (unsigned int v = 0; v < blockCount; ++v, in += stream.sourceStride, out += vertexSize)
+            {
+                CopyAttribute(out, in, stream.size);
+            }
+        }
+    }
+}
+
+
+//-----------------------------------
+// SIMD version
+//-----------------------------------
+
+#if MATH_SIMD_X86
+
+// Copy each attribute in turn into a block of vertices with 16 byte copies where possible. With ordinary
+// stores the block is built in place in the destination. With streaming stores the block is built in an
+// aligned staging buffer then written to the destination in whole cache lines, bypassing the cache
+SIMD_TARGET_SSE41 static void InterleaveVerticesSSE41(const VertexStream* unsortedStreams, unsigned int numStreams,
+                                                      unsigned char* destination, unsigned int vertexSize,
+                                                      unsigned int numVertices, bool nonTemporal)
+{
+    // A 16 byte copy of a smaller attribute writes extra bytes over the attributes after it in the same
+    // vertex. Copying the streams in order of offset means those are overwritten with their real values
+    // afterwards. The copy must not write past the end of the vertex, nor read past the end of the next
+    // vertex's attribute (the final vertex always copies the exact size)
+    // Insertion sort while copying, there are at most INTERLEAVE_MAX_STREAMS streams
+    VertexStream streams[INTERLEAVE_MAX_STREAMS];
+    for (unsigned int s = 0; s < numStreams; ++s)
+    {
+        unsigned int i = s;
+        for (; i > 0 && streams[i - 1].offset > unsortedStreams[s].offset; --i)
+        {
+            streams[i] = streams[i - 1];
+        }
+        streams[i] = unsortedStreams[s];
+    }
+    bool wideCopy[INTERLEAVE_MAX_STREAMS];
+    for (unsigned int s = 0; s < numStreams; ++s)
+    {
+        wideCopy[s] = streams[s].offset + 16 <= vertexSize && streams[s].sourceStride + streams[s].size >= 16;
+    }
+
+    unsigned int blockVertices = BlockVertices(vertexSize);
+    bool streaming = nonTemporal && (reinterpret_cast<uintptr_t>(destination) & 15) == 0;
+    alignas(16) unsigned char staging[INTERLEAVE_BLOCK_BYTES];
+
+    for (unsigned int firstVertex = 0; firstVertex < numVertices; firstVertex += blockVertices)
+    {
+        unsigned int blockCount = std::min(blockVertices, numVertices - firstVertex);
+        unsigned int wideCount = firstVertex + blockCount == numVertices ? blockCount - 1 : blockCount;
+        unsigned char* block = destination + static_cast<size_t>(firstVertex) * vertexSize;
+        unsigned char* target = streaming ? staging : block;
+
+        for (unsigned int s = 0; s < numStreams; ++s)
+        {
+            const VertexStream& stream = streams[s];
+            const unsigned char* in = static_cast<const unsigned char*>(stream.source) + static_cast<size_t>(firstVertex) * stream.sourceStride;
+            unsigned char* out = target + stream.offset;
+            unsigned int v = 0;
+            if (wideCopy[s])
+            {
+                for (; v < wideCount; ++v, in += stream.sourceStride, out += vertexSize)
+                {
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_loadu_si128(reinterpret_cast<const __m128i*>(in)));
+                }
+            }
+            for (; v < blockCount; ++v, in += stream.sourceStride, out += vertexSize)
+            {
+                CopyAttribute(out, in, stream.size);
+            }
+        }
+
+        if (streaming)
+        {
+            size_t blockBytes = static_cast<size_t>(blockCount) * vertexSize;
+            size_t i = 0;
+            for (; i + 16 <= blockBytes; i += 16)
+            {
+                _mm_stream_si128(reinterpret_cast<__m128i*>(block + i), _mm_load_si128(reinterpret_cast<const __m128i*>(staging + i)));
+            }
+            std::memcpy(block + i, staging + i, blockBytes - i);
+        }
+    }
+
+    // Streaming stores are weakly ordered, make sure they are complete before anything else uses the vertices
+    if (streaming)  _mm_sfence();
+}
+
+#endif // MATH_SIMD_X86
+
+
+//-----------------------------------
+// Interleaving
+//-----------------------------------
+
+// Build interleaved vertices from separate attribute streams, see header
+void InterleaveVertices(const VertexStream* streams, unsigned int numStreams, void* destination,
+                        unsigned int vertexSize, unsigned int numVertices, InterleaveStores stores)
+{
+    unsigned char* out = static_cast<unsigned char*>(destination);
+
+#if MATH_SIMD_X86
+    // The SIMD version needs a block of at least 4 vertices to fit in its staging buffer
+    if (GetSimdLevel() != SimdLevel::None && numStreams <= INTERLEAVE_MAX_STREAMS && vertexSize * 4 <= INTERLEAVE_BLOCK_BYTES)
+    {
+        InterleaveVerticesSSE41(streams, numStreams, out, vertexSize, numVertices, stores == InterleaveStores::NonTemporal);
+        return;
+    }
+#endif
+
+    InterleaveVerticesPlain(streams, numStreams, out, vertexSize, numVertices);
+}
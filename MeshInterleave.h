@@ -0,0 +1,50 @@
+//--------------------------------------------------------------------------------------
+// Vertex interleaving - building interleaved vertices from separate attribute arrays
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+//
+// Importers such as assimp hold each vertex attribute (position, normal, UV...) in its own array,
+// but the GPU wants one interleaved vertex after another. Copying one attribute at a time over the
+// whole vertex array touches every cache line of the destination once per attribute, which for
+// large meshes means reading and writing the whole vertex array from main memory several times.
+//
+// InterleaveVertices instead works through the vertices in small blocks that stay in the L1 cache,
+// copying every attribute into a block before moving on, so the destination is written once from
+// start to end. The SIMD version copies each attribute with a single 16 byte load and store. With
+// InterleaveStores::NonTemporal it builds each block in a staging buffer and writes it with streaming
+// stores that bypass the cache, which suits large vertex arrays that are not read again soon (e.g.
+// data about to be copied to a GPU buffer). The SIMD version is chosen with GetSimdLevel (see
+// Math/SIMD.h), the plain C++ version is the reference. Nothing here uses DirectX or Windows.
+
+#ifndef _MESH_INTERLEAVE_H_INCLUDED_
+#define _MESH_INTERLEAVE_H_INCLUDED_
+
+
+// Most attributes in one interleaved vertex
+const unsigned int INTERLEAVE_MAX_STREAMS = 8;
+
+// One vertex attribute copied by InterleaveVertices
+struct VertexStream
+{
+    const void*  source;       // The attribute of the first vertex
+    unsigned int sourceStride; // Bytes between vertices in the source. 0 to use the same value for every vertex
+    unsigned int size;         // Bytes copied per vertex, a multiple of 4 up to 16 (e.g. 12 for 3 floats)
+    unsigned int offset;       // Offset of the attribute in the interleaved vertex, a multiple of 4
+};
+
+// How the interleaved vertices are written
+enum class InterleaveStores
+{
+    Normal,      // Ordinary stores, the vertices end up in the cache
+    NonTemporal, // Streaming stores that bypass the cache. Only used by the SIMD version
+};
+
+// Build numVertices interleaved vertices of vertexSize bytes (a multiple of 4) at the destination from
+// the given attribute streams (up to INTERLEAVE_MAX_STREAMS, in any order, they must not overlap).
+// Bytes of each vertex that are not covered by a stream are undefined afterwards
+void InterleaveVertices(const VertexStream* streams, unsigned int numStreams, void* destination,
+                        unsigned int vertexSize, unsigned int numVertices,
+                        InterleaveStores stores = InterleaveStores::Normal);
+
+
+#endif //_MESH_INTERLEAVE_H_INCLUDED_
@@ -0,0 +1,251 @@
+//--------------------------------------------------------------------------------------
+// Morph targets - blend shapes applied to a mesh's vertices on the CPU
+//--------------------------------------------------------------------------------------
+
+#include "MeshMorph.h"
+#include "SIMD.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+
+//-----------------------------------
+// Building targets
+//-----------------------------------
+
+// Radius of each bulge and the height it moves the surface at its centre, as fractions of the mesh's bounding radius
+static const float BULGE_RADIUS = 0.3f;
+static const float BULGE_HEIGHT = 0.15f;
+
+// Group a target's deltas into ranges, starting a new range after a large gap in the vertex numbers
+static void SetMorphRanges(MorphTarget& target)
+{
+    target.ranges.clear();
+    for (const MorphDelta& delta : target.deltas)
+    {
+        if (target.ranges.empty() || delta.vertex > target.ranges.back().endVertex + MORPH_RANGE_GAP)
+        {
+            target.ranges.push_back({ delta.vertex, delta.vertex + 1 });
+        }
+        else
+        {
+            target.ranges.back().endVertex = delta.vertex + 1;
+        }
+    }
+}
+
+// Give a mesh targets that push out or pull in round patches of its surface, see header
+void BuildBulgeTargets(const void* vertices, const MorphVertexLayout& layout, unsigned int numVertices,
+                       unsigned int numTargets, std::vector<MorphTarget>& targets)
+{
+    if (numVertices == 0)  return;
+    const unsigned char* in = static_cast<const unsigned char*>(vertices);
+    auto position = [&](unsigned int vertex) { return reinterpret_cast<const float*>(in + static_cast<size_t>(vertex) * layout.vertexSize + layout.positionOffset); };
+    auto normal   = [&](unsigned int vertex) { return reinterpret_cast<const float*>(in + static_cast<size_t>(vertex) * layout.vertexSize + layout.normalOffset); };
+
+    // Size of the mesh, and the highest vertex for the first patch
+    float boundsMin[3] = {  3e38f,  3e38f,  3e38f };
+    float boundsMax[3] = { -3e38f, -3e38f, -3e38f };
+    unsigned int top = 0;
+    for (unsigned int vertex = 0; vertex < numVertices; ++vertex)
+    {
+        const float* p = position(vertex);
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            boundsMin[axis] = std::min(boundsMin[axis], p[axis]);
+            boundsMax[axis] = std::max(boundsMax[axis], p[axis]);
+        }
+        if (p[1] > position(top)[1])  top = vertex;
+    }
+    float size[3] = { boundsMax[0] - boundsMin[0], boundsMax[1] - boundsMin[1], boundsMax[2] - boundsMin[2] };
+    float meshRadius = std::max(std::sqrt(size[0] * size[0] + size[1] * size[1] + size[2] * size[2]) * 0.5f, 1e-6f);
+    float radius = meshRadius * BULGE_RADIUS;
+    float radiusSquared = radius * radius;
+
+    // Each patch is centred on the vertex furthest from the patches before it
+    std::vector<float> nearest(numVertices, 3e38f);
+    unsigned int centre = top;
+    for (unsigned int t = 0; t < numTargets; ++t)
+    {
+        const float* c = position(centre);
+        MorphTarget target;
+        target.name = (t % 2 == 0 ? "Bulge" : "Dent") + std::to_string(t);
+        float height = meshRadius * BULGE_HEIGHT * (t % 2 == 0 ? 1.0f : -0.5f);
+
+        unsigned int furthest = 0;
+        for (unsigned int vertex = 0; vertex < numVertices; ++vertex)
+        {
+            const float* p = position(vertex);
+            float d[3] = { p[0] - c[0], p[1] - c[1], p[2] - c[2] };
+            float distanceSquared = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+            nearest[vertex] = std::min(nearest[vertex], distanceSquared);
+            if (nearest[vertex] > nearest[furthest])  furthest = vertex;
+            if (distanceSquared >= radiusSquared)  continue;
+
+            // The surface moves along the normal by height * (1 - s)^2, s being the squared distance as a
+            // fraction of the squared radius. The normal tilts against the slope of that, which is
+            // -4 * height * (1 - s) / radius^2 times the part of d across the surface
+            const float* n = normal(vertex);
+            float s = distanceSquared / radiusSquared;
+            float move = height * (1 - s) * (1 - s);
+            float tilt = 4 * height * (1 - s) / radiusSquared;
+            float along = d[0] * n[0] + d[1] * n[1] + d[2] * n[2];
+            float tilted[3];
+            for (int axis = 0; axis < 3; ++axis)  tilted[axis] = n[axis] + (d[axis] - n[axis] * along) * tilt;
+            float length = std::sqrt(tilted[0] * tilted[0] + tilted[1] * tilted[1] + tilted[2] * tilted[2]);
+            if (length > 0)  for (int axis = 0; axis < 3; ++axis)  tilted[axis] /= length;
+
+            MorphDelta delta;
+            delta.vertex = vertex;
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                delta.position[axis] = n[axis] * move;
+                delta.normal[axis]   = tilted[axis] - n[axis];
+            }
+            target.deltas.push_back(delta);
+        }
+        SetMorphRanges(target);
+        targets.push_back(std::move(target));
+        centre = furthest;
+    }
+}
+
+
+//-----------------------------------
+// Applying targets
+//-----------------------------------
+
+static void AccumulateMorphDeltasPlain(const MorphDelta* deltas, unsigned int numDeltas, float weight, const MorphVertexLayout& layout,
+                                       unsigned char* vertices)
+{
+    for (unsigned int i = 0; i < numDeltas; ++i)
+    {
+        const MorphDelta& delta = deltas[i];
+        unsigned char* vertex = vertices + static_cast<size_t>(delta.vertex) * layout.vertexSize;
+        float* position = reinterpret_cast<float*>(vertex + layout.positionOffset);
+        float* normal   = reinterpret_cast<float*>(vertex + layout.normalOffset);
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            position[axis] = position[axis] + weight * delta.position[axis];
+            normal[axis]   = normal[axis]   + weight * delta.normal[axis];
+        }
+    }
+}
+
+
+#if MATH_SIMD_X86
+
+// The position and normal of a delta, and of a vertex laid out by the import, are 6 floats in a row. They
+// are added as 4 floats then 2. A delta is too narrow to fill AVX registers, so there is no AVX2 version
+SIMD_TARGET_SSE41 static void AccumulateMorphDeltasSSE41(const MorphDelta* deltas, unsigned int numDeltas, float weight,
+                                                         const MorphVertexLayout& layout, unsigned char* vertices)
+{
+    const __m128 w = _mm_set1_ps(weight);
+    const __m128 zero = _mm_setzero_ps();
+    for (unsigned int i = 0; i < numDeltas; ++i)
+    {
+        const MorphDelta& delta = deltas[i];
+        float* out = reinterpret_cast<float*>(vertices + static_cast<size_t>(delta.vertex) * layout.vertexSize + layout.positionOffset);
+        const float* change = delta.position;
+
+        __m128 first = _mm_add_ps(_mm_loadu_ps(out), _mm_mul_ps(w, _mm_loadu_ps(change)));
+        __m128 rest  = _mm_add_ps(_mm_loadl_pi(zero, reinterpret_cast<const __m64*>(out + 4)),
+                                  _mm_mul_ps(w, _mm_loadl_pi(zero, reinterpret_cast<const __m64*>(change + 4))));
+        _mm_storeu_ps(out, first);
+        _mm_storel_pi(reinterpret_cast<__m64*>(out + 4), rest);
+    }
+}
+
+#endif // MATH_SIMD_X86
+
+
+// Add weight times each delta to its vertex, see header
+void AccumulateMorphDeltas(const MorphDelta* deltas, unsigned int numDeltas, float weight, const MorphVertexLayout& layout,
+                           void* vertices)
+{
+    unsigned char* out = static_cast<unsigned char*>(vertices);
+
+#if MATH_SIMD_X86
+    static_assert(offsetof(MorphDelta, normal) == offsetof(MorphDelta, position) + 12, "Morph delta position and normal must be together");
+    if (layout.normalOffset == layout.positionOffset + 12 && GetSimdLevel() >= SimdLevel::SSE41)
+    {
+        AccumulateMorphDeltasSSE41(deltas, numDeltas, weight, layout, out);
+        return;
+    }
+#endif
+
+    AccumulateMorphDeltasPlain(deltas, numDeltas, weight, layout, out);
+}
+
+
+//-----------------------------------
+// Morphed vertices
+//-----------------------------------
+
+MorphedVertices::MorphedVertices(const MorphTarget* targets, unsigned int numTargets, const MorphVertexLayout& layout,
+                                 const void* meshVertices, unsigned int numVertices)
+    : mTargets(targets), mLayout(layout), mMeshVertices(static_cast<const unsigned char*>(meshVertices)), mNumVertices(numVertices),
+      mWeights(numTargets, 0.0f), mAppliedWeights(numTargets, 0.0f)
+{
+    // With every weight zero the vertices are the mesh's own
+    size_t bytes = static_cast<size_t>(numVertices) * layout.vertexSize;
+    mVertices.reset(new unsigned char[bytes]);
+    std::memcpy(mVertices.get(), mMeshVertices, bytes);
+}
+
+
+// Rebuild the ranges of the targets whose weights changed, see header
+const std::vector<MorphRange>& MorphedVertices::Update()
+{
+    mChanged.clear();
+    mDeltasProcessed = 0;
+    for (unsigned int t = 0; t < NumTargets(); ++t)
+    {
+        if (mWeights[t] != mAppliedWeights[t])
+        {
+            mChanged.insert(mChanged.end(), mTargets[t].ranges.begin(), mTargets[t].ranges.end());
+        }
+    }
+    if (mChanged.empty())  return mChanged;
+
+    // Merge the ranges where they overlap or touch
+    std::sort(mChanged.begin(), mChanged.end(), [](const MorphRange& a, const MorphRange& b) { return a.firstVertex < b.firstVertex; });
+    size_t numMerged = 0;
+    for (const MorphRange& range : mChanged)
+    {
+        if (numMerged > 0 && range.firstVertex <= mChanged[numMerged - 1].endVertex)
+        {
+            mChanged[numMerged - 1].endVertex = std::max(mChanged[numMerged - 1].endVertex, range.endVertex);
+        }
+        else
+        {
+            mChanged[numMerged++] = range;
+        }
+    }
+    mChanged.resize(numMerged);
+
+    // Start each range from the mesh's vertices, then add the deltas in it of every target in use, in target order
+    auto byVertex = [](const MorphDelta& delta, unsigned int vertex) { return delta.vertex < vertex; };
+    size_t vertexSize = mLayout.vertexSize;
+    for (const MorphRange& range : mChanged)
+    {
+        std::memcpy(mVertices.get() + range.firstVertex * vertexSize, mMeshVertices + range.firstVertex * vertexSize,
+                    (range.endVertex - range.firstVertex) * vertexSize);
+        for (unsigned int t = 0; t < NumTargets(); ++t)
+        {
+            const std::vector<MorphDelta>& deltas = mTargets[t].deltas;
+            if (mWeights[t] == 0 || deltas.empty() || deltas.front().vertex >= range.endVertex || deltas.back().vertex < range.firstVertex)  continue;
+
+            auto first = std::lower_bound(deltas.begin(), deltas.end(), range.firstVertex, byVertex);
+            auto end   = std::lower_bound(first, deltas.end(), range.endVertex, byVertex);
+            unsigned int count = static_cast<unsigned int>(end - first);
+            if (count == 0)  continue;
+            AccumulateMorphDeltas(&*first, count, mWeights[t], mLayout, mVertices.get());
+            mDeltasProcessed += count;
+        }
+    }
+    mAppliedWeights = mWeights;
+    return mChanged;
+}
@@ -0,0 +1,133 @@
+//--------------------------------------------------------------------------------------
+// Morph targets - blend shapes applied to a mesh's vertices on the CPU
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+//
+// A morph target (blend shape) is a change to the shape of a mesh, e.g. a smile on a face. Most
+// targets only move a small part of the mesh, so each is stored as a sparse list of deltas - a vertex
+// index with the change to its position and normal - sorted by vertex. Each instance of the mesh has a
+// weight for each target, and its vertices are the mesh's vertices plus the weighted deltas of every
+// target. Normals are not renormalised, the pixel shaders do that.
+//
+// The deltas of a target are grouped into ranges of nearby vertices. When the weights change only the
+// ranges of the targets that changed are rebuilt - copied from the mesh's vertices, then the deltas in
+// them of every target with a non-zero weight added (see MorphedVertices). Those ranges are all that
+// needs uploading to the instance's vertex buffer. So the cost follows the deltas touched rather than the
+// size of the mesh, an instance whose weights haven't changed costs nothing, and targets with zero
+// weight are never read. The ranges are rebuilt from the mesh's vertices each time rather than having
+// weight changes added to them, so rounding errors don't build up over time.
+//
+// The deltas are added with SIMD, chosen with GetSimdLevel (see Math/SIMD.h), giving bit-identical
+// results to the plain C++ version, which is the reference.
+//
+// The mesh files here have no blend shapes, and the version of assimp used can't import them, so meshes
+// are given procedural targets that push out or pull in round patches of their surface (see BuildBulgeTargets).
+// Nothing here uses DirectX or Windows.
+
+#ifndef _MESH_MORPH_H_INCLUDED_
+#define _MESH_MORPH_H_INCLUDED_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+
+
+// Targets given to a mesh by BuildBulgeTargets
+const unsigned int MORPH_BULGE_TARGETS = 8;
+
+// A target's deltas start a new range after a gap of more than this many vertices without one
+const unsigned int MORPH_RANGE_GAP = 64;
+
+
+// The change to one vertex made by a target at full weight
+struct MorphDelta
+{
+    uint32_t vertex;
+    float    position[3];
+    float    normal[3];
+};
+
+// A run of vertices, firstVertex up to but not including endVertex
+struct MorphRange
+{
+    unsigned int firstVertex;
+    unsigned int endVertex;
+};
+
+// One morph target. The deltas are sorted by vertex and the ranges cover them, in order
+struct MorphTarget
+{
+    std::string             name;
+    std::vector<MorphDelta> deltas;
+    std::vector<MorphRange> ranges;
+};
+
+// Where the morphed elements are in a vertex. Offsets are in bytes and multiples of 4, position and normal
+// are 3 floats. The SIMD versions need the normal straight after the position, as the import lays them out
+struct MorphVertexLayout
+{
+    unsigned int vertexSize     = 0;
+    unsigned int positionOffset = 0;
+    unsigned int normalOffset   = 0;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Building targets
+//--------------------------------------------------------------------------------------
+
+// Give a mesh numTargets targets, each pushing out (or for every other target pulling in) a round patch of
+// its surface along the normals. The patches are centred on vertices spread over the mesh, starting at the
+// top, and the normal deltas follow the slope of each patch. Adds to the given targets
+void BuildBulgeTargets(const void* vertices, const MorphVertexLayout& layout, unsigned int numVertices,
+                       unsigned int numTargets, std::vector<MorphTarget>& targets);
+
+
+//--------------------------------------------------------------------------------------
+// Applying targets
+//--------------------------------------------------------------------------------------
+
+// Add weight times each of the given deltas to the position and normal of its vertex
+void AccumulateMorphDeltas(const MorphDelta* deltas, unsigned int numDeltas, float weight, const MorphVertexLayout& layout,
+                           void* vertices);
+
+
+// One instance's morphed copy of a mesh's vertices. Set the weights, then Update brings the vertices up to
+// date and gives the ranges that changed. The targets and the mesh's vertices are not copied, they must
+// last as long as this object
+class MorphedVertices
+{
+public:
+    MorphedVertices(const MorphTarget* targets, unsigned int numTargets, const MorphVertexLayout& layout,
+                    const void* meshVertices, unsigned int numVertices);
+
+    unsigned int NumTargets() const                  { return static_cast<unsigned int>(mWeights.size()); }
+    float        Weight(unsigned int target) const   { return mWeights[target]; }
+    void         SetWeight(unsigned int target, float weight)  { mWeights[target] = weight; }
+
+    // Rebuild the ranges of every target whose weight changed since the last update. Returns the vertex
+    // ranges rebuilt, in order and not overlapping, empty if no weight changed. Valid until the next update
+    const std::vector<MorphRange>& Update();
+
+    // The morphed vertices, in the mesh's vertex layout
+    const void*  Vertices() const                    { return mVertices.get(); }
+
+    // Deltas added by the last update
+    unsigned int DeltasProcessed() const             { return mDeltasProcessed; }
+
+private:
+    const MorphTarget*               mTargets;
+    MorphVertexLayout                mLayout;
+    const unsigned char*             mMeshVertices;
+    unsigned int                     mNumVertices;
+    std::unique_ptr<unsigned char[]> mVertices;
+
+    std::vector<float>               mWeights;
+    std::vector<float>               mAppliedWeights; // Weights the vertices were last built with
+    std::vector<MorphRange>          mChanged;
+    unsigned int                     mDeltasProcessed = 0;
+};
+
+
+#endif //_MESH_MORPH_H_INCLUDED_
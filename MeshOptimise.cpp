@@ -0,0 +1,374 @@
+//--------------------------------------------------------------------------------------
+// Triangle and vertex reordering for faster rendering of meshes
+//--------------------------------------------------------------------------------------
+
+#include "MeshOptimise.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+
+//--------------------------------------------------------------------------------------
+// Measuring cache use
+//--------------------------------------------------------------------------------------
+
+// Count the vertices transformed drawing the given triangle list with a FIFO cache of the given size
+unsigned int CountTransformedVertices(const uint32_t* indices, unsigned int numIndices, unsigned int numVertices,
+                                      unsigned int cacheSize /*= VERTEX_CACHE_FIFO_SIZE*/)
+{
+    // Each vertex holds the time it entered the cache, it is still in the cache if fewer than
+    // cacheSize vertices have entered since
+    std::vector<unsigned int> entryTime(numVertices, 0);
+    unsigned int time = cacheSize + 1;
+    unsigned int numTransformed = 0;
+    for (unsigned int i = 0; i < numIndices; ++i)
+    {
+        uint32_t vertex = indices[i];
+        if (time - entryTime[vertex] > cacheSize)
+        {
+            entryTime[vertex] = time++;
+            ++numTransformed;
+        }
+    }
+    return numTransformed;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Vertex cache
+//--------------------------------------------------------------------------------------
+
+// Forsyth's algorithm models an LRU cache of this size
+const int FORSYTH_CACHE_SIZE = 32;
+
+// Score of a vertex - high for vertices recently used (so still in the cache) and for vertices with few
+// triangles left to draw (so they can leave the cache sooner). Values from Forsyth's article
+static float CalculateVertexScore(int cachePosition, unsigned int numTrianglesLeft)
+{
+    if (numTrianglesLeft == 0)  return -1; // Not used by any more triangles
+
+    float score = 0;
+    if (cachePosition >= 3)
+    {
+        float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+        score = std::pow(1.0f - (cachePosition - 3) * scaler, 1.5f);
+    }
+    else if (cachePosition >= 0)
+    {
+        score = 0.75f; // The last triangle's vertices get a fixed score, so the next triangle doesn't prefer any edge
+    }
+    return score + 2.0f / std::sqrt(static_cast<float>(numTrianglesLeft));
+}
+
+// The score is looked up in a table for the common cases, the pow and sqrt are most of the time taken otherwise
+const unsigned int VERTEX_SCORE_MAX_TRIANGLES = 32;
+struct VertexScoreTable
+{
+    float scores[FORSYTH_CACHE_SIZE + 1][VERTEX_SCORE_MAX_TRIANGLES]; // First row is for vertices not in the cache
+
+    VertexScoreTable()
+    {
+        for (int position = -1; position < FORSYTH_CACHE_SIZE; ++position)
+        {
+            for (unsigned int triangles = 0; triangles < VERTEX_SCORE_MAX_TRIANGLES; ++triangles)
+            {
+                scores[position + 1][triangles] = CalculateVertexScore(position, triangles);
+            }
+        }
+    }
+};
+
+static float VertexScore(int cachePosition, unsigned int numTrianglesLeft)
+{
+    static const VertexScoreTable table;
+    if (numTrianglesLeft >= VERTEX_SCORE_MAX_TRIANGLES)  return CalculateVertexScore(cachePosition, numTrianglesLeft);
+    return table.scores[cachePosition + 1][numTrianglesLeft];
+}
+
+
+// Reorder triangles for the post-transform vertex cache
+void OptimiseVertexCache(uint32_t* indices, unsigned int numIndices, unsigned int numVertices)
+{
+    unsigned int numTriangles = numIndices / 3;
+    if (numTriangles == 0)  return;
+
+    // List of triangles using each vertex. The first numTrianglesLeft entries of a vertex's list are
+    // the triangles not yet drawn
+    std::vector<unsigned int> numTrianglesLeft(numVertices, 0);
+    for (unsigned int i = 0; i < numIndices; ++i)  ++numTrianglesLeft[indices[i]];
+
+    std::vector<unsigned int> triangleListStart(numVertices + 1, 0);
+    for (unsigned int v = 0; v < numVertices; ++v)  triangleListStart[v + 1] = triangleListStart[v] + numTrianglesLeft[v];
+
+    std::vector<unsigned int> triangleLists(numIndices);
+    std::vector<unsigned int> fill(triangleListStart.begin(), triangleListStart.end() - 1);
+    for (unsigned int i = 0; i < numIndices; ++i)  triangleLists[fill[indices[i]]++] = i / 3;
+
+    // Initial scores, nothing is in the cache
+    std::vector<int>   cachePosition(numVertices, -1);
+    std::vector<float> vertexScore(numVertices);
+    for (unsigned int v = 0; v < numVertices; ++v)  vertexScore[v] = VertexScore(-1, numTrianglesLeft[v]);
+
+    std::vector<float> triangleScore(numTriangles);
+    std::vector<char>  triangleDrawn(numTriangles, false);
+    unsigned int bestTriangle = 0;
+    for (unsigned int t = 0; t < numTriangles; ++t)
+    {
+        triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+        if (triangleScore[t] > triangleScore[bestTriangle])  bestTriangle = t;
+    }
+
+    std::unique_ptr<uint32_t[]> output(new uint32_t[numTriangles * 3]);
+    uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+    int cacheSize = 0;
+    unsigned int nextUndrawn = 0; // For finding a triangle when none of the cached vertices have any left
+
+    for (unsigned int drawn = 0; drawn < numTriangles; ++drawn)
+    {
+        // Draw the best triangle, removing it from its vertices' lists
+        const uint32_t* triangle = indices + bestTriangle * 3;
+        uint32_t* outputTriangle = output.get() + drawn * 3;
+        triangleDrawn[bestTriangle] = true;
+        for (int corner = 0; corner < 3; ++corner)
+        {
+            uint32_t vertex = triangle[corner];
+            outputTriangle[corner] = vertex;
+
+            unsigned int* list = triangleLists.data() + triangleListStart[vertex];
+            unsigned int& listSize = numTrianglesLeft[vertex];
+            auto position = std::find(list, list + listSize, bestTriangle);
+            if (position != list + listSize)  std::swap(*position, list[--listSize]); // May be missing if the triangle repeats a vertex
+        }
+
+        // Move the triangle's vertices to the front of the cache, the rest move back
+        uint32_t newCache[FORSYTH_CACHE_SIZE + 3];
+        int newCacheSize = 0;
+        for (int corner = 0; corner < 3; ++corner)
+        {
+            if (std::find(newCache, newCache + newCacheSize, triangle[corner]) == newCache + newCacheSize)  newCache[newCacheSize++] = triangle[corner];
+        }
+        for (int i = 0; i < cacheSize; ++i)
+        {
+            if (std::find(newCache, newCache + newCacheSize, cache[i]) == newCache + newCacheSize)  newCache[newCacheSize++] = cache[i];
+        }
+
+        // Update the scores of all the vertices that moved, including those pushed out of the cache
+        for (int i = 0; i < newCacheSize; ++i)
+        {
+            uint32_t vertex = newCache[i];
+            cachePosition[vertex] = (i < FORSYTH_CACHE_SIZE) ? i : -1;
+            vertexScore[vertex] = VertexScore(cachePosition[vertex], numTrianglesLeft[vertex]);
+        }
+
+        // Then the scores of their triangles, picking the best one to draw next
+        float bestScore = -1;
+        bool found = false;
+        for (int i = 0; i < newCacheSize; ++i)
+        {
+            uint32_t vertex = newCache[i];
+            const unsigned int* list = triangleLists.data() + triangleListStart[vertex];
+            for (unsigned int j = 0; j < numTrianglesLeft[vertex]; ++j)
+            {
+                unsigned int t = list[j];
+                triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+                if (triangleScore[t] > bestScore)
+                {
+                    bestScore = triangleScore[t];
+                    bestTriangle = t;
+                    found = true;
+                }
+            }
+        }
+
+        cacheSize = std::min(newCacheSize, FORSYTH_CACHE_SIZE);
+        std::copy(newCache, newCache + cacheSize, cache);
+
+        // If no cached vertex has triangles left then continue with the next undrawn triangle. Forsyth
+        // searches for the best scoring one, but they all score the same apart from the valence part
+        if (!found)
+        {
+            while (nextUndrawn < numTriangles && triangleDrawn[nextUndrawn])  ++nextUndrawn;
+            bestTriangle = nextUndrawn;
+        }
+    }
+
+    std::memcpy(indices, output.get(), numTriangles * 3 * sizeof(uint32_t));
+}
+
+
+//--------------------------------------------------------------------------------------
+// Overdraw
+//--------------------------------------------------------------------------------------
+
+// Reorder clusters of triangles to reduce overdraw, see header
+void OptimiseOverdraw(uint32_t* indices, unsigned int numIndices, const void* vertices, unsigned int vertexSize,
+                      unsigned int positionOffset, unsigned int numVertices, float threshold /*= 1.05f*/)
+{
+    unsigned int numTriangles = numIndices / 3;
+    if (numTriangles < 2)  return;
+
+    // Simulate the cache for each triangle. A triangle where all three vertices miss starts a new
+    // "hard" cluster - the cache has been refilled so the triangles can be moved without losing any reuse
+    std::vector<unsigned int> entryTime(numVertices, 0);
+    unsigned int time = VERTEX_CACHE_FIFO_SIZE + 1;
+    std::vector<unsigned int> triangleMisses(numTriangles);
+    std::vector<unsigned int> hardClusters;
+    for (unsigned int t = 0; t < numTriangles; ++t)
+    {
+        unsigned int misses = 0;
+        for (int corner = 0; corner < 3; ++corner)
+        {
+            uint32_t vertex = indices[t * 3 + corner];
+            if (time - entryTime[vertex] > VERTEX_CACHE_FIFO_SIZE)
+            {
+                entryTime[vertex] = time++;
+                ++misses;
+            }
+        }
+        triangleMisses[t] = misses;
+        if (t == 0 || misses == 3)  hardClusters.push_back(t);
+    }
+    hardClusters.push_back(numTriangles);
+
+    // Split the hard clusters further into "soft" clusters. Starting a cluster empties the cache, so a
+    // cluster is ended once its own ACMR is within the threshold of the hard cluster's ACMR
+    std::vector<unsigned int> clusters;
+    for (size_t c = 0; c + 1 < hardClusters.size(); ++c)
+    {
+        unsigned int start = hardClusters[c], end = hardClusters[c + 1];
+        unsigned int hardMisses = 0;
+        for (unsigned int t = start; t < end; ++t)  hardMisses += triangleMisses[t];
+        float targetACMR = threshold * hardMisses / (end - start);
+
+        clusters.push_back(start);
+        unsigned int clusterStart = start, clusterMisses = 0;
+        time += VERTEX_CACHE_FIFO_SIZE + 1; // Empty the cache
+        for (unsigned int t = start; t < end; ++t)
+        {
+            for (int corner = 0; corner < 3; ++corner)
+            {
+                uint32_t vertex = indices[t * 3 + corner];
+                if (time - entryTime[vertex] > VERTEX_CACHE_FIFO_SIZE)
+                {
+                    entryTime[vertex] = time++;
+                    ++clusterMisses;
+                }
+            }
+            if (t + 1 < end && static_cast<float>(clusterMisses) / (t + 1 - clusterStart) <= targetACMR)
+            {
+                clusters.push_back(t + 1);
+                clusterStart = t + 1;
+                clusterMisses = 0;
+                time += VERTEX_CACHE_FIFO_SIZE + 1;
+            }
+        }
+    }
+    unsigned int numClusters = static_cast<unsigned int>(clusters.size());
+    clusters.push_back(numTriangles);
+
+
+    //-----------------------------------
+
+    // Area-weighted centre and normal of each cluster and the centre of the whole mesh
+    auto position = [&](uint32_t vertex)
+    {
+        return reinterpret_cast<const float*>(static_cast<const unsigned char*>(vertices) + vertex * vertexSize + positionOffset);
+    };
+    struct Cluster
+    {
+        unsigned int start, end;
+        float centre[3];
+        float normal[3];
+        float sortKey;
+    };
+    std::vector<Cluster> clusterData(numClusters);
+    float meshCentre[3] = {};
+    float meshArea = 0;
+    for (unsigned int c = 0; c < numClusters; ++c)
+    {
+        Cluster& cluster = clusterData[c];
+        cluster = { clusters[c], clusters[c + 1], { 0, 0, 0 }, { 0, 0, 0 }, 0 };
+        float clusterArea = 0;
+        for (unsigned int t = cluster.start; t < cluster.end; ++t)
+        {
+            const float* p0 = position(indices[t * 3]);
+            const float* p1 = position(indices[t * 3 + 1]);
+            const float* p2 = position(indices[t * 3 + 2]);
+            float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+            float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+            float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] }; // Length is twice the area
+            float area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                cluster.centre[axis] += (p0[axis] + p1[axis] + p2[axis]) * (area / 3);
+                cluster.normal[axis] += n[axis];
+            }
+            clusterArea += area;
+        }
+        for (int axis = 0; axis < 3; ++axis)  meshCentre[axis] += cluster.centre[axis];
+        meshArea += clusterArea;
+        if (clusterArea > 0)
+        {
+            for (int axis = 0; axis < 3; ++axis)  cluster.centre[axis] /= clusterArea;
+        }
+    }
+    if (meshArea > 0)
+    {
+        for (int axis = 0; axis < 3; ++axis)  meshCentre[axis] /= meshArea;
+    }
+
+    // Clusters further out along their facing direction are drawn first. Triangles are clockwise
+    // from the front, which in left-handed coordinates means the cross product above faces outward
+    for (Cluster& cluster : clusterData)
+    {
+        float length = std::sqrt(cluster.normal[0] * cluster.normal[0] + cluster.normal[1] * cluster.normal[1] + cluster.normal[2] * cluster.normal[2]);
+        cluster.sortKey = 0;
+        if (length > 0)
+        {
+            for (int axis = 0; axis < 3; ++axis)  cluster.sortKey += (cluster.centre[axis] - meshCentre[axis]) * cluster.normal[axis] / length;
+        }
+    }
+    std::stable_sort(clusterData.begin(), clusterData.end(), [](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey; });
+
+    std::unique_ptr<uint32_t[]> output(new uint32_t[numTriangles * 3]);
+    uint32_t* out = output.get();
+    for (const Cluster& cluster : clusterData)
+    {
+        out = std::copy(indices + cluster.start * 3, indices + cluster.end * 3, out);
+    }
+    std::memcpy(indices, output.get(), numTriangles * 3 * sizeof(uint32_t));
+}
+
+
+//--------------------------------------------------------------------------------------
+// Vertex fetch
+//--------------------------------------------------------------------------------------
+
+// Renumber vertices in the order they are first used by the triangles, see header
+void OptimiseVertexFetch(void* vertices, unsigned int vertexSize, unsigned int numVertices, uint32_t* indices, unsigned int numIndices)
+{
+    const uint32_t UNUSED = 0xffffffff;
+    std::vector<uint32_t> newVertex(numVertices, UNUSED);
+    uint32_t nextVertex = 0;
+    for (unsigned int i = 0; i < numIndices; ++i)
+    {
+        uint32_t& vertex = newVertex[indices[i]];
+        if (vertex == UNUSED)  vertex = nextVertex++;
+        indices[i] = vertex;
+    }
+    for (uint32_t& vertex : newVertex)
+    {
+        if (vertex == UNUSED)  vertex = nextVertex++;
+    }
+
+    unsigned char* data = static_cast<unsigned char*>(vertices);
+    std::unique_ptr<unsigned char[]> reordered(new unsigned char[numVertices * vertexSize]);
+    for (unsigned int v = 0; v < numVertices; ++v)
+    {
+        std::memcpy(reordered.get() + newVertex[v] * vertexSize, data + v * vertexSize, vertexSize);
+    }
+    std::memcpy(data, reordered.get(), numVertices * vertexSize);
+}
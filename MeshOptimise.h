@@ -0,0 +1,81 @@
+//--------------------------------------------------------------------------------------
+// Triangle and vertex reordering for faster rendering of meshes
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+//
+// Three passes over the index (and vertex) data of a mesh, run in this order:
+//     OptimiseVertexCache - reorders triangles so vertices are reused while still in the GPU's
+//                           post-transform cache, using Tom Forsyth's linear-speed algorithm
+//     OptimiseOverdraw    - splits the result into clusters that each use the cache well, then
+//                           sorts the clusters so outward facing parts on the outside of the mesh
+//                           are drawn first and hide the rest (Sander, Nehab & Barczak, "Fast
+//                           triangle reordering for vertex locality and reduced overdraw")
+//     OptimiseVertexFetch - renumbers the vertices in the order the triangles first use them, so
+//                           vertex data is read from memory in order
+// The import runs these on each sub-mesh (see MeshData.cpp), so the results are stored in the
+// cooked files and cost nothing when loading.
+//
+// Cache use is measured by simulating a FIFO cache and counting the vertices transformed:
+//     ACMR (average cache miss ratio)     = vertices transformed / triangles. Best possible is
+//                                           about 0.5 for large regular meshes, 3 is the worst
+//     ATVR (average transform to vertex ratio) = vertices transformed / vertices. Best is 1.0
+// Nothing here uses DirectX or Windows.
+
+#ifndef _MESH_OPTIMISE_H_INCLUDED_
+#define _MESH_OPTIMISE_H_INCLUDED_
+
+#include <cstdint>
+
+
+//--------------------------------------------------------------------------------------
+// Measuring cache use
+//--------------------------------------------------------------------------------------
+
+// Size of the simulated FIFO cache used for the reported figures. Real GPUs vary, this is a
+// conservative size that is commonly used to compare results
+const unsigned int VERTEX_CACHE_FIFO_SIZE = 16;
+
+// Vertices transformed for a set of triangles, can be added together to combine sub-meshes
+struct MeshCacheStats
+{
+    unsigned int numTriangles   = 0;
+    unsigned int numVertices    = 0;
+    unsigned int numTransformed = 0;
+
+    float ACMR() const  { return numTriangles > 0 ? static_cast<float>(numTransformed) / numTriangles : 0; }
+    float ATVR() const  { return numVertices  > 0 ? static_cast<float>(numTransformed) / numVertices  : 0; }
+
+    MeshCacheStats& operator+=(const MeshCacheStats& s)
+    {
+        numTriangles += s.numTriangles;  numVertices += s.numVertices;  numTransformed += s.numTransformed;
+        return *this;
+    }
+};
+
+// Count the vertices transformed drawing the given triangle list with a FIFO cache of the given size.
+// Index values must be less than numVertices
+unsigned int CountTransformedVertices(const uint32_t* indices, unsigned int numIndices, unsigned int numVertices,
+                                      unsigned int cacheSize = VERTEX_CACHE_FIFO_SIZE);
+
+
+//--------------------------------------------------------------------------------------
+// Optimising
+//--------------------------------------------------------------------------------------
+// Each pass works on a triangle list with index values less than numVertices, in place
+
+// Reorder triangles for the post-transform vertex cache
+void OptimiseVertexCache(uint32_t* indices, unsigned int numIndices, unsigned int numVertices);
+
+// Reorder clusters of triangles to reduce overdraw, after OptimiseVertexCache. A cluster is ended
+// once its ACMR is within the threshold (a ratio) of what the vertex cache pass achieved, so larger
+// thresholds give more, smaller clusters - less overdraw but more vertex transforms. The positions
+// are 3 floats at the given offset in each vertex
+void OptimiseOverdraw(uint32_t* indices, unsigned int numIndices, const void* vertices, unsigned int vertexSize,
+                      unsigned int positionOffset, unsigned int numVertices, float threshold = 1.05f);
+
+// Renumber vertices in the order they are first used by the triangles, moving the vertex data to
+// match. Vertices no triangle uses are moved to the end
+void OptimiseVertexFetch(void* vertices, unsigned int vertexSize, unsigned int numVertices, uint32_t* indices, unsigned int numIndices);
+
+
+#endif //_MESH_OPTIMISE_H_INCLUDED_
@@ -0,0 +1,299 @@
+//--------------------------------------------------------------------------------------
+// Mesh simplification for levels of detail
+//--------------------------------------------------------------------------------------
+
+#include "MeshSimplify.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+
+//--------------------------------------------------------------------------------------
+// Quadrics
+//--------------------------------------------------------------------------------------
+
+// Sum of squared distances to a set of planes, weighted by triangle area, as a symmetric 4x4 matrix.
+// For a point p the error is p.A.p + 2 b.p + c. Doubles because the sums of many planes lose
+// precision in floats
+struct Quadric
+{
+    double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+    double b0 = 0, b1 = 0, b2 = 0;
+    double c = 0;
+    double weight = 0; // Total area of the planes, to turn the sum into an average
+
+    Quadric& operator+=(const Quadric& q)
+    {
+        a00 += q.a00;  a01 += q.a01;  a02 += q.a02;  a11 += q.a11;  a12 += q.a12;  a22 += q.a22;
+        b0  += q.b0;   b1  += q.b1;   b2  += q.b2;   c   += q.c;    weight += q.weight;
+        return *this;
+    }
+};
+
+// Add the plane with the given unit normal n through point p, weighted by the given area
+static void AddPlane(Quadric& q, const double n[3], const float p[3], double area)
+{
+    double d = -(n[0] * p[0] + n[1] * p[1] + n[2] * p[2]);
+    q.a00 += area * n[0] * n[0];  q.a01 += area * n[0] * n[1];  q.a02 += area * n[0] * n[2];
+    q.a11 += area * n[1] * n[1];  q.a12 += area * n[1] * n[2];  q.a22 += area * n[2] * n[2];
+    q.b0  += area * n[0] * d;     q.b1  += area * n[1] * d;     q.b2  += area * n[2] * d;
+    q.c   += area * d * d;
+    q.weight += area;
+}
+
+// Average squared distance of point p from the planes of the sum of two quadrics
+static double QuadricError(const Quadric& q1, const Quadric& q2, const float p[3])
+{
+    Quadric q = q1;
+    q += q2;
+    double x = p[0], y = p[1], z = p[2];
+    double error = x * (q.a00 * x + q.a01 * y + q.a02 * z) +
+                   y * (q.a01 * x + q.a11 * y + q.a12 * z) +
+                   z * (q.a02 * x + q.a12 * y + q.a22 * z) +
+                   2 * (q.b0 * x + q.b1 * y + q.b2 * z) + q.c;
+    return q.weight > 0 ? std::max(error, 0.0) / q.weight : 0;
+}
+
+
+// Cross product of (b - a) and (c - a) - the normal of triangle abc scaled by twice its area
+static void TriangleNormal(const float* a, const float* b, const float* c, double n[3])
+{
+    double e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+    double e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+    n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+
+//--------------------------------------------------------------------------------------
+// Locked vertices
+//--------------------------------------------------------------------------------------
+
+// Mark the vertices that must not move: those on a seam, where other vertices share their position,
+// and those on a border edge (used by one triangle) or a non-manifold edge (used by more than two)
+static std::vector<char> FindLockedVertices(const uint32_t* indices, unsigned int numIndices, const void* vertices,
+                                            unsigned int vertexSize, unsigned int positionOffset, unsigned int numVertices)
+{
+    std::vector<char> locked(numVertices, 0);
+    auto position = [&](uint32_t v) { return reinterpret_cast<const float*>(static_cast<const unsigned char*>(vertices) + v * vertexSize + positionOffset); };
+
+    // Sort the vertices by position so vertices sharing a position are next to each other
+    std::vector<uint32_t> byPosition(numVertices);
+    for (uint32_t v = 0; v < numVertices; ++v)  byPosition[v] = v;
+    std::sort(byPosition.begin(), byPosition.end(), [&](uint32_t a, uint32_t b)
+    {
+        return std::lexicographical_compare(position(a), position(a) + 3, position(b), position(b) + 3);
+    });
+    for (uint32_t i = 1; i < numVertices; ++i)
+    {
+        if (std::memcmp(position(byPosition[i - 1]), position(byPosition[i]), 3 * sizeof(float)) == 0)
+        {
+            locked[byPosition[i - 1]] = locked[byPosition[i]] = 1;
+        }
+    }
+
+    // Each edge as its two vertices in a single value, smaller vertex first. After sorting, matching
+    // edges are next to each other
+    std::vector<uint64_t> edges;
+    edges.reserve(numIndices);
+    for (unsigned int i = 0; i < numIndices; i += 3)
+    {
+        for (int corner = 0; corner < 3; ++corner)
+        {
+            uint32_t a = indices[i + corner];
+            uint32_t b = indices[i + (corner + 1) % 3];
+            edges.push_back(a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a);
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    for (size_t i = 0; i < edges.size(); )
+    {
+        size_t end = i + 1;
+        while (end < edges.size() && edges[end] == edges[i])  ++end;
+        if (end - i != 2)
+        {
+            locked[edges[i] >> 32] = locked[edges[i] & 0xffffffff] = 1;
+        }
+        i = end;
+    }
+
+    return locked;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Simplification
+//--------------------------------------------------------------------------------------
+
+// Collapses are rejected if they turn a triangle further than this, as the cosine of the angle
+// between the old and new normals. Stops thin triangles folding over their neighbours
+const double MAX_NORMAL_CHANGE_COS = 0.25;
+
+// Each pass collapses edges in order of cost, up to this many times the cost of the collapse that
+// would reach the target if every collapse succeeded. Stops a pass using expensive collapses when
+// the cheap ones nearby are blocked, they will be cheaper to do in a later pass
+const double PASS_COST_LIMIT_SCALE = 1.5;
+
+// Moving vertex "from" onto vertex "to"
+struct EdgeCollapse
+{
+    uint32_t from;
+    uint32_t to;
+    double   cost;
+};
+
+
+// Simplify a triangle list to each of the given index counts in turn, see header
+std::vector<SimplifiedMesh> SimplifyMesh(const uint32_t* indices, unsigned int numIndices, const void* vertices,
+                                         unsigned int vertexSize, unsigned int positionOffset, unsigned int numVertices,
+                                         const unsigned int* targetNumIndices, unsigned int numTargets)
+{
+    auto position = [&](uint32_t v) { return reinterpret_cast<const float*>(static_cast<const unsigned char*>(vertices) + v * vertexSize + positionOffset); };
+
+    std::vector<uint32_t> triangles(indices, indices + numIndices);
+    std::vector<char> locked = FindLockedVertices(indices, numIndices, vertices, vertexSize, positionOffset, numVertices);
+
+    // Start each vertex with the planes of the triangles using it
+    std::vector<Quadric> quadrics(numVertices);
+    for (unsigned int i = 0; i < numIndices; i += 3)
+    {
+        const float* p[3] = { position(indices[i]), position(indices[i + 1]), position(indices[i + 2]) };
+        double n[3];
+        TriangleNormal(p[0], p[1], p[2], n);
+        double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length == 0)  continue;
+
+        n[0] /= length;  n[1] /= length;  n[2] /= length;
+        Quadric q;
+        AddPlane(q, n, p[0], length * 0.5);
+        for (int corner = 0; corner < 3; ++corner)  quadrics[indices[i + corner]] += q;
+    }
+
+    std::vector<uint32_t> collapseTo(numVertices);
+    std::vector<char> passLocked(numVertices);
+    std::vector<uint32_t> adjacencyStart(numVertices + 1);
+    std::vector<uint32_t> adjacency;
+    std::vector<EdgeCollapse> collapses;
+    double maxCost = 0;
+
+    std::vector<SimplifiedMesh> results;
+    for (unsigned int target = 0; target < numTargets; ++target)
+    {
+        // Collapse edges in passes. Each pass chooses the cheapest collapses that don't touch each other,
+        // then rebuilds the triangle list
+        while (triangles.size() > targetNumIndices[target])
+        {
+            unsigned int numTriangles = static_cast<unsigned int>(triangles.size() / 3);
+
+            // Triangles using each vertex
+            std::fill(adjacencyStart.begin(), adjacencyStart.end(), 0);
+            for (uint32_t v : triangles)  ++adjacencyStart[v + 1];
+            for (unsigned int v = 0; v < numVertices; ++v)  adjacencyStart[v + 1] += adjacencyStart[v];
+            adjacency.resize(triangles.size());
+            {
+                std::vector<uint32_t> next(adjacencyStart.begin(), adjacencyStart.end() - 1);
+                for (unsigned int i = 0; i < triangles.size(); ++i)  adjacency[next[triangles[i]]++] = i / 3;
+            }
+
+            // Cost of each edge, collapsed in whichever direction is cheaper. Each edge is found from
+            // the triangle using it in the order smaller vertex to larger vertex
+            collapses.clear();
+            for (unsigned int i = 0; i < triangles.size(); i += 3)
+            {
+                for (int corner = 0; corner < 3; ++corner)
+                {
+                    uint32_t a = triangles[i + corner];
+                    uint32_t b = triangles[i + (corner + 1) % 3];
+                    if (a > b || (locked[a] && locked[b]))  continue;
+
+                    double costAB = locked[a] ? -1 : QuadricError(quadrics[a], quadrics[b], position(b));
+                    double costBA = locked[b] ? -1 : QuadricError(quadrics[a], quadrics[b], position(a));
+                    if (costBA < 0 || (costAB >= 0 && costAB <= costBA))  collapses.push_back({ a, b, costAB });
+                    else                                                  collapses.push_back({ b, a, costBA });
+                }
+            }
+            if (collapses.empty())  break;
+            std::sort(collapses.begin(), collapses.end(), [](const EdgeCollapse& a, const EdgeCollapse& b) { return a.cost < b.cost; });
+
+            // Most collapses remove two triangles
+            unsigned int trianglesToRemove = numTriangles - targetNumIndices[target] / 3;
+            size_t limitIndex = std::min(collapses.size() - 1, static_cast<size_t>(trianglesToRemove / 2));
+            double costLimit = collapses[limitIndex].cost * PASS_COST_LIMIT_SCALE;
+
+            for (uint32_t v = 0; v < numVertices; ++v)  collapseTo[v] = v;
+            std::fill(passLocked.begin(), passLocked.end(), 0);
+            unsigned int trianglesRemoved = 0;
+            for (const EdgeCollapse& collapse : collapses)
+            {
+                if (trianglesRemoved >= trianglesToRemove || collapse.cost > costLimit)  break;
+                if (passLocked[collapse.from] || passLocked[collapse.to])  continue;
+
+                // Check the triangles that will move don't flip or turn too far
+                const float* to = position(collapse.to);
+                bool valid = true;
+                unsigned int removed = 0;
+                for (uint32_t a = adjacencyStart[collapse.from]; a < adjacencyStart[collapse.from + 1] && valid; ++a)
+                {
+                    const uint32_t* triangle = &triangles[adjacency[a] * 3];
+                    if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+                    {
+                        ++removed;
+                        continue;
+                    }
+
+                    const float* p[3];
+                    const float* moved[3];
+                    for (int corner = 0; corner < 3; ++corner)
+                    {
+                        p[corner] = position(triangle[corner]);
+                        moved[corner] = (triangle[corner] == collapse.from) ? to : p[corner];
+                    }
+                    double before[3], after[3];
+                    TriangleNormal(p[0], p[1], p[2], before);
+                    TriangleNormal(moved[0], moved[1], moved[2], after);
+                    double dot = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+                    double lengths = std::sqrt((before[0] * before[0] + before[1] * before[1] + before[2] * before[2]) *
+                                               (after[0]  * after[0]  + after[1]  * after[1]  + after[2]  * after[2]));
+                    valid = dot > MAX_NORMAL_CHANGE_COS * lengths;
+                }
+                if (!valid)  continue;
+
+                // Collapse, and lock every vertex of the affected triangles for the rest of the pass so
+                // the checks above stay correct
+                collapseTo[collapse.from] = collapse.to;
+                quadrics[collapse.to] += quadrics[collapse.from];
+                for (uint32_t a = adjacencyStart[collapse.from]; a < adjacencyStart[collapse.from + 1]; ++a)
+                {
+                    const uint32_t* triangle = &triangles[adjacency[a] * 3];
+                    passLocked[triangle[0]] = passLocked[triangle[1]] = passLocked[triangle[2]] = 1;
+                }
+                maxCost = std::max(maxCost, collapse.cost);
+                trianglesRemoved += removed;
+            }
+            if (trianglesRemoved == 0)  break;
+
+            // Apply the collapses, dropping triangles that now have two corners on the same vertex
+            size_t numKept = 0;
+            for (size_t i = 0; i < triangles.size(); i += 3)
+            {
+                uint32_t a = collapseTo[triangles[i]];
+                uint32_t b = collapseTo[triangles[i + 1]];
+                uint32_t c = collapseTo[triangles[i + 2]];
+                if (a == b || b == c || c == a)  continue;
+                triangles[numKept++] = a;
+                triangles[numKept++] = b;
+                triangles[numKept++] = c;
+            }
+            triangles.resize(numKept);
+        }
+
+        SimplifiedMesh result;
+        result.indices = triangles;
+        result.error = static_cast<float>(std::sqrt(maxCost));
+        results.push_back(std::move(result));
+    }
+
+    return results;
+}
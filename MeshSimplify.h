@@ -0,0 +1,42 @@
+//--------------------------------------------------------------------------------------
+// Mesh simplification for levels of detail
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+//
+// Builds simpler versions of a triangle list by repeatedly collapsing edges - moving one vertex of
+// an edge onto the other, which removes the two triangles sharing the edge. The edges to collapse
+// are chosen by the quadric error metric (Garland & Heckbert, "Surface simplification using quadric
+// error metrics"): each vertex keeps the planes of the triangles that have merged into it, and an
+// edge costs the squared distance of the new position from those planes.
+//
+// A vertex only ever moves onto another existing vertex, so every level of detail is just a new
+// index list using the original vertices - the levels share the full detail vertex buffer. Vertices
+// on the border of the mesh or on a seam (several vertices at one position with different normals or
+// UVs) never move, so simplifying doesn't open gaps in the mesh or stretch its textures.
+// The import builds the levels for each sub-mesh (see MeshData.cpp) and stores them in the cooked
+// files. Nothing here uses DirectX or Windows.
+
+#ifndef _MESH_SIMPLIFY_H_INCLUDED_
+#define _MESH_SIMPLIFY_H_INCLUDED_
+
+#include <vector>
+#include <cstdint>
+
+
+// One simplified version of a triangle list
+struct SimplifiedMesh
+{
+    std::vector<uint32_t> indices;
+    float                 error = 0; // Estimated model space distance the surface has moved from the original
+};
+
+// Simplify a triangle list (index values less than numVertices, positions are 3 floats at the given
+// offset in each vertex) to each of the given index counts in turn, largest first. Each result
+// continues from the previous one, so they get steadily simpler. A result can have more indices than
+// its target if no more edges could be collapsed, then the remaining results are the same.
+std::vector<SimplifiedMesh> SimplifyMesh(const uint32_t* indices, unsigned int numIndices, const void* vertices,
+                                         unsigned int vertexSize, unsigned int positionOffset, unsigned int numVertices,
+                                         const unsigned int* targetNumIndices, unsigned int numTargets);
+
+
+#endif //_MESH_SIMPLIFY_H_INCLUDED_
@@ -0,0 +1,649 @@
+//--------------------------------------------------------------------------------------
+// Skinning - animating a mesh's vertices with a skeleton on the CPU
+//--------------------------------------------------------------------------------------
+
+#include "MeshSkinning.h"
+#include "SIMD.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+
+//-----------------------------------
+// Building the skin
+//-----------------------------------
+
+// Reduce the bone influences of one vertex to the largest few, quantised to bytes adding up to 255
+void QuantiseSkinWeights(const uint32_t* bones, const float* weights, unsigned int count,
+                         uint8_t outBones[SKIN_WEIGHTS_PER_VERTEX], uint8_t outWeights[SKIN_WEIGHTS_PER_VERTEX])
+{
+    // Indices of the largest weights, largest first
+    unsigned int largest[SKIN_WEIGHTS_PER_VERTEX];
+    unsigned int numKept = 0;
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        if (!(weights[i] > 0))  continue;
+        unsigned int position = numKept;
+        while (position > 0 && weights[largest[position - 1]] < weights[i])  --position;
+        if (position >= SKIN_WEIGHTS_PER_VERTEX)  continue;
+        numKept = std::min(numKept + 1, SKIN_WEIGHTS_PER_VERTEX);
+        for (unsigned int j = numKept - 1; j > position; --j)  largest[j] = largest[j - 1];
+        largest[position] = i;
+    }
+
+    for (unsigned int i = 0; i < SKIN_WEIGHTS_PER_VERTEX; ++i)  outBones[i] = outWeights[i] = 0;
+    if (numKept == 0)
+    {
+        outWeights[0] = 255;
+        return;
+    }
+
+    // Round each weight down then give the rest of the 255 to those that lost most in rounding
+    float total = 0;
+    for (unsigned int i = 0; i < numKept; ++i)  total += weights[largest[i]];
+    float remainders[SKIN_WEIGHTS_PER_VERTEX];
+    unsigned int sum = 0;
+    for (unsigned int i = 0; i < numKept; ++i)
+    {
+        float scaled = std::min(weights[largest[i]] / total * 255.0f, 255.0f);
+        outBones[i]   = static_cast<uint8_t>(bones[largest[i]]);
+        outWeights[i] = static_cast<uint8_t>(scaled);
+        remainders[i] = scaled - outWeights[i];
+        sum += outWeights[i];
+    }
+    for (; sum < 255; ++sum)
+    {
+        unsigned int most = 0;
+        for (unsigned int i = 1; i < numKept; ++i)  if (remainders[i] > remainders[most])  most = i;
+        ++outWeights[most];
+        remainders[most] -= 1.0f;
+    }
+}
+
+
+// Store a matrix in a cooked bone
+static void StoreMatrix(const CMatrix4x4& m, float out[16])
+{
+    std::memcpy(out, &m.e00, sizeof(float) * 16);
+}
+
+// Give a mesh without a skeleton a chain of bones up its Y axis, see header
+void BuildChainSkin(unsigned char* vertices, unsigned int vertexSize, unsigned int numVertices, unsigned int positionOffset,
+                    unsigned int blendIndicesOffset, unsigned int blendWeightsOffset, unsigned int numBones,
+                    std::vector<CookedBone>& bones)
+{
+    numBones = std::max(std::min(numBones, SKIN_MAX_BONES), 1u);
+
+    // The chain runs up the middle of the vertices' bounds
+    float boundsMin[3] = {  3e38f,  3e38f,  3e38f };
+    float boundsMax[3] = { -3e38f, -3e38f, -3e38f };
+    for (unsigned int vertex = 0; vertex < numVertices; ++vertex)
+    {
+        const float* position = reinterpret_cast<const float*>(vertices + static_cast<size_t>(vertex) * vertexSize + positionOffset);
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            boundsMin[axis] = std::min(boundsMin[axis], position[axis]);
+            boundsMax[axis] = std::max(boundsMax[axis], position[axis]);
+        }
+    }
+    if (numVertices == 0)  boundsMin[0] = boundsMin[1] = boundsMin[2] = boundsMax[0] = boundsMax[1] = boundsMax[2] = 0;
+    CVector3 base = { (boundsMin[0] + boundsMax[0]) * 0.5f, boundsMin[1], (boundsMin[2] + boundsMax[2]) * 0.5f };
+    float boneLength = std::max((boundsMax[1] - boundsMin[1]) / numBones, 1e-6f);
+
+    // Each bone starts where its parent ends
+    bones.resize(numBones);
+    for (unsigned int b = 0; b < numBones; ++b)
+    {
+        CookedBone& bone = bones[b];
+        bone = {};
+        std::snprintf(bone.name, sizeof(bone.name), "Chain%u", b);
+        bone.parent = static_cast<int32_t>(b) - 1;
+        CVector3 start = base + CVector3{ 0, boneLength * b, 0 };
+        StoreMatrix(MatrixTranslation(b == 0 ? start : CVector3{ 0, boneLength, 0 }), bone.bindLocal);
+        StoreMatrix(MatrixTranslation(CVector3{ -start.x, -start.y, -start.z }), bone.offset);
+    }
+
+    // Weight each vertex between the two bones whose middles it lies between
+    for (unsigned int vertex = 0; vertex < numVertices; ++vertex)
+    {
+        unsigned char* out = vertices + static_cast<size_t>(vertex) * vertexSize;
+        float height = reinterpret_cast<const float*>(out + positionOffset)[1] - base.y;
+        float along = std::min(std::max(height / boneLength - 0.5f, 0.0f), static_cast<float>(numBones - 1));
+        uint32_t influenceBones[2];
+        influenceBones[0] = std::min(static_cast<uint32_t>(along), numBones - 1);
+        influenceBones[1] = std::min(influenceBones[0] + 1, numBones - 1);
+        float fraction = along - influenceBones[0];
+        float influenceWeights[2] = { 1 - fraction, fraction };
+        QuantiseSkinWeights(influenceBones, influenceWeights, 2, out + blendIndicesOffset, out + blendWeightsOffset);
+    }
+}
+
+
+//-----------------------------------
+// Posing
+//-----------------------------------
+
+CMatrix4x4 BoneBindLocal(const CookedBone& bone)
+{
+    CMatrix4x4 m;
+    std::memcpy(&m.e00, bone.bindLocal, sizeof(bone.bindLocal));
+    return m;
+}
+
+CMatrix4x4 BoneOffset(const CookedBone& bone)
+{
+    CMatrix4x4 m;
+    std::memcpy(&m.e00, bone.offset, sizeof(bone.offset));
+    return m;
+}
+
+
+// Calculate the skin matrix of each bone for a pose, see header
+void CalculateSkinMatrices(const CookedBone* bones, unsigned int numBones, const CMatrix4x4* localMatrices,
+                           CMatrix4x4* skinMatrices, CMatrix4x4* boneMatrices /*= nullptr*/)
+{
+    // Model space transforms are only needed for parents, which always come first. Keep them in the skin
+    // matrix array if the caller doesn't want them, then replace each with the skin matrix afterwards
+    CMatrix4x4* model = boneMatrices ? boneMatrices : skinMatrices;
+    for (unsigned int b = 0; b < numBones; ++b)
+    {
+        int parent = bones[b].parent;
+        if (parent < 0)  model[b] = localMatrices[b];
+        else             MatrixMultiply(localMatrices[b], model[parent], model[b]);
+    }
+    for (unsigned int b = 0; b < numBones; ++b)
+    {
+        MatrixMultiply(BoneOffset(bones[b]), model[b], skinMatrices[b]);
+    }
+}
+
+
+//-----------------------------------
+// Skinning helpers
+//-----------------------------------
+
+// Vertices are skinned in blocks of about this many bytes, small enough that a block stays in the L1 cache
+static const unsigned int SKIN_BLOCK_BYTES = 4096;
+
+// Vertices in each block, a multiple of 4 so every block of the destination has the same 16 byte alignment as the first
+static unsigned int SkinBlockVertices(unsigned int skinnedSize)
+{
+    return std::max((SKIN_BLOCK_BYTES / skinnedSize) & ~3u, 4u);
+}
+
+// The parts of the skinned vertex that are copied unchanged, i.e. all but the transformed x, y and z of the
+// position, normal and tangent. Offsets and sizes are multiples of 4
+struct CopyRanges
+{
+    static const unsigned int MAX_RANGES = 4;
+    unsigned int offset[MAX_RANGES];
+    unsigned int size[MAX_RANGES];
+    unsigned int count = 0;
+};
+
+static CopyRanges SkinCopyRanges(const SkinVertexLayout& layout)
+{
+    unsigned int transformed[3] = { layout.positionOffset, layout.normalOffset, layout.tangentOffset };
+    std::sort(transformed, transformed + 3);
+    CopyRanges ranges;
+    unsigned int start = 0;
+    for (unsigned int i = 0; i <= 3; ++i)
+    {
+        unsigned int end = (i < 3) ? std::min(transformed[i], layout.skinnedSize) : layout.skinnedSize;
+        if (end > start)
+        {
+            ranges.offset[ranges.count] = start;
+            ranges.size[ranges.count]   = end - start;
+            ++ranges.count;
+        }
+        if (i < 3 && transformed[i] != SKIN_NO_ELEMENT)  start = transformed[i] + 12;
+    }
+    return ranges;
+}
+
+// Copy a multiple of 4 bytes
+static inline void CopyWords(unsigned char* out, const unsigned char* in, unsigned int size)
+{
+    for (; size >= 8; size -= 8, in += 8, out += 8)  std::memcpy(out, in, 8);
+    if (size > 0)  std::memcpy(out, in, 4);
+}
+
+
+//-----------------------------------
+// Plain C++ version
+//-----------------------------------
+
+// Skin one vertex - the reference for the SIMD versions, which do the same operations in the same order
+static void SkinVertexPlain(const CMatrix4x4* skinMatrices, const SkinVertexLayout& layout, const unsigned char* in, unsigned char* out)
+{
+    std::memcpy(out, in, layout.skinnedSize);
+
+    // Blend the rows of the vertex's bone matrices, only x, y and z of each row are needed
+    const uint8_t* boneIndices = in + layout.blendIndicesOffset;
+    const uint8_t* boneWeights = in + layout.blendWeightsOffset;
+    const float* m[SKIN_WEIGHTS_PER_VERTEX];
+    float w[SKIN_WEIGHTS_PER_VERTEX];
+    for (unsigned int i = 0; i < SKIN_WEIGHTS_PER_VERTEX; ++i)
+    {
+        m[i] = &skinMatrices[boneIndices[i]].e00;
+        w[i] = static_cast<float>(boneWeights[i]) * (1.0f / 255.0f);
+    }
+    float blend[4][3];
+    for (int row = 0; row < 4; ++row)
+    {
+        for (int column = 0; column < 3; ++column)
+        {
+            int e = row * 4 + column;
+            blend[row][column] = w[0] * m[0][e] + w[1] * m[1][e] + w[2] * m[2][e] + w[3] * m[3][e];
+        }
+    }
+
+    const float* p = reinterpret_cast<const float*>(in + layout.positionOffset);
+    const float* n = reinterpret_cast<const float*>(in + layout.normalOffset);
+    float* pOut = reinterpret_cast<float*>(out + layout.positionOffset);
+    float* nOut = reinterpret_cast<float*>(out + layout.normalOffset);
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        pOut[axis] = p[0] * blend[0][axis] + p[1] * blend[1][axis] + p[2] * blend[2][axis] + blend[3][axis];
+        nOut[axis] = n[0] * blend[0][axis] + n[1] * blend[1][axis] + n[2] * blend[2][axis];
+    }
+    if (layout.tangentOffset != SKIN_NO_ELEMENT)
+    {
+        const float* t = reinterpret_cast<const float*>(in + layout.tangentOffset);
+        float* tOut = reinterpret_cast<float*>(out + layout.tangentOffset);
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            tOut[axis] = t[0] * blend[0][axis] + t[1] * blend[1][axis] + t[2] * blend[2][axis];
+        }
+    }
+}
+
+static void SkinVerticesPlain(const CMatrix4x4* skinMatrices, const SkinVertexLayout& layout, const unsigned char* source,
+                              unsigned char* destination, unsigned int numVertices)
+{
+    for (unsigned int vertex = 0; vertex < numVertices; ++vertex)
+    {
+        SkinVertexPlain(skinMatrices, layout, source + static_cast<size_t>(vertex) * layout.sourceSize,
+                        destination + static_cast<size_t>(vertex) * layout.skinnedSize);
+    }
+}
+
+
+//-----------------------------------
+// SIMD versions
+//-----------------------------------
+
+#if MATH_SIMD_X86
+
+// Write x, y and z of a vector, leaving the 4th float in memory alone
+SIMD_TARGET_SSE41 static inline void StoreXYZ(unsigned char* out, __m128 v)
+{
+    _mm_storel_pi(reinterpret_cast<__m64*>(out), v);
+    _mm_store_ss(reinterpret_cast<float*>(out + 8), _mm_movehl_ps(v, v));
+}
+
+// Write a finished block of vertices from the staging buffer to the destination, with streaming stores
+// if the destination is aligned
+SIMD_TARGET_SSE41 static void WriteBlock(unsigned char* out, const unsigned char* staging, size_t bytes, bool streaming)
+{
+    if (!streaming)
+    {
+        std::memcpy(out, staging, bytes);
+        return;
+    }
+    size_t i = 0;
+    for (; i + 16 <= bytes; i += 16)
+    {
+        _mm_stream_si128(reinterpret_cast<__m128i*>(out + i), _mm_load_si128(reinterpret_cast<const __m128i*>(staging + i)));
+    }
+    std::memcpy(out + i, staging + i, bytes - i);
+}
+
+// Both SIMD versions copy the unchanged parts of each vertex, then write the transformed elements over
+// them. Each source element is read with a 16 byte load, which is safe since the 8 bytes of blend elements
+// come after the skinned vertex. Blocks are built in the destination, or in an aligned staging buffer for
+// streaming stores
+
+// Blend the rows of one vertex's bone matrices (4 floats each, the 4th is ignored)
+SIMD_TARGET_SSE41 static inline void BlendRowsSSE41(const CMatrix4x4* skinMatrices, const unsigned char* in,
+                                                    const SkinVertexLayout& layout, __m128 rows[4])
+{
+    const uint8_t* boneIndices = in + layout.blendIndicesOffset;
+    int packedWeights;
+    std::memcpy(&packedWeights, in + layout.blendWeightsOffset, 4);
+    __m128 weights = _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(packedWeights))), _mm_set1_ps(1.0f / 255.0f));
+    __m128 w0 = _mm_shuffle_ps(weights, weights, _MM_SHUFFLE(0, 0, 0, 0));
+    __m128 w1 = _mm_shuffle_ps(weights, weights, _MM_SHUFFLE(1, 1, 1, 1));
+    __m128 w2 = _mm_shuffle_ps(weights, weights, _MM_SHUFFLE(2, 2, 2, 2));
+    __m128 w3 = _mm_shuffle_ps(weights, weights, _MM_SHUFFLE(3, 3, 3, 3));
+    const float* m0 = &skinMatrices[boneIndices[0]].e00;
+    const float* m1 = &skinMatrices[boneIndices[1]].e00;
+    const float* m2 = &skinMatrices[boneIndices[2]].e00;
+    const float* m3 = &skinMatrices[boneIndices[3]].e00;
+    for (int row = 0; row < 4; ++row)
+    {
+        __m128 blend = _mm_mul_ps(w0, _mm_loadu_ps(m0 + row * 4));
+        blend = _mm_add_ps(blend, _mm_mul_ps(w1, _mm_loadu_ps(m1 + row * 4)));
+        blend = _mm_add_ps(blend, _mm_mul_ps(w2, _mm_loadu_ps(m2 + row * 4)));
+        rows[row] = _mm_add_ps(blend, _mm_mul_ps(w3, _mm_loadu_ps(m3 + row * 4)));
+    }
+}
+
+// Transform a direction (3 floats at in) by blended rows, with the point's translation if rows[3] is given
+SIMD_TARGET_SSE41 static inline __m128 TransformSSE41(const unsigned char* in, const __m128 rows[4], bool point)
+{
+    __m128 v = _mm_loadu_ps(reinterpret_cast<const float*>(in));
+    __m128 result = _mm_mul_ps(_mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0)), rows[0]);
+    result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)), rows[1]));
+    result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2)), rows[2]));
+    return point ? _mm_add_ps(result, rows[3]) : result;
+}
+
+SIMD_TARGET_SSE41 static void SkinVerticesSSE41(const CMatrix4x4* skinMatrices, const SkinVertexLayout& layout,
+                                                const unsigned char* source, unsigned char* destination,
+                                                unsigned int numVertices, bool nonTemporal)
+{
+    CopyRanges copies = SkinCopyRanges(layout);
+    bool hasTangent = layout.tangentOffset != SKIN_NO_ELEMENT;
+    unsigned int blockVertices = SkinBlockVertices(layout.skinnedSize);
+    bool streaming = nonTemporal && (reinterpret_cast<uintptr_t>(destination) & 15) == 0;
+    alignas(16) unsigned char staging[SKIN_BLOCK_BYTES];
+
+    for (unsigned int firstVertex = 0; firstVertex < numVertices; firstVertex += blockVertices)
+    {
+        unsigned int blockCount = std::min(blockVertices, numVertices - firstVertex);
+        const unsigned char* in = source + static_cast<size_t>(firstVertex) * layout.sourceSize;
+        unsigned char* block = destination + static_cast<size_t>(firstVertex) * layout.skinnedSize;
+        unsigned char* out = streaming ? staging : block;
+
+        for (unsigned int v = 0; v < blockCount; ++v, in += layout.sourceSize, out += layout.skinnedSize)
+        {
+            for (unsigned int c = 0; c < copies.count; ++c)  CopyWords(out + copies.offset[c], in + copies.offset[c], copies.size[c]);
+
+            __m128 rows[4];
+            BlendRowsSSE41(skinMatrices, in, layout, rows);
+            StoreXYZ(out + layout.positionOffset, TransformSSE41(in + layout.positionOffset, rows, true));
+            StoreXYZ(out + layout.normalOffset,   TransformSSE41(in + layout.normalOffset,   rows, false));
+            if (hasTangent)  StoreXYZ(out + layout.tangentOffset, TransformSSE41(in + layout.tangentOffset, rows, false));
+        }
+
+        if (streaming)  WriteBlock(block, staging, static_cast<size_t>(blockCount) * layout.skinnedSize, true);
+    }
+
+    // Streaming stores are weakly ordered, make sure they are complete before anything else uses the vertices
+    if (streaming)  _mm_sfence();
+}
+
+
+// Two vertices at a time, one in each 128-bit half of the AVX registers. Loads 8 floats of the matrix
+// rows as two halves, so the blend needs no gathers. No FMA, so results match the plain version exactly
+SIMD_TARGET_AVX2 static inline __m256 LoadPair(const float* a, const float* b)
+{
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(a)), _mm_loadu_ps(b), 1);
+}
+
+SIMD_TARGET_AVX2 static inline void BlendRowsAVX2(const CMatrix4x4* skinMatrices, const unsigned char* inA, const unsigned char* inB,
+                                                  const SkinVertexLayout& layout, __m256 rows[4])
+{
+    const uint8_t* indicesA = inA + layout.blendIndicesOffset;
+    const uint8_t* indicesB = inB + layout.blendIndicesOffset;
+    int packedA, packedB;
+    std::memcpy(&packedA, inA + layout.blendWeightsOffset, 4);
+    std::memcpy(&packedB, inB + layout.blendWeightsOffset, 4);
+    __m256i bytes = _mm256_cvtepu8_epi32(_mm_unpacklo_epi32(_mm_cvtsi32_si128(packedA), _mm_cvtsi32_si128(packedB)));
+    __m256 weights = _mm256_mul_ps(_mm256_cvtepi32_ps(bytes), _mm256_set1_ps(1.0f / 255.0f));
+    __m256 w[4] = { _mm256_permute_ps(weights, _MM_SHUFFLE(0, 0, 0, 0)), _mm256_permute_ps(weights, _MM_SHUFFLE(1, 1, 1, 1)),
+                    _mm256_permute_ps(weights, _MM_SHUFFLE(2, 2, 2, 2)), _mm256_permute_ps(weights, _MM_SHUFFLE(3, 3, 3, 3)) };
+    const float* mA[4];
+    const float* mB[4];
+    for (int i = 0; i < 4; ++i)
+    {
+        mA[i] = &skinMatrices[indicesA[i]].e00;
+        mB[i] = &skinMatrices[indicesB[i]].e00;
+    }
+    for (int row = 0; row < 4; ++row)
+    {
+        __m256 blend = _mm256_mul_ps(w[0], LoadPair(mA[0] + row * 4, mB[0] + row * 4));
+        blend = _mm256_add_ps(blend, _mm256_mul_ps(w[1], LoadPair(mA[1] + row * 4, mB[1] + row * 4)));
+        blend = _mm256_add_ps(blend, _mm256_mul_ps(w[2], LoadPair(mA[2] + row * 4, mB[2] + row * 4)));
+        rows[row] = _mm256_add_ps(blend, _mm256_mul_ps(w[3], LoadPair(mA[3] + row * 4, mB[3] + row * 4)));
+    }
+}
+
+SIMD_TARGET_AVX2 static inline void TransformPairAVX2(const unsigned char* inA, const unsigned char* inB, unsigned char* outA,
+                                                      unsigned char* outB, const __m256 rows[4], bool point)
+{
+    __m256 v = LoadPair(reinterpret_cast<const float*>(inA), reinterpret_cast<const float*>(inB));
+    __m256 result = _mm256_mul_ps(_mm256_permute_ps(v, _MM_SHUFFLE(0, 0, 0, 0)), rows[0]);
+    result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_permute_ps(v, _MM_SHUFFLE(1, 1, 1, 1)), rows[1]));
+    result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_permute_ps(v, _MM_SHUFFLE(2, 2, 2, 2)), rows[2]));
+    if (point)  result = _mm256_add_ps(result, rows[3]);
+    __m128 a = _mm256_castps256_ps128(result);
+    __m128 b = _mm256_extractf128_ps(result, 1);
+    _mm_storel_pi(reinterpret_cast<__m64*>(outA), a);
+    _mm_store_ss(reinterpret_cast<float*>(outA + 8), _mm_movehl_ps(a, a));
+    _mm_storel_pi(reinterpret_cast<__m64*>(outB), b);
+    _mm_store_ss(reinterpret_cast<float*>(outB + 8), _mm_movehl_ps(b, b));
+}
+
+SIMD_TARGET_AVX2 static void SkinVerticesAVX2(const CMatrix4x4* skinMatrices, const SkinVertexLayout& layout,
+                                              const unsigned char* source, unsigned char* destination,
+                                              unsigned int numVertices, bool nonTemporal)
+{
+    CopyRanges copies = SkinCopyRanges(layout);
+    bool hasTangent = layout.tangentOffset != SKIN_NO_ELEMENT;
+    unsigned int blockVertices = SkinBlockVertices(layout.skinnedSize);
+    bool streaming = nonTemporal && (reinterpret_cast<uintptr_t>(destination) & 15) == 0;
+    alignas(16) unsigned char staging[SKIN_BLOCK_BYTES];
+    unsigned int sourceSize = layout.sourceSize, skinnedSize = layout.skinnedSize;
+
+    for (unsigned int firstVertex = 0; firstVertex < numVertices; firstVertex += blockVertices)
+    {
+        unsigned int blockCount = std::min(blockVertices, numVertices - firstVertex);
+        const unsigned char* in = source + static_cast<size_t>(firstVertex) * sourceSize;
+        unsigned char* block = destination + static_cast<size_t>(firstVertex) * skinnedSize;
+        unsigned char* out = streaming ? staging : block;
+
+        unsigned int v = 0;
+        for (; v + 2 <= blockCount; v += 2)
+        {
+            const unsigned char* inA = in + static_cast<size_t>(v) * sourceSize;
+            const unsigned char* inB = inA + sourceSize;
+            unsigned char* outA = out + static_cast<size_t>(v) * skinnedSize;
+            unsigned char* outB = outA + skinnedSize;
+            for (unsigned int c = 0; c < copies.count; ++c)
+            {
+                CopyWords(outA + copies.offset[c], inA + copies.offset[c], copies.size[c]);
+                CopyWords(outB + copies.offset[c], inB + copies.offset[c], copies.size[c]);
+            }
+            __m256 rows[4];
+            BlendRowsAVX2(skinMatrices, inA, inB, layout, rows);
+            TransformPairAVX2(inA + layout.positionOffset, inB + layout.positionOffset, outA + layout.positionOffset,
+                              outB + layout.positionOffset, rows, true);
+            TransformPairAVX2(inA + layout.normalOffset, inB + layout.normalOffset, outA + layout.normalOffset,
+                              outB + layout.normalOffset, rows, false);
+            if (hasTangent)
+            {
+                TransformPairAVX2(inA + layout.tangentOffset, inB + layout.tangentOffset, outA + layout.tangentOffset,
+                                  outB + layout.tangentOffset, rows, false);
+            }
+        }
+        for (; v < blockCount; ++v)
+        {
+            const unsigned char* vertexIn = in + static_cast<size_t>(v) * sourceSize;
+            unsigned char* vertexOut = out + static_cast<size_t>(v) * skinnedSize;
+            for (unsigned int c = 0; c < copies.count; ++c)  CopyWords(vertexOut + copies.offset[c], vertexIn + copies.offset[c], copies.size[c]);
+            __m128 rows[4];
+            BlendRowsSSE41(skinMatrices, vertexIn, layout, rows);
+            StoreXYZ(vertexOut + layout.positionOffset, TransformSSE41(vertexIn + layout.positionOffset, rows, true));
+            StoreXYZ(vertexOut + layout.normalOffset,   TransformSSE41(vertexIn + layout.normalOffset,   rows, false));
+            if (hasTangent)  StoreXYZ(vertexOut + layout.tangentOffset, TransformSSE41(vertexIn + layout.tangentOffset, rows, false));
+        }
+
+        if (streaming)  WriteBlock(block, staging, static_cast<size_t>(blockCount) * skinnedSize, true);
+    }
+
+    if (streaming)  _mm_sfence();
+}
+
+#endif // MATH_SIMD_X86
+
+
+//-----------------------------------
+// Skinning vertices
+//-----------------------------------
+
+// Skin vertices from source to destination, see header
+void SkinVertices(const CMatrix4x4* skinMatrices, const SkinVertexLayout& layout, const void* source, void* destination,
+                  unsigned int numVertices, SkinStores stores /*= SkinStores::Normal*/)
+{
+    const unsigned char* in = static_cast<const unsigned char*>(source);
+    unsigned char* out = static_cast<unsigned char*>(destination);
+
+#if MATH_SIMD_X86
+    // The SIMD versions need a block of at least 4 vertices to fit in their staging buffer
+    SimdLevel level = GetSimdLevel();
+    bool nonTemporal = (stores == SkinStores::NonTemporal);
+    if (layout.skinnedSize * 4 <= SKIN_BLOCK_BYTES)
+    {
+        if (level >= SimdLevel::AVX2)
+        {
+            SkinVerticesAVX2(skinMatrices, layout, in, out, numVertices, nonTemporal);
+            return;
+        }
+        if (level >= SimdLevel::SSE41)
+        {
+            SkinVerticesSSE41(skinMatrices, layout, in, out, numVertices, nonTemporal);
+            return;
+        }
+    }
+#endif
+
+    SkinVerticesPlain(skinMatrices, layout, in, out, numVertices);
+}
+
+
+//-----------------------------------
+// Skinning engine
+//-----------------------------------
+
+// The worker threads and what they share with the thread calling Run
+struct SkinningEngine::Workers
+{
+    std::vector<std::thread>  threads;
+    std::mutex                mutex;
+    std::condition_variable   startRun;   // Signalled when a run starts or the engine is destroyed
+    std::condition_variable   runDone;    // Signalled when the last worker finishes a run
+    unsigned long long        run = 0;    // Increases for each run
+    unsigned int              busy = 0;   // Workers yet to finish the current run
+    bool                      quit = false;
+    std::atomic<unsigned int> nextTask{ 0 };
+};
+
+
+// Start the worker threads, see header
+SkinningEngine::SkinningEngine(unsigned int numThreads /*= 0*/)
+    : mWorkers(new Workers)
+{
+    if (numThreads == 0)  numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    mNumThreads = numThreads;
+
+    Workers& workers = *mWorkers;
+    for (unsigned int t = 1; t < numThreads; ++t)
+    {
+        workers.threads.emplace_back([this, &workers]()
+        {
+            unsigned long long lastRun = 0;
+            for (;;)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(workers.mutex);
+                    workers.startRun.wait(lock, [&]() { return workers.quit || workers.run != lastRun; });
+                    if (workers.quit)  return;
+                    lastRun = workers.run;
+                }
+                DoTasks();
+                std::lock_guard<std::mutex> lock(workers.mutex);
+                if (--workers.busy == 0)  workers.runDone.notify_one();
+            }
+        });
+    }
+}
+
+SkinningEngine::~SkinningEngine()
+{
+    {
+        std::lock_guard<std::mutex> lock(mWorkers->mutex);
+        mWorkers->quit = true;
+    }
+    mWorkers->startRun.notify_all();
+    for (std::thread& thread : mWorkers->threads)  thread.join();
+}
+
+
+// Add a mesh instance to skin in the next Run
+void SkinningEngine::Add(const CMatrix4x4* skinMatrices, const SkinVertexLayout& layout, const void* source, void* destination,
+                         unsigned int numVertices, SkinStores stores /*= SkinStores::Normal*/)
+{
+    unsigned int instance = static_cast<unsigned int>(mInstances.size());
+    mInstances.push_back({ skinMatrices, layout, source, destination, stores });
+    for (unsigned int first = 0; first < numVertices; first += SKIN_VERTICES_PER_TASK)
+    {
+        mTasks.push_back({ instance, first, std::min(SKIN_VERTICES_PER_TASK, numVertices - first) });
+    }
+}
+
+
+// Skin all the instances added since the last Run on all the threads
+unsigned int SkinningEngine::Run()
+{
+    unsigned int numVertices = 0;
+    for (const Task& task : mTasks)  numVertices += task.numVertices;
+
+    // Only wake the workers if there is more than one task for them to share
+    Workers& workers = *mWorkers;
+    workers.nextTask = 0;
+    bool useWorkers = !workers.threads.empty() && mTasks.size() > 1;
+    if (useWorkers)
+    {
+        std::lock_guard<std::mutex> lock(workers.mutex);
+        workers.busy = static_cast<unsigned int>(workers.threads.size());
+        ++workers.run;
+    }
+    if (useWorkers)  workers.startRun.notify_all();
+
+    DoTasks();
+
+    if (useWorkers)
+    {
+        std::unique_lock<std::mutex> lock(workers.mutex);
+        workers.runDone.wait(lock, [&]() { return workers.busy == 0; });
+    }
+
+    mInstances.clear();
+    mTasks.clear();
+    return numVertices;
+}
+
+
+// Do tasks from the current run until there are none left. Tasks are taken in order, so each thread
+// works through a run of vertices that are mostly next to each other
+void SkinningEngine::DoTasks()
+{
+    Workers& workers = *mWorkers;
+    unsigned int numTasks = static_cast<unsigned int>(mTasks.size());
+    for (unsigned int t = workers.nextTask++; t < numTasks; t = workers.nextTask++)
+    {
+        const Task& task = mTasks[t];
+        const Instance& instance = mInstances[task.instance];
+        const unsigned char* in = static_cast<const unsigned char*>(instance.source) + static_cast<size_t>(task.firstVertex) * instance.layout.sourceSize;
+        unsigned char* out = static_cast<unsigned char*>(instance.destination) + static_cast<size_t>(task.firstVertex) * instance.layout.skinnedSize;
+        SkinVertices(instance.skinMatrices, instance.layout, in, out, task.numVertices, instance.stores);
+    }
+}
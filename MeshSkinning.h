@@ -0,0 +1,184 @@
+//--------------------------------------------------------------------------------------
+// Skinning - animating a mesh's vertices with a skeleton on the CPU
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+//
+// A skinned mesh has a skeleton of bones, and each vertex is moved by up to 4 of them. The import
+// (see MeshData.h) keeps the 4 largest bone weights of each vertex, quantised to bytes that add up to
+// 255, in two extra vertex elements at the end of each vertex: "BlendIndices" (4 x uint8 bone indices)
+// and "BlendWeights" (4 x uint8 weights). It also keeps the bind pose - each bone's transform relative
+// to its parent, and the matrix taking mesh space into the bone's space (see CookedBone in CookedMesh.h).
+// Mesh files without a skeleton get a simple chain of bones up the model's Y axis (see BuildChainSkin).
+//
+// To draw a pose, each bone's transform relative to its parent is set (e.g. its bind pose transform
+// with some rotation added), then CalculateSkinMatrices gives one matrix per bone. SkinVertices
+// transforms each vertex's position, normal and tangent by the blend of its bones' matrices (linear
+// blend skinning) and writes the vertex out for the GPU, normally into a dynamic vertex buffer. Normals
+// and tangents are not renormalised, the pixel shaders do that. The skinned vertex is the source vertex
+// without the blend elements, anything else in it (e.g. UVs) is copied unchanged.
+//
+// Skinning works through the vertices in small blocks built in the L1 cache then written out in
+// one pass, as in MeshInterleave.h. With SkinStores::NonTemporal the blocks are written with
+// streaming stores, which suits dynamic vertex buffers (write-combined memory that is never read
+// by the CPU). The SIMD versions are chosen with GetSimdLevel (see Math/SIMD.h) and give
+// bit-identical results to the plain C++ version, which is the reference.
+//
+// A SkinningEngine skins many mesh instances each frame on a pool of worker threads, splitting
+// large meshes so that a few big characters spread over the threads as well as many small ones.
+// Nothing here uses DirectX or Windows.
+
+#ifndef _MESH_SKINNING_H_INCLUDED_
+#define _MESH_SKINNING_H_INCLUDED_
+
+#include "CookedMesh.h"
+#include "CMatrix4x4.h"
+
+#include <cstdint>
+#include <vector>
+#include <memory>
+
+
+// Most bones in one skinned mesh, bone indices are stored in bytes
+const unsigned int SKIN_MAX_BONES = 256;
+
+// Most bones moving one vertex
+const unsigned int SKIN_WEIGHTS_PER_VERTEX = 4;
+
+// Bones in the chain given to meshes without a skeleton, see BuildChainSkin
+const unsigned int SKIN_CHAIN_BONES = 6;
+
+// Marks an element that is not in the vertex, see SkinVertexLayout
+const unsigned int SKIN_NO_ELEMENT = ~0u;
+
+
+//--------------------------------------------------------------------------------------
+// Building the skin
+//--------------------------------------------------------------------------------------
+
+// Reduce the bone influences of one vertex to the SKIN_WEIGHTS_PER_VERTEX largest weights, quantised to
+// bytes that add up to exactly 255. Unused entries get bone 0 with weight 0. A vertex with no influences,
+// or only zero weights, is given bone 0 with the full weight
+void QuantiseSkinWeights(const uint32_t* bones, const float* weights, unsigned int count,
+                         uint8_t outBones[SKIN_WEIGHTS_PER_VERTEX], uint8_t outWeights[SKIN_WEIGHTS_PER_VERTEX]);
+
+// Give a mesh without a skeleton a chain of numBones bones (up to SKIN_MAX_BONES) from the bottom to
+// the top of its vertices along the Y axis, each the parent of the next. Each vertex is weighted
+// between the two bones nearest to it. Writes the bind pose to bones and the blend indices and
+// weights into each vertex at the given offsets. Positions are 3 floats
+void BuildChainSkin(unsigned char* vertices, unsigned int vertexSize, unsigned int numVertices, unsigned int positionOffset,
+                    unsigned int blendIndicesOffset, unsigned int blendWeightsOffset, unsigned int numBones,
+                    std::vector<CookedBone>& bones);
+
+
+//--------------------------------------------------------------------------------------
+// Posing
+//--------------------------------------------------------------------------------------
+
+// Return a bone's bind pose transform relative to its parent, or the matrix from mesh space into
+// its space in the bind pose
+CMatrix4x4 BoneBindLocal(const CookedBone& bone);
+CMatrix4x4 BoneOffset(const CookedBone& bone);
+
+// Calculate the skin matrix of each bone for a pose, given each bone's transform relative to its
+// parent (the bind pose transforms give the bind pose, where every skin matrix is close to identity).
+// Bones come after their parents (as in cooked files). The model space transform of each bone is
+// written to boneMatrices, which may be null if not needed
+void CalculateSkinMatrices(const CookedBone* bones, unsigned int numBones, const CMatrix4x4* localMatrices,
+                           CMatrix4x4* skinMatrices, CMatrix4x4* boneMatrices = nullptr);
+
+
+//--------------------------------------------------------------------------------------
+// Skinning vertices
+//--------------------------------------------------------------------------------------
+
+// Where the skinned elements are in the source vertices. The skinned vertex is the first skinnedSize bytes
+// of the source vertex (so the blend elements must come after it) with the position, normal and tangent
+// transformed. Offsets are in bytes and multiples of 4. Position and normal are 3 floats, the tangent is
+// 4 floats whose 4th value (the bitangent sign) is copied, SKIN_NO_ELEMENT if the vertex has no tangent
+struct SkinVertexLayout
+{
+    unsigned int sourceSize         = 0;
+    unsigned int skinnedSize        = 0;
+    unsigned int positionOffset     = 0;
+    unsigned int normalOffset       = 0;
+    unsigned int tangentOffset      = SKIN_NO_ELEMENT;
+    unsigned int blendIndicesOffset = 0;
+    unsigned int blendWeightsOffset = 0;
+};
+
+// How the skinned vertices are written
+enum class SkinStores
+{
+    Normal,      // Ordinary stores, the vertices end up in the cache
+    NonTemporal, // Streaming stores that bypass the cache, for dynamic vertex buffers. Only used by the SIMD versions
+};
+
+// Skin numVertices vertices from source to destination (which must not overlap) with the given skin
+// matrices, one per bone (see CalculateSkinMatrices). Every blend index must be less than the number
+// of matrices
+void SkinVertices(const CMatrix4x4* skinMatrices, const SkinVertexLayout& layout, const void* source, void* destination,
+                  unsigned int numVertices, SkinStores stores = SkinStores::Normal);
+
+
+//--------------------------------------------------------------------------------------
+// Skinning engine
+//--------------------------------------------------------------------------------------
+
+// Vertices skinned by one task, large meshes are split into tasks of this size so they spread over the threads
+const unsigned int SKIN_VERTICES_PER_TASK = 4096;
+
+// Skins many mesh instances at a time on a pool of worker threads. Add each instance to skin, then Run.
+// Not thread-safe, use from one thread
+class SkinningEngine
+{
+public:
+    // Start the worker threads. The thread calling Run also works, so numThreads - 1 are started.
+    // Pass 0 for one thread per CPU core
+    explicit SkinningEngine(unsigned int numThreads = 0);
+    ~SkinningEngine();
+
+    SkinningEngine(const SkinningEngine&) = delete;
+    SkinningEngine& operator=(const SkinningEngine&) = delete;
+
+    unsigned int NumThreads() const  { return mNumThreads; }
+
+    // Add a mesh instance to skin in the next Run, parameters as for SkinVertices. The matrices, source
+    // and destination must stay valid until Run returns
+    void Add(const CMatrix4x4* skinMatrices, const SkinVertexLayout& layout, const void* source, void* destination,
+             unsigned int numVertices, SkinStores stores = SkinStores::Normal);
+
+    // Skin all the instances added since the last Run, using all the threads. Returns when every vertex
+    // has been written. Returns the number of vertices skinned
+    unsigned int Run();
+
+private:
+    struct Instance
+    {
+        const CMatrix4x4* skinMatrices;
+        SkinVertexLayout  layout;
+        const void*       source;
+        void*             destination;
+        SkinStores        stores;
+    };
+
+    // A run of one instance's vertices
+    struct Task
+    {
+        unsigned int instance;
+        unsigned int firstVertex;
+        unsigned int numVertices;
+    };
+
+    struct Workers;
+
+    // Do tasks from the current run until there are none left
+    void DoTasks();
+
+    unsigned int              mNumThreads = 1;
+    std::vector<Instance>     mInstances;
+    std::vector<Task>         mTasks;
+    std::unique_ptr<Workers>  mWorkers;
+};
+
+
+#endif //_MESH_SKINNING_H_INCLUDED_
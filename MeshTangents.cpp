@@ -0,0 +1,180 @@
+//--------------------------------------------------------------------------------------
+// Tangent generation for normal and parallax mapping
+//--------------------------------------------------------------------------------------
+
+#include "MeshTangents.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <thread>
+#include <vector>
+
+
+//-----------------------------------
+// Helpers
+//-----------------------------------
+
+static inline void Subtract(const float* a, const float* b, float* result)
+{
+    for (int axis = 0; axis < 3; ++axis)  result[axis] = a[axis] - b[axis];
+}
+
+static inline float Dot(const float* a, const float* b)
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static inline void Cross(const float* a, const float* b, float* result)
+{
+    result[0] = a[1] * b[2] - a[2] * b[1];
+    result[1] = a[2] * b[0] - a[0] * b[2];
+    result[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+// Remove the part of v along the unit normal n and normalise what is left. Returns false if nothing is left
+static inline bool ProjectNormalise(float* v, const float* n)
+{
+    float along = Dot(v, n);
+    for (int axis = 0; axis < 3; ++axis)  v[axis] -= n[axis] * along;
+    float length = std::sqrt(Dot(v, v));
+    if (length < 1e-20f)  return false;
+    for (int axis = 0; axis < 3; ++axis)  v[axis] /= length;
+    return true;
+}
+
+// Call work(begin, end) over ranges covering 0 to count, on up to numThreads threads (0 for one per CPU core)
+// with at least minPerThread items each. The calling thread takes the first range
+template <typename Work>
+static void ParallelFor(unsigned int count, unsigned int minPerThread, unsigned int numThreads, Work work)
+{
+    if (numThreads == 0)  numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    numThreads = std::max(std::min(numThreads, count / minPerThread), 1u);
+
+    std::vector<std::thread> threads;
+    for (unsigned int t = 1; t < numThreads; ++t)
+    {
+        unsigned int begin = static_cast<unsigned int>(static_cast<uint64_t>(count) * t / numThreads);
+        unsigned int end   = static_cast<unsigned int>(static_cast<uint64_t>(count) * (t + 1) / numThreads);
+        threads.emplace_back(work, begin, end);
+    }
+    work(0u, static_cast<unsigned int>(static_cast<uint64_t>(count) / numThreads));
+    for (std::thread& thread : threads)  thread.join();
+}
+
+
+//-----------------------------------
+// Tangent generation
+//-----------------------------------
+
+// Calculate the tangents of a triangle list, see header
+void GenerateTangents(const uint32_t* indices, unsigned int numIndices, void* vertices, unsigned int vertexSize,
+                      unsigned int numVertices, unsigned int positionOffset, unsigned int normalOffset,
+                      unsigned int uvOffset, unsigned int tangentOffset, unsigned int numThreads /*= 0*/)
+{
+    unsigned char* vertexData = static_cast<unsigned char*>(vertices);
+    auto element = [&](uint32_t vertex, unsigned int offset)
+    {
+        return reinterpret_cast<float*>(vertexData + static_cast<size_t>(vertex) * vertexSize + offset);
+    };
+
+    // Each corner of each triangle: the triangle's tangent projected onto the corner's normal plane, and
+    // the bitangent sign, both times the angle at the corner. Threads work on separate ranges of triangles
+    struct Corner
+    {
+        float tangent[3];
+        float sign;
+    };
+    std::unique_ptr<Corner[]> corners(new Corner[numIndices]);
+    unsigned int numTriangles = numIndices / 3;
+    ParallelFor(numTriangles, TANGENT_MIN_TRIANGLES_PER_THREAD, numThreads, [&](unsigned int firstTriangle, unsigned int endTriangle)
+    {
+        for (unsigned int triangle = firstTriangle; triangle < endTriangle; ++triangle)
+        {
+            const uint32_t* corner = indices + triangle * 3;
+            const float* p[3] = { element(corner[0], positionOffset), element(corner[1], positionOffset), element(corner[2], positionOffset) };
+            const float* uv[3] = { element(corner[0], uvOffset), element(corner[1], uvOffset), element(corner[2], uvOffset) };
+
+            // Directions of increasing U and V across the triangle (MikkTSpace's vOs and vOt)
+            float d1[3], d2[3];
+            Subtract(p[1], p[0], d1);
+            Subtract(p[2], p[0], d2);
+            float s1 = uv[1][0] - uv[0][0], t1 = uv[1][1] - uv[0][1];
+            float s2 = uv[2][0] - uv[0][0], t2 = uv[2][1] - uv[0][1];
+            float signedArea = s1 * t2 - t1 * s2;
+            float dPdu[3], dPdv[3];
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                dPdu[axis] = (t2 * d1[axis] - t1 * d2[axis]) * (signedArea < 0 ? -1.0f : 1.0f);
+                dPdv[axis] = (s1 * d2[axis] - s2 * d1[axis]) * (signedArea < 0 ? -1.0f : 1.0f);
+            }
+            bool usable = std::abs(signedArea) > 1e-20f;
+
+            for (int c = 0; c < 3; ++c)
+            {
+                Corner& result = corners[triangle * 3 + c];
+                result = { { 0, 0, 0 }, 0 };
+                if (!usable)  continue; // No UV mapping across this triangle, it doesn't affect the tangents
+
+                // Angle of the triangle at this corner, measured in the normal plane
+                const float* n = element(corner[c], normalOffset);
+                float edge1[3], edge2[3];
+                Subtract(p[(c + 1) % 3], p[c], edge1);
+                Subtract(p[(c + 2) % 3], p[c], edge2);
+                float tangent[3] = { dPdu[0], dPdu[1], dPdu[2] };
+                if (!ProjectNormalise(edge1, n) || !ProjectNormalise(edge2, n) || !ProjectNormalise(tangent, n))  continue;
+                float angle = std::acos(std::min(std::max(Dot(edge1, edge2), -1.0f), 1.0f));
+
+                float bitangent[3];
+                Cross(n, tangent, bitangent);
+                float sign = Dot(bitangent, dPdv) < 0 ? -1.0f : 1.0f;
+                for (int axis = 0; axis < 3; ++axis)  result.tangent[axis] = tangent[axis] * angle;
+                result.sign = sign * angle;
+            }
+        }
+    });
+
+    // List the corners of each vertex, in index order
+    std::vector<unsigned int> vertexStart(numVertices + 1, 0);
+    for (unsigned int i = 0; i < numIndices; ++i)  ++vertexStart[indices[i] + 1];
+    for (unsigned int vertex = 0; vertex < numVertices; ++vertex)  vertexStart[vertex + 1] += vertexStart[vertex];
+    std::unique_ptr<unsigned int[]> vertexCorners(new unsigned int[numIndices]);
+    {
+        std::vector<unsigned int> next(vertexStart.begin(), vertexStart.end() - 1);
+        for (unsigned int i = 0; i < numIndices; ++i)  vertexCorners[next[indices[i]]++] = i;
+    }
+
+    // Sum the corners of each vertex. Threads work on separate ranges of vertices
+    unsigned int minVerticesPerThread = std::max(TANGENT_MIN_TRIANGLES_PER_THREAD / 2, 1u);
+    ParallelFor(numVertices, minVerticesPerThread, numThreads, [&](unsigned int firstVertex, unsigned int endVertex)
+    {
+        for (unsigned int vertex = firstVertex; vertex < endVertex; ++vertex)
+        {
+            float sum[3] = { 0, 0, 0 }, sign = 0;
+            for (unsigned int i = vertexStart[vertex]; i < vertexStart[vertex + 1]; ++i)
+            {
+                const Corner& corner = corners[vertexCorners[i]];
+                for (int axis = 0; axis < 3; ++axis)  sum[axis] += corner.tangent[axis];
+                sign += corner.sign;
+            }
+
+            // Corners are all in the normal plane so the sum is too, unless they cancelled out. Without a
+            // usable tangent take the axis furthest from the normal onto the normal plane
+            const float* n = element(vertex, normalOffset);
+            if (!ProjectNormalise(sum, n))
+            {
+                int axis = (std::abs(n[0]) < std::abs(n[1])) ? 0 : 1;
+                if (std::abs(n[2]) < std::abs(n[axis]))  axis = 2;
+                sum[0] = sum[1] = sum[2] = 0;
+                sum[axis] = 1;
+                ProjectNormalise(sum, n);
+            }
+
+            float* tangent = element(vertex, tangentOffset);
+            tangent[0] = sum[0];
+            tangent[1] = sum[1];
+            tangent[2] = sum[2];
+            tangent[3] = sign < 0 ? -1.0f : 1.0f;
+        }
+    });
+}
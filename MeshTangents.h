@@ -0,0 +1,44 @@
+//--------------------------------------------------------------------------------------
+// Tangent generation for normal and parallax mapping
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+//
+// Calculates a tangent for every vertex of a mesh following MikkTSpace (Morten Mikkelsen, the standard
+// used by most texture baking tools), so normal maps baked against it come out as intended:
+//     - Each triangle's tangent is the direction of increasing U across it
+//     - At each corner it is projected onto the plane of the vertex normal, and the vertex tangent is the
+//       sum of its corners weighted by the angle of the triangle at that corner
+//     - The bitangent is not stored. It is the direction of increasing V, which is always the cross
+//       product of normal and tangent times +1 or -1. That sign is packed into the tangent's 4th value
+//       and is -1 where the texture is mirrored
+// The shaders rebuild the bitangent as cross(normal, tangent.xyz) * tangent.w.
+//
+// MikkTSpace splits a vertex shared by triangles whose tangent frames disagree (e.g. across a mirrored
+// UV seam). Here the vertex buffer is already built so vertices are never split, and such a vertex takes
+// the sign of the larger weight of triangles.
+//
+// The triangles and then the vertices are split into ranges processed on separate threads. Each vertex
+// sums its corners in index order, so the result is the same whatever the number of threads.
+// The import uses this instead of assimp's aiProcess_CalcTangentSpace (see MeshData.cpp).
+// Nothing here uses DirectX or Windows.
+
+#ifndef _MESH_TANGENTS_H_INCLUDED_
+#define _MESH_TANGENTS_H_INCLUDED_
+
+#include <cstdint>
+
+
+// Triangles below this many are not worth splitting over threads
+const unsigned int TANGENT_MIN_TRIANGLES_PER_THREAD = 16384;
+
+// Calculate the tangents of a triangle list (index values less than numVertices). Positions and normals
+// are 3 floats and UVs 2 floats at the given offsets in each vertex. The tangent is written as 4 floats at
+// tangentOffset: the unit tangent then the bitangent sign. Vertices not used by any triangle with a usable
+// UV mapping get an arbitrary tangent at right angles to the normal. Uses up to numThreads threads, 0 for
+// one per CPU core
+void GenerateTangents(const uint32_t* indices, unsigned int numIndices, void* vertices, unsigned int vertexSize,
+                      unsigned int numVertices, unsigned int positionOffset, unsigned int normalOffset,
+                      unsigned int uvOffset, unsigned int tangentOffset, unsigned int numThreads = 0);
+
+
+#endif //_MESH_TANGENTS_H_INCLUDED_
@@ -9,19 +9,139 @@
 #include "Common.h"
 #include "GraphicsHelpers.h"
 #include "Mesh.h"
+#include "MathHelpers.h"
+#include <algorithm>
+#include <cmath>
+
+
+// Models draw the simplest level of detail whose error covers no more than this many pixels on screen
+const float LOD_PIXEL_ERROR = 1.0f;
+
+// A model only changes to a simpler level of detail once the error is this fraction of the limit above,
+// so a model close to the switching distance doesn't keep flipping between levels
+const float LOD_HYSTERESIS = 0.75f;
+
+// The mesh's bounding sphere is for its unskinned vertices, skinned models grow it by this factor to
+// cover the poses they are animated into
+const float SKINNED_BOUNDS_MARGIN = 1.5f;
+
+// Likewise for morphed models, to cover the shapes their morph targets make (see MeshMorph.h)
+const float MORPHED_BOUNDS_MARGIN = 1.25f;
+
+ModelView    Model::sView;
+unsigned int Model::sTrianglesRendered[MAX_MODEL_VIEWS] = {};
+unsigned int Model::sTrianglesCulled[MAX_MODEL_VIEWS]   = {};
+unsigned long long Model::sVertexFetchBytes[MAX_MODEL_VIEWS] = {};
+
 
 void Model::Render()
 {
     UpdateWorldMatrix();
+    unsigned int lod = SelectLod();
+
+    // The view frustum in model space, so the mesh's bounds can be tested without transforming them. Skip
+    // the model if the whole mesh is outside
+    Frustum frustum(mWorldMatrix * sView.viewProjectionMatrix);
+    float boundsRadius = mMesh->BoundsRadius() * (mSkinnedVertices ? SKINNED_BOUNDS_MARGIN : (mMorphedVertices ? MORPHED_BOUNDS_MARGIN : 1.0f));
+    if (sView.cullClusters && frustum.TestSphere(mMesh->BoundsCentre(), boundsRadius) == CullResult::Outside)
+    {
+        sTrianglesCulled[sView.id] += mMesh->NumTriangles(lod);
+        return;
+    }
 
     gPerModelConstants.worldMatrix = mWorldMatrix; // Update C++ side constant buffer
+
+    // Let the vertex shader decode the mesh's vertices if they are compressed (see MeshCompression.h)
+    gPerModelConstants.positionOffset    = mMesh->PositionOffset();
+    gPerModelConstants.positionScale     = mMesh->PositionScale();
+    gPerModelConstants.compressedNormals = mMesh->HasCompressedVertices() ? 1 : 0;
     UpdateConstantBuffer(gPerModelConstantBuffer, gPerModelConstants); // Send to GPU
 
     // Indicate that the constant buffer we just updated is for use in the vertex shader (VS) and pixel shader (PS)
     gD3DContext->VSSetConstantBuffers(1, 1, &gPerModelConstantBuffer); // First parameter must match constant buffer number in the shader
     gD3DContext->PSSetConstantBuffers(1, 1, &gPerModelConstantBuffer);
 
-    mMesh->Render();
+    // At full detail only draw the clusters of the mesh that are in view and facing the viewpoint (see MeshClusters.h).
+    // Skinned and morphed models draw their own vertices in every view, including depth-only ones
+    Mesh::Stream stream = sView.positionOnly ? Mesh::Stream::Position : Mesh::Stream::Full;
+    ID3D11Buffer* instanceVertices = mSkinnedVertices ? mSkinnedVertices : mMorphedVertices;
+    if      (mSkinnedVertices)  stream = Mesh::Stream::Skinned;
+    else if (mMorphedVertices)  stream = Mesh::Stream::Morphed;
+    unsigned int numRendered;
+    if (lod == 0 && sView.cullClusters && !instanceVertices)
+    {
+        CMatrix4x4 inverseWorld = InverseAffine(mWorldMatrix);
+        CVector3 viewpoint = inverseWorld.GetXAxis() * sView.position.x + inverseWorld.GetYAxis() * sView.position.y +
+                             inverseWorld.GetZAxis() * sView.position.z + inverseWorld.GetPosition();
+        unsigned int numCulled = mMesh->RenderClusters(frustum, viewpoint, sView.cullBackFacing, stream);
+        sTrianglesCulled[sView.id] += numCulled;
+        numRendered = mMesh->NumTriangles() - numCulled;
+    }
+    else
+    {
+        mMesh->RenderLod(lod, stream, instanceVertices);
+        numRendered = mMesh->NumTriangles(lod);
+    }
+    sTrianglesRendered[sView.id] += numRendered;
+    sVertexFetchBytes[sView.id]  += mMesh->VertexFetchBytes(numRendered, stream);
+}
+
+
+// Set the view that following Render calls draw for, see header
+void Model::SetView(const ModelView& view)
+{
+    sView = view;
+    sView.id = std::min(std::max(view.id, 0), MAX_MODEL_VIEWS - 1);
+}
+
+// Reset the triangle counts and vertex fetch estimates of all views
+void Model::ResetTriangleCounts()
+{
+    for (int i = 0; i < MAX_MODEL_VIEWS; ++i)
+    {
+        sTrianglesRendered[i] = 0;
+        sTrianglesCulled[i]   = 0;
+        sVertexFetchBytes[i]  = 0;
+    }
+}
+
+
+// Add to the triangle counts and vertex fetch estimate of the current view
+void Model::CountTriangles(unsigned int rendered, unsigned int culled, unsigned long long vertexFetchBytes)
+{
+    sTrianglesRendered[sView.id] += rendered;
+    sTrianglesCulled[sView.id]   += culled;
+    sVertexFetchBytes[sView.id]  += vertexFetchBytes;
+}
+
+
+// Choose the mesh's level of detail for the current view. The world matrix must be up to date
+unsigned int Model::SelectLod()
+{
+    unsigned int& current = mLods[sView.id];
+    if (sView.pixelsPerUnit <= 0 || mMesh->NumLods() <= 1)  return current = 0;
+
+    // Distance from the viewpoint to the nearest point of the mesh's bounding sphere
+    CVector3 boundsCentre = mMesh->BoundsCentre();
+    CVector3 centre = mWorldMatrix.GetXAxis() * boundsCentre.x + mWorldMatrix.GetYAxis() * boundsCentre.y +
+                      mWorldMatrix.GetZAxis() * boundsCentre.z + mWorldMatrix.GetPosition();
+    float scale = std::max(std::max(std::abs(mScale.x), std::abs(mScale.y)), std::abs(mScale.z));
+    float distance = Length(centre - sView.position) - mMesh->BoundsRadius() * scale;
+    if (distance <= 0)  return current = 0;
+
+    // Size on screen in pixels of one unit of model space error at that distance
+    float pixelsPerError = sView.pixelsPerUnit * scale / distance;
+
+    // Stay on the current level, or a simpler one, while its error is within the limit. Only take simpler
+    // levels than the current one once they are well within the limit
+    unsigned int lod = 0;
+    for (unsigned int i = 1; i < mMesh->NumLods(); ++i)
+    {
+        float limit = (i > current) ? LOD_PIXEL_ERROR * LOD_HYSTERESIS : LOD_PIXEL_ERROR;
+        if (mMesh->LodError(i) * pixelsPerError > limit)  break;
+        lod = i;
+    }
+    return current = lod;
 }
 
 
@@ -74,7 +194,37 @@ void Model::Control(float frameTime, KeyCode turnUp, KeyCode turnDown, KeyCode t
 }
 
 
+// Turn the model's Z axis to face the given target point, keeping its X axis horizontal. Nothing changes
+// if the target is at the model's position or directly above/below it
+void Model::FaceTarget(CVector3 target)
+{
+    // Same result as CMatrix4x4::FaceTarget followed by GetEulerAngles. Facing a target never needs a
+    // Z rotation, so the X and Y angles can be found directly from the direction to the target
+    CVector3 axisZ = Normalise(target - mPosition);
+    float horizontalLength = std::sqrt(axisZ.x * axisZ.x + axisZ.z * axisZ.z);
+    if (IsZero(Length(axisZ)) || IsZero(horizontalLength)) return;
+
+    mRotation = { std::atan2(-axisZ.y, horizontalLength), std::atan2(axisZ.x, axisZ.z), 0.0f };
+}
+
+
 void Model::UpdateWorldMatrix()
 {
-    mWorldMatrix = MatrixScaling(mScale) * MatrixRotationZ(mRotation.z) * MatrixRotationX(mRotation.x) * MatrixRotationY(mRotation.y) * MatrixTranslation(mPosition);
+    // The world matrix is requested several times a frame (controls, shadow passes, main render), but the
+    // model usually hasn't changed in between
+    if (mWorldMatrixValid && mPosition.x == mWorldMatrixPosition.x && mPosition.y == mWorldMatrixPosition.y && mPosition.z == mWorldMatrixPosition.z &&
+                             mRotation.x == mWorldMatrixRotation.x && mRotation.y == mWorldMatrixRotation.y && mRotation.z == mWorldMatrixRotation.z &&
+                             mScale.x    == mWorldMatrixScale.x    && mScale.y    == mWorldMatrixScale.y    && mScale.z    == mWorldMatrixScale.z)
+    {
+        return;
+    }
+
+    // Same as MatrixScaling(mScale) * MatrixRotationZ(mRotation.z) * MatrixRotationX(mRotation.x) * MatrixRotationY(mRotation.y) * MatrixTranslation(mPosition)
+    // but built directly rather than with four matrix multiplies
+    mWorldMatrix = MatrixTRS(mPosition, mRotation, mScale);
+
+    mWorldMatrixValid = true;
+    mWorldMatrixPosition = mPosition;
+    mWorldMatrixRotation = mRotation;
+    mWorldMatrixScale = mScale;
 }
\ No newline at end of file
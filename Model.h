@@ -7,6 +7,8 @@
 #include "Common.h"
 #include "CVector3.h"
 #include "CMatrix4x4.h"
+#include "Transform.h"
+#include "Frustum.h"
 #include "Input.h"
 
 #ifndef _MODEL_H_INCLUDED_
@@ -14,6 +16,30 @@
 
 class Mesh;
 
+// Number of views that models keep a separate level of detail for, see ModelView
+const int MAX_MODEL_VIEWS = 4;
+
+// A view the scene is drawn for (e.g. the camera, or a light for a shadow map), see Model::SetView.
+// Models choose their level of detail by its size in the view, and skip the parts of their mesh that
+// are outside the view or facing away
+struct ModelView
+{
+    int        id = 0;                 // 0 to MAX_MODEL_VIEWS-1. Models remember the level of detail last drawn in each view
+    CVector3   position = { 0, 0, 0 }; // Viewpoint in world space
+    CMatrix4x4 viewProjectionMatrix;
+
+    // Size in pixels of one unit at a distance of one unit: half the viewport height times the e11 element
+    // of the projection matrix. 0 to always draw full detail
+    float      pixelsPerUnit = 0;
+
+    bool       cullClusters   = true; // Skip mesh clusters outside the view (see MeshClusters.h)...
+    bool       cullBackFacing = true; // ...and those facing away, only if drawing with back face culling
+
+    // Draw from the meshes' position-only vertex stream (see Mesh.h), for depth-only passes whose vertex
+    // shader reads nothing but position
+    bool       positionOnly   = false;
+};
+
 class Model
 {
 public:
@@ -22,27 +48,41 @@ public:
 	//-------------------------------------
 
     Model(Mesh* mesh, CVector3 position = { 0,0,0 }, CVector3 rotation = { 0,0,0 }, float scale = 1)
-        : mMesh(mesh), mPosition(position), mRotation(rotation), mScale({ scale, scale, scale })
+        : mMesh(mesh), mPosition(position), mRotation(rotation), mScale({ scale, scale, scale }), mWorldMatrixValid(false)
     {
     }
 
     // The render function sets the world matrix in the per-frame constant buffer and makes that buffer available
     // to vertex & pixel shader. Then it calls Mesh:Render, which renders the geometry with current GPU settings.
     // So all other per-frame constants must have been set already along with shaders, textures, samplers, states etc.
+    // What is drawn depends on the current view, see SetView
     void Render();
 
 
+    // Set the view that following Render calls draw for. Models draw the simplest level of detail whose error
+    // is no more than about a pixel in the view. At full detail they skip the mesh clusters that are outside
+    // the view or facing away, and models completely outside the view are not drawn at all
+    static void SetView(const ModelView& view);
+    static const ModelView& View()  { return sView; }
+
+    // Triangles drawn and culled by all models in each view since the last reset, and an estimate of the
+    // vertex data the GPU read to draw them (see Mesh::VertexFetchBytes), for reporting
+    static unsigned int       TrianglesRendered(int viewId)  { return sTrianglesRendered[viewId]; }
+    static unsigned int       TrianglesCulled(int viewId)    { return sTrianglesCulled[viewId]; }
+    static unsigned long long VertexFetchBytes(int viewId)   { return sVertexFetchBytes[viewId]; }
+    static void               ResetTriangleCounts();
+
+    // Add to the counts of the current view, for geometry drawn without a model (e.g. a static batch, see StaticBatch.h)
+    static void               CountTriangles(unsigned int rendered, unsigned int culled, unsigned long long vertexFetchBytes);
+
+
 	// Control the model's position and rotation using keys provided. Amount of motion performed depends on frame time
 	void Control( float frameTime, KeyCode turnUp, KeyCode turnDown, KeyCode turnLeft, KeyCode turnRight,  
 				  KeyCode turnCW, KeyCode turnCCW, KeyCode moveForward, KeyCode moveBackward );
 
 
-    void FaceTarget(CVector3 target)
-    {
-        UpdateWorldMatrix();
-        mWorldMatrix.FaceTarget(target);
-        mRotation = mWorldMatrix.GetEulerAngles();
-    }
+    // Turn the model's Z axis to face the given target point, keeping its X axis horizontal
+    void FaceTarget(CVector3 target);
 
 
 	//-------------------------------------
@@ -61,9 +101,29 @@ public:
 	void SetScale   ( CVector3 scale    )  { mScale = scale;       } 
 	void SetScale   ( float scale       )  { mScale = { scale, scale, scale };}
 
+	// Get / set position, rotation and scale together. The rotation is converted to/from the Euler angles used above
+	Transform GetTransform()                    { return { mPosition, QuaternionFromEulerAngles(mRotation), mScale }; }
+	void SetTransform( const Transform& t )     { mPosition = t.position; mRotation = t.rotation.ToEulerAngles(); mScale = t.scale; }
+
 	// Read only access to model world matrix, updated on request
 	CMatrix4x4 WorldMatrix()  { UpdateWorldMatrix();  return mWorldMatrix; }
 
+    Mesh* GetMesh()  { return mMesh; }
+
+    // Flag a model that never moves, so it can be merged into a static batch (see StaticBatch.h). Its position,
+    // rotation and scale must not change once it has been batched
+    void SetStatic(bool isStatic)  { mStatic = isStatic; }
+    bool IsStatic()                { return mStatic; }
+
+    // Draw from this model's own skinned vertices (see Mesh::CreateSkinnedVertexBuffer) in every view, or pass
+    // nullptr to draw the mesh's unskinned vertices. The buffer is not owned by the model. Skinned models
+    // skip cluster culling as the clusters' bounds don't follow the skin
+    void SetSkinnedVertices(ID3D11Buffer* skinnedVertices)  { mSkinnedVertices = skinnedVertices; }
+
+    // Draw from this model's own morphed vertices (see Mesh::CreateMorphedVertexBuffer) in the same way, or pass
+    // nullptr to draw the mesh's own vertices. Skinned vertices are used if both are set
+    void SetMorphedVertices(ID3D11Buffer* morphedVertices)  { mMorphedVertices = morphedVertices; }
+
 
 	//-------------------------------------
 	// Private data / members
@@ -71,7 +131,22 @@ public:
 private:
     void UpdateWorldMatrix();
 
+    // Choose the mesh's level of detail for the current view
+    unsigned int SelectLod();
+
     Mesh* mMesh;
+    ID3D11Buffer* mSkinnedVertices = nullptr;
+    ID3D11Buffer* mMorphedVertices = nullptr;
+    bool mStatic = false;
+
+    // Level of detail last drawn in each view
+    unsigned int mLods[MAX_MODEL_VIEWS] = {};
+
+    // Current view, see SetView
+    static ModelView    sView;
+    static unsigned int sTrianglesRendered[MAX_MODEL_VIEWS];
+    static unsigned int sTrianglesCulled[MAX_MODEL_VIEWS];
+    static unsigned long long sVertexFetchBytes[MAX_MODEL_VIEWS];
 
 	// Position, rotation and scaling for the model
 	CVector3 mPosition;
@@ -80,6 +155,12 @@ private:
 
 	// World matrix for the model - built from the above
 	CMatrix4x4 mWorldMatrix;
+
+	// Values the world matrix was last built from, it is only rebuilt when they change
+	bool     mWorldMatrixValid;
+	CVector3 mWorldMatrixPosition;
+	CVector3 mWorldMatrixRotation;
+	CVector3 mWorldMatrixScale;
 };
 
 
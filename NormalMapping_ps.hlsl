@@ -7,9 +7,10 @@ SamplerState TexSampler : register(s0);
 float4 main(NormalMappingPixelShaderInput input) : SV_Target
 {
     float3 modelNormal = normalize(input.modelNormal);
-    float3 modelTangent = normalize(input.modelTangent);
+    float3 modelTangent = normalize(input.modelTangent.xyz);
 
-    float3 modelBiTangent = cross(modelNormal, modelTangent);
+    // The bitangent is flipped where the texture is mirrored
+    float3 modelBiTangent = cross(modelNormal, modelTangent) * (input.modelTangent.w < 0 ? -1.0f : 1.0f);
     float3x3 invTangentMatrix = float3x3(modelTangent, modelBiTangent, modelNormal);
 
     float3 textureNormal = 2.0f * NormalMap.Sample(TexSampler, input.uv).rgb - 1.0f;
@@ -4,6 +4,8 @@ NormalMappingPixelShaderInput main(TangentVertex modelVertex)
 {
     NormalMappingPixelShaderInput output;
 
+    DecodeVertex(modelVertex); // Decode compressed vertices if the mesh uses them (see Common.hlsli)
+
     float4 modelPosition = float4(modelVertex.position, 1);
     float4 worldPosition = mul(gWorldMatrix, modelPosition);
     float4 viewPosition = mul(gViewMatrix, worldPosition);
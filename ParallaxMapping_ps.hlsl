@@ -19,9 +19,10 @@ SamplerState TexSampler : register(s0); // A sampler is a filter for a texture l
 float4 main(NormalMappingPixelShaderInput input) : SV_Target
 {
     float3 modelNormal = normalize(input.modelNormal);
-    float3 modelTangent = normalize(input.modelTangent);
+    float3 modelTangent = normalize(input.modelTangent.xyz);
 
-    float3 modelBiTangent = cross(modelNormal, modelTangent);
+    // The bitangent is flipped where the texture is mirrored
+    float3 modelBiTangent = cross(modelNormal, modelTangent) * (input.modelTangent.w < 0 ? -1.0f : 1.0f);
     float3x3 invTangentMatrix = float3x3(modelTangent, modelBiTangent, modelNormal);
 	
 
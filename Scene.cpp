@@ -5,6 +5,10 @@
 
 #include "Scene.h"
 #include "Mesh.h"
+#include "MeshCache.h"
+#include "MeshSkinning.h"
+#include "MeshMorph.h"
+#include "StaticBatch.h"
 #include "Model.h"
 #include "Camera.h"
 #include "State.h"
@@ -14,11 +18,19 @@
 #include "CVector2.h" 
 #include "CVector3.h" 
 #include "CMatrix4x4.h"
+#include "MathBatch.h"
 #include "MathHelpers.h"     // Helper functions for maths
+#include "MathHelpersSIMD.h" // Fast sin/cos etc.
 #include "GraphicsHelpers.h" // Helper functions to unclutter the code here
 #include "ColourRGBA.h" 
+#include "StartupLoader.h"
+#include "Timer.h"
 #include <sstream>
+#include <algorithm>
 #include <memory>
+#include <vector>
+#include <cmath>
+#include <cstdio>
 
 //--------------------------------------------------------------------------------------
 // Scene Data
@@ -32,13 +44,15 @@ const float MOVEMENT_SPEED = 50.0f; // 50 units per second for movement (what a
 
 
 // Meshes, models and cameras, same meaning as TL-Engine. Meshes prepared in InitGeometry function, Models & camera in InitScene
-Mesh* gCharacterMesh;
-Mesh* gCrateMesh;
-Mesh* gGroundMesh;
-Mesh* gLightMesh;
-Mesh* gSphereMesh;
-Mesh* gCubeMesh;
-Mesh* gCube2Mesh;
+// Meshes are shared handles from gMeshCache, which makes sure each mesh file is only loaded once
+MeshCache gMeshCache;
+std::shared_ptr<Mesh> gCharacterMesh;
+std::shared_ptr<Mesh> gCrateMesh;
+std::shared_ptr<Mesh> gGroundMesh;
+std::shared_ptr<Mesh> gLightMesh;
+std::shared_ptr<Mesh> gSphereMesh;
+std::shared_ptr<Mesh> gCubeMesh;
+std::shared_ptr<Mesh> gCube2Mesh;
 
 Model* gCharacter;
 Model* gCrate;
@@ -48,9 +62,60 @@ Model* gCubeLerp;
 Model* gCubeParallax;
 Model* gCube3;
 
+// The ground, crate and third cube never move, so are merged into one static batch (see StaticBatch.h)
+std::unique_ptr<StaticBatch> gStaticBatch;
+
 Camera* gCamera;
 
 
+// A crowd of trolls animated by skinning on the CPU (see MeshSkinning.h). Troll.x has no skeleton, so the
+// skinned import gives it a chain of bones up its body, and each troll sways the chain with its own timing.
+// Every frame all the trolls are skinned into their own dynamic vertex buffers on all the CPU cores
+std::shared_ptr<Mesh> gTrollMesh; // Loaded with a skin, so not shared through gMeshCache
+
+const int   NUM_TROLLS_X     = 10;    // Grid of trolls
+const int   NUM_TROLLS_Z     = 10;
+const int   NUM_TROLLS       = NUM_TROLLS_X * NUM_TROLLS_Z;
+const float TROLL_SPACING    = 20.0f;
+const float TROLL_SCALE      = 5.0f;
+const float TROLL_SWAY_ANGLE = 0.25f; // Largest rotation of each bone from its bind pose, in radians
+const float TROLL_SWAY_SPEED = 2.5f;  // Radians per second
+
+struct Troll
+{
+    Model*                  model           = nullptr;
+    ID3D11Buffer*           skinnedVertices = nullptr; // Dynamic vertex buffer rewritten each frame
+    std::vector<CMatrix4x4> skinMatrices;              // One per bone, must last until the skinning engine has run
+    float                   phase           = 0;       // Start of the sway cycle, so the trolls don't move in step
+};
+Troll gTrolls[NUM_TROLLS];
+
+std::unique_ptr<SkinningEngine> gSkinningEngine;
+
+
+// A crowd of blobs changing shape with morph targets (see MeshMorph.h). Each blob eases its targets in and out
+// in turn, with pauses between when nothing changes. Only the parts of a blob's vertices that its changing
+// targets move are rebuilt and uploaded, so a blob costs nothing while it pauses
+std::shared_ptr<Mesh> gBlobMesh; // Loaded with morph targets, so not shared through gMeshCache
+
+const int   NUM_BLOBS_X     = 8;    // Grid of blobs
+const int   NUM_BLOBS_Z     = 8;
+const int   NUM_BLOBS       = NUM_BLOBS_X * NUM_BLOBS_Z;
+const float BLOB_SPACING    = 14.0f;
+const float BLOB_SCALE      = 0.5f;
+const float BLOB_MORPH_TIME = 1.5f; // Seconds to ease a target in and out again
+const float BLOB_PAUSE_TIME = 1.0f; // Seconds between targets
+
+struct Blob
+{
+    Model*                           model           = nullptr;
+    ID3D11Buffer*                    morphedVertices = nullptr; // Updated where the morphed vertices change
+    std::unique_ptr<MorphedVertices> morphed;
+    float                            phase           = 0;       // Start of the cycle of targets, so the blobs don't move in step
+};
+Blob gBlobs[NUM_BLOBS];
+
+
 // Store lights in an array in this exercise
 const int NUM_LIGHTS = 2;
 struct Light
@@ -73,7 +138,12 @@ const float gLightOrbit = 20.0f;
 const float gLightOrbitSpeed = 0.7f;
 
 // Spotlight data - using spotlights in this lab because shadow mapping needs to treat each light as a camera, which is easy with spotlights
-float gSpotlightConeAngle = 90.0f; // Spot light cone angle (degrees), like the FOV (field-of-view) of the spot light
+constexpr float gSpotlightConeAngle = 90.0f; // Spot light cone angle (degrees), like the FOV (field-of-view) of the spot light
+
+// The cone angle is fixed, so the spotlight projection matrix and the cosine used for the cone test in the shaders
+// are calculated at compile time
+constexpr CMatrix4x4 gLightProjectionMatrix = MakeProjectionMatrix(1.0f, ToRadians(gSpotlightConeAngle)); // Helper function in Utility\GraphicsHelpers.h
+constexpr float gSpotlightCosHalfAngle = static_cast<float>(ConstexprCos(ToRadians(gSpotlightConeAngle / 2)));
 const float maxStrength = 90;
 float lightSize = 10;
 float currentRGB[3] = {0, 0,0};
@@ -116,10 +186,22 @@ ID3D11Buffer*     gPerFrameConstantBuffer; // The GPU buffer that will recieve t
 PerModelConstants gPerModelConstants;      // As above, but constant that change per-model (e.g. world matrix)
 ID3D11Buffer*     gPerModelConstantBuffer; // --"--
 
+RenderCounts gRenderCounts;     // Draw calls and constant buffer updates (see Common.h)...
+RenderCounts gShadowPassCounts; // ...made by the two shadow passes together last frame...
+RenderCounts gCameraPassCounts; // ...and by the camera pass, for the stats in the debugger output
+
 float gParallaxDepth = 0.08f;
 bool gUseParallax = true;
 bool spinning = true;
 bool wiggleActive = true;
+bool gUseLods = true;            // Whether models draw simpler levels of detail when far away (see Model::SetView)
+bool gUseClusterCulling = true;  // Whether models skip the parts of their meshes out of view or facing away
+bool gUsePositionStream = true;  // Whether shadow passes draw from the meshes' position-only vertex stream (see Mesh.h)
+bool gShowTrolls = false;        // Whether the crowd of trolls is drawn and animated. Off by default, skinning them takes CPU time every frame
+bool gUseSkinning = true;        // Whether the trolls are animated, otherwise they are drawn in their bind pose
+bool gShowBlobs = false;         // Whether the crowd of blobs is drawn and morphed. Off by default, morphing them takes CPU time and uploads every frame
+bool gUseMorphs = true;          // Whether the blobs change shape, otherwise they are drawn as the mesh's own shape
+bool gUseStaticBatching = true;  // Whether the models that never move are drawn from the static batch, otherwise one by one
 
 //--------------------------------------------------------------------------------------
 // Textures
@@ -155,19 +237,40 @@ ID3D11ShaderResourceView* gCube2NormalHeightMapSRV        = nullptr;
 
 
 //--------------------------------------------------------------------------------------
-// Light Helper Functions
+// Startup timing
 //--------------------------------------------------------------------------------------
 
-// Get "camera-like" view matrix for a spotlight
-CMatrix4x4 CalculateLightViewMatrix(int lightIndex)
+// Times for the startup breakdown reported after the first frame is presented. This timer is started during
+// static initialisation, before wWinMain, so times are in seconds from (close to) the start of the program
+Timer gStartupTimer;
+struct StartupTimes
 {
-    return InverseAffine(gLights[lightIndex].model->WorldMatrix());
-}
+    float geometryStart = 0; // Window and Direct3D setup is done before this
+    float geometryEnd   = 0;
+    float sceneEnd      = 0;
+} gStartupTimes;
+bool gFirstFrame = true;
+
+
+//--------------------------------------------------------------------------------------
+// Light Helper Functions
+//--------------------------------------------------------------------------------------
+
+// "Camera-like" view matrices for each spotlight. Calculated once per frame by CalculateLightMatrices, then used
+// both to render the shadow maps and to render the main scene. All lights share gLightProjectionMatrix
+CMatrix4x4 gLightViewMatrices[NUM_LIGHTS];
 
-// Get "camera-like" projection matrix for a spotlight
-CMatrix4x4 CalculateLightProjectionMatrix(int lightIndex)
+// Calculate the view matrices for all the spotlights
+void CalculateLightMatrices()
 {
-    return MakeProjectionMatrix(1.0f, ToRadians(gSpotlightConeAngle)); // Helper function in Utility\GraphicsHelpers.cpp
+    CMatrix4x4 lightWorldMatrices[NUM_LIGHTS];
+    for (int i = 0; i < NUM_LIGHTS; ++i)
+    {
+        lightWorldMatrices[i] = gLights[i].model->WorldMatrix();
+    }
+
+    // View matrix is the inverse of the light's world matrix, invert them all together
+    InverseAffineMany(lightWorldMatrices, gLightViewMatrices, NUM_LIGHTS);
 }
 
 
@@ -179,30 +282,54 @@ CMatrix4x4 CalculateLightProjectionMatrix(int lightIndex)
 // Returns true on success
 bool InitGeometry()
 {
+    gStartupTimes.geometryStart = gStartupTimer.GetTime();
+
+    // Meshes, shaders and textures are loaded together by a StartupLoader (see StartupLoader.h). It reads and
+    // decodes the files on several threads and creates the DirectX objects on this thread
+    StartupLoader loader;
+
     // Load mesh geometry data, just like TL-Engine this doesn't create anything in the scene. Create a Model for that.
-    // IMPORTANT NOTE: Will only keep the first object from the mesh - multipart objects will have parts missing - see later lab for more robust loader
-    try 
-    {
-        gCharacterMesh = new Mesh("teapot.x", true);
-        gCrateMesh     = new Mesh("CargoContainer.x");
-        gGroundMesh    = new Mesh("Ground.x");
-        gLightMesh     = new Mesh("Light.x");
-		gSphereMesh    = new Mesh("Sphere.x");
-		gCubeMesh      = new Mesh("Cube.x");
-		gCube2Mesh     = new Mesh("Cube.x", true);
-    }
-    catch (std::runtime_error e)  // Constructors cannot return error messages so use exceptions to catch mesh errors (fairly standard approach this)
-    {
-        gLastError = e.what(); // This picks up the error message put in the exception (see Mesh.cpp)
-        return false;
-    }
+    // Requests for the same file share one mesh (see MeshCache.h), so the two cube meshes are one mesh with tangents.
+    // Meshes use the compressed vertex layout (see MeshCompression.h), which roughly halves the vertex data fetched
+    // in each pass, most usefully the shadow map passes. The meshes of the static batch keep their full precision
+    // data for merging (see InitScene)
+    gMeshCache.SetCompressVertices(true);
+    gMeshCache.Request("teapot.x",         true,  &gCharacterMesh);
+    gMeshCache.Request("CargoContainer.x", false, &gCrateMesh,  true);
+    gMeshCache.Request("Ground.x",         false, &gGroundMesh, true);
+    gMeshCache.Request("Light.x",          false, &gLightMesh);
+    gMeshCache.Request("Sphere.x",         false, &gSphereMesh);
+    gMeshCache.Request("Cube.x",           false, &gCubeMesh,   true);
+    gMeshCache.Request("Cube.x",           true,  &gCube2Mesh);
+    gMeshCache.AddToLoader(loader);
+    loader.AddSkinnedMesh("Troll.x", false, &gTrollMesh);
+    loader.AddMorphedMesh("Sphere.x", false, &gBlobMesh); // Shares the cooked file with gSphereMesh (see WriteCookedMesh)
 
     // Load the shaders required for the geometry we will use (see Shader.cpp / .h)
-    if (!LoadShaders())
-    {
-        gLastError = "Error loading shaders";
-        return false;
-    }
+    AddShaders(loader);
+
+    //// Load / prepare textures on the GPU ////
+
+    // Load textures and create DirectX objects for them
+    // AddTexture requires you to pass a ID3D11Resource* (e.g. &gCubeDiffuseMap), which manages the GPU memory for the
+    // texture and also a ID3D11ShaderResourceView* (e.g. &gCubeDiffuseMapSRV), which allows us to use the texture in shaders
+    // The loader will fill in these pointers with usable data. The variables used here are globals found near the top of the file.
+    loader.AddTexture("PatternDiffuseSpecular.dds", &gCharacterDiffuseSpecularMap, &gCharacterDiffuseSpecularMapSRV);
+    loader.AddTexture("PatternNormal.dds",          &gCharacterNormalMap,          &gCharacterNormalMapSRV         );
+    loader.AddTexture("TechDiffuseSpecular.dds",    &gCube2DiffuseSpecularMap,     &gCube2DiffuseSpecularMapSRV    );
+    loader.AddTexture("TechNormalHeight.dds",       &gCube2NormalHeightMap,        &gCube2NormalHeightMapSRV       );
+    loader.AddTexture("Lines.png",                  &gSphereDiffuseSpecularMap,    &gSphereDiffuseSpecularMapSRV   );
+    loader.AddTexture("CargoA.dds",                 &gCrateDiffuseSpecularMap,     &gCrateDiffuseSpecularMapSRV    );
+    loader.AddTexture("GrassDiffuseSpecular.dds",   &gGroundDiffuseSpecularMap,    &gGroundDiffuseSpecularMapSRV   );
+    loader.AddTexture("Flare.jpg",                  &gLightDiffuseMap,             &gLightDiffuseMapSRV            );
+    loader.AddTexture("StoneDiffuseSpecular.dds",   &gCubeTwoDiffuseSpecularMap,   &gCubeTwoDiffuseSpecularMapSRV  );
+    loader.AddTexture("wood2.jpg",                  &gCubeDiffuseSpecularMap,      &gCubeDiffuseSpecularMapSRV     );
+
+    // Errors are reported through gLastError, e.g. the exception message from a mesh that failed to load (see Mesh.cpp)
+    bool loaded = loader.Run();
+    loader.ReportTimes();
+    gMeshCache.ReportUse();
+    if (!loaded)  return false;
 
     // Create GPU-side constant buffers to receive the gPerFrameConstants and gPerModelConstants structures above
     // These allow us to pass data from CPU to shaders such as lighting information or matrices
@@ -215,27 +342,6 @@ bool InitGeometry()
         return false;
     }
 
-    //// Load / prepare textures on the GPU ////
-
-    // Load textures and create DirectX objects for them
-    // The LoadTexture function requires you to pass a ID3D11Resource* (e.g. &gCubeDiffuseMap), which manages the GPU memory for the
-    // texture and also a ID3D11ShaderResourceView* (e.g. &gCubeDiffuseMapSRV), which allows us to use the texture in shaders
-    // The function will fill in these pointers with usable data. The variables used here are globals found near the top of the file.
-    if (!LoadTexture("PatternDiffuseSpecular.dds", &gCharacterDiffuseSpecularMap, &gCharacterDiffuseSpecularMapSRV) ||
-		!LoadTexture("PatternNormal.dds",          &gCharacterNormalMap,          &gCharacterNormalMapSRV         ) ||
-		!LoadTexture("TechDiffuseSpecular.dds",    &gCube2DiffuseSpecularMap,     &gCube2DiffuseSpecularMapSRV    ) ||
-		!LoadTexture("TechNormalHeight.dds",       &gCube2NormalHeightMap,        &gCube2NormalHeightMapSRV       ) ||
-		!LoadTexture("Lines.png",                  &gSphereDiffuseSpecularMap,    &gSphereDiffuseSpecularMapSRV   ) ||
-        !LoadTexture("CargoA.dds",                 &gCrateDiffuseSpecularMap,     &gCrateDiffuseSpecularMapSRV    ) ||
-        !LoadTexture("GrassDiffuseSpecular.dds",   &gGroundDiffuseSpecularMap,    &gGroundDiffuseSpecularMapSRV   ) ||
-        !LoadTexture("Flare.jpg",                  &gLightDiffuseMap,             &gLightDiffuseMapSRV            ) ||
-		!LoadTexture("StoneDiffuseSpecular.dds",   &gCubeTwoDiffuseSpecularMap,   &gCubeTwoDiffuseSpecularMapSRV  ) ||
-		!LoadTexture("wood2.jpg",                  &gCubeDiffuseSpecularMap,      &gCubeDiffuseSpecularMapSRV))
-    {
-        gLastError = "Error loading textures";
-        return false;
-    }
-
 
 
 	//**** Create Shadow Map texture ****//
@@ -310,6 +416,7 @@ bool InitGeometry()
 		return false;
 	}
 
+    gStartupTimes.geometryEnd = gStartupTimer.GetTime();
 	return true;
 }
 
@@ -318,13 +425,13 @@ bool InitGeometry()
 bool InitScene()
 {
     //// Set up scene ////
-    gCharacter = new Model(gCharacterMesh);
-    gCrate     = new Model(gCrateMesh);
-    gGround    = new Model(gGroundMesh);
-	gSphere    = new Model(gSphereMesh);
-	gCubeLerp      = new Model(gCubeMesh);
-	gCubeParallax     = new Model(gCube2Mesh);
-	gCube3     = new Model(gCubeMesh);
+    gCharacter = new Model(gCharacterMesh.get());
+    gCrate     = new Model(gCrateMesh.get());
+    gGround    = new Model(gGroundMesh.get());
+	gSphere    = new Model(gSphereMesh.get());
+	gCubeLerp      = new Model(gCubeMesh.get());
+	gCubeParallax     = new Model(gCube2Mesh.get());
+	gCube3     = new Model(gCubeMesh.get());
 
 	// Initial positions
 	gCharacter->SetPosition({ 15, 0, 0 });
@@ -337,10 +444,74 @@ bool InitScene()
 	gCubeParallax->SetPosition({ -20, 10, -3 });
 	gCube3->SetPosition({ 20, 10, 40 });
 
+    // Merge the models that never move into one static batch. They are drawn with the pixel lighting shader and
+    // a texture each, so the camera pass draws each texture's part of the batch, the shadow passes all of it at once.
+    // The batch isn't compressed, compressed positions would be quantised over the whole 2000x2000 ground
+    gGround->SetStatic(true);
+    gCrate ->SetStatic(true);
+    gCube3 ->SetStatic(true);
+    gStaticBatch = std::make_unique<StaticBatch>();
+    try
+    {
+        gStaticBatch->Add(gGround, { gPixelLightingPixelShader, gGroundDiffuseSpecularMapSRV  });
+        gStaticBatch->Add(gCrate,  { gPixelLightingPixelShader, gCrateDiffuseSpecularMapSRV   });
+        gStaticBatch->Add(gCube3,  { gPixelLightingPixelShader, gCubeTwoDiffuseSpecularMapSRV });
+        gStaticBatch->Build(false);
+    }
+    catch (std::runtime_error& e)
+    {
+        gLastError = e.what();
+        return false;
+    }
+
+    // Trolls in a grid behind the crate, each with its own skinned vertices
+    gSkinningEngine = std::make_unique<SkinningEngine>();
+    for (int i = 0; i < NUM_TROLLS; ++i)
+    {
+        Troll& troll = gTrolls[i];
+        float x = (i % NUM_TROLLS_X - (NUM_TROLLS_X - 1) * 0.5f) * TROLL_SPACING;
+        float z = 120.0f + (i / NUM_TROLLS_X) * TROLL_SPACING;
+        troll.model = new Model(gTrollMesh.get(), { x, 0, z }, { 0, ToRadians(180.0f), 0 }, TROLL_SCALE);
+        troll.skinMatrices.resize(gTrollMesh->NumBones());
+        troll.phase = i * 2.4f;
+        try
+        {
+            troll.skinnedVertices = gTrollMesh->CreateSkinnedVertexBuffer();
+        }
+        catch (std::runtime_error& e)
+        {
+            gLastError = e.what();
+            return false;
+        }
+        troll.model->SetSkinnedVertices(troll.skinnedVertices);
+    }
+
+    // Blobs in a grid to the left of the trolls, each with its own morphed vertices
+    for (int i = 0; i < NUM_BLOBS; ++i)
+    {
+        Blob& blob = gBlobs[i];
+        float x = -200.0f + (i % NUM_BLOBS_X) * BLOB_SPACING;
+        float z = (i / NUM_BLOBS_X) * BLOB_SPACING;
+        blob.model = new Model(gBlobMesh.get(), { x, 10 * BLOB_SCALE, z }, { 0, 0, 0 }, BLOB_SCALE);
+        blob.morphed = std::make_unique<MorphedVertices>(gBlobMesh->MorphTargets(), gBlobMesh->NumMorphTargets(), gBlobMesh->MorphLayout(),
+                                                         gBlobMesh->MorphSourceVertices(), gBlobMesh->NumVertices());
+        blob.phase = i * 0.77f;
+        try
+        {
+            blob.morphedVertices = gBlobMesh->CreateMorphedVertexBuffer();
+        }
+        catch (std::runtime_error& e)
+        {
+            gLastError = e.what();
+            return false;
+        }
+        blob.model->SetMorphedVertices(blob.morphedVertices);
+    }
+
     // Light set-up - using an array this time
     for (int i = 0; i < NUM_LIGHTS; ++i)
     {
-        gLights[i].model = new Model(gLightMesh);
+        gLights[i].model = new Model(gLightMesh.get());
     }
 
     gLights[0].colour = { 0.8f, 0.8f, 1.0f };
@@ -362,6 +533,7 @@ bool InitScene()
     gCamera->SetPosition({ 15, 30,-70 });
     gCamera->SetRotation({ ToRadians(13), 0, 0 });
 
+    gStartupTimes.sceneEnd = gStartupTimer.GetTime();
     return true;
 }
 
@@ -401,6 +573,24 @@ void ReleaseResources()
 
     ReleaseShaders();
 
+    for (Troll& troll : gTrolls)
+    {
+        if (troll.skinnedVertices)  troll.skinnedVertices->Release();
+        troll.skinnedVertices = nullptr;
+        delete troll.model;  troll.model = nullptr;
+    }
+    gSkinningEngine = nullptr;
+
+    for (Blob& blob : gBlobs)
+    {
+        if (blob.morphedVertices)  blob.morphedVertices->Release();
+        blob.morphedVertices = nullptr;
+        blob.morphed = nullptr;
+        delete blob.model;  blob.model = nullptr;
+    }
+
+    gStaticBatch = nullptr;
+
     // See note in InitGeometry about why we're not using unique_ptr and having to manually delete
     for (int i = 0; i < NUM_LIGHTS; ++i)
     {
@@ -415,12 +605,16 @@ void ReleaseResources()
 	delete gCubeParallax;     gCubeParallax     = nullptr;
 	delete gCube3;     gCube3     = nullptr;
 
-    delete gLightMesh;     gLightMesh     = nullptr;
-    delete gGroundMesh;    gGroundMesh    = nullptr;
-    delete gCrateMesh;     gCrateMesh     = nullptr;
-    delete gCharacterMesh; gCharacterMesh = nullptr;
-	delete gSphereMesh;    gSphereMesh    = nullptr;
-	delete gCubeMesh;      gCubeMesh      = nullptr;
+    // Meshes are released when their last handle is released
+    gLightMesh     = nullptr;
+    gGroundMesh    = nullptr;
+    gCrateMesh     = nullptr;
+    gCharacterMesh = nullptr;
+    gSphereMesh    = nullptr;
+    gCubeMesh      = nullptr;
+    gCube2Mesh     = nullptr;
+    gTrollMesh     = nullptr;
+    gBlobMesh      = nullptr;
 }
 
 
@@ -433,8 +627,8 @@ void ReleaseResources()
 void RenderDepthBufferFromLight(int lightIndex)
 {
     // Get camera-like matrices from the spotlight, seet in the constant buffer and send over to GPU
-    gPerFrameConstants.viewMatrix           = CalculateLightViewMatrix(lightIndex);
-    gPerFrameConstants.projectionMatrix     = CalculateLightProjectionMatrix(lightIndex);
+    gPerFrameConstants.viewMatrix           = gLightViewMatrices[lightIndex];
+    gPerFrameConstants.projectionMatrix     = gLightProjectionMatrix;
     gPerFrameConstants.viewProjectionMatrix = gPerFrameConstants.viewMatrix * gPerFrameConstants.projectionMatrix;
 	gPerFrameConstants.parallaxDepth = (gUseParallax ? gParallaxDepth : 0);
     UpdateConstantBuffer(gPerFrameConstantBuffer, gPerFrameConstants);
@@ -443,12 +637,24 @@ void RenderDepthBufferFromLight(int lightIndex)
     gD3DContext->VSSetConstantBuffers(0, 1, &gPerFrameConstantBuffer); // First parameter must match constant buffer number in the shader 
     gD3DContext->PSSetConstantBuffers(0, 1, &gPerFrameConstantBuffer);
 
+    // Models choose levels of detail by their size in the shadow map, and cull against the light's view. Each
+    // light is a separate view from the camera (view 0)
+    ModelView view;
+    view.id                   = 1 + lightIndex;
+    view.position             = gLights[lightIndex].model->Position();
+    view.viewProjectionMatrix = gPerFrameConstants.viewProjectionMatrix;
+    view.pixelsPerUnit        = gUseLods ? gShadowMapSize * 0.5f * gLightProjectionMatrix.e11 : 0.0f;
+    view.cullClusters         = gUseClusterCulling;
+    view.positionOnly         = gUsePositionStream;
+    Model::SetView(view);
+
 
     //// Only render models that cast shadows ////
 
-    // Use special depth-only rendering shaders
-    gD3DContext->VSSetShader(gBasicTransformVertexShader, nullptr, 0);
-    gD3DContext->PSSetShader(gDepthOnlyPixelShader,       nullptr, 0);
+    // Use special depth-only rendering shaders. Drawing from the position-only vertex stream needs a vertex
+    // shader that reads nothing else
+    gD3DContext->VSSetShader(gUsePositionStream ? gDepthOnlyVertexShader : gBasicTransformVertexShader, nullptr, 0);
+    gD3DContext->PSSetShader(gDepthOnlyPixelShader, nullptr, 0);
     
     // States - no blending, normal depth buffer and culling
     gD3DContext->OMSetBlendState(gNoBlendingState, nullptr, 0xffffff);
@@ -456,13 +662,29 @@ void RenderDepthBufferFromLight(int lightIndex)
     gD3DContext->RSSetState(gCullBackState);
 
     // Render models - no state changes required between each object in this situation (no textures used in this step)
-    gGround->Render();
+    // So the static batch is drawn in one go
+    if (gUseStaticBatching)
+    {
+        gStaticBatch->Render();
+    }
+    else
+    {
+        gGround->Render();
+        gCrate->Render();
+        gCube3->Render();
+    }
     gCharacter->Render();
-    gCrate->Render();
 	gSphere->Render();
 	gCubeLerp->Render();
 	gCubeParallax->Render();
-	gCube3->Render();
+    if (gShowTrolls)
+    {
+        for (Troll& troll : gTrolls)  troll.model->Render();
+    }
+    if (gShowBlobs)
+    {
+        for (Blob& blob : gBlobs)  blob.model->Render();
+    }
 }
 
 void RenderSceneFromCamera(Camera* camera)
@@ -477,6 +699,15 @@ void RenderSceneFromCamera(Camera* camera)
     gD3DContext->VSSetConstantBuffers(0, 1, &gPerFrameConstantBuffer); // First parameter must match constant buffer number in the shader 
     gD3DContext->PSSetConstantBuffers(0, 1, &gPerFrameConstantBuffer);
 
+    // Models choose levels of detail by their size on screen, and cull against the camera's view
+    ModelView view;
+    view.id                   = 0;
+    view.position             = camera->Position();
+    view.viewProjectionMatrix = camera->ViewProjectionMatrix();
+    view.pixelsPerUnit        = gUseLods ? gViewportHeight * 0.5f * camera->ProjectionMatrix().e11 : 0.0f;
+    view.cullClusters         = gUseClusterCulling;
+    Model::SetView(view);
+
 
     //// Render lit models ////
 
@@ -489,21 +720,44 @@ void RenderSceneFromCamera(Camera* camera)
     gD3DContext->OMSetDepthStencilState(gUseDepthBufferState, 0);
     gD3DContext->RSSetState(gCullBackState);
 
-    // Select the approriate textures and sampler to use in the pixel shader
-    gD3DContext->PSSetShaderResources(0, 1, &gGroundDiffuseSpecularMapSRV); // First parameter must match texture slot number in the shader
+    // Select the approriate sampler to use in the pixel shader
     gD3DContext->PSSetSamplers(0, 1, &gAnisotropic4xSampler);
 
-    // Render model - it will update the model's world matrix and send it to the GPU in a constant buffer, then it will call
-    // the Mesh render function, which will set up vertex & index buffer before finally calling Draw on the GPU
+    // The static batch sets the texture for each part it draws, all of them use the pixel lighting shader
+    if (gUseStaticBatching)
+    {
+        gStaticBatch->RenderMaterials();
+    }
+    else
+    {
+        // Select the approriate textures to use in the pixel shader
+        gD3DContext->PSSetShaderResources(0, 1, &gGroundDiffuseSpecularMapSRV); // First parameter must match texture slot number in the shader
 
-	gGround->Render();
+        // Render model - it will update the model's world matrix and send it to the GPU in a constant buffer, then it will call
+        // the Mesh render function, which will set up vertex & index buffer before finally calling Draw on the GPU
+        gGround->Render();
 
-    // Render other lit models, only change textures for each onee
-	gD3DContext->PSSetShaderResources(0, 1, &gCrateDiffuseSpecularMapSRV);
-    gCrate->Render();
+        // Render other lit models, only change textures for each onee
+        gD3DContext->PSSetShaderResources(0, 1, &gCrateDiffuseSpecularMapSRV);
+        gCrate->Render();
 
-	gD3DContext->PSSetShaderResources(0, 1, &gCubeTwoDiffuseSpecularMapSRV);
-	gCube3->Render();
+        gD3DContext->PSSetShaderResources(0, 1, &gCubeTwoDiffuseSpecularMapSRV);
+        gCube3->Render();
+    }
+
+    // The trolls draw their skinned vertices, which the pixel lighting shaders read like any other mesh
+    if (gShowTrolls)
+    {
+        gD3DContext->PSSetShaderResources(0, 1, &gCharacterDiffuseSpecularMapSRV);
+        for (Troll& troll : gTrolls)  troll.model->Render();
+    }
+
+    // The blobs draw their morphed vertices in the same way
+    if (gShowBlobs)
+    {
+        gD3DContext->PSSetShaderResources(0, 1, &gSphereDiffuseSpecularMapSRV);
+        for (Blob& blob : gBlobs)  blob.model->Render();
+    }
 
 	gD3DContext->VSSetShader(gNormalMappingVertexShader, nullptr, 0);
 	gD3DContext->PSSetShader(gNormalMappingPixelShader, nullptr, 0);
@@ -522,7 +776,13 @@ void RenderSceneFromCamera(Camera* camera)
 	gD3DContext->VSSetShader(gWiggleVertexShader, nullptr, 0);
 	gD3DContext->PSSetShader(gWigglePixelShader, nullptr, 0);
 	gD3DContext->PSSetShaderResources(0, 1, &gSphereDiffuseSpecularMapSRV);
+
+	// The wiggle moves vertices outside the mesh's cluster bounds, so don't cull the sphere
+	view.cullClusters = false;
+	Model::SetView(view);
 	gSphere->Render();
+	view.cullClusters = gUseClusterCulling;
+	Model::SetView(view);
 
 	gD3DContext->PSSetShader(gLerpPixelShader, nullptr, 0);
 	gD3DContext->PSSetShaderResources(0, 1, &gCubeDiffuseSpecularMapSRV);
@@ -544,7 +804,9 @@ void RenderSceneFromCamera(Camera* camera)
     gD3DContext->OMSetDepthStencilState(gDepthReadOnlyState, 0);
     gD3DContext->RSSetState(gCullNoneState);
 
-    // Render all the lights in the array
+    // Render all the lights in the array. With no culling their back faces are visible too
+    view.cullBackFacing = false;
+    Model::SetView(view);
     for (int i = 0; i < NUM_LIGHTS; ++i)
     {
         gPerModelConstants.objectColour = gLights[i].colour; // Set any per-model constants apart from the world matrix just before calling render (light colour here)
@@ -561,21 +823,26 @@ void RenderScene()
 {
     //// Common settings ////
 
+    // Count the triangles, draw calls and constant buffer updates this frame, shown in the window title and the debugger output
+    Model::ResetTriangleCounts();
+    gRenderCounts = RenderCounts();
+
     // Set up the light information in the constant buffer
     // Don't send to the GPU yet, the function RenderSceneFromCamera will do that
+    CalculateLightMatrices();
     gPerFrameConstants.light1Colour   = gLights[0].colour * gLights[0].strength;
     gPerFrameConstants.light1Position = gLights[0].model->Position();
     gPerFrameConstants.light1Facing   = Normalise(gLights[0].model->WorldMatrix().GetZAxis());    // Additional lighting information for spotlights
-    gPerFrameConstants.light1CosHalfAngle = cos(ToRadians(gSpotlightConeAngle / 2)); // --"--
-    gPerFrameConstants.light1ViewMatrix       = CalculateLightViewMatrix(0);         // Calculate camera-like matrices for...
-    gPerFrameConstants.light1ProjectionMatrix = CalculateLightProjectionMatrix(0);   //...lights to support shadow mapping
+    gPerFrameConstants.light1CosHalfAngle = gSpotlightCosHalfAngle; // --"--
+    gPerFrameConstants.light1ViewMatrix       = gLightViewMatrices[0];         // Camera-like matrices for...
+    gPerFrameConstants.light1ProjectionMatrix = gLightProjectionMatrix;    //...lights to support shadow mapping
 
 	gPerFrameConstants.light2Colour = gLights[1].colour * gLights[1].strength;
 	gPerFrameConstants.light2Position = gLights[1].model->Position();
 	gPerFrameConstants.light2Facing = Normalise(gLights[1].model->WorldMatrix().GetZAxis());    // Additional lighting information for spotlights
-	gPerFrameConstants.light2CosHalfAngle = cos(ToRadians(gSpotlightConeAngle / 2)); // --"--
-	gPerFrameConstants.light2ViewMatrix = CalculateLightViewMatrix(1);         // Calculate camera-like matrices for...
-	gPerFrameConstants.light2ProjectionMatrix = CalculateLightProjectionMatrix(1);   //...lights to support shadow mapping
+	gPerFrameConstants.light2CosHalfAngle = gSpotlightCosHalfAngle; // --"--
+	gPerFrameConstants.light2ViewMatrix = gLightViewMatrices[1];         // Camera-like matrices for...
+	gPerFrameConstants.light2ProjectionMatrix = gLightProjectionMatrix;    //...lights to support shadow mapping
 
     gPerFrameConstants.ambientColour  = gAmbientColour;
     gPerFrameConstants.specularPower  = gSpecularPower;
@@ -610,6 +877,8 @@ void RenderScene()
 
 	// Render the scene from the point of view of light 1 (only depth values written)
 	RenderDepthBufferFromLight(1);
+    gShadowPassCounts = gRenderCounts;
+    gRenderCounts = RenderCounts();
 
 
 
@@ -645,6 +914,7 @@ void RenderScene()
 
     // Render the scene for the main window
     RenderSceneFromCamera(gCamera);
+    gCameraPassCounts = gRenderCounts;
 
     // Unbind shadow maps from shaders - prevents warnings from DirectX when we try to render to the shadow maps again next frame
     ID3D11ShaderResourceView* nullView = nullptr;
@@ -652,6 +922,19 @@ void RenderScene()
 
     // When drawing to the off-screen back buffer is complete, we "present" the image to the front buffer (the screen)
     gSwapChain->Present(0, 0);
+
+    // Report the startup time breakdown once the first frame has been presented
+    if (gFirstFrame)
+    {
+        gFirstFrame = false;
+        float firstFrameTime = gStartupTimer.GetTime();
+        char message[256];
+        std::snprintf(message, sizeof(message), "Startup: window and Direct3D %.1f ms, geometry %.1f ms, scene %.1f ms, first frame %.1f ms - time to first frame %.1f ms\n",
+                  gStartupTimes.geometryStart * 1000, (gStartupTimes.geometryEnd - gStartupTimes.geometryStart) * 1000,
+                  (gStartupTimes.sceneEnd - gStartupTimes.geometryEnd) * 1000, (firstFrameTime - gStartupTimes.sceneEnd) * 1000,
+                  firstFrameTime * 1000);
+        OutputDebugStringA(message);
+    }
 }
 
 
@@ -659,6 +942,80 @@ void RenderScene()
 // Scene Update
 //--------------------------------------------------------------------------------------
 
+// Pose every troll and skin them all into their dynamic vertex buffers (see MeshSkinning.h). Each bone of the
+// chain sways about its start, a little behind its parent. Returns the number of vertices skinned
+unsigned int SkinTrolls(float time)
+{
+    const Mesh& mesh = *gTrollMesh;
+    unsigned int numBones = mesh.NumBones();
+    static std::vector<CMatrix4x4> localMatrices;
+    localMatrices.resize(numBones);
+
+    // Buffers are mapped until the engine has finished writing them, then all unmapped together
+    bool mapped[NUM_TROLLS] = {};
+    for (int i = 0; i < NUM_TROLLS; ++i)
+    {
+        Troll& troll = gTrolls[i];
+        for (unsigned int b = 0; b < numBones; ++b)
+        {
+            float angle = TROLL_SWAY_ANGLE * std::sin(time * TROLL_SWAY_SPEED + troll.phase - b * 0.5f);
+            localMatrices[b] = MatrixRotationZ(angle) * BoneBindLocal(mesh.Bones()[b]);
+        }
+        CalculateSkinMatrices(mesh.Bones(), numBones, localMatrices.data(), troll.skinMatrices.data());
+
+        D3D11_MAPPED_SUBRESOURCE mappedVertices;
+        if (FAILED(gD3DContext->Map(troll.skinnedVertices, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedVertices)))  continue;
+        mapped[i] = true;
+
+        // The mapped memory is write-combined, so write it with streaming stores
+        gSkinningEngine->Add(troll.skinMatrices.data(), mesh.SkinLayout(), mesh.SkinSourceVertices(), mappedVertices.pData,
+                             mesh.NumVertices(), SkinStores::NonTemporal);
+    }
+    unsigned int numVertices = gSkinningEngine->Run();
+
+    for (int i = 0; i < NUM_TROLLS; ++i)
+    {
+        if (mapped[i])  gD3DContext->Unmap(gTrolls[i].skinnedVertices, 0);
+    }
+    return numVertices;
+}
+
+
+// Set the weights of every blob's morph targets and upload the parts of their vertices that changed (see
+// MeshMorph.h). Each blob eases two targets in and out at a time, each then pausing before the next target.
+// Returns the number of deltas added, and the bytes uploaded in uploadedBytes
+unsigned int MorphBlobs(float time, unsigned int& uploadedBytes)
+{
+    const float cycle = BLOB_MORPH_TIME + BLOB_PAUSE_TIME;
+    unsigned int numTargets = gBlobMesh->NumMorphTargets();
+    static std::vector<float> weights;
+    weights.resize(numTargets);
+
+    unsigned int numDeltas = 0;
+    uploadedBytes = 0;
+    for (Blob& blob : gBlobs)
+    {
+        std::fill(weights.begin(), weights.end(), 0.0f);
+        for (unsigned int channel = 0; channel < 2; ++channel)
+        {
+            float t = time * (1.0f + 0.3f * channel) + blob.phase + channel * cycle * 0.5f;
+            float step = std::floor(t / cycle);
+            float into = t - step * cycle;
+            if (into >= BLOB_MORPH_TIME)  continue;
+            unsigned int target = (static_cast<unsigned int>(step) * 2 + channel) % numTargets;
+            float ease = std::sin(PI * into / BLOB_MORPH_TIME);
+            weights[target] = std::max(weights[target], ease * ease);
+        }
+        for (unsigned int target = 0; target < numTargets; ++target)  blob.morphed->SetWeight(target, weights[target]);
+
+        const std::vector<MorphRange>& changed = blob.morphed->Update();
+        uploadedBytes += gBlobMesh->UploadMorphedVertices(blob.morphedVertices, *blob.morphed, changed);
+        numDeltas += blob.morphed->DeltasProcessed();
+    }
+    return numDeltas;
+}
+
+
 // Update models and camera. frameTime is the time passed since the last frame
 void UpdateScene(float frameTime)
 {
@@ -714,7 +1071,7 @@ void UpdateScene(float frameTime)
 	if (spinning == true)
 	{
 		gParallaxDepth = 0.9f;
-		currentRotation.y += 10.0f;
+		currentRotation.y = std::fmod(currentRotation.y + 10.0f, 2 * PI); // Wrapped so the float angle keeps its precision
 		currentRotation.x = 0;
 		currentRotation.z = 0;
 		gCubeParallax->SetRotation(currentRotation);
@@ -727,11 +1084,65 @@ void UpdateScene(float frameTime)
     // Orbit the light
 	static float rotate = 0.0f;
     static bool go = true;
-	gLights[0].model->SetPosition( gCharacter->Position() + CVector3{ cos(rotate) * gLightOrbit, 10, sin(rotate) * gLightOrbit } );
+	float sinRotate, cosRotate;
+	SinCos(rotate, sinRotate, cosRotate);
+	gLights[0].model->SetPosition( gCharacter->Position() + CVector3{ cosRotate * gLightOrbit, 10, sinRotate * gLightOrbit } );
 	gLights[0].model->FaceTarget(gCharacter->Position());
-    if (go)  rotate -= gLightOrbitSpeed * frameTime;
+    if (go)  rotate = std::fmod(rotate - gLightOrbitSpeed * frameTime, 2 * PI); // Wrapped so SinCos takes its fast path for small angles
     if (KeyHit(Key_3))  go = !go;
 
+    // Toggle levels of detail, to compare against full detail
+    if (KeyHit(Key_5))  gUseLods = !gUseLods;
+
+    // Toggle culling of mesh clusters, to compare against drawing whole models
+    if (KeyHit(Key_6))  gUseClusterCulling = !gUseClusterCulling;
+
+    // Toggle the position-only vertex stream in the shadow passes, to compare against the full vertices
+    if (KeyHit(Key_7))  gUsePositionStream = !gUsePositionStream;
+
+    // Show the crowd of trolls, animating them while shown. The skinning is timed for the debugger output,
+    // without skinning they draw their bind pose
+    if (KeyHit(Key_T))  gShowTrolls = !gShowTrolls;
+    if (KeyHit(Key_8))
+    {
+        gUseSkinning = !gUseSkinning;
+        for (Troll& troll : gTrolls)  troll.model->SetSkinnedVertices(gUseSkinning ? troll.skinnedVertices : nullptr);
+    }
+    static float trollTime = 0;
+    static float skinningSeconds = 0;
+    static unsigned long long skinnedVertices = 0;
+    if (gShowTrolls && gUseSkinning)
+    {
+        trollTime += frameTime;
+        Timer skinningTimer;
+        skinnedVertices += SkinTrolls(trollTime);
+        skinningSeconds += skinningTimer.GetTime();
+    }
+
+    // Show the crowd of blobs, changing their shapes while shown. The morphing is timed for the debugger output,
+    // without morphing they draw the mesh's own shape
+    if (KeyHit(Key_B))  gShowBlobs = !gShowBlobs;
+    if (KeyHit(Key_9))
+    {
+        gUseMorphs = !gUseMorphs;
+        for (Blob& blob : gBlobs)  blob.model->SetMorphedVertices(gUseMorphs ? blob.morphedVertices : nullptr);
+    }
+    static float blobTime = 0;
+    static float morphSeconds = 0;
+    static unsigned long long morphDeltas = 0, morphBytes = 0;
+    if (gShowBlobs && gUseMorphs)
+    {
+        blobTime += frameTime;
+        Timer morphTimer;
+        unsigned int uploadedBytes;
+        morphDeltas += MorphBlobs(blobTime, uploadedBytes);
+        morphBytes  += uploadedBytes;
+        morphSeconds += morphTimer.GetTime();
+    }
+
+    // Toggle the static batch, to compare the draw calls and constant buffer updates against drawing each model
+    if (KeyHit(Key_0))  gUseStaticBatching = !gUseStaticBatching;
+
 	// Control camera (will update its view matrix)
 	gCamera->Control(frameTime, Key_Up, Key_Down, Key_Left, Key_Right, Key_W, Key_S, Key_A, Key_D );
 
@@ -750,7 +1161,40 @@ void UpdateScene(float frameTime)
         frameTimeMs.precision(2);
         frameTimeMs << std::fixed << avgFrameTime * 1000;
         std::string windowTitle = "CO2409 Week 20: Shadow Mapping - Frame Time: " + frameTimeMs.str() +
-                                  "ms, FPS: " + std::to_string(static_cast<int>(1 / avgFrameTime + 0.5f));
+                                  "ms, FPS: " + std::to_string(static_cast<int>(1 / avgFrameTime + 0.5f)) +
+                                  ", Triangles: camera " + std::to_string(Model::TrianglesRendered(0)) +
+                                  " (" + std::to_string(Model::TrianglesCulled(0)) + " culled), shadows " +
+                                  std::to_string(Model::TrianglesRendered(1) + Model::TrianglesRendered(2)) +
+                                  " (" + std::to_string(Model::TrianglesCulled(1) + Model::TrianglesCulled(2)) + " culled)" +
+                                  ", Vertex fetch KB: camera " + std::to_string(Model::VertexFetchBytes(0) / 1024) +
+                                  ", shadow 1 " + std::to_string(Model::VertexFetchBytes(1) / 1024) +
+                                  ", shadow 2 " + std::to_string(Model::VertexFetchBytes(2) / 1024) +
+                                  (gUseLods ? "" : ", LODs off") + (gUseClusterCulling ? "" : ", culling off") +
+                                  (gUsePositionStream ? "" : ", full vertices in shadows");
+
+        // Draw counts and timings of the CPU work go to the debugger output, the title is long enough already
+        std::ostringstream stats;
+        stats.precision(2);
+        stats << std::fixed << "Draw calls: shadows " << gShadowPassCounts.drawCalls << ", camera " << gCameraPassCounts.drawCalls
+              << "  CB updates: shadows " << gShadowPassCounts.constantBufferUpdates << ", camera " << gCameraPassCounts.constantBufferUpdates
+              << (gUseStaticBatching ? "  " : " (static batching off)  ");
+        if (gShowTrolls && gUseSkinning && skinnedVertices > 0)
+        {
+            stats << "Skinning: " << skinningSeconds * 1000 / frameCount << "ms (" << skinnedVertices / skinningSeconds / 1e6
+                  << "M vertices/s, " << gSkinningEngine->NumThreads() << " threads)  ";
+        }
+        if (gShowBlobs && gUseMorphs)
+        {
+            stats << "Morphs: " << morphSeconds * 1000 / frameCount << "ms (" << morphDeltas / frameCount << " deltas, "
+                  << morphBytes / frameCount / 1024 << "KB uploaded per frame)  ";
+        }
+        stats << "\n";
+        OutputDebugStringA(stats.str().c_str());
+        skinningSeconds = 0;
+        skinnedVertices = 0;
+        morphSeconds = 0;
+        morphDeltas = 0;
+        morphBytes = 0;
         SetWindowTextA(gHWnd, windowTitle.c_str());
         totalFrameTime = 0;
         frameCount = 0;
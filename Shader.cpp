@@ -4,6 +4,7 @@
 //--------------------------------------------------------------------------------------
 
 #include "Shader.h"
+#include "StartupLoader.h"
 #include <fstream>
 #include <vector>
 #include <d3dcompiler.h>
@@ -20,6 +21,7 @@ ID3D11PixelShader*  gPixelLightingPixelShader    = nullptr;
 ID3D11VertexShader* gBasicTransformVertexShader  = nullptr; // Used before light model and depth-only pixel shader
 ID3D11PixelShader*  gLightModelPixelShader       = nullptr;
 ID3D11PixelShader*  gDepthOnlyPixelShader        = nullptr;
+ID3D11VertexShader* gDepthOnlyVertexShader       = nullptr; // Draws from meshes' position-only stream, see Mesh.h
 ID3D11VertexShader* gWiggleVertexShader          = nullptr;
 ID3D11PixelShader*  gWigglePixelShader           = nullptr;
 ID3D11PixelShader*  gLerpPixelShader             = nullptr;
@@ -32,42 +34,39 @@ ID3D11PixelShader*  gNormalMappingPixelShader     = nullptr;
 // Shader creation / destruction
 //--------------------------------------------------------------------------------------
 
-// Load shaders required for this app, returns true on success
-bool LoadShaders()
+// Add the shaders required for this app to the given loader. They are loaded when the loader is run
+void AddShaders(StartupLoader& loader)
 {
     // Shaders must be added to the Visual Studio project to be compiled, they use the extension ".hlsl".
     // To load them for use, include them here without the extension. Use the correct function for each.
     // Ensure you release the shaders in the ShutdownDirect3D function below
-    gPixelLightingVertexShader   = LoadVertexShader("ShadowMapping_vs");
-    gPixelLightingPixelShader    = LoadPixelShader ("ShadowMapping_ps");
-    gBasicTransformVertexShader  = LoadVertexShader("BasicTransform_vs");
-    gLightModelPixelShader       = LoadPixelShader ("LightModel_ps");
-    gDepthOnlyPixelShader        = LoadPixelShader ("DepthOnly_ps");
-	gWiggleVertexShader          = LoadVertexShader("Wiggle_vs");
-	gWigglePixelShader           = LoadPixelShader("Wiggle_ps");
-	gLerpPixelShader             = LoadPixelShader("Lerp_ps");
-	gParallaxMappingVertexShader = LoadVertexShader("ParallaxMapping_vs");
-	gParallaxMappingPixelShader  = LoadPixelShader("ParallaxMapping_ps");
-	gNormalMappingVertexShader   = LoadVertexShader("NormalMapping_vs");
-	gNormalMappingPixelShader    = LoadPixelShader("NormalMapping_ps");
-
-    if (gPixelLightingVertexShader   == nullptr || gPixelLightingPixelShader   == nullptr ||
-        gBasicTransformVertexShader  == nullptr || gLightModelPixelShader      == nullptr || 
-		gDepthOnlyPixelShader        == nullptr || gWigglePixelShader          == nullptr ||
-		gParallaxMappingVertexShader == nullptr || gParallaxMappingPixelShader == nullptr ||
-		gNormalMappingPixelShader    == nullptr || gNormalMappingVertexShader  == nullptr ||
-		gWiggleVertexShader          == nullptr || gLerpPixelShader            == nullptr)
-    {
-        gLastError = "Error loading shaders";
-        return false;
-    }
+    loader.AddVertexShader("ShadowMapping_vs",   &gPixelLightingVertexShader);
+    loader.AddPixelShader ("ShadowMapping_ps",   &gPixelLightingPixelShader);
+    loader.AddVertexShader("BasicTransform_vs",  &gBasicTransformVertexShader);
+    loader.AddPixelShader ("LightModel_ps",      &gLightModelPixelShader);
+    loader.AddPixelShader ("DepthOnly_ps",       &gDepthOnlyPixelShader);
+    loader.AddVertexShader("DepthOnly_vs",       &gDepthOnlyVertexShader);
+    loader.AddVertexShader("Wiggle_vs",          &gWiggleVertexShader);
+    loader.AddPixelShader ("Wiggle_ps",          &gWigglePixelShader);
+    loader.AddPixelShader ("Lerp_ps",            &gLerpPixelShader);
+    loader.AddVertexShader("ParallaxMapping_vs", &gParallaxMappingVertexShader);
+    loader.AddPixelShader ("ParallaxMapping_ps", &gParallaxMappingPixelShader);
+    loader.AddVertexShader("NormalMapping_vs",   &gNormalMappingVertexShader);
+    loader.AddPixelShader ("NormalMapping_ps",   &gNormalMappingPixelShader);
+}
 
-    return true;
+// Load shaders required for this app, returns true on success
+bool LoadShaders()
+{
+    StartupLoader loader;
+    AddShaders(loader);
+    return loader.Run(); // Sets gLastError on failure
 }
 
 
 void ReleaseShaders()
 {
+    if (gDepthOnlyVertexShader)       gDepthOnlyVertexShader->Release();
     if (gDepthOnlyPixelShader)        gDepthOnlyPixelShader->Release();
     if (gLightModelPixelShader)       gLightModelPixelShader->Release();
     if (gBasicTransformVertexShader)  gBasicTransformVertexShader->Release();
@@ -82,28 +81,32 @@ void ReleaseShaders()
 	if (gNormalMappingVertexShader)   gNormalMappingVertexShader->Release();
 }
 
-// Load a vertex shader, include the file in the project and pass the name (without the .hlsl extension)
-// to this function. The returned pointer needs to be released before quitting. Returns nullptr on failure. 
-ID3D11VertexShader* LoadVertexShader(std::string shaderName)
+// Read a compiled shader file into memory, pass the name without the .hlsl extension. Returns false on failure
+bool ReadShaderFile(const std::string& shaderName, std::vector<char>& byteCode)
 {
     // Open compiled shader object file
     std::ifstream shaderFile(shaderName + ".cso", std::ios::in | std::ios::binary | std::ios::ate);
     if (!shaderFile.is_open())
     {
-        return nullptr;
+        return false;
     }
 
     // Read file into vector of chars
     std::streamoff fileSize = shaderFile.tellg();
-    shaderFile.seekg(0, std::ios::beg);
-    std::vector<char> byteCode(fileSize);
-    shaderFile.read(&byteCode[0], fileSize);
-    if (shaderFile.fail())
+    if (fileSize <= 0)
     {
-        return nullptr;
+        return false;
     }
+    shaderFile.seekg(0, std::ios::beg);
+    byteCode.resize(static_cast<size_t>(fileSize));
+    shaderFile.read(&byteCode[0], fileSize);
+    return !shaderFile.fail();
+}
 
-    // Create shader object from loaded file (we will use the object later when rendering)
+
+// Create shader objects from compiled shader code. Returns nullptr on failure
+ID3D11VertexShader* CreateVertexShader(const std::vector<char>& byteCode)
+{
     ID3D11VertexShader* shader;
     HRESULT hr = gD3DDevice->CreateVertexShader(byteCode.data(), byteCode.size(), nullptr, &shader);
     if (FAILED(hr))
@@ -114,34 +117,41 @@ ID3D11VertexShader* LoadVertexShader(std::string shaderName)
     return shader;
 }
 
-ID3D11PixelShader* LoadPixelShader(std::string shaderName)
+ID3D11PixelShader* CreatePixelShader(const std::vector<char>& byteCode)
 {
-    // Open compiled shader object file
-    std::ifstream shaderFile(shaderName + ".cso", std::ios::in | std::ios::binary | std::ios::ate);
-    if (!shaderFile.is_open())
+    ID3D11PixelShader* shader;
+    HRESULT hr = gD3DDevice->CreatePixelShader(byteCode.data(), byteCode.size(), nullptr, &shader);
+    if (FAILED(hr))
     {
         return nullptr;
     }
 
-    // Read file into vector of chars
-    std::streamoff fileSize = shaderFile.tellg();
-    shaderFile.seekg(0, std::ios::beg);
-    std::vector<char>byteCode(fileSize);
-    shaderFile.read(&byteCode[0], fileSize);
-    if (shaderFile.fail())
+    return shader;
+}
+
+
+// Load a vertex shader, include the file in the project and pass the name (without the .hlsl extension)
+// to this function. The returned pointer needs to be released before quitting. Returns nullptr on failure. 
+ID3D11VertexShader* LoadVertexShader(std::string shaderName)
+{
+    // Create shader object from loaded file (we will use the object later when rendering)
+    std::vector<char> byteCode;
+    if (!ReadShaderFile(shaderName, byteCode))
     {
         return nullptr;
     }
+    return CreateVertexShader(byteCode);
+}
 
+ID3D11PixelShader* LoadPixelShader(std::string shaderName)
+{
     // Create shader object from loaded file (we will use the object later when rendering)
-    ID3D11PixelShader* shader;
-    HRESULT hr = gD3DDevice->CreatePixelShader(byteCode.data(), byteCode.size(), nullptr, &shader);
-    if (FAILED(hr))
+    std::vector<char> byteCode;
+    if (!ReadShaderFile(shaderName, byteCode))
     {
         return nullptr;
     }
-
-    return shader;
+    return CreatePixelShader(byteCode);
 }
 
 ID3DBlob* CreateSignatureForVertexLayout(const D3D11_INPUT_ELEMENT_DESC vertexLayout[], int numElements)
@@ -155,6 +165,12 @@ ID3DBlob* CreateSignatureForVertexLayout(const D3D11_INPUT_ELEMENT_DESC vertexLa
         else if (format == DXGI_FORMAT_R32G32B32_FLOAT)    shaderSource += "float3";
         else if (format == DXGI_FORMAT_R32G32_FLOAT)       shaderSource += "float2";
         else if (format == DXGI_FORMAT_R32_FLOAT)          shaderSource += "float";
+        else if (format == DXGI_FORMAT_R16G16B16A16_UNORM) shaderSource += "float4"; // Compressed formats, see MeshCompression.h
+        else if (format == DXGI_FORMAT_R16G16B16A16_SNORM) shaderSource += "float4";
+        else if (format == DXGI_FORMAT_R16G16_SNORM)       shaderSource += "float2";
+        else if (format == DXGI_FORMAT_R16G16_FLOAT)       shaderSource += "float2";
+        else if (format == DXGI_FORMAT_R8G8B8A8_UNORM)     shaderSource += "float4"; // Skinning blend elements, see MeshSkinning.h
+        else if (format == DXGI_FORMAT_R8G8B8A8_UINT)      shaderSource += "uint4";
         else return nullptr; // Unsupported type in layout
 
         uint8_t index = static_cast<uint8_t>(vertexLayout[elt].SemanticIndex);
@@ -6,6 +6,10 @@
 #define _SHADER_H_INCLUDED_
 
 #include "Common.h"
+#include <string>
+#include <vector>
+
+class StartupLoader;
 
 //--------------------------------------------------------------------------------------
 // Global Variables
@@ -16,6 +20,7 @@ extern ID3D11PixelShader*  gPixelLightingPixelShader;
 extern ID3D11VertexShader* gBasicTransformVertexShader;
 extern ID3D11PixelShader*  gLightModelPixelShader;
 extern ID3D11PixelShader*  gDepthOnlyPixelShader;
+extern ID3D11VertexShader* gDepthOnlyVertexShader;
 extern ID3D11VertexShader* gWiggleVertexShader;
 extern ID3D11PixelShader*  gWigglePixelShader;
 extern ID3D11PixelShader*  gLerpPixelShader;
@@ -31,6 +36,10 @@ extern ID3D11PixelShader*  gNormalMappingPixelShader;
 // Load shaders required for this app, returns true on success
 bool LoadShaders();
 
+// Add the shaders required for this app to the given loader instead, to load them along with other
+// assets (see StartupLoader.h). They are loaded when the loader is run
+void AddShaders(StartupLoader& loader);
+
 // Release shaders used by the app
 void ReleaseShaders();
 
@@ -52,6 +61,12 @@ ID3D11Buffer* CreateConstantBuffer(int size);
 ID3D11VertexShader* LoadVertexShader(std::string shaderName);
 ID3D11PixelShader*  LoadPixelShader (std::string shaderName);
 
+// The two halves of the functions above. Reading the file doesn't use the device so can be done on any
+// thread. ReadShaderFile returns false on failure, the create functions return nullptr on failure
+bool ReadShaderFile(const std::string& shaderName, std::vector<char>& byteCode);
+ID3D11VertexShader* CreateVertexShader(const std::vector<char>& byteCode);
+ID3D11PixelShader*  CreatePixelShader (const std::vector<char>& byteCode);
+
 // Helper function. Returns nullptr on failure.
 ID3DBlob* CreateSignatureForVertexLayout(const D3D11_INPUT_ELEMENT_DESC vertexLayout[], int numElements);
 
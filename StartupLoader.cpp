@@ -0,0 +1,366 @@
+//--------------------------------------------------------------------------------------
+// Loading meshes, textures and shaders at startup using several threads
+//--------------------------------------------------------------------------------------
+
+#include "StartupLoader.h"
+#include "Mesh.h"
+#include "Shader.h"
+#include "GraphicsHelpers.h"
+#include "Timer.h"
+
+#include <wincodec.h>
+#include <atlbase.h> // CComPtr
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+
+//--------------------------------------------------------------------------------------
+// Texture loading helpers
+//--------------------------------------------------------------------------------------
+
+// Read a whole file into memory, returns false on failure
+static bool ReadFileBytes(const std::string& fileName, std::vector<uint8_t>& data)
+{
+    std::ifstream file(fileName, std::ios::in | std::ios::binary | std::ios::ate);
+    if (!file.is_open())  return false;
+
+    std::streamoff fileSize = file.tellg();
+    if (fileSize <= 0)  return false;
+    file.seekg(0, std::ios::beg);
+    data.resize(static_cast<size_t>(fileSize));
+    file.read(reinterpret_cast<char*>(data.data()), fileSize);
+    return !file.fail();
+}
+
+// Return true if the file name has a .dds extension (case insensitive)
+static bool IsDDSFile(const std::string& fileName)
+{
+    std::string dds = ".dds";
+    return fileName.size() >= 4 &&
+           std::equal(dds.rbegin(), dds.rend(), fileName.rbegin(), [](unsigned char a, unsigned char b) { return std::tolower(a) == std::tolower(b); });
+}
+
+
+// An image file (png, jpg etc.) decoded to 32-bit RGBA pixels
+struct DecodedImage
+{
+    UINT                 width  = 0;
+    UINT                 height = 0;
+    std::vector<uint8_t> pixels;
+};
+
+// Decode an image file held in memory using the Windows Imaging Component (WIC), which is what
+// DirectXTK uses to load these files. COM must be initialised on the calling thread
+static bool DecodeImage(const std::vector<uint8_t>& fileData, DecodedImage& image)
+{
+    CComPtr<IWICImagingFactory> factory;
+    if (FAILED(CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory))))  return false;
+
+    CComPtr<IWICStream> stream;
+    if (FAILED(factory->CreateStream(&stream)) ||
+        FAILED(stream->InitializeFromMemory(const_cast<BYTE*>(fileData.data()), static_cast<DWORD>(fileData.size()))))  return false;
+
+    CComPtr<IWICBitmapDecoder> decoder;
+    CComPtr<IWICBitmapFrameDecode> frame;
+    if (FAILED(factory->CreateDecoderFromStream(stream, nullptr, WICDecodeMetadataCacheOnDemand, &decoder)) ||
+        FAILED(decoder->GetFrame(0, &frame)))  return false;
+
+    CComPtr<IWICFormatConverter> converter;
+    if (FAILED(factory->CreateFormatConverter(&converter)) ||
+        FAILED(converter->Initialize(frame, GUID_WICPixelFormat32bppRGBA, WICBitmapDitherTypeNone, nullptr, 0.0, WICBitmapPaletteTypeCustom)) ||
+        FAILED(converter->GetSize(&image.width, &image.height)))  return false;
+
+    image.pixels.resize(static_cast<size_t>(image.width) * image.height * 4);
+    return SUCCEEDED(converter->CopyPixels(nullptr, image.width * 4, static_cast<UINT>(image.pixels.size()), image.pixels.data()));
+}
+
+// Create a texture with a full set of mip-maps from a decoded image. The mip-maps are generated on
+// the GPU as DirectXTK does when given a context. Returns false on failure
+static bool CreateTextureFromImage(const DecodedImage& image, ID3D11Resource** texture, ID3D11ShaderResourceView** textureSRV)
+{
+    D3D11_TEXTURE2D_DESC textureDesc = {};
+    textureDesc.Width  = image.width;
+    textureDesc.Height = image.height;
+    textureDesc.MipLevels = 0; // 0 means a full set of mip-maps
+    textureDesc.ArraySize = 1;
+    textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    textureDesc.SampleDesc.Count = 1;
+    textureDesc.SampleDesc.Quality = 0;
+    textureDesc.Usage = D3D11_USAGE_DEFAULT;
+    textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET; // Render target needed to generate mip-maps
+    textureDesc.CPUAccessFlags = 0;
+    textureDesc.MiscFlags = D3D11_RESOURCE_MISC_GENERATE_MIPS;
+
+    ID3D11Texture2D* newTexture = nullptr;
+    if (FAILED(gD3DDevice->CreateTexture2D(&textureDesc, nullptr, &newTexture)))  return false;
+
+    ID3D11ShaderResourceView* newSRV = nullptr;
+    if (FAILED(gD3DDevice->CreateShaderResourceView(newTexture, nullptr, &newSRV)))
+    {
+        newTexture->Release();
+        return false;
+    }
+
+    gD3DContext->UpdateSubresource(newTexture, 0, nullptr, image.pixels.data(), image.width * 4, 0);
+    gD3DContext->GenerateMips(newSRV);
+
+    *texture    = newTexture;
+    *textureSRV = newSRV;
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Adding assets
+//--------------------------------------------------------------------------------------
+
+void StartupLoader::Add(const std::string& name, std::function<void()> load, std::function<void()> create)
+{
+    std::unique_ptr<Asset> asset = std::make_unique<Asset>();
+    asset->name   = name;
+    asset->load   = std::move(load);
+    asset->create = std::move(create);
+    mAssets.push_back(std::move(asset));
+}
+
+
+void StartupLoader::AddMesh(const std::string& fileName, bool requireTangents, bool compressVertices, std::shared_ptr<Mesh>* mesh,
+                            bool keepPreparedData /*= false*/)
+{
+    AddMesh(fileName, requireTangents, compressVertices, [mesh](std::shared_ptr<Mesh> newMesh) { *mesh = std::move(newMesh); },
+            keepPreparedData);
+}
+
+void StartupLoader::AddMesh(const std::string& fileName, bool requireTangents, bool compressVertices,
+                            std::function<void(std::shared_ptr<Mesh>)> created, bool keepPreparedData /*= false*/)
+{
+    auto prepared = std::make_shared<PreparedMesh>();
+    Add(fileName, [=]() { *prepared = PrepareMesh(fileName, requireTangents, compressVertices); },
+                  [=]()
+                  {
+                      std::shared_ptr<Mesh> mesh;
+                      if (keepPreparedData)
+                      {
+                          mesh = std::make_shared<Mesh>(prepared); // The mesh shares the prepared data
+                      }
+                      else
+                      {
+                          mesh = std::make_shared<Mesh>(*prepared);
+                          *prepared = PreparedMesh(); // Release the CPU-side data or cooked file mapping now the GPU buffers exist
+                      }
+                      created(std::move(mesh));
+                  });
+}
+
+void StartupLoader::AddSkinnedMesh(const std::string& fileName, bool requireTangents, std::shared_ptr<Mesh>* mesh)
+{
+    auto prepared = std::make_shared<PreparedMesh>();
+    Add(fileName, [=]() { *prepared = PrepareMesh(fileName, requireTangents, false, true); },
+                  [=]()
+                  {
+                      *mesh = std::make_shared<Mesh>(*prepared);
+                      *prepared = PreparedMesh(); // The mesh keeps its own copy of the vertices for skinning
+                  });
+}
+
+void StartupLoader::AddMorphedMesh(const std::string& fileName, bool requireTangents, std::shared_ptr<Mesh>* mesh)
+{
+    auto prepared = std::make_shared<PreparedMesh>();
+    Add(fileName, [=]() { *prepared = PrepareMesh(fileName, requireTangents, false, false, true); },
+                  [=]()
+                  {
+                      *mesh = std::make_shared<Mesh>(*prepared);
+                      *prepared = PreparedMesh(); // The mesh keeps its own copy of the vertices and targets
+                  });
+}
+
+
+void StartupLoader::AddTexture(const std::string& fileName, ID3D11Resource** texture, ID3D11ShaderResourceView** textureSRV)
+{
+    // DDS files hold data ready for the GPU so only need reading. Other files are decoded after reading
+    struct TextureData
+    {
+        std::vector<uint8_t> fileData;
+        DecodedImage         image;
+    };
+    auto data = std::make_shared<TextureData>();
+    bool isDDS = IsDDSFile(fileName);
+
+    Add(fileName, [=]()
+                  {
+                      if (!ReadFileBytes(fileName, data->fileData) || (!isDDS && !DecodeImage(data->fileData, data->image)))
+                      {
+                          throw std::runtime_error("Error loading texture " + fileName);
+                      }
+                  },
+                  [=]()
+                  {
+                      bool created = isDDS ? SUCCEEDED(DirectX::CreateDDSTextureFromMemory(gD3DDevice, data->fileData.data(), data->fileData.size(),
+                                                                                           texture, textureSRV))
+                                           : CreateTextureFromImage(data->image, texture, textureSRV);
+                      *data = TextureData();
+                      if (!created)  throw std::runtime_error("Error loading texture " + fileName);
+                  });
+}
+
+
+void StartupLoader::AddVertexShader(const std::string& shaderName, ID3D11VertexShader** shader)
+{
+    auto byteCode = std::make_shared<std::vector<char>>();
+    Add(shaderName, [=]()
+                    {
+                        if (!ReadShaderFile(shaderName, *byteCode))  throw std::runtime_error("Error loading shader " + shaderName);
+                    },
+                    [=]()
+                    {
+                        *shader = CreateVertexShader(*byteCode);
+                        if (*shader == nullptr)  throw std::runtime_error("Error loading shader " + shaderName);
+                    });
+}
+
+void StartupLoader::AddPixelShader(const std::string& shaderName, ID3D11PixelShader** shader)
+{
+    auto byteCode = std::make_shared<std::vector<char>>();
+    Add(shaderName, [=]()
+                    {
+                        if (!ReadShaderFile(shaderName, *byteCode))  throw std::runtime_error("Error loading shader " + shaderName);
+                    },
+                    [=]()
+                    {
+                        *shader = CreatePixelShader(*byteCode);
+                        if (*shader == nullptr)  throw std::runtime_error("Error loading shader " + shaderName);
+                    });
+}
+
+
+//--------------------------------------------------------------------------------------
+// Loading
+//--------------------------------------------------------------------------------------
+
+// Load all the assets added. Returns false on failure and sets gLastError
+bool StartupLoader::Run()
+{
+    Timer totalTimer;
+    mWaitSeconds = 0;
+    if (mAssets.empty())  return true;
+
+    // Worker threads take the next asset that hasn't been started until none are left, or until the
+    // calling thread finds a failure and sets the stop flag
+    std::mutex              mutex;
+    std::condition_variable loadedCondition;
+    std::atomic<size_t>     nextAsset(0);
+    std::atomic<bool>       stop(false);
+
+    int numThreads = static_cast<int>(std::thread::hardware_concurrency());
+    mNumWorkers = std::max(1, std::min(numThreads, static_cast<int>(mAssets.size())));
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < mNumWorkers; ++i)
+    {
+        workers.emplace_back([&]()
+        {
+            // Image decoding uses COM
+            HRESULT comResult = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+            for (size_t index = nextAsset++; index < mAssets.size() && !stop; index = nextAsset++)
+            {
+                Asset& asset = *mAssets[index];
+                Timer loadTimer;
+                std::string error;
+                try
+                {
+                    asset.load();
+                }
+                catch (const std::exception& e)
+                {
+                    error = e.what();
+                }
+                catch (...)
+                {
+                    error = "Error loading " + asset.name;
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    asset.loaded      = true;
+                    asset.error       = error;
+                    asset.loadSeconds = loadTimer.GetTime();
+                }
+                loadedCondition.notify_all();
+            }
+
+            if (SUCCEEDED(comResult))  CoUninitialize();
+        });
+    }
+
+    // Create the DirectX objects on this thread, in order, as each asset finishes loading
+    bool success = true;
+    for (auto& assetPointer : mAssets)
+    {
+        Asset& asset = *assetPointer;
+
+        Timer waitTimer;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            loadedCondition.wait(lock, [&]() { return asset.loaded; });
+        }
+        mWaitSeconds += waitTimer.GetTime();
+
+        if (asset.error.empty())
+        {
+            Timer createTimer;
+            try
+            {
+                asset.create();
+            }
+            catch (const std::exception& e)
+            {
+                asset.error = e.what();
+            }
+            asset.createSeconds = createTimer.GetTime();
+        }
+
+        if (!asset.error.empty())
+        {
+            gLastError = asset.error;
+            success = false;
+            break;
+        }
+    }
+
+    stop = true;
+    for (std::thread& worker : workers)  worker.join();
+
+    mTotalSeconds = totalTimer.GetTime();
+    return success;
+}
+
+
+// Send the time taken for each asset and for the whole load to the debugger output
+void StartupLoader::ReportTimes() const
+{
+    char message[512];
+    float totalLoadSeconds = 0, totalCreateSeconds = 0;
+    for (auto& asset : mAssets)
+    {
+        std::snprintf(message, sizeof(message), "    %-28s load %8.2f ms   create %8.2f ms\n",
+                      asset->name.c_str(), asset->loadSeconds * 1000, asset->createSeconds * 1000);
+        OutputDebugStringA(message);
+        totalLoadSeconds   += asset->loadSeconds;
+        totalCreateSeconds += asset->createSeconds;
+    }
+
+    std::snprintf(message, sizeof(message),
+                  "Loaded %d assets in %.2f ms using %d worker threads: load %.2f ms (summed over workers), create %.2f ms, waiting for workers %.2f ms\n",
+                  static_cast<int>(mAssets.size()), mTotalSeconds * 1000, mNumWorkers, totalLoadSeconds * 1000,
+                  totalCreateSeconds * 1000, mWaitSeconds * 1000);
+    OutputDebugStringA(message);
+}
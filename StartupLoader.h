@@ -0,0 +1,90 @@
+//--------------------------------------------------------------------------------------
+// Loading meshes, textures and shaders at startup using several threads
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+//
+// Each asset is loaded in two steps. The first step reads and decodes the file - the mesh import,
+// the image decode or reading the compiled shader. It doesn't use DirectX so the first steps of all
+// the assets run at the same time on a pool of worker threads. The second step creates the DirectX
+// objects from the decoded data. The second steps run one at a time on the thread that called Run,
+// in the order the assets were added, each starting as soon as that asset's first step is done.
+
+#ifndef _STARTUP_LOADER_H_INCLUDED_
+#define _STARTUP_LOADER_H_INCLUDED_
+
+#include "Common.h"
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <memory>
+
+class Mesh;
+
+
+class StartupLoader
+{
+public:
+    // Add an asset to load. The load function is called on a worker thread and must not use the
+    // device or context. The create function is called afterwards on the thread that called Run.
+    // Both should throw a std::runtime_error exception on failure
+    void Add(const std::string& name, std::function<void()> load, std::function<void()> create);
+
+    // Add a mesh, see the Mesh class. The mesh handle is set by Run. The second version passes the new
+    // mesh to a function instead (called on the thread that called Run). Usually meshes are requested
+    // from a MeshCache instead, which uses these functions. The mesh's full precision data is released
+    // once the mesh is created unless keepPreparedData is set (see Mesh::PreparedData)
+    void AddMesh(const std::string& fileName, bool requireTangents, bool compressVertices, std::shared_ptr<Mesh>* mesh,
+                 bool keepPreparedData = false);
+    void AddMesh(const std::string& fileName, bool requireTangents, bool compressVertices,
+                 std::function<void(std::shared_ptr<Mesh>)> created, bool keepPreparedData = false);
+
+    // Add a mesh keeping its skeleton and bone weights for skinning (see MeshSkinning.h). Skinned meshes
+    // are not shared through a MeshCache since their vertex layout differs. The mesh handle is set by Run
+    void AddSkinnedMesh(const std::string& fileName, bool requireTangents, std::shared_ptr<Mesh>* mesh);
+
+    // Add a mesh with morph targets (see MeshMorph.h). Not shared through a MeshCache either, since meshes
+    // with morph targets keep full precision vertices. The mesh handle is set by Run
+    void AddMorphedMesh(const std::string& fileName, bool requireTangents, std::shared_ptr<Mesh>* mesh);
+
+    // Add a texture, see LoadTexture in GraphicsHelpers.h. The texture pointers are set by Run
+    void AddTexture(const std::string& fileName, ID3D11Resource** texture, ID3D11ShaderResourceView** textureSRV);
+
+    // Add a shader, see LoadVertexShader in Shader.h. The shader pointer is set by Run
+    void AddVertexShader(const std::string& shaderName, ID3D11VertexShader** shader);
+    void AddPixelShader (const std::string& shaderName, ID3D11PixelShader**  shader);
+
+
+    // Load all the assets added. Returns false on failure and sets gLastError to the error from the
+    // first asset that failed (in the order added). Objects created before a failure are kept, the
+    // caller releases them as usual
+    bool Run();
+
+    // Send the time taken for each asset and for the whole load to the debugger output
+    void ReportTimes() const;
+
+
+private:
+    struct Asset
+    {
+        std::string           name;
+        std::function<void()> load;
+        std::function<void()> create;
+
+        // Set by the worker thread that loads the asset
+        bool        loaded = false;
+        std::string error;
+        float       loadSeconds = 0;
+
+        float       createSeconds = 0;
+    };
+
+    std::vector<std::unique_ptr<Asset>> mAssets;
+
+    int   mNumWorkers      = 0;
+    float mTotalSeconds    = 0; // Time for the whole of Run
+    float mWaitSeconds     = 0; // Time the calling thread spent waiting for worker threads
+};
+
+
+#endif //_STARTUP_LOADER_H_INCLUDED_
@@ -0,0 +1,190 @@
+//--------------------------------------------------------------------------------------
+// Static batch - models that never move drawn together from one mesh
+//--------------------------------------------------------------------------------------
+
+#include "StaticBatch.h"
+
+#include "Mesh.h"
+#include "Model.h"
+#include "MeshBatch.h"
+#include "GraphicsHelpers.h"
+#include "Timer.h"
+
+#include <cstdio>
+#include <stdexcept>
+
+
+// Describe a prepared mesh's full precision data for merging into a batch
+static BatchInstance ToBatchInstance(const PreparedMesh& prepared)
+{
+    BatchInstance instance;
+    if (prepared.cooked)
+    {
+        const CookedMeshHeader& header = prepared.cooked->Header();
+        instance.elements     = prepared.cooked->Elements();
+        instance.numElements  = header.numElements;
+        instance.vertexSize   = header.vertexSize;
+        instance.vertices     = prepared.cooked->Vertices();
+        instance.numVertices  = header.numVertices;
+        instance.subMeshes    = prepared.cooked->SubMeshes();
+        instance.numSubMeshes = header.numSubMeshes;
+        instance.indices      = prepared.cooked->Indices();
+    }
+    else
+    {
+        const MeshData& mesh = prepared.imported;
+        instance.elements     = mesh.vertexElements.data();
+        instance.numElements  = static_cast<unsigned int>(mesh.vertexElements.size());
+        instance.vertexSize   = mesh.vertexSize;
+        instance.vertices     = mesh.vertices.get();
+        instance.numVertices  = mesh.numVertices;
+        instance.subMeshes    = mesh.subMeshes.data();
+        instance.numSubMeshes = static_cast<unsigned int>(mesh.subMeshes.size());
+        instance.indices      = mesh.indices.get();
+    }
+    return instance;
+}
+
+
+StaticBatch::StaticBatch()
+{
+}
+
+// Defined here, where Mesh is a complete type
+StaticBatch::~StaticBatch()
+{
+}
+
+
+// Add a model to the batch, see header
+void StaticBatch::Add(Model* model, const Material& material)
+{
+    Mesh* mesh = model->GetMesh();
+    if (mMesh)                                        throw std::runtime_error("Cannot add " + mesh->FileName() + " to a static batch that has been built");
+    if (!model->IsStatic())                           throw std::runtime_error("Cannot batch " + mesh->FileName() + ", the model is not static");
+    if (mesh->HasSkin() || mesh->HasMorphTargets())  throw std::runtime_error("Cannot batch " + mesh->FileName() + ", the mesh is animated");
+    if (!mesh->PreparedData())                        throw std::runtime_error("Cannot batch " + mesh->FileName() + ", the mesh didn't keep its prepared data");
+
+    unsigned int index = 0;
+    while (index < NumMaterials() && (mMaterials[index].pixelShader != material.pixelShader ||
+                                      mMaterials[index].diffuseSpecularMap != material.diffuseSpecularMap))
+    {
+        ++index;
+    }
+    if (index == NumMaterials())  mMaterials.push_back(material);
+
+    mModels.push_back(model);
+    mModelMaterials.push_back(index);
+}
+
+
+// Merge the models added into the batch's mesh, see header
+void StaticBatch::Build(bool compressVertices)
+{
+    Timer buildTimer;
+    if (mModels.empty())  throw std::runtime_error("Static batch has no models");
+
+    // Place each model's mesh in the world, from the full precision data the mesh kept. Drawn separately each
+    // model would update the constant buffer and draw each of its sub-meshes
+    std::vector<BatchInstance> instances;
+    unsigned int drawsBefore = 0;
+    for (unsigned int i = 0; i < NumModels(); ++i)
+    {
+        Mesh* mesh = mModels[i]->GetMesh();
+        BatchInstance instance = ToBatchInstance(*mesh->PreparedData());
+        instance.worldMatrix = mModels[i]->WorldMatrix();
+        instance.material    = mModelMaterials[i];
+        instances.push_back(instance);
+        drawsBefore += mesh->NumSubMeshes();
+    }
+
+    PreparedMesh batch;
+    batch.fileName = "static batch";
+    batch.built    = true;
+    batch.imported = BuildStaticBatch(instances.data(), NumModels());
+    if (compressVertices)
+    {
+        const MeshData& merged = batch.imported;
+        batch.compressed = std::make_unique<CompressedMeshData>(
+            CompressMesh(merged.vertexElements.data(), static_cast<unsigned int>(merged.vertexElements.size()), merged.vertexSize,
+                         merged.vertices.get(), merged.numVertices, merged.indices.get(), merged.numIndices));
+    }
+    batch.prepareSeconds = buildTimer.GetTime();
+    mMesh = std::make_unique<Mesh>(batch);
+
+    char message[512];
+    std::snprintf(message, sizeof(message), "    %u models in %u materials: each depth-only pass %u draw calls and %u constant buffer updates -> 1 and 1, "
+                  "camera pass %u draw calls and %u constant buffer updates -> %u and 1 (before culling)\n",
+                  NumModels(), NumMaterials(), drawsBefore, NumModels(), drawsBefore, NumModels(), NumMaterials());
+    OutputDebugStringA(message);
+}
+
+
+// Send the batch's per-model constants to the GPU. The vertices are already in world space
+void StaticBatch::SetConstants()
+{
+    gPerModelConstants.worldMatrix       = MatrixIdentity();
+    gPerModelConstants.positionOffset    = mMesh->PositionOffset();
+    gPerModelConstants.positionScale     = mMesh->PositionScale();
+    gPerModelConstants.compressedNormals = mMesh->HasCompressedVertices() ? 1 : 0;
+    UpdateConstantBuffer(gPerModelConstantBuffer, gPerModelConstants);
+
+    gD3DContext->VSSetConstantBuffers(1, 1, &gPerModelConstantBuffer);
+    gD3DContext->PSSetConstantBuffers(1, 1, &gPerModelConstantBuffer);
+}
+
+
+// Draw every model in the batch with one call, see header
+void StaticBatch::Render()
+{
+    if (!mMesh)  return;
+    const ModelView& view = Model::View();
+    Mesh::Stream stream = view.positionOnly ? Mesh::Stream::Position : Mesh::Stream::Full;
+    unsigned int numTriangles = mMesh->NumTriangles();
+
+    Frustum frustum(view.viewProjectionMatrix);
+    if (view.cullClusters && frustum.TestSphere(mMesh->BoundsCentre(), mMesh->BoundsRadius()) == CullResult::Outside)
+    {
+        Model::CountTriangles(0, numTriangles, 0);
+        return;
+    }
+
+    SetConstants();
+    mMesh->Render(stream);
+    Model::CountTriangles(numTriangles, 0, mMesh->VertexFetchBytes(numTriangles, stream));
+}
+
+
+// Draw the models of each material with one call, see header
+void StaticBatch::RenderMaterials()
+{
+    if (!mMesh)  return;
+    const ModelView& view = Model::View();
+    Mesh::Stream stream = view.positionOnly ? Mesh::Stream::Position : Mesh::Stream::Full;
+
+    Frustum frustum(view.viewProjectionMatrix);
+    bool constantsSet = false;
+    for (unsigned int m = 0; m < NumMaterials(); ++m)
+    {
+        // Sub-mesh bounds are in world space
+        const Mesh::SubMesh& subMesh = mMesh->GetSubMesh(m);
+        unsigned int numTriangles = subMesh.numIndices / 3;
+        CVector3 centre = (subMesh.boundsMin + subMesh.boundsMax) * 0.5f;
+        float radius = Length(subMesh.boundsMax - subMesh.boundsMin) * 0.5f;
+        if (view.cullClusters && frustum.TestSphere(centre, radius) == CullResult::Outside)
+        {
+            Model::CountTriangles(0, numTriangles, 0);
+            continue;
+        }
+
+        if (!constantsSet)
+        {
+            SetConstants();
+            constantsSet = true;
+        }
+        gD3DContext->PSSetShader(mMaterials[m].pixelShader, nullptr, 0);
+        gD3DContext->PSSetShaderResources(0, 1, &mMaterials[m].diffuseSpecularMap);
+        mMesh->Render(m, stream);
+        Model::CountTriangles(numTriangles, 0, mMesh->VertexFetchBytes(numTriangles, stream));
+    }
+}
@@ -0,0 +1,78 @@
+//--------------------------------------------------------------------------------------
+// Static batch - models that never move drawn together from one mesh
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+//
+// Models flagged static (see Model::SetStatic) are added with the material they are drawn with in the
+// camera pass - the pixel shader and texture. Building the batch merges their meshes, transformed into
+// world space, into one mesh with one sub-mesh per material (see MeshBatch.h). The GPU copies of the
+// meshes may be compressed, so the merge uses the full precision data each mesh kept from loading (see
+// Mesh::PreparedData). Nothing is read from file, so building is quick enough for the device thread.
+// The merged mesh is compressed afterwards if required, though its positions are then quantised over
+// the bounds of the whole batch, which are usually far larger than any one mesh.
+//
+// The whole batch is drawn with one constant buffer update. Depth-only passes draw every model in it with
+// one call, the camera pass with one call per material. Each material is skipped if it is outside the view.
+// The batch doesn't draw from the clusters of the merged mesh, as culling them would split the calls.
+
+#ifndef _STATIC_BATCH_H_INCLUDED_
+#define _STATIC_BATCH_H_INCLUDED_
+
+#include "Common.h"
+
+#include <vector>
+#include <memory>
+
+class Mesh;
+class Model;
+
+
+class StaticBatch
+{
+public:
+    // What a model is drawn with in the camera pass. Models with the same pixel shader and texture are
+    // drawn together
+    struct Material
+    {
+        ID3D11PixelShader*        pixelShader        = nullptr;
+        ID3D11ShaderResourceView* diffuseSpecularMap = nullptr; // Texture slot 0
+    };
+
+    StaticBatch();
+    ~StaticBatch();
+
+    // Add a model to the batch. It must be static, its mesh must have kept its prepared data (see
+    // MeshCache::Request) and must not be skinned or have morph targets. Will throw a std::runtime_error
+    // exception otherwise
+    void Add(Model* model, const Material& material);
+
+    // Merge the models added into the batch's mesh, optionally using the compressed vertex layout (see
+    // MeshCompression.h). Models can't be added afterwards. Will throw a std::runtime_error exception on failure
+    void Build(bool compressVertices);
+
+    unsigned int NumModels() const     { return static_cast<unsigned int>(mModels.size()); }
+    unsigned int NumMaterials() const  { return static_cast<unsigned int>(mMaterials.size()); }
+
+
+    // Draw every model in the batch with one call, with whatever shaders and textures are set. For
+    // depth-only passes. Draws for the current view (see Model::SetView), from the position-only stream if
+    // the view asks for it
+    void Render();
+
+    // Draw the models of each material with one call, setting the material's pixel shader and texture
+    // first. The vertex shader, samplers and states must be set already. Draws for the current view
+    void RenderMaterials();
+
+
+private:
+    // Send the batch's per-model constants to the GPU: an identity world matrix and the merged mesh's decoding
+    void SetConstants();
+
+    std::vector<Model*>       mModels;
+    std::vector<unsigned int> mModelMaterials; // Index into mMaterials for each model
+    std::vector<Material>     mMaterials;
+    std::unique_ptr<Mesh>     mMesh;           // Sub-mesh i holds the models of material i
+};
+
+
+#endif //_STATIC_BATCH_H_INCLUDED_
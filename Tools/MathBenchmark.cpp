@@ -0,0 +1,689 @@
+//--------------------------------------------------------------------------------------
+// Maths micro-benchmark - times the functions in the Math folder on their own
+//--------------------------------------------------------------------------------------
+// A separate command line program, not part of the Visual Studio project. It only needs this
+// file and the Math folder so builds on any platform, e.g. from the repository folder on Linux:
+//     g++ -O2 -std=c++14 -IMath Tools/MathBenchmark.cpp Math/*.cpp -o MathBenchmark
+// or from a Visual Studio developer command prompt:
+//     cl /O2 /EHsc /IMath Tools\MathBenchmark.cpp Math\*.cpp
+//
+// Each function is timed on working sets sized to fit in the L1, L2 and L3 caches and to spill
+// to main memory (DRAM). Functions with SIMD versions are timed at each SIMD level the CPU
+// supports. Results are printed as ns per operation and operations per second.
+//
+// The mesh benchmarks transform the vertices of a real mesh instead of random data, read from a
+// DirectX .x text file (Troll.x by default, so run from the repository folder). Its vertices are
+// repeated to make at least 100,000, like a crowd of the same model, and timed at that size only.
+//
+// Options:
+//     --quick               Shorter timing runs, less accurate
+//     --mesh <file>         DirectX .x text file used by the mesh benchmarks (default Troll.x)
+//     --filter <text>       Only run benchmarks whose name contains the given text
+//     --json <file>         Write the results to a JSON file
+//     --baseline <file>     Compare with results previously written with --json. Exits with
+//                           code 1 if any result is slower than the baseline by more than...
+//     --threshold <value>   ...this fraction (default 0.1, i.e. 10% slower)
+//
+// Timings vary between runs, so only compare against a baseline from the same machine.
+
+#include "CVector3.h"
+#include "CMatrix4x4.h"
+#include "MathBatch.h"
+#include "MathHelpersSIMD.h"
+#include "Frustum.h"
+#include "Transform.h"
+#include "SIMD.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+
+/*-----------------------------------------------------------------------------------------
+    Benchmark data
+-----------------------------------------------------------------------------------------*/
+
+// Arrays used by the benchmarks. Each benchmark sizes the arrays it needs in its setup function,
+// the arrays are all emptied between benchmarks so only one benchmark's data is held at a time
+struct BenchmarkData
+{
+    std::vector<CVector3>   vectorsA, vectorsB, vectorsOut;
+    std::vector<CMatrix4x4> matrices, matricesOut;
+    std::vector<float>      x, y, z, outX, outY, outZ;
+    std::vector<CullResult> cullResults;
+    CMatrix4x4 matrix, normalMatrix;
+    Frustum    frustum;
+
+    // Free all the arrays
+    void Clear()
+    {
+        vectorsA = vectorsB = vectorsOut = {};
+        matrices = matricesOut = {};
+        x = y = z = outX = outY = outZ = {};
+        cullResults = {};
+    }
+};
+BenchmarkData gData;
+
+std::mt19937 gRandom(1234); // Fixed seed so every run times the same data
+
+float Random(float min, float max)
+{
+    return std::uniform_real_distribution<float>(min, max)(gRandom);
+}
+
+void RandomVectors(std::vector<CVector3>& vectors, int count, float range)
+{
+    vectors.resize(count);
+    for (auto& v : vectors)  v = { Random(-range, range), Random(-range, range), Random(-range, range) };
+}
+
+void RandomFloats(std::vector<float>& values, int count, float min, float max)
+{
+    values.resize(count);
+    for (auto& value : values)  value = Random(min, max);
+}
+
+// Random world matrices, so all are invertible and have sensible Euler angles
+void RandomMatrices(std::vector<CMatrix4x4>& matrices, int count)
+{
+    matrices.resize(count);
+    for (auto& m : matrices)
+    {
+        m = MatrixTRS(CVector3{ Random(-100, 100), Random(-100, 100), Random(-100, 100) },
+                      CVector3{ Random(-1.5f, 1.5f), Random(-3, 3), Random(-3, 3) },
+                      CVector3{ Random(0.5f, 2), Random(0.5f, 2), Random(0.5f, 2) });
+    }
+}
+
+// Written with a value from each benchmark's output so the compiler cannot remove the work
+volatile float gSink;
+
+
+// Vertex positions and normals of the mesh used by the mesh benchmarks, empty if it couldn't be read
+std::vector<CVector3> gMeshPositions, gMeshNormals;
+
+// Read the positions and normals of the first mesh in a DirectX .x text file. Returns false if the file
+// can't be read or has no normals
+bool LoadMesh(const std::string& fileName)
+{
+    std::ifstream file(fileName);
+    if (!file)  return false;
+
+    // Each list is a count followed by one "x;y;z;," line per vector
+    auto readVectors = [&](std::vector<CVector3>& vectors)
+    {
+        std::string line;
+        int count = 0;
+        if (!std::getline(file, line) || std::sscanf(line.c_str(), "%d", &count) != 1 || count <= 0)  return false;
+        vectors.resize(count);
+        for (auto& v : vectors)
+        {
+            if (!std::getline(file, line) || std::sscanf(line.c_str(), " %f;%f;%f", &v.x, &v.y, &v.z) != 3)  return false;
+        }
+        return true;
+    };
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        size_t start = line.find_first_not_of(" \t");
+        if (start == std::string::npos)  continue;
+        if      (line.compare(start, 5, "Mesh ") == 0 && gMeshPositions.empty())    { if (!readVectors(gMeshPositions))  break; }
+        else if (line.compare(start, 11, "MeshNormals") == 0 && gMeshNormals.empty())
+        {
+            if (readVectors(gMeshNormals))  break;
+        }
+    }
+    if (gMeshPositions.empty() || gMeshNormals.empty())
+    {
+        gMeshPositions.clear();
+        gMeshNormals.clear();
+        return false;
+    }
+    return true;
+}
+
+// The mesh's vertices are repeated to make at least this many
+const int MESH_BENCHMARK_VERTICES = 100000;
+
+int MeshBenchmarkCount()
+{
+    int vertices = static_cast<int>(gMeshPositions.size());
+    return (MESH_BENCHMARK_VERTICES + vertices - 1) / vertices * vertices;
+}
+
+// Fill the array with count vectors, repeating the given ones
+void RepeatVectors(std::vector<CVector3>& vectors, const std::vector<CVector3>& source, int count)
+{
+    vectors.resize(count);
+    for (int i = 0; i < count; ++i)  vectors[i] = source[i % source.size()];
+}
+
+void RepeatVectors(std::vector<float>& x, std::vector<float>& y, std::vector<float>& z, const std::vector<CVector3>& source, int count)
+{
+    x.resize(count);  y.resize(count);  z.resize(count);
+    for (int i = 0; i < count; ++i)
+    {
+        const CVector3& v = source[i % source.size()];
+        x[i] = v.x;  y[i] = v.y;  z[i] = v.z;
+    }
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Benchmarks
+-----------------------------------------------------------------------------------------*/
+
+struct Benchmark
+{
+    const char* name;
+    bool simd;      // Has SIMD versions, so is timed at each SIMD level
+    int  bytesPerOp; // Memory read and written by each operation, used to size the working sets
+    std::function<void(int count)> setup;
+    std::function<void(int count)> run;
+    int  count = 0; // Fixed number of operations, only timed at this size. 0 to time at each of the data sizes
+};
+
+std::vector<Benchmark> Benchmarks()
+{
+    BenchmarkData& d = gData;
+    std::vector<Benchmark> benchmarks =
+    {
+        //*********************************
+        // CVector3
+
+        { "CVector3 operator+", false, 36,
+          [&](int n) { RandomVectors(d.vectorsA, n, 100); RandomVectors(d.vectorsB, n, 100); d.vectorsOut.resize(n); },
+          [&](int n) { for (int i = 0; i < n; ++i)  d.vectorsOut[i] = d.vectorsA[i] + d.vectorsB[i];
+                       gSink = d.vectorsOut[n - 1].x; } },
+
+        { "Cross", false, 36,
+          [&](int n) { RandomVectors(d.vectorsA, n, 100); RandomVectors(d.vectorsB, n, 100); d.vectorsOut.resize(n); },
+          [&](int n) { for (int i = 0; i < n; ++i)  d.vectorsOut[i] = Cross(d.vectorsA[i], d.vectorsB[i]);
+                       gSink = d.vectorsOut[n - 1].x; } },
+
+        { "Normalise", false, 24,
+          [&](int n) { RandomVectors(d.vectorsA, n, 100); d.vectorsOut.resize(n); },
+          [&](int n) { for (int i = 0; i < n; ++i)  d.vectorsOut[i] = Normalise(d.vectorsA[i]);
+                       gSink = d.vectorsOut[n - 1].x; } },
+
+        { "NormaliseMany fast (AoS)", true, 24,
+          [&](int n) { RandomVectors(d.vectorsA, n, 100); d.vectorsOut.resize(n); },
+          [&](int n) { NormaliseMany(d.vectorsA.data(), d.vectorsOut.data(), n, SqrtPrecision::Fast);
+                       gSink = d.vectorsOut[n - 1].x; } },
+
+        { "NormaliseMany precise (AoS)", true, 24,
+          [&](int n) { RandomVectors(d.vectorsA, n, 100); d.vectorsOut.resize(n); },
+          [&](int n) { NormaliseMany(d.vectorsA.data(), d.vectorsOut.data(), n, SqrtPrecision::Precise);
+                       gSink = d.vectorsOut[n - 1].x; } },
+
+        { "NormaliseMany fast (SoA)", true, 24,
+          [&](int n) { RandomFloats(d.x, n, -100, 100); RandomFloats(d.y, n, -100, 100); RandomFloats(d.z, n, -100, 100);
+                       d.outX.resize(n); d.outY.resize(n); d.outZ.resize(n); },
+          [&](int n) { NormaliseMany({ d.x.data(), d.y.data(), d.z.data() }, { d.outX.data(), d.outY.data(), d.outZ.data() }, n);
+                       gSink = d.outX[n - 1]; } },
+
+        { "TransformPoints (AoS)", true, 24,
+          [&](int n) { RandomVectors(d.vectorsA, n, 100); d.vectorsOut.resize(n); d.matrix = MatrixTRS(CVector3{ 1, 2, 3 }, CVector3{ 0.1f, 0.2f, 0.3f }, CVector3{ 1, 1, 1 }); },
+          [&](int n) { TransformPoints(d.matrix, d.vectorsA.data(), d.vectorsOut.data(), n);
+                       gSink = d.vectorsOut[n - 1].x; } },
+
+        { "TransformPoints (SoA)", true, 24,
+          [&](int n) { RandomFloats(d.x, n, -100, 100); RandomFloats(d.y, n, -100, 100); RandomFloats(d.z, n, -100, 100);
+                       d.outX.resize(n); d.outY.resize(n); d.outZ.resize(n); d.matrix = MatrixTRS(CVector3{ 1, 2, 3 }, CVector3{ 0.1f, 0.2f, 0.3f }, CVector3{ 1, 1, 1 }); },
+          [&](int n) { TransformPoints(d.matrix, { d.x.data(), d.y.data(), d.z.data() }, { d.outX.data(), d.outY.data(), d.outZ.data() }, n);
+                       gSink = d.outX[n - 1]; } },
+
+
+        //*********************************
+        // CMatrix4x4
+
+        { "CMatrix4x4 operator*", true, 128,
+          [&](int n) { RandomMatrices(d.matrices, n); d.matricesOut.resize(n); d.matrix = d.matrices[0]; },
+          [&](int n) { for (int i = 0; i < n; ++i)  d.matricesOut[i] = d.matrices[i] * d.matrix;
+                       gSink = d.matricesOut[n - 1].e00; } },
+
+        { "MatrixTRS (Euler)", false, 100,
+          [&](int n) { RandomVectors(d.vectorsA, n, 3); d.matricesOut.resize(n); },
+          [&](int n) { for (int i = 0; i < n; ++i)  d.matricesOut[i] = MatrixTRS(d.vectorsA[i], d.vectorsA[i], CVector3{ 1, 1, 1 });
+                       gSink = d.matricesOut[n - 1].e00; } },
+
+        { "InverseAffine", false, 128,
+          [&](int n) { RandomMatrices(d.matrices, n); d.matricesOut.resize(n); },
+          [&](int n) { for (int i = 0; i < n; ++i)  d.matricesOut[i] = InverseAffine(d.matrices[i]);
+                       gSink = d.matricesOut[n - 1].e00; } },
+
+        { "InverseAffineMany", true, 128,
+          [&](int n) { RandomMatrices(d.matrices, n); d.matricesOut.resize(n); },
+          [&](int n) { InverseAffineMany(d.matrices.data(), d.matricesOut.data(), n);
+                       gSink = d.matricesOut[n - 1].e00; } },
+
+        { "Inverse", true, 128,
+          [&](int n) { RandomMatrices(d.matrices, n); d.matricesOut.resize(n); },
+          [&](int n) { for (int i = 0; i < n; ++i)  d.matricesOut[i] = Inverse(d.matrices[i]);
+                       gSink = d.matricesOut[n - 1].e00; } },
+
+        { "GetEulerAngles", false, 76,
+          [&](int n) { RandomMatrices(d.matrices, n); d.vectorsOut.resize(n); },
+          [&](int n) { for (int i = 0; i < n; ++i)  d.vectorsOut[i] = d.matrices[i].GetEulerAngles();
+                       gSink = d.vectorsOut[n - 1].x; } },
+
+        { "FaceTarget", false, 140,
+          [&](int n) { RandomMatrices(d.matrices, n); RandomVectors(d.vectorsA, n, 100); d.matricesOut.resize(n); },
+          [&](int n) { for (int i = 0; i < n; ++i)
+                       {
+                           d.matricesOut[i] = d.matrices[i];
+                           d.matricesOut[i].FaceTarget(d.vectorsA[i]);
+                       }
+                       gSink = d.matricesOut[n - 1].e00; } },
+
+
+        //*********************************
+        // Other
+
+        { "SinCosMany", true, 12,
+          [&](int n) { RandomFloats(d.x, n, -10, 10); d.outX.resize(n); d.outY.resize(n); },
+          [&](int n) { SinCosMany(d.x.data(), d.outX.data(), d.outY.data(), n);
+                       gSink = d.outX[n - 1]; } },
+
+        { "SinMany", true, 8,
+          [&](int n) { RandomFloats(d.x, n, -10, 10); d.outX.resize(n); },
+          [&](int n) { SinMany(d.x.data(), d.outX.data(), n);
+                       gSink = d.outX[n - 1]; } },
+
+        { "TanMany", true, 8,
+          [&](int n) { RandomFloats(d.x, n, -1.5f, 1.5f); d.outX.resize(n); },
+          [&](int n) { TanMany(d.x.data(), d.outX.data(), n);
+                       gSink = d.outX[n - 1]; } },
+
+        { "Atan2Many", true, 12,
+          [&](int n) { RandomFloats(d.y, n, -10, 10); RandomFloats(d.x, n, -10, 10); d.outX.resize(n); },
+          [&](int n) { Atan2Many(d.y.data(), d.x.data(), d.outX.data(), n);
+                       gSink = d.outX[n - 1]; } },
+
+        { "ExpMany", true, 8,
+          [&](int n) { RandomFloats(d.x, n, -10, 10); d.outX.resize(n); },
+          [&](int n) { ExpMany(d.x.data(), d.outX.data(), n);
+                       gSink = d.outX[n - 1]; } },
+
+        // The standard library functions the above replace, for comparison
+        { "std::sin", false, 8,
+          [&](int n) { RandomFloats(d.x, n, -10, 10); d.outX.resize(n); },
+          [&](int n) { for (int i = 0; i < n; ++i)  d.outX[i] = std::sin(d.x[i]);
+                       gSink = d.outX[n - 1]; } },
+
+        { "std::tan", false, 8,
+          [&](int n) { RandomFloats(d.x, n, -1.5f, 1.5f); d.outX.resize(n); },
+          [&](int n) { for (int i = 0; i < n; ++i)  d.outX[i] = std::tan(d.x[i]);
+                       gSink = d.outX[n - 1]; } },
+
+        { "std::atan2", false, 12,
+          [&](int n) { RandomFloats(d.y, n, -10, 10); RandomFloats(d.x, n, -10, 10); d.outX.resize(n); },
+          [&](int n) { for (int i = 0; i < n; ++i)  d.outX[i] = std::atan2(d.y[i], d.x[i]);
+                       gSink = d.outX[n - 1]; } },
+
+        { "std::exp", false, 8,
+          [&](int n) { RandomFloats(d.x, n, -10, 10); d.outX.resize(n); },
+          [&](int n) { for (int i = 0; i < n; ++i)  d.outX[i] = std::exp(d.x[i]);
+                       gSink = d.outX[n - 1]; } },
+
+        { "TestAABBs", true, 25,
+          [&](int n) { RandomFloats(d.x, n, -100, 100); RandomFloats(d.y, n, -100, 100); RandomFloats(d.z, n, -100, 100);
+                       d.outX = d.x; d.outY = d.y; d.outZ = d.z;
+                       for (int i = 0; i < n; ++i)  { d.outX[i] += 5; d.outY[i] += 5; d.outZ[i] += 5; }
+                       d.cullResults.resize(n);
+                       d.frustum = Frustum(CMatrix4x4{ 1, 0, 0, 0,   0, 1, 0, 0,   0, 0, 1.0001f, 1,   0, 0, -0.1f, 0 }); }, // 90 degree FOV
+          [&](int n) { TestAABBs(d.frustum, { d.x.data(), d.y.data(), d.z.data() }, { d.outX.data(), d.outY.data(), d.outZ.data() }, d.cullResults.data(), n);
+                       gSink = static_cast<float>(d.cullResults[n - 1]); } },
+    };
+
+
+    //*********************************
+    // Culling a million boxes, as a scene would each frame. With a fixed count of a million, the time per
+    // box in ns is also the time per frame in ms
+
+    // Boxes of up to 10 units scattered through a 1000 unit cube, viewed from its centre by a camera turned
+    // away from the axes with a 90 degree field of view and a far plane at 1000. Some boxes are inside, most
+    // outside, and some cross the edges
+    auto cullingBoxes = [&](int n)
+    {
+        RandomFloats(d.x, n, -500, 500); RandomFloats(d.y, n, -500, 500); RandomFloats(d.z, n, -500, 500);
+        d.outX = d.x; d.outY = d.y; d.outZ = d.z;
+        for (int i = 0; i < n; ++i)  { d.outX[i] += Random(0, 10); d.outY[i] += Random(0, 10); d.outZ[i] += Random(0, 10); }
+        d.cullResults.resize(n);
+        CMatrix4x4 view = InverseAffine(MatrixTRS(CVector3{ 0, 0, 0 }, CVector3{ 0.3f, 0.7f, 0 }, CVector3{ 1, 1, 1 }));
+        const float nearClip = 0.1f, farClip = 1000.0f, q = farClip / (farClip - nearClip);
+        CMatrix4x4 projection = { 1, 0, 0, 0,   0, 1, 0, 0,   0, 0, q, 1,   0, 0, -nearClip * q, 0 };
+        d.frustum = Frustum(view * projection);
+    };
+    const int cullingCount = 1000000;
+    std::vector<Benchmark> cullingBenchmarks =
+    {
+        { "Cull 1M boxes (TestAABB)", false, 25,
+          [&](int n) { cullingBoxes(n); },
+          [&](int n) { for (int i = 0; i < n; ++i)
+                       {
+                           d.cullResults[i] = d.frustum.TestAABB(CVector3{ d.x[i], d.y[i], d.z[i] }, CVector3{ d.outX[i], d.outY[i], d.outZ[i] });
+                       }
+                       gSink = static_cast<float>(d.cullResults[n - 1]); }, cullingCount },
+
+        { "Cull 1M boxes (TestAABBs)", true, 25,
+          [&](int n) { cullingBoxes(n); },
+          [&](int n) { TestAABBs(d.frustum, { d.x.data(), d.y.data(), d.z.data() }, { d.outX.data(), d.outY.data(), d.outZ.data() }, d.cullResults.data(), n);
+                       gSink = static_cast<float>(d.cullResults[n - 1]); }, cullingCount },
+
+        { "Cull 1M spheres (TestSpheres)", true, 17,
+          [&](int n) { cullingBoxes(n); for (int i = 0; i < n; ++i)  d.outX[i] = Random(0, 10);
+                       d.outY.clear(); d.outZ.clear(); },
+          [&](int n) { TestSpheres(d.frustum, { d.x.data(), d.y.data(), d.z.data() }, d.outX.data(), d.cullResults.data(), n);
+                       gSink = static_cast<float>(d.cullResults[n - 1]); }, cullingCount },
+    };
+    benchmarks.insert(benchmarks.end(), cullingBenchmarks.begin(), cullingBenchmarks.end());
+    if (gMeshPositions.empty())  return benchmarks;
+
+
+    //*********************************
+    // Mesh vertices
+
+    // A world matrix with rotation and non-uniform scaling, so normals need the inverse transpose
+    auto meshWorldMatrix = [&]()
+    {
+        d.matrix = MatrixTRS(CVector3{ 10, 0, -20 }, CVector3{ 0.1f, 2.5f, 0 }, CVector3{ 1.5f, 1, 1.2f });
+        d.normalMatrix = InverseTranspose(d.matrix);
+    };
+    int meshCount = MeshBenchmarkCount();
+    std::vector<Benchmark> meshBenchmarks =
+    {
+        { "Mesh TransformPoints (AoS)", true, 24,
+          [&](int n) { RepeatVectors(d.vectorsA, gMeshPositions, n); d.vectorsOut.resize(n); meshWorldMatrix(); },
+          [&](int n) { TransformPoints(d.matrix, d.vectorsA.data(), d.vectorsOut.data(), n);
+                       gSink = d.vectorsOut[n - 1].x; }, meshCount },
+
+        { "Mesh TransformPoints (SoA)", true, 24,
+          [&](int n) { RepeatVectors(d.x, d.y, d.z, gMeshPositions, n); d.outX.resize(n); d.outY.resize(n); d.outZ.resize(n); meshWorldMatrix(); },
+          [&](int n) { TransformPoints(d.matrix, { d.x.data(), d.y.data(), d.z.data() }, { d.outX.data(), d.outY.data(), d.outZ.data() }, n);
+                       gSink = d.outX[n - 1]; }, meshCount },
+
+        { "Mesh TransformNormals + Normalise", true, 24,
+          [&](int n) { RepeatVectors(d.vectorsA, gMeshNormals, n); d.vectorsOut.resize(n); meshWorldMatrix(); },
+          [&](int n) { TransformNormals(d.normalMatrix, d.vectorsA.data(), d.vectorsOut.data(), n);
+                       NormaliseMany(d.vectorsOut.data(), d.vectorsOut.data(), n);
+                       gSink = d.vectorsOut[n - 1].x; }, meshCount },
+
+        { "Mesh TransformPointsProject", true, 24,
+          [&](int n) { RepeatVectors(d.vectorsA, gMeshPositions, n); d.vectorsOut.resize(n); meshWorldMatrix();
+                       d.matrix = d.matrix * CMatrix4x4{ 1, 0, 0, 0,   0, 1, 0, 0,   0, 0, 1.0001f, 1,   0, 0, -0.1f, 0 }; },
+          [&](int n) { TransformPointsProject(d.matrix, d.vectorsA.data(), d.vectorsOut.data(), n);
+                       gSink = d.vectorsOut[n - 1].x; }, meshCount },
+    };
+    benchmarks.insert(benchmarks.end(), meshBenchmarks.begin(), meshBenchmarks.end());
+    return benchmarks;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Timing
+-----------------------------------------------------------------------------------------*/
+
+// Working set sizes, from fitting in the smallest cache to well beyond the largest
+struct DataSize
+{
+    const char* name;
+    int bytes;
+};
+const DataSize gDataSizes[] =
+{
+    { "L1",   16 * 1024 },
+    { "L2",   128 * 1024 },
+    { "L3",   4 * 1024 * 1024 },
+    { "DRAM", 128 * 1024 * 1024 },
+};
+
+struct Result
+{
+    std::string name;
+    std::string simd;
+    std::string size;
+    int    count;
+    double nsPerOp;
+};
+
+
+double Seconds(std::chrono::steady_clock::duration d)
+{
+    return std::chrono::duration<double>(d).count();
+}
+
+// Return the time for one run of the benchmark in seconds. Runs are repeated until each timing
+// lasts at least minTime, and the fastest of several timings is used to reduce noise
+double TimeBenchmark(const Benchmark& benchmark, int count, double minTime)
+{
+    benchmark.run(count); // Warm up caches and memory
+
+    int repeats = 1;
+    for (;;)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < repeats; ++r)  benchmark.run(count);
+        if (Seconds(std::chrono::steady_clock::now() - start) >= minTime)  break;
+        repeats *= 2;
+    }
+
+    double best = 1e30;
+    for (int trial = 0; trial < 5; ++trial)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < repeats; ++r)  benchmark.run(count);
+        double time = Seconds(std::chrono::steady_clock::now() - start) / repeats;
+        if (time < best)  best = time;
+    }
+    return best;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    JSON results
+-----------------------------------------------------------------------------------------*/
+// Results are written one per line in a fixed format, which is all ReadJson needs to handle
+
+std::string ResultKey(const Result& r)
+{
+    return r.name + " | " + r.simd + " | " + r.size;
+}
+
+bool WriteJson(const std::string& fileName, const std::vector<Result>& results)
+{
+    std::ofstream file(fileName);
+    if (!file)  return false;
+
+    file << "{\n";
+    file << "  \"supported_simd\": \"" << SimdLevelName(GetSupportedSimdLevel()) << "\",\n";
+    file << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const Result& r = results[i];
+        char line[512];
+        std::snprintf(line, sizeof(line),
+                      "    {\"name\": \"%s\", \"simd\": \"%s\", \"size\": \"%s\", \"count\": %d, \"ns_per_op\": %.4f, \"ops_per_sec\": %.0f}%s\n",
+                      r.name.c_str(), r.simd.c_str(), r.size.c_str(), r.count, r.nsPerOp, 1e9 / r.nsPerOp,
+                      i + 1 < results.size() ? "," : "");
+        file << line;
+    }
+    file << "  ]\n";
+    file << "}\n";
+    return true;
+}
+
+// Find "key": in the line and return the value after it, without quotes for strings
+std::string JsonValue(const std::string& line, const char* key)
+{
+    std::string search = std::string("\"") + key + "\": ";
+    size_t start = line.find(search);
+    if (start == std::string::npos)  return "";
+    start += search.size();
+    if (line[start] == '"')
+    {
+        size_t end = line.find('"', start + 1);
+        return line.substr(start + 1, end - start - 1);
+    }
+    size_t end = line.find_first_of(",}", start);
+    return line.substr(start, end - start);
+}
+
+// Read results written by WriteJson, keyed by ResultKey. Returns false if the file can't be read
+bool ReadJson(const std::string& fileName, std::map<std::string, Result>& results)
+{
+    std::ifstream file(fileName);
+    if (!file)  return false;
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.find("\"ns_per_op\"") == std::string::npos)  continue;
+        Result r;
+        r.name    = JsonValue(line, "name");
+        r.simd    = JsonValue(line, "simd");
+        r.size    = JsonValue(line, "size");
+        r.count   = std::atoi(JsonValue(line, "count").c_str());
+        r.nsPerOp = std::atof(JsonValue(line, "ns_per_op").c_str());
+        results[ResultKey(r)] = r;
+    }
+    return true;
+}
+
+// Print how each result compares to the baseline, return the number of results slower than the
+// baseline by more than the threshold
+int CompareWithBaseline(const std::vector<Result>& results, const std::map<std::string, Result>& baseline, double threshold)
+{
+    std::printf("\nComparison with baseline (threshold %.0f%%):\n", threshold * 100);
+    int regressions = 0;
+    for (const Result& r : results)
+    {
+        auto base = baseline.find(ResultKey(r));
+        if (base == baseline.end())
+        {
+            std::printf("  %-52s  new, not in baseline\n", ResultKey(r).c_str());
+            continue;
+        }
+        double change = r.nsPerOp / base->second.nsPerOp - 1.0;
+        bool regressed = change > threshold;
+        if (regressed)  ++regressions;
+        std::printf("  %-52s  %9.3f -> %9.3f ns  %+6.1f%%%s\n", ResultKey(r).c_str(),
+                    base->second.nsPerOp, r.nsPerOp, change * 100, regressed ? "  REGRESSION" : "");
+    }
+    return regressions;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Main
+-----------------------------------------------------------------------------------------*/
+
+int main(int argc, char* argv[])
+{
+    bool quick = false;
+    std::string filter, jsonFile, baselineFile, meshFile = "Troll.x";
+    double threshold = 0.1;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if      (arg == "--quick")                  quick = true;
+        else if (arg == "--filter"    && hasValue)  filter = argv[++i];
+        else if (arg == "--mesh"      && hasValue)  meshFile = argv[++i];
+        else if (arg == "--json"      && hasValue)  jsonFile = argv[++i];
+        else if (arg == "--baseline"  && hasValue)  baselineFile = argv[++i];
+        else if (arg == "--threshold" && hasValue)  threshold = std::atof(argv[++i]);
+        else
+        {
+            std::fprintf(stderr, "Usage: %s [--quick] [--filter text] [--mesh file] [--json file] [--baseline file] [--threshold fraction]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    // Read the baseline first so a bad file name is reported before the long benchmark run
+    std::map<std::string, Result> baseline;
+    if (!baselineFile.empty() && !ReadJson(baselineFile, baseline))
+    {
+        std::fprintf(stderr, "Cannot read baseline file %s\n", baselineFile.c_str());
+        return 2;
+    }
+
+    // The SIMD levels to time, from none up to the best this CPU supports
+    std::vector<SimdLevel> levels = { SimdLevel::None };
+    SimdLevel supported = GetSupportedSimdLevel();
+    for (SimdLevel level : { SimdLevel::SSE41, SimdLevel::AVX2, SimdLevel::AVX512 })
+    {
+        if (level <= supported)  levels.push_back(level);
+    }
+    std::printf("Supported SIMD level: %s\n", SimdLevelName(supported));
+
+    if (LoadMesh(meshFile))
+    {
+        std::printf("Mesh benchmarks use the %d vertices of %s, repeated to make %d\n\n",
+                    static_cast<int>(gMeshPositions.size()), meshFile.c_str(), MeshBenchmarkCount());
+    }
+    else
+    {
+        std::printf("Cannot read the vertices of %s, skipping the mesh benchmarks\n\n", meshFile.c_str());
+    }
+
+    double minTime = quick ? 0.005 : 0.05;
+    std::printf("%-30s %-8s %-5s %10s %12s %14s\n", "Benchmark", "SIMD", "Size", "Count", "ns/op", "ops/s");
+
+    std::vector<Result> results;
+    for (const Benchmark& benchmark : Benchmarks())
+    {
+        if (!filter.empty() && std::string(benchmark.name).find(filter) == std::string::npos)  continue;
+
+        // Benchmarks with a fixed count are timed once at that size
+        std::vector<DataSize> sizes(std::begin(gDataSizes), std::end(gDataSizes));
+        if (benchmark.count > 0)  sizes = { { "Fixed", benchmark.count * benchmark.bytesPerOp } };
+        for (const DataSize& size : sizes)
+        {
+            int count = size.bytes / benchmark.bytesPerOp;
+            gData.Clear();
+            benchmark.setup(count);
+
+            for (SimdLevel level : levels)
+            {
+                if (!benchmark.simd && level != SimdLevel::None)  break;
+                SetSimdLevel(level);
+
+                double nsPerOp = TimeBenchmark(benchmark, count, minTime) * 1e9 / count;
+                Result r = { benchmark.name, benchmark.simd ? SimdLevelName(level) : "Scalar", size.name, count, nsPerOp };
+                std::printf("%-30s %-8s %-5s %10d %12.3f %14.0f\n", r.name.c_str(), r.simd.c_str(), r.size.c_str(), count, nsPerOp, 1e9 / nsPerOp);
+                results.push_back(r);
+            }
+        }
+    }
+    SetSimdLevel(supported);
+    gData.Clear();
+
+    if (!jsonFile.empty() && !WriteJson(jsonFile, results))
+    {
+        std::fprintf(stderr, "Cannot write results file %s\n", jsonFile.c_str());
+        return 2;
+    }
+
+    if (!baselineFile.empty())
+    {
+        int regressions = CompareWithBaseline(results, baseline, threshold);
+        if (regressions > 0)
+        {
+            std::printf("\n%d result(s) slower than the baseline by more than %.0f%%\n", regressions, threshold * 100);
+            return 1;
+        }
+        std::printf("\nNo regressions\n");
+    }
+    return 0;
+}
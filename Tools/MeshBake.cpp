@@ -0,0 +1,1099 @@
+//--------------------------------------------------------------------------------------
+// Mesh bake - imports mesh files and writes the cooked files that the app loads instead
+//--------------------------------------------------------------------------------------
+// A separate command line program, not part of the Visual Studio project. It runs the same import
+// as the Mesh class (see MeshData.h) without a device, so runs on any platform with assimp, e.g.
+// from the repository folder on Linux (one command, split over three lines here):
+//     g++ -O2 -std=c++14 -I. -IMath Tools/MeshBake.cpp MeshData.cpp CookedMesh.cpp MeshCompression.cpp MeshOptimise.cpp
+//         MeshSimplify.cpp MeshClusters.cpp MeshInterleave.cpp MeshTangents.cpp MeshSkinning.cpp MeshMorph.cpp Math/SIMD.cpp
+//         Math/CMatrix4x4.cpp Math/CVector3.cpp Math/MathHelpersSIMD.cpp -lassimp -pthread -o mesh-bake
+//
+// Pass any number of mesh files and folders. Folders are searched recursively for files that assimp
+// can import. Each mesh is cooked without and with tangents, since the app loads meshes both ways,
+// and the cooked files are written next to the mesh file. Meshes are processed in parallel, one
+// worker per CPU core by default. Cooked files that are already up to date are left alone.
+//
+// A report is printed with the vertex/index counts, sizes and time for each stage of each mesh, and
+// the vertex cache use (ACMR and ATVR, see MeshOptimise.h) before and after the import reordered the
+// triangles. A second table gives the triangle count and estimated error of each level of detail
+// (see MeshSimplify.h) and the number of culling clusters (see MeshClusters.h). The figures are kept in the cooked files so are also shown for meshes already
+// up to date.
+// With --compress the meshes are also converted to the compressed vertex layout the app can use
+// (see MeshCompression.h) and the sizes and largest errors are reported. The cooked files always
+// hold full precision data so are not affected.
+// With --interleave, after baking, each mesh's vertices are rebuilt from separate attribute arrays with
+// the original one-pass-per-attribute loops and with each version of InterleaveVertices (see
+// MeshInterleave.h), and the times are reported largest mesh first. This runs on one thread.
+// With --tangent-threads, after baking, the tangents of each mesh cooked with tangents are calculated
+// again (see MeshTangents.h) on 1, 2, 4... threads up to one per CPU core, and the times and speed-up
+// are reported, checking every thread count gives the same tangents.
+// With --skinning, after baking, each mesh is imported again with a skin (see MeshSkinning.h) and posed,
+// then skinned with each version of SkinVertices on one thread, and by a SkinningEngine skinning many
+// copies of it (like a crowd of characters) on 1, 2, 4... threads. Speeds are reported in millions of
+// vertices per second, checking every version gives the same vertices.
+// With --morphs, after baking, each mesh is given morph targets (see MeshMorph.h) and their deltas are added
+// with each version of AccumulateMorphDeltas. Then an instance with two targets changing is updated, which
+// only rebuilds the ranges those targets touch, and compared with rebuilding all of its vertices. Times
+// and the bytes each would upload are reported, checking every version gives the same vertices.
+//
+// Options:
+//     --tangents <both|yes|no>  Which cooked files to write, default both
+//     --jobs <count>            Number of worker threads, default one per CPU core
+//     --force                   Write cooked files even if they are up to date
+//     --compress                Report the compressed vertex layout sizes and errors
+//     --interleave              Benchmark building the interleaved vertices
+//     --tangent-threads         Benchmark tangent generation on different numbers of threads
+//     --skinning                Benchmark CPU skinning
+//     --morphs                  Benchmark morph targets
+//     --json <file>             Also write the report to a JSON file
+//
+// Exits with code 1 if any mesh failed to import or its cooked file couldn't be written.
+
+#include "MeshData.h"
+#include "CookedMesh.h"
+#include "MeshCompression.h"
+#include "MeshInterleave.h"
+#include "MeshTangents.h"
+#include "MeshSkinning.h"
+#include "MeshMorph.h"
+#include "CVector2.h"
+#include "CVector3.h"
+#include "SIMD.h"
+
+#include <assimp/Importer.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <dirent.h>
+    #include <sys/stat.h>
+#endif
+
+
+/*-----------------------------------------------------------------------------------------
+    Finding mesh files
+-----------------------------------------------------------------------------------------*/
+
+// Return true if assimp can import the given file, judging by its extension
+bool IsMeshFile(const Assimp::Importer& importer, const std::string& fileName)
+{
+    size_t dot = fileName.find_last_of('.');
+    if (dot == std::string::npos || fileName.find_first_of("/\\", dot) != std::string::npos)  return false;
+    return importer.IsExtensionSupported(fileName.substr(dot));
+}
+
+// Add the mesh files in the given folder and its subfolders to the list
+void FindMeshFiles(const Assimp::Importer& importer, const std::string& folder, std::vector<std::string>& files)
+{
+#ifdef _WIN32
+    WIN32_FIND_DATAA data;
+    HANDLE find = FindFirstFileA((folder + "\\*").c_str(), &data);
+    if (find == INVALID_HANDLE_VALUE)  return;
+    do
+    {
+        std::string name = data.cFileName;
+        if (name == "." || name == "..")  continue;
+        std::string path = folder + "\\" + name;
+        if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)  FindMeshFiles(importer, path, files);
+        else if (IsMeshFile(importer, path))                    files.push_back(path);
+    } while (FindNextFileA(find, &data));
+    FindClose(find);
+#else
+    DIR* dir = opendir(folder.c_str());
+    if (dir == nullptr)  return;
+    while (dirent* entry = readdir(dir))
+    {
+        std::string name = entry->d_name;
+        if (name == "." || name == "..")  continue;
+        std::string path = folder + "/" + name;
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0)  continue;
+        if (S_ISDIR(info.st_mode))                                   FindMeshFiles(importer, path, files);
+        else if (S_ISREG(info.st_mode) && IsMeshFile(importer, path))  files.push_back(path);
+    }
+    closedir(dir);
+#endif
+}
+
+// Return true if the given path is a folder
+bool IsFolder(const std::string& path)
+{
+#ifdef _WIN32
+    DWORD attributes = GetFileAttributesA(path.c_str());
+    return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+#else
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+#endif
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Baking
+-----------------------------------------------------------------------------------------*/
+
+// One cooked file to write - a mesh file with or without tangents - and the outcome
+struct Job
+{
+    Job(const std::string& meshFileName, bool withTangents) : fileName(meshFileName), tangents(withTangents) {}
+
+    std::string fileName;
+    bool        tangents;
+    uint64_t    sourceHash = 0;
+
+    enum class Status { Baked, UpToDate, Failed } status = Status::Failed;
+    std::string     error;
+    unsigned int    numSubMeshes = 0;
+    unsigned int    numVertices  = 0;
+    unsigned int    numIndices   = 0;
+    unsigned int    vertexSize   = 0;
+    MeshImportStats stats;
+    double          writeSeconds = 0;
+    MeshCacheStats  cacheBefore;
+    MeshCacheStats  cacheAfter;
+    unsigned int    numClusters = 0;
+    unsigned int    numLods = 0;                  // Levels of detail of the sub-mesh with the most
+    unsigned int    lodTriangles[MESH_MAX_LODS] = {}; // Triangles in each level over all sub-meshes
+    float           lodError[MESH_MAX_LODS] = {};     // Largest error of each level over all sub-meshes
+
+    bool                 compressed = false; // Whether the compression below was done
+    MeshCompressionStats compression;
+};
+
+// Fill in the level of detail figures of a job from the sub-mesh table
+void CountLods(Job& job, const CookedSubMesh* subMeshes)
+{
+    for (unsigned int i = 0; i < job.numSubMeshes; ++i)
+    {
+        job.numLods = std::max(job.numLods, subMeshes[i].numLods);
+        for (unsigned int lod = 0; lod < MESH_MAX_LODS; ++lod)
+        {
+            job.lodTriangles[lod] += subMeshes[i].lods[lod].numIndices / 3;
+            job.lodError[lod] = std::max(job.lodError[lod], subMeshes[i].lods[lod].error);
+        }
+    }
+}
+
+// Import a mesh and write its cooked file, filling in the outcome in the job. Optionally compress the
+// mesh data too, for the report only
+void Bake(Job& job, bool force, bool compress)
+{
+    try
+    {
+        std::string cookedFileName = CookedMeshFileName(job.fileName, job.tangents);
+        auto start = std::chrono::steady_clock::now();
+        uint64_t sourceHash = MeshSourceHash(job.fileName, job.tangents);
+        if (sourceHash == 0)  throw std::runtime_error("Cannot read file");
+        job.sourceHash = sourceHash;
+        job.stats.hashSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (!force)
+        {
+            CookedMeshFile cooked(cookedFileName, sourceHash);
+            if (cooked.IsValid())
+            {
+                job.status       = Job::Status::UpToDate;
+                job.numSubMeshes = cooked.Header().numSubMeshes;
+                job.numVertices  = cooked.Header().numVertices;
+                job.numIndices   = cooked.Header().numIndices;
+                job.vertexSize   = cooked.Header().vertexSize;
+                job.numClusters  = cooked.Header().numClusters;
+                job.cacheBefore  = MeshCacheTotals(cooked.SubMeshes(), job.numSubMeshes, false);
+                job.cacheAfter   = MeshCacheTotals(cooked.SubMeshes(), job.numSubMeshes, true);
+                CountLods(job, cooked.SubMeshes());
+                if (compress)
+                {
+                    const CookedMeshHeader& header = cooked.Header();
+                    job.compression = CompressMesh(cooked.Elements(), header.numElements, header.vertexSize, cooked.Vertices(),
+                                                   header.numVertices, cooked.Indices(), header.numIndices).stats;
+                    job.compressed = true;
+                }
+                return;
+            }
+        }
+
+        MeshData mesh = ImportMeshData(job.fileName, job.tangents, sourceHash);
+        job.numSubMeshes = static_cast<unsigned int>(mesh.subMeshes.size());
+        job.numVertices  = mesh.numVertices;
+        job.numIndices   = mesh.numIndices;
+        job.vertexSize   = mesh.vertexSize;
+        job.numClusters  = static_cast<unsigned int>(mesh.clusters.size());
+        job.cacheBefore  = MeshCacheTotals(mesh.subMeshes.data(), job.numSubMeshes, false);
+        job.cacheAfter   = MeshCacheTotals(mesh.subMeshes.data(), job.numSubMeshes, true);
+        CountLods(job, mesh.subMeshes.data());
+        job.stats.importSeconds   = mesh.stats.importSeconds;
+        job.stats.extractSeconds  = mesh.stats.extractSeconds;
+        job.stats.indexSeconds    = mesh.stats.indexSeconds;
+        job.stats.tangentSeconds  = mesh.stats.tangentSeconds;
+        job.stats.optimiseSeconds = mesh.stats.optimiseSeconds;
+        job.stats.simplifySeconds = mesh.stats.simplifySeconds;
+        job.stats.clusterSeconds  = mesh.stats.clusterSeconds;
+
+        start = std::chrono::steady_clock::now();
+        if (!WriteCookedMesh(cookedFileName, mesh))  throw std::runtime_error("Cannot write " + cookedFileName);
+        job.writeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        job.status = Job::Status::Baked;
+
+        if (compress)
+        {
+            job.compression = CompressMesh(mesh.vertexElements.data(), static_cast<unsigned int>(mesh.vertexElements.size()), mesh.vertexSize,
+                                           mesh.vertices.get(), mesh.numVertices, mesh.indices.get(), mesh.numIndices).stats;
+            job.compressed = true;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        job.status = Job::Status::Failed;
+        job.error  = e.what();
+    }
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Report
+-----------------------------------------------------------------------------------------*/
+
+const char* StatusName(Job::Status status)
+{
+    switch (status)
+    {
+        case Job::Status::Baked:    return "baked";
+        case Job::Status::UpToDate: return "up to date";
+        default:                    return "FAILED";
+    }
+}
+
+void PrintReport(const std::vector<Job>& jobs, double wallSeconds, int numWorkers)
+{
+    std::printf("%-40s %-8s %-10s %10s %10s %10s %12s %12s %10s %10s %10s %10s %10s %11s %11s %10s %8s %8s %8s %8s\n", "Mesh", "Tangents", "Status",
+                "Sub-meshes", "Vertices", "Indices", "VB bytes", "IB bytes", "Hash ms", "Import ms", "Extract ms", "Index ms", "Tangent ms",
+                "Optimise ms", "Simplify ms", "Write ms", "ACMR in", "ACMR out", "ATVR in", "ATVR out");
+
+    double total[8] = {};
+    unsigned long long totalVertexBytes = 0, totalIndexBytes = 0;
+    int counts[3] = {};
+    MeshCacheStats cacheBefore, cacheAfter;
+    for (const Job& job : jobs)
+    {
+        unsigned long long vertexBytes = static_cast<unsigned long long>(job.numVertices) * job.vertexSize;
+        unsigned long long indexBytes  = static_cast<unsigned long long>(job.numIndices) * sizeof(uint32_t);
+        std::printf("%-40s %-8s %-10s %10u %10u %10u %12llu %12llu %10.2f %10.2f %10.2f %10.2f %10.2f %11.2f %11.2f %10.2f %8.3f %8.3f %8.3f %8.3f\n",
+                    job.fileName.c_str(), job.tangents ? "yes" : "no", StatusName(job.status), job.numSubMeshes, job.numVertices, job.numIndices,
+                    vertexBytes, indexBytes, job.stats.hashSeconds * 1000, job.stats.importSeconds * 1000, job.stats.extractSeconds * 1000,
+                    job.stats.indexSeconds * 1000, job.stats.tangentSeconds * 1000, job.stats.optimiseSeconds * 1000, job.stats.simplifySeconds * 1000, job.writeSeconds * 1000,
+                    job.cacheBefore.ACMR(), job.cacheAfter.ACMR(), job.cacheBefore.ATVR(), job.cacheAfter.ATVR());
+        if (job.status == Job::Status::Failed)  std::printf("    %s\n", job.error.c_str());
+
+        ++counts[static_cast<int>(job.status)];
+        totalVertexBytes += vertexBytes;
+        totalIndexBytes  += indexBytes;
+        total[0] += job.stats.hashSeconds;
+        total[1] += job.stats.importSeconds;
+        total[2] += job.stats.extractSeconds;
+        total[3] += job.stats.indexSeconds;
+        total[4] += job.stats.tangentSeconds;
+        total[5] += job.stats.optimiseSeconds;
+        total[6] += job.stats.simplifySeconds;
+        total[7] += job.writeSeconds;
+        cacheBefore += job.cacheBefore;
+        cacheAfter  += job.cacheAfter;
+    }
+
+    std::printf("\n%d baked, %d up to date, %d failed. %llu vertex bytes, %llu index bytes\n",
+                counts[0], counts[1], counts[2], totalVertexBytes, totalIndexBytes);
+    std::printf("Time summed over meshes: hash %.1f ms, import %.1f ms, extract %.1f ms, index %.1f ms, tangents %.1f ms, optimise %.1f ms, simplify %.1f ms, write %.1f ms\n",
+                total[0] * 1000, total[1] * 1000, total[2] * 1000, total[3] * 1000, total[4] * 1000, total[5] * 1000, total[6] * 1000, total[7] * 1000);
+    std::printf("Vertex cache (%u entry FIFO) over all meshes: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", VERTEX_CACHE_FIFO_SIZE,
+                cacheBefore.ACMR(), cacheAfter.ACMR(), cacheBefore.ATVR(), cacheAfter.ATVR());
+    std::printf("Wall time %.1f ms with %d worker(s)\n", wallSeconds * 1000, numWorkers);
+
+    // Levels of detail, triangles and the largest estimated error (model space distance) of each, then the
+    // culling clusters of the full detail level
+    std::printf("\nLevels of detail and clusters\n");
+    std::printf("%-40s %-8s %5s", "Mesh", "Tangents", "LODs");
+    for (unsigned int lod = 0; lod < MESH_MAX_LODS; ++lod)  std::printf("   LOD%u tris  LOD%u error", lod, lod);
+    std::printf(" %9s %11s %11s\n", "Clusters", "Tris each", "Cluster ms");
+    for (const Job& job : jobs)
+    {
+        if (job.status == Job::Status::Failed)  continue;
+        std::printf("%-40s %-8s %5u", job.fileName.c_str(), job.tangents ? "yes" : "no", job.numLods);
+        for (unsigned int lod = 0; lod < MESH_MAX_LODS; ++lod)  std::printf(" %11u %11.5f", job.lodTriangles[lod], job.lodError[lod]);
+        std::printf(" %9u %11.1f %11.2f\n", job.numClusters, job.numClusters > 0 ? static_cast<float>(job.lodTriangles[0]) / job.numClusters : 0.0f,
+                    job.stats.clusterSeconds * 1000);
+    }
+
+    // Compressed layout sizes and errors, if requested
+    if (std::none_of(jobs.begin(), jobs.end(), [](const Job& job) { return job.compressed; }))  return;
+    std::printf("\nCompressed vertex layout\n");
+    std::printf("%-40s %-8s %12s %12s %12s %12s %8s %12s %11s %11s %10s %10s\n", "Mesh", "Tangents", "VB bytes", "Compressed",
+                "IB bytes", "Compressed", "Saved", "Max pos err", "Normal deg", "Tangent deg", "UV err", "Time ms");
+    unsigned long long totalBefore = 0, totalAfter = 0;
+    for (const Job& job : jobs)
+    {
+        if (!job.compressed)  continue;
+        const MeshCompressionStats& stats = job.compression;
+        std::printf("%-40s %-8s %12u %12u %12u %12u %7.1f%% %12.6f %11.4f %11.4f %10.6f %10.2f\n", job.fileName.c_str(),
+                    job.tangents ? "yes" : "no", stats.vertexBytesBefore, stats.vertexBytesAfter, stats.indexBytesBefore, stats.indexBytesAfter,
+                    stats.BytesBefore() > 0 ? 100.0 * (stats.BytesBefore() - stats.BytesAfter()) / stats.BytesBefore() : 0.0,
+                    stats.maxPositionError, stats.maxNormalError, stats.maxTangentError, stats.maxUVError, stats.seconds * 1000);
+        totalBefore += stats.BytesBefore();
+        totalAfter  += stats.BytesAfter();
+    }
+    std::printf("\n%llu bytes -> %llu bytes compressed (%.1f%% saved)\n", totalBefore, totalAfter,
+                totalBefore > 0 ? 100.0 * (totalBefore - totalAfter) / totalBefore : 0.0);
+}
+
+// Escape backslashes and quotes for a JSON string
+std::string JsonString(const std::string& text)
+{
+    std::string result;
+    for (char c : text)
+    {
+        if (c == '\\' || c == '"')  result += '\\';
+        result += c;
+    }
+    return result;
+}
+
+bool WriteJson(const std::string& fileName, const std::vector<Job>& jobs, double wallSeconds, int numWorkers)
+{
+    std::ofstream file(fileName);
+    if (!file)  return false;
+
+    file << "{\n";
+    file << "  \"workers\": " << numWorkers << ",\n";
+    file << "  \"wall_ms\": " << wallSeconds * 1000 << ",\n";
+    file << "  \"meshes\": [\n";
+    for (size_t i = 0; i < jobs.size(); ++i)
+    {
+        const Job& job = jobs[i];
+        char line[1024];
+        std::snprintf(line, sizeof(line),
+                      "    {\"file\": \"%s\", \"tangents\": %s, \"status\": \"%s\", \"sub_meshes\": %u, \"vertices\": %u, \"indices\": %u, "
+                      "\"vertex_bytes\": %llu, \"index_bytes\": %llu, \"hash_ms\": %.3f, \"import_ms\": %.3f, "
+                      "\"extract_ms\": %.3f, \"index_ms\": %.3f, \"tangent_ms\": %.3f, \"optimise_ms\": %.3f, \"simplify_ms\": %.3f, \"cluster_ms\": %.3f, \"write_ms\": %.3f, "
+                      "\"acmr_before\": %.4f, \"acmr_after\": %.4f, \"atvr_before\": %.4f, \"atvr_after\": %.4f, \"error\": \"%s\"",
+                      JsonString(job.fileName).c_str(), job.tangents ? "true" : "false", StatusName(job.status),
+                      job.numSubMeshes, job.numVertices, job.numIndices, static_cast<unsigned long long>(job.numVertices) * job.vertexSize,
+                      static_cast<unsigned long long>(job.numIndices) * sizeof(uint32_t), job.stats.hashSeconds * 1000,
+                      job.stats.importSeconds * 1000, job.stats.extractSeconds * 1000, job.stats.indexSeconds * 1000,
+                      job.stats.tangentSeconds * 1000, job.stats.optimiseSeconds * 1000, job.stats.simplifySeconds * 1000, job.stats.clusterSeconds * 1000, job.writeSeconds * 1000, job.cacheBefore.ACMR(), job.cacheAfter.ACMR(),
+                      job.cacheBefore.ATVR(), job.cacheAfter.ATVR(), JsonString(job.error).c_str());
+        file << line;
+        file << ", \"lods\": [";
+        for (unsigned int lod = 0; lod < job.numLods; ++lod)
+        {
+            std::snprintf(line, sizeof(line), "%s{\"triangles\": %u, \"error\": %g}", lod > 0 ? ", " : "",
+                          job.lodTriangles[lod], job.lodError[lod]);
+            file << line;
+        }
+        file << "], \"clusters\": " << job.numClusters;
+        if (job.compressed)
+        {
+            const MeshCompressionStats& stats = job.compression;
+            std::snprintf(line, sizeof(line),
+                          ", \"compression\": {\"vertex_bytes\": %u, \"index_bytes\": %u, \"max_position_error\": %g, "
+                          "\"max_normal_degrees\": %g, \"max_tangent_degrees\": %g, \"max_uv_error\": %g, \"ms\": %.3f}",
+                          stats.vertexBytesAfter, stats.indexBytesAfter, stats.maxPositionError, stats.maxNormalError,
+                          stats.maxTangentError, stats.maxUVError, stats.seconds * 1000);
+            file << line;
+        }
+        file << "}" << (i + 1 < jobs.size() ? "," : "") << "\n";
+    }
+    file << "  ]\n";
+    file << "}\n";
+    return true;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Vertex interleaving benchmark
+-----------------------------------------------------------------------------------------*/
+
+// Timings of building one mesh's vertices from separate attribute arrays (see MeshInterleave.h)
+struct InterleaveResult
+{
+    std::string  fileName;
+    bool         tangents = false;
+    unsigned int numVertices = 0;
+    unsigned int vertexSize  = 0;
+    double       seconds[4] = {};  // Best time of each method in InterleaveMethodName order
+    bool         matches = true;   // Whether every method built the same vertices as the strided passes
+};
+
+const int INTERLEAVE_METHODS = 4;
+const char* InterleaveMethodName(int method)
+{
+    static const char* names[INTERLEAVE_METHODS] = { "Strided", "Plain", "SIMD", "Streaming" };
+    return names[method];
+}
+
+// How the import used to extract vertices: a separate pass over the whole vertex array for each attribute
+void InterleaveStrided(const VertexStream* streams, unsigned int numStreams, unsigned char* destination,
+                       unsigned int vertexSize, unsigned int numVertices)
+{
+    for (unsigned int s = 0; s < numStreams; ++s)
+    {
+        const unsigned char* in = static_cast<const unsigned char*>(streams[s].source);
+        unsigned char* out = destination + streams[s].offset;
+        unsigned char* outEnd = out + static_cast<size_t>(numVertices) * vertexSize;
+        while (out != outEnd)
+        {
+            if      (streams[s].size == 12)  *(CVector3*)out = *(const CVector3*)in;
+            else if (streams[s].size == 8)   *(CVector2*)out = *(const CVector2*)in;
+            else                             std::memcpy(out, in, streams[s].size);
+            out += vertexSize;
+            in += streams[s].sourceStride;
+        }
+    }
+}
+
+// Split a cooked mesh's vertices back into one array per attribute, laid out much as assimp holds them (4
+// floats per vertex, even for UVs, to leave room for tangents), then time rebuilding the vertices with the old strided passes and with each
+// version of InterleaveVertices. The best of several runs is kept
+InterleaveResult BenchmarkInterleave(const Job& job)
+{
+    InterleaveResult result;
+    result.fileName = job.fileName;
+    result.tangents = job.tangents;
+
+    CookedMeshFile cooked(CookedMeshFileName(job.fileName, job.tangents), job.sourceHash);
+    if (!cooked.IsValid())  return result;
+    const CookedMeshHeader& header = cooked.Header();
+    result.numVertices = header.numVertices;
+    result.vertexSize  = header.vertexSize;
+
+    std::vector<std::vector<float>> sources(header.numElements);
+    std::vector<VertexStream> streams(header.numElements);
+    for (unsigned int e = 0; e < header.numElements; ++e)
+    {
+        const CookedVertexElement& element = cooked.Elements()[e];
+        unsigned int size = element.format == MESH_FORMAT_R32G32_FLOAT ? 8 : element.format == MESH_FORMAT_R32G32B32A32_FLOAT ? 16 : 12;
+        sources[e].resize(static_cast<size_t>(header.numVertices) * 4);
+        const unsigned char* in = static_cast<const unsigned char*>(cooked.Vertices()) + element.offset;
+        for (unsigned int vertex = 0; vertex < header.numVertices; ++vertex)
+        {
+            std::memcpy(&sources[e][vertex * 4], in + static_cast<size_t>(vertex) * header.vertexSize, size);
+        }
+        streams[e] = { sources[e].data(), 4 * sizeof(float), size, element.offset };
+    }
+
+    size_t bytes = static_cast<size_t>(header.numVertices) * header.vertexSize;
+    std::unique_ptr<unsigned char[]> reference(new unsigned char[bytes]);
+    std::unique_ptr<unsigned char[]> vertices(new unsigned char[bytes]);
+    InterleaveStrided(streams.data(), header.numElements, reference.get(), header.vertexSize, header.numVertices);
+
+    SimdLevel simdLevel = GetSimdLevel();
+    const int RUNS = 10;
+    for (int method = 0; method < INTERLEAVE_METHODS; ++method)
+    {
+        SetSimdLevel(method == 1 ? SimdLevel::None : simdLevel);
+        double best = 0;
+        for (int run = 0; run < RUNS; ++run)
+        {
+            auto start = std::chrono::steady_clock::now();
+            if (method == 0)  InterleaveStrided(streams.data(), header.numElements, vertices.get(), header.vertexSize, header.numVertices);
+            else              InterleaveVertices(streams.data(), header.numElements, vertices.get(), header.vertexSize, header.numVertices,
+                                                 method == 3 ? InterleaveStores::NonTemporal : InterleaveStores::Normal);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (run == 0 || seconds < best)  best = seconds;
+        }
+        result.seconds[method] = best;
+        if (std::memcmp(vertices.get(), reference.get(), bytes) != 0)  result.matches = false;
+    }
+    SetSimdLevel(simdLevel);
+    return result;
+}
+
+void PrintInterleaveReport(std::vector<InterleaveResult>& results)
+{
+    // Largest vertex data first
+    std::sort(results.begin(), results.end(), [](const InterleaveResult& a, const InterleaveResult& b)
+    {
+        return static_cast<unsigned long long>(a.numVertices) * a.vertexSize > static_cast<unsigned long long>(b.numVertices) * b.vertexSize;
+    });
+
+    std::printf("\nVertex interleaving (best of several runs, GB/s of vertex data written, %s)\n", SimdLevelName(GetSimdLevel()));
+    std::printf("%-40s %-8s %12s", "Mesh", "Tangents", "VB bytes");
+    for (int method = 0; method < INTERLEAVE_METHODS; ++method)  std::printf(" %9s ms %9s GB/s", InterleaveMethodName(method), "");
+    std::printf(" %8s\n", "Matches");
+    for (const InterleaveResult& result : results)
+    {
+        if (result.numVertices == 0)  continue;
+        double bytes = static_cast<double>(result.numVertices) * result.vertexSize;
+        std::printf("%-40s %-8s %12.0f", result.fileName.c_str(), result.tangents ? "yes" : "no", bytes);
+        for (int method = 0; method < INTERLEAVE_METHODS; ++method)
+        {
+            double seconds = result.seconds[method];
+            std::printf(" %12.3f %14.2f", seconds * 1000, seconds > 0 ? bytes / seconds * 1e-9 : 0.0);
+        }
+        std::printf(" %8s\n", result.matches ? "yes" : "NO");
+    }
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Tangent generation benchmark
+-----------------------------------------------------------------------------------------*/
+
+// Timings of calculating one mesh's tangents on different numbers of threads (see MeshTangents.h)
+struct TangentResult
+{
+    std::string               fileName;
+    unsigned int              numVertices = 0;
+    unsigned int              numTriangles = 0;
+    std::vector<unsigned int> threads;           // Number of threads for each timing, starting with 1
+    std::vector<double>       seconds;           // Best time for each number of threads
+    bool                      matches = true;    // Whether every number of threads gave the same tangents as one thread
+};
+
+// Recalculate the tangents of a cooked mesh with tangents on 1, 2, 4... threads up to one per CPU core.
+// The best of several runs is kept
+TangentResult BenchmarkTangents(const Job& job)
+{
+    TangentResult result;
+    result.fileName = job.fileName;
+
+    CookedMeshFile cooked(CookedMeshFileName(job.fileName, job.tangents), job.sourceHash);
+    if (!cooked.IsValid())  return result;
+    const CookedMeshHeader& header = cooked.Header();
+    unsigned int offsets[4] = { ~0u, ~0u, ~0u, ~0u }; // Position, normal, UV, tangent
+    const char* names[4] = { "Position", "Normal", "UV", "Tangent" };
+    for (unsigned int e = 0; e < header.numElements; ++e)
+    {
+        for (int n = 0; n < 4; ++n)
+        {
+            if (std::strcmp(cooked.Elements()[e].semanticName, names[n]) == 0)  offsets[n] = cooked.Elements()[e].offset;
+        }
+    }
+    if (std::find(offsets, offsets + 4, ~0u) != offsets + 4)  return result;
+    result.numVertices = header.numVertices;
+    for (unsigned int s = 0; s < header.numSubMeshes; ++s)  result.numTriangles += cooked.SubMeshes()[s].numIndices / 3;
+
+    size_t bytes = static_cast<size_t>(header.numVertices) * header.vertexSize;
+    std::unique_ptr<unsigned char[]> vertices(new unsigned char[bytes]);
+    std::unique_ptr<unsigned char[]> reference(new unsigned char[bytes]);
+    std::memcpy(vertices.get(), cooked.Vertices(), bytes);
+
+    unsigned int maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    for (unsigned int threads = 1; ; threads = std::min(threads * 2, maxThreads))
+    {
+        const int RUNS = 5;
+        double best = 0;
+        for (int run = 0; run < RUNS; ++run)
+        {
+            auto start = std::chrono::steady_clock::now();
+            for (unsigned int s = 0; s < header.numSubMeshes; ++s)
+            {
+                const CookedSubMesh& subMesh = cooked.SubMeshes()[s];
+                GenerateTangents(cooked.Indices() + subMesh.indexStart, subMesh.numIndices,
+                                 vertices.get() + static_cast<size_t>(subMesh.baseVertex) * header.vertexSize, header.vertexSize,
+                                 subMesh.numVertices, offsets[0], offsets[1], offsets[2], offsets[3], threads);
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (run == 0 || seconds < best)  best = seconds;
+        }
+        result.threads.push_back(threads);
+        result.seconds.push_back(best);
+        if (threads == 1)  std::memcpy(reference.get(), vertices.get(), bytes);
+        else if (std::memcmp(vertices.get(), reference.get(), bytes) != 0)  result.matches = false;
+        if (threads == maxThreads)  break;
+    }
+    return result;
+}
+
+void PrintTangentReport(std::vector<TangentResult>& results)
+{
+    // Most triangles first
+    std::sort(results.begin(), results.end(), [](const TangentResult& a, const TangentResult& b) { return a.numTriangles > b.numTriangles; });
+
+    std::printf("\nTangent generation (best of several runs, speed-up over one thread, up to %u threads)\n",
+                std::max(std::thread::hardware_concurrency(), 1u));
+    std::printf("%-40s %10s %10s  %s\n", "Mesh", "Vertices", "Triangles", "Threads: ms (speed-up)");
+    for (const TangentResult& result : results)
+    {
+        if (result.threads.empty())  continue;
+        std::printf("%-40s %10u %10u ", result.fileName.c_str(), result.numVertices, result.numTriangles);
+        for (size_t i = 0; i < result.threads.size(); ++i)
+        {
+            double speedUp = result.seconds[i] > 0 ? result.seconds[0] / result.seconds[i] : 0.0;
+            std::printf(" %u: %.2f (%.2fx)", result.threads[i], result.seconds[i] * 1000, speedUp);
+        }
+        std::printf("%s\n", result.matches ? "" : "  DIFFERENT RESULTS");
+    }
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Skinning benchmark
+-----------------------------------------------------------------------------------------*/
+
+// Versions of SkinVertices timed on one thread, see SkinningMethodName
+const int SKINNING_METHODS = 4;
+
+// Copies of each mesh skinned by the engine, fewer for large meshes so the total stays below the vertex limit
+const unsigned int SKINNING_INSTANCES    = 100;
+const unsigned int SKINNING_MAX_VERTICES = 4000000;
+
+const char* SkinningMethodName(int method)
+{
+    static const char* names[SKINNING_METHODS] = { "Plain", "SSE4.1", "AVX2", "AVX2 NT" };
+    return names[method];
+}
+
+// Timings of skinning one mesh (see MeshSkinning.h)
+struct SkinningResult
+{
+    std::string               fileName;
+    bool                      tangents = false;
+    unsigned int              numVertices = 0;
+    unsigned int              numBones = 0;
+    unsigned int              numInstances = 0;
+    double                    seconds[SKINNING_METHODS] = {}; // Best time for one copy on one thread, 0 if not supported
+    std::vector<unsigned int> threads;                        // Number of engine threads for each timing, starting with 1
+    std::vector<double>       engineSeconds;                  // Best time to skin all the copies
+    bool                      matches = true;                 // Whether every version gave the same vertices as the plain one
+    std::string               error;
+};
+
+// Import a mesh with a skin, pose it and time skinning it with each version of SkinVertices, then many copies
+// of it with a SkinningEngine on 1, 2, 4... threads up to one per CPU core. The best of several runs is kept
+SkinningResult BenchmarkSkinning(const Job& job)
+{
+    SkinningResult result;
+    result.fileName = job.fileName;
+    result.tangents = job.tangents;
+
+    MeshData mesh;
+    try
+    {
+        mesh = ImportMeshData(job.fileName, job.tangents, 0, true);
+    }
+    catch (const std::exception& e)
+    {
+        result.error = e.what();
+        return result;
+    }
+
+    SkinVertexLayout layout;
+    layout.sourceSize = mesh.vertexSize;
+    for (const CookedVertexElement& element : mesh.vertexElements)
+    {
+        std::string name = element.semanticName;
+        if      (name == "Position")      layout.positionOffset     = element.offset;
+        else if (name == "Normal")        layout.normalOffset       = element.offset;
+        else if (name == "Tangent")       layout.tangentOffset      = element.offset;
+        else if (name == "BlendIndices")  layout.blendIndicesOffset = element.offset;
+        else if (name == "BlendWeights")  layout.blendWeightsOffset = element.offset;
+    }
+    layout.skinnedSize = std::min(layout.blendIndicesOffset, layout.blendWeightsOffset);
+    result.numVertices = mesh.numVertices;
+    result.numBones    = static_cast<unsigned int>(mesh.bones.size());
+
+    // Sway each bone from its bind pose, as the app does
+    std::vector<CMatrix4x4> localMatrices(mesh.bones.size()), skinMatrices(mesh.bones.size());
+    for (size_t b = 0; b < mesh.bones.size(); ++b)
+    {
+        localMatrices[b] = MatrixRotationZ(0.25f * std::sin(1.0f - b * 0.5f)) * BoneBindLocal(mesh.bones[b]);
+    }
+    CalculateSkinMatrices(mesh.bones.data(), result.numBones, localMatrices.data(), skinMatrices.data());
+
+    size_t bytes = static_cast<size_t>(mesh.numVertices) * layout.skinnedSize;
+    std::unique_ptr<unsigned char[]> reference(new unsigned char[bytes]);
+    std::unique_ptr<unsigned char[]> vertices(new unsigned char[bytes]);
+    SimdLevel simdLevel = GetSimdLevel();
+    SetSimdLevel(SimdLevel::None);
+    SkinVertices(skinMatrices.data(), layout, mesh.vertices.get(), reference.get(), mesh.numVertices);
+
+    const int RUNS = 10;
+    for (int method = 0; method < SKINNING_METHODS; ++method)
+    {
+        SimdLevel level = (method == 0) ? SimdLevel::None : (method == 1 ? SimdLevel::SSE41 : SimdLevel::AVX2);
+        if (level > GetSupportedSimdLevel())  continue;
+        SetSimdLevel(level);
+        SkinStores stores = (method == 3) ? SkinStores::NonTemporal : SkinStores::Normal;
+        double best = 0;
+        for (int run = 0; run < RUNS; ++run)
+        {
+            auto start = std::chrono::steady_clock::now();
+            SkinVertices(skinMatrices.data(), layout, mesh.vertices.get(), vertices.get(), mesh.numVertices, stores);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (run == 0 || seconds < best)  best = seconds;
+        }
+        result.seconds[method] = best;
+        if (std::memcmp(vertices.get(), reference.get(), bytes) != 0)  result.matches = false;
+    }
+    SetSimdLevel(simdLevel);
+
+    // Many copies, each into its own buffer as each character has its own vertex buffer
+    result.numInstances = std::max(std::min(SKINNING_INSTANCES, SKINNING_MAX_VERTICES / std::max(mesh.numVertices, 1u)), 1u);
+    std::vector<std::unique_ptr<unsigned char[]>> instances;
+    for (unsigned int i = 0; i < result.numInstances; ++i)  instances.emplace_back(new unsigned char[bytes]);
+    unsigned int maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    for (unsigned int threads = 1; ; threads = std::min(threads * 2, maxThreads))
+    {
+        SkinningEngine engine(threads);
+        const int ENGINE_RUNS = 5;
+        double best = 0;
+        for (int run = 0; run < ENGINE_RUNS; ++run)
+        {
+            auto start = std::chrono::steady_clock::now();
+            for (auto& instance : instances)
+            {
+                engine.Add(skinMatrices.data(), layout, mesh.vertices.get(), instance.get(), mesh.numVertices, SkinStores::NonTemporal);
+            }
+            engine.Run();
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (run == 0 || seconds < best)  best = seconds;
+        }
+        result.threads.push_back(threads);
+        result.engineSeconds.push_back(best);
+        for (auto& instance : instances)
+        {
+            if (std::memcmp(instance.get(), reference.get(), bytes) != 0)  result.matches = false;
+        }
+        if (threads == maxThreads)  break;
+    }
+    return result;
+}
+
+void PrintSkinningReport(std::vector<SkinningResult>& results)
+{
+    // Most vertices first
+    std::sort(results.begin(), results.end(), [](const SkinningResult& a, const SkinningResult& b) { return a.numVertices > b.numVertices; });
+
+    std::printf("\nSkinning (best of several runs, M vertices/s, supported up to %s, engine up to %u threads)\n",
+                SimdLevelName(GetSupportedSimdLevel()), std::max(std::thread::hardware_concurrency(), 1u));
+    std::printf("%-40s %-8s %10s %6s", "Mesh", "Tangents", "Vertices", "Bones");
+    for (int method = 0; method < SKINNING_METHODS; ++method)  std::printf(" %10s", SkinningMethodName(method));
+    std::printf(" %8s  %s\n", "Matches", "Engine copies, threads: M vertices/s (speed-up)");
+    for (const SkinningResult& result : results)
+    {
+        if (!result.error.empty())
+        {
+            std::printf("%-40s %-8s FAILED: %s\n", result.fileName.c_str(), result.tangents ? "yes" : "no", result.error.c_str());
+            continue;
+        }
+        std::printf("%-40s %-8s %10u %6u", result.fileName.c_str(), result.tangents ? "yes" : "no", result.numVertices, result.numBones);
+        for (int method = 0; method < SKINNING_METHODS; ++method)
+        {
+            double seconds = result.seconds[method];
+            if (seconds > 0)  std::printf(" %10.1f", result.numVertices / seconds * 1e-6);
+            else              std::printf(" %10s", "-");
+        }
+        std::printf(" %8s  %u copies,", result.matches ? "yes" : "NO", result.numInstances);
+        double vertices = static_cast<double>(result.numVertices) * result.numInstances;
+        for (size_t i = 0; i < result.threads.size(); ++i)
+        {
+            double speedUp = result.engineSeconds[i] > 0 ? result.engineSeconds[0] / result.engineSeconds[i] : 0.0;
+            std::printf(" %u: %.1f (%.2fx)", result.threads[i], result.engineSeconds[i] > 0 ? vertices / result.engineSeconds[i] * 1e-6 : 0.0, speedUp);
+        }
+        std::printf("\n");
+    }
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Morph target benchmark
+-----------------------------------------------------------------------------------------*/
+
+// Versions of AccumulateMorphDeltas timed, see MorphMethodName
+const int MORPH_METHODS = 2;
+
+const char* MorphMethodName(int method)
+{
+    static const char* names[MORPH_METHODS] = { "Plain", "SSE4.1" };
+    return names[method];
+}
+
+// Timings of morphing one mesh (see MeshMorph.h)
+struct MorphResult
+{
+    std::string  fileName;
+    bool         tangents = false;
+    unsigned int numVertices = 0;
+    unsigned int numTargets = 0;
+    unsigned int numDeltas = 0;                 // Of all the targets
+    double       seconds[MORPH_METHODS] = {};   // Best time to add every target's deltas, 0 if not supported
+    double       updateSeconds = 0;             // Best time for an instance update with two targets changing...
+    double       rebuildSeconds = 0;            // ...and to rebuild all the vertices with the same weights instead
+    unsigned int updateBytes = 0;               // Bytes the update would upload, the rebuild uploads all the vertices
+    unsigned int rebuildBytes = 0;
+    bool         matches = true;                // Whether every version gave the same vertices as the plain one
+    std::string  error;
+};
+
+// Import a mesh, give it morph targets and time adding their deltas with each version of AccumulateMorphDeltas,
+// then time updating an instance against rebuilding all its vertices. The best of several runs is kept
+MorphResult BenchmarkMorphs(const Job& job)
+{
+    MorphResult result;
+    result.fileName = job.fileName;
+    result.tangents = job.tangents;
+
+    MeshData mesh;
+    try
+    {
+        mesh = ImportMeshData(job.fileName, job.tangents);
+    }
+    catch (const std::exception& e)
+    {
+        result.error = e.what();
+        return result;
+    }
+
+    MorphVertexLayout layout;
+    layout.vertexSize = mesh.vertexSize;
+    for (const CookedVertexElement& element : mesh.vertexElements)
+    {
+        std::string name = element.semanticName;
+        if      (name == "Position")  layout.positionOffset = element.offset;
+        else if (name == "Normal")    layout.normalOffset   = element.offset;
+    }
+    std::vector<MorphTarget> targets;
+    BuildBulgeTargets(mesh.vertices.get(), layout, mesh.numVertices, MORPH_BULGE_TARGETS, targets);
+    result.numVertices = mesh.numVertices;
+    result.numTargets  = static_cast<unsigned int>(targets.size());
+    for (const MorphTarget& target : targets)  result.numDeltas += static_cast<unsigned int>(target.deltas.size());
+    if (targets.size() < 2)
+    {
+        result.error = "Too few morph targets";
+        return result;
+    }
+
+    size_t bytes = static_cast<size_t>(mesh.numVertices) * layout.vertexSize;
+    std::unique_ptr<unsigned char[]> reference(new unsigned char[bytes]);
+    std::unique_ptr<unsigned char[]> vertices(new unsigned char[bytes]);
+    auto addAll = [&](unsigned char* out)
+    {
+        std::memcpy(out, mesh.vertices.get(), bytes);
+        for (const MorphTarget& target : targets)
+        {
+            AccumulateMorphDeltas(target.deltas.data(), static_cast<unsigned int>(target.deltas.size()), 0.5f, layout, out);
+        }
+    };
+    SimdLevel simdLevel = GetSimdLevel();
+    SetSimdLevel(SimdLevel::None);
+    addAll(reference.get());
+
+    const int RUNS = 20;
+    for (int method = 0; method < MORPH_METHODS; ++method)
+    {
+        SimdLevel level = (method == 0) ? SimdLevel::None : SimdLevel::SSE41;
+        if (level > GetSupportedSimdLevel())  continue;
+        SetSimdLevel(level);
+        double best = 0;
+        for (int run = 0; run < RUNS; ++run)
+        {
+            std::memcpy(vertices.get(), mesh.vertices.get(), bytes);
+            auto start = std::chrono::steady_clock::now();
+            for (const MorphTarget& target : targets)
+            {
+                AccumulateMorphDeltas(target.deltas.data(), static_cast<unsigned int>(target.deltas.size()), 0.5f, layout, vertices.get());
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (run == 0 || seconds < best)  best = seconds;
+        }
+        result.seconds[method] = best;
+        if (std::memcmp(vertices.get(), reference.get(), bytes) != 0)  result.matches = false;
+    }
+    SetSimdLevel(simdLevel);
+
+    // An instance with the first two targets changing weight each update, as a blob in the app easing them in.
+    // The rebuild copies all the vertices and adds the deltas of the same two targets
+    MorphedVertices instance(targets.data(), result.numTargets, layout, mesh.vertices.get(), mesh.numVertices);
+    for (int run = 0; run < RUNS; ++run)
+    {
+        float weight = (run % 2 == 0) ? 0.75f : 0.25f;
+        instance.SetWeight(0, weight);
+        instance.SetWeight(1, 1 - weight);
+        auto start = std::chrono::steady_clock::now();
+        const std::vector<MorphRange>& changed = instance.Update();
+        double updateSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+        std::memcpy(vertices.get(), mesh.vertices.get(), bytes);
+        AccumulateMorphDeltas(targets[0].deltas.data(), static_cast<unsigned int>(targets[0].deltas.size()), weight, layout, vertices.get());
+        AccumulateMorphDeltas(targets[1].deltas.data(), static_cast<unsigned int>(targets[1].deltas.size()), 1 - weight, layout, vertices.get());
+        double rebuildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (run == 0 || updateSeconds  < result.updateSeconds)   result.updateSeconds  = updateSeconds;
+        if (run == 0 || rebuildSeconds < result.rebuildSeconds)  result.rebuildSeconds = rebuildSeconds;
+        result.updateBytes = 0;
+        for (const MorphRange& range : changed)  result.updateBytes += (range.endVertex - range.firstVertex) * layout.vertexSize;
+        if (std::memcmp(instance.Vertices(), vertices.get(), bytes) != 0)  result.matches = false;
+    }
+    result.rebuildBytes = static_cast<unsigned int>(bytes);
+    return result;
+}
+
+void PrintMorphReport(std::vector<MorphResult>& results)
+{
+    // Most vertices first
+    std::sort(results.begin(), results.end(), [](const MorphResult& a, const MorphResult& b) { return a.numVertices > b.numVertices; });
+
+    std::printf("\nMorph targets (best of several runs, supported up to %s)\n", SimdLevelName(GetSupportedSimdLevel()));
+    std::printf("%-40s %-8s %10s %7s %10s", "Mesh", "Tangents", "Vertices", "Targets", "Deltas");
+    for (int method = 0; method < MORPH_METHODS; ++method)  std::printf(" %10s", MorphMethodName(method));
+    std::printf(" %8s  %s\n", "Matches", "Two targets changing: update vs rebuild all (us, KB uploaded)");
+    for (const MorphResult& result : results)
+    {
+        if (!result.error.empty())
+        {
+            std::printf("%-40s %-8s FAILED: %s\n", result.fileName.c_str(), result.tangents ? "yes" : "no", result.error.c_str());
+            continue;
+        }
+        std::printf("%-40s %-8s %10u %7u %10u", result.fileName.c_str(), result.tangents ? "yes" : "no", result.numVertices,
+                    result.numTargets, result.numDeltas);
+        for (int method = 0; method < MORPH_METHODS; ++method)
+        {
+            double seconds = result.seconds[method];
+            if (seconds > 0)  std::printf(" %10.1f", result.numDeltas / seconds * 1e-6);
+            else              std::printf(" %10s", "-");
+        }
+        std::printf(" %8s  %.1f vs %.1f us (%.2fx), %.1f vs %.1f KB\n", result.matches ? "yes" : "NO", result.updateSeconds * 1e6,
+                    result.rebuildSeconds * 1e6, result.updateSeconds > 0 ? result.rebuildSeconds / result.updateSeconds : 0.0,
+                    result.updateBytes / 1024.0, result.rebuildBytes / 1024.0);
+    }
+    std::printf("Delta columns are M deltas/s\n");
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Main
+-----------------------------------------------------------------------------------------*/
+
+int main(int argc, char* argv[])
+{
+    std::string tangents = "both", jsonFile;
+    int numWorkers = static_cast<int>(std::thread::hardware_concurrency());
+    bool force = false, compress = false, interleave = false, tangentThreads = false, skinning = false, morphs = false;
+    bool usage = false;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if      (arg == "--force")                 force = true;
+        else if (arg == "--compress")              compress = true;
+        else if (arg == "--interleave")            interleave = true;
+        else if (arg == "--tangent-threads")       tangentThreads = true;
+        else if (arg == "--skinning")              skinning = true;
+        else if (arg == "--morphs")                morphs = true;
+        else if (arg == "--tangents" && hasValue)  tangents = argv[++i];
+        else if (arg == "--jobs"     && hasValue)  numWorkers = std::atoi(argv[++i]);
+        else if (arg == "--json"     && hasValue)  jsonFile = argv[++i];
+        else if (arg.compare(0, 2, "--") != 0)     paths.push_back(arg);
+        else                                       usage = true;
+    }
+    if (usage || paths.empty() || (tangents != "both" && tangents != "yes" && tangents != "no"))
+    {
+        std::fprintf(stderr, "Usage: %s [--tangents both|yes|no] [--jobs count] [--force] [--compress] [--interleave] [--tangent-threads] [--skinning] [--morphs] [--json file] <mesh file or folder>...\n", argv[0]);
+        return 2;
+    }
+    if (numWorkers < 1)  numWorkers = 1;
+
+    // Collect the mesh files, folders are searched, files are used as given
+    std::vector<std::string> files;
+    {
+        Assimp::Importer importer;
+        for (const std::string& path : paths)
+        {
+            if (IsFolder(path))  FindMeshFiles(importer, path, files);
+            else                 files.push_back(path);
+        }
+    }
+    std::sort(files.begin(), files.end());
+    files.erase(std::unique(files.begin(), files.end()), files.end());
+
+    std::vector<Job> jobs;
+    for (const std::string& file : files)
+    {
+        if (tangents != "yes")  jobs.emplace_back(file, false);
+        if (tangents != "no")   jobs.emplace_back(file, true);
+    }
+    if (jobs.empty())
+    {
+        std::fprintf(stderr, "No mesh files found\n");
+        return 2;
+    }
+
+    // Each worker takes the next job until none are left. An importer is created per job, assimp
+    // importers are safe to use on several threads as long as each thread has its own
+    numWorkers = std::min(numWorkers, static_cast<int>(jobs.size()));
+    std::atomic<size_t> nextJob(0);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        workers.emplace_back([&]()
+        {
+            for (size_t job = nextJob++; job < jobs.size(); job = nextJob++)
+            {
+                Bake(jobs[job], force, compress);
+            }
+        });
+    }
+    for (std::thread& worker : workers)  worker.join();
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    PrintReport(jobs, wallSeconds, numWorkers);
+    if (interleave)
+    {
+        // After the workers have finished so the timings are not disturbed
+        std::vector<InterleaveResult> results;
+        for (const Job& job : jobs)
+        {
+            if (job.status != Job::Status::Failed)  results.push_back(BenchmarkInterleave(job));
+        }
+        PrintInterleaveReport(results);
+    }
+    if (tangentThreads)
+    {
+        std::vector<TangentResult> results;
+        for (const Job& job : jobs)
+        {
+            if (job.tangents && job.status != Job::Status::Failed)  results.push_back(BenchmarkTangents(job));
+        }
+        PrintTangentReport(results);
+    }
+    if (skinning)
+    {
+        std::vector<SkinningResult> results;
+        for (const Job& job : jobs)
+        {
+            if (job.status != Job::Status::Failed)  results.push_back(BenchmarkSkinning(job));
+        }
+        PrintSkinningReport(results);
+    }
+    if (morphs)
+    {
+        std::vector<MorphResult> results;
+        for (const Job& job : jobs)
+        {
+            if (job.status != Job::Status::Failed)  results.push_back(BenchmarkMorphs(job));
+        }
+        PrintMorphReport(results);
+    }
+    if (!jsonFile.empty() && !WriteJson(jsonFile, jobs, wallSeconds, numWorkers))
+    {
+        std::fprintf(stderr, "Cannot write report file %s\n", jsonFile.c_str());
+        return 2;
+    }
+
+    bool failed = std::any_of(jobs.begin(), jobs.end(), [](const Job& job) { return job.status == Job::Status::Failed; });
+    return failed ? 1 : 0;
+}
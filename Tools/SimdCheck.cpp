@@ -0,0 +1,489 @@
+//--------------------------------------------------------------------------------------
+// SIMD check - compares each SIMD version of the maths functions with the plain C++ version
+//--------------------------------------------------------------------------------------
+// A separate command line program, not part of the Visual Studio project. It only needs this
+// file and the Math folder so builds on any platform, e.g. from the repository folder on Linux:
+//     g++ -O2 -std=c++14 -IMath Tools/SimdCheck.cpp Math/*.cpp -o SimdCheck
+// or from a Visual Studio developer command prompt:
+//     cl /O2 /EHsc /IMath Tools\SimdCheck.cpp Math\*.cpp
+//
+// The plain C++ version of each function is the reference (see SIMD.h). Every function with SIMD
+// versions is run on the same inputs at each SIMD level the CPU supports, and each output value is
+// compared with the reference. Functions documented as bit-identical must match exactly, the fast
+// approximations must stay within their documented error. For each check the largest difference is
+// printed in ulps (units in the last place) and as an absolute value.
+//
+// The fast sin, cos, tan, atan2 and exp functions are also checked against double precision results
+// at every level, including the plain C++ one, to confirm the maximum errors given in MathHelpersSIMD.h.
+//
+// Options:
+//     --filter <text>   Only run checks whose name contains the given text
+//     --count <n>       Number of values per check (default 10007, not a multiple of any SIMD width
+//                       so the plain C++ code that finishes off each array is included)
+//
+// Exits with code 1 if any check fails.
+
+#include "CVector3.h"
+#include "CMatrix4x4.h"
+#include "MathBatch.h"
+#include "MathHelpersSIMD.h"
+#include "Frustum.h"
+#include "Transform.h"
+#include "SIMD.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+
+/*-----------------------------------------------------------------------------------------
+    Input data
+-----------------------------------------------------------------------------------------*/
+// Every run of a check generates its inputs again from the same seed, so the reference and each
+// SIMD level see identical data
+
+float Random(std::mt19937& random, float min, float max)
+{
+    return std::uniform_real_distribution<float>(min, max)(random);
+}
+
+// Random vectors, with some zero and very short vectors among them to test the special cases
+std::vector<CVector3> RandomVectors(std::mt19937& random, int count, float range)
+{
+    std::vector<CVector3> vectors(count);
+    for (auto& v : vectors)  v = { Random(random, -range, range), Random(random, -range, range), Random(random, -range, range) };
+    for (int i = 0; i < count; i += 97)  vectors[i] = { 0, 0, 0 };
+    for (int i = 50; i < count; i += 97)  vectors[i] = { 1e-20f, 0, 1e-20f };
+    return vectors;
+}
+
+std::vector<float> RandomFloats(std::mt19937& random, int count, float min, float max)
+{
+    std::vector<float> values(count);
+    for (auto& value : values)  value = Random(random, min, max);
+    return values;
+}
+
+// Random world matrices, so all are invertible
+std::vector<CMatrix4x4> RandomMatrices(std::mt19937& random, int count)
+{
+    std::vector<CMatrix4x4> matrices(count);
+    for (auto& m : matrices)
+    {
+        m = MatrixTRS(CVector3{ Random(random, -100, 100), Random(random, -100, 100), Random(random, -100, 100) },
+                      CVector3{ Random(random, -1.5f, 1.5f), Random(random, -3, 3), Random(random, -3, 3) },
+                      CVector3{ Random(random, 0.5f, 2), Random(random, 0.5f, 2), Random(random, 0.5f, 2) });
+    }
+    return matrices;
+}
+
+// A perspective projection looking down z, 90 degree field of view
+const CMatrix4x4 gProjection = { 1, 0, 0, 0,   0, 1, 0, 0,   0, 0, 1.0001f, 1,   0, 0, -0.1f, 0 };
+
+// Flatten the outputs of a check into a single array of values to compare
+void Append(std::vector<float>& values, const std::vector<CVector3>& vectors)
+{
+    for (const auto& v : vectors)  values.insert(values.end(), { v.x, v.y, v.z });
+}
+
+void Append(std::vector<float>& values, const std::vector<CMatrix4x4>& matrices)
+{
+    for (const auto& m : matrices)  values.insert(values.end(), &m.e00, &m.e00 + 16);
+}
+
+void Append(std::vector<float>& values, const std::vector<CullResult>& results)
+{
+    for (CullResult r : results)  values.push_back(static_cast<float>(r));
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Checks
+-----------------------------------------------------------------------------------------*/
+
+struct Check
+{
+    const char* name;
+
+    // Largest difference allowed from the reference, a value passes if it is within either limit.
+    // Both zero for functions that must be bit-identical
+    int   maxUlps;
+    float maxAbsolute;
+
+    // Generate inputs from the given seed, run the function on count values and return all its outputs
+    std::function<std::vector<float>(unsigned int seed, int count)> run;
+};
+
+std::vector<Check> Checks()
+{
+    return
+    {
+        //*********************************
+        // CMatrix4x4
+
+        { "MatrixMultiply", 0, 0,
+          [](unsigned int seed, int n) { std::mt19937 r(seed); auto a = RandomMatrices(r, n); auto b = RandomMatrices(r, n);
+                                         std::vector<CMatrix4x4> out(n); for (int i = 0; i < n; ++i)  MatrixMultiply(a[i], b[i], out[i]);
+                                         std::vector<float> values; Append(values, out); return values; } },
+
+        { "Inverse", 0, 0,
+          [](unsigned int seed, int n) { std::mt19937 r(seed); auto m = RandomMatrices(r, n);
+                                         std::vector<CMatrix4x4> out(n); for (int i = 0; i < n; ++i)  out[i] = Inverse(m[i]);
+                                         std::vector<float> values; Append(values, out); return values; } },
+
+
+        //*********************************
+        // MathBatch
+
+        { "InverseAffineMany", 0, 0,
+          [](unsigned int seed, int n) { std::mt19937 r(seed); auto m = RandomMatrices(r, n);
+                                         std::vector<CMatrix4x4> out(n); InverseAffineMany(m.data(), out.data(), n);
+                                         std::vector<float> values; Append(values, out); return values; } },
+
+        { "TransformPoints (AoS)", 0, 0,
+          [](unsigned int seed, int n) { std::mt19937 r(seed); auto m = RandomMatrices(r, 1)[0]; auto in = RandomVectors(r, n, 100);
+                                         std::vector<CVector3> out(n); TransformPoints(m, in.data(), out.data(), n);
+                                         std::vector<float> values; Append(values, out); return values; } },
+
+        { "TransformPoints (SoA)", 0, 0,
+          [](unsigned int seed, int n) { std::mt19937 r(seed); auto m = RandomMatrices(r, 1)[0];
+                                         auto x = RandomFloats(r, n, -100, 100), y = RandomFloats(r, n, -100, 100), z = RandomFloats(r, n, -100, 100);
+                                         std::vector<float> ox(n), oy(n), oz(n); TransformPoints(m, { x.data(), y.data(), z.data() }, { ox.data(), oy.data(), oz.data() }, n);
+                                         ox.insert(ox.end(), oy.begin(), oy.end()); ox.insert(ox.end(), oz.begin(), oz.end()); return ox; } },
+
+        { "TransformNormals (AoS)", 0, 0,
+          [](unsigned int seed, int n) { std::mt19937 r(seed); auto m = RandomMatrices(r, 1)[0]; auto in = RandomVectors(r, n, 1);
+                                         std::vector<CVector3> out(n); TransformNormals(m, in.data(), out.data(), n);
+                                         std::vector<float> values; Append(values, out); return values; } },
+
+        { "TransformNormals (SoA)", 0, 0,
+          [](unsigned int seed, int n) { std::mt19937 r(seed); auto m = RandomMatrices(r, 1)[0];
+                                         auto x = RandomFloats(r, n, -1, 1), y = RandomFloats(r, n, -1, 1), z = RandomFloats(r, n, -1, 1);
+                                         std::vector<float> ox(n), oy(n), oz(n); TransformNormals(m, { x.data(), y.data(), z.data() }, { ox.data(), oy.data(), oz.data() }, n);
+                                         ox.insert(ox.end(), oy.begin(), oy.end()); ox.insert(ox.end(), oz.begin(), oz.end()); return ox; } },
+
+        { "TransformPointsProject (AoS)", 0, 0,
+          [](unsigned int seed, int n) { std::mt19937 r(seed); auto in = RandomVectors(r, n, 100);
+                                         std::vector<CVector3> out(n); TransformPointsProject(gProjection, in.data(), out.data(), n);
+                                         std::vector<float> values; Append(values, out); return values; } },
+
+        { "TransformPointsProject (SoA)", 0, 0,
+          [](unsigned int seed, int n) { std::mt19937 r(seed);
+                                         auto x = RandomFloats(r, n, -100, 100), y = RandomFloats(r, n, -100, 100), z = RandomFloats(r, n, -100, 100);
+                                         std::vector<float> ox(n), oy(n), oz(n); TransformPointsProject(gProjection, { x.data(), y.data(), z.data() }, { ox.data(), oy.data(), oz.data() }, n);
+                                         ox.insert(ox.end(), oy.begin(), oy.end()); ox.insert(ox.end(), oz.begin(), oz.end()); return ox; } },
+
+        { "NormaliseMany precise", 0, 0,
+          [](unsigned int seed, int n) { std::mt19937 r(seed); auto in = RandomVectors(r, n, 100);
+                                         std::vector<CVector3> out(n); NormaliseMany(in.data(), out.data(), n, SqrtPrecision::Precise);
+                                         std::vector<float> values; Append(values, out); return values; } },
+
+        // Relative error below 5e-7 of the vector's length, so up to 5e-7 absolute on unit vector components
+        { "NormaliseMany fast", 4, 5e-7f,
+          [](unsigned int seed, int n) { std::mt19937 r(seed); auto in = RandomVectors(r, n, 100);
+                                         std::vector<CVector3> out(n); NormaliseMany(in.data(), out.data(), n, SqrtPrecision::Fast);
+                                         std::vector<float> values; Append(values, out); return values; } },
+
+        { "LengthMany precise", 0, 0,
+          [](unsigned int seed, int n) { std::mt19937 r(seed); auto in = RandomVectors(r, n, 100);
+                                         std::vector<float> out(n); LengthMany(in.data(), out.data(), n, SqrtPrecision::Precise); return out; } },
+
+        // The fast version returns 0 for lengths below about 1e-19
+        { "LengthMany fast", 4, 1e-19f,
+          [](unsigned int seed, int n) { std::mt19937 r(seed); auto in = RandomVectors(r, n, 100);
+                                         std::vector<float> out(n); LengthMany(in.data(), out.data(), n, SqrtPrecision::Fast); return out; } },
+
+
+        //*********************************
+        // Frustum
+
+        { "TestSpheres", 0, 0,
+          [](unsigned int seed, int n) { std::mt19937 r(seed); Frustum frustum(gProjection);
+                                         auto x = RandomFloats(r, n, -100, 100), y = RandomFloats(r, n, -100, 100), z = RandomFloats(r, n, -100, 100);
+                                         auto radii = RandomFloats(r, n, 0, 20);
+                                         std::vector<CullResult> out(n); TestSpheres(frustum, { x.data(), y.data(), z.data() }, radii.data(), out.data(), n);
+                                         std::vector<float> values; Append(values, out); return values; } },
+
+        { "TestAABBs", 0, 0,
+          [](unsigned int seed, int n) { std::mt19937 r(seed); Frustum frustum(gProjection);
+                                         auto x = RandomFloats(r, n, -100, 100), y = RandomFloats(r, n, -100, 100), z = RandomFloats(r, n, -100, 100);
+                                         auto size = RandomFloats(r, n, 0, 20);
+                                         std::vector<float> x2(n), y2(n), z2(n);
+                                         for (int i = 0; i < n; ++i)  { x2[i] = x[i] + size[i]; y2[i] = y[i] + size[i]; z2[i] = z[i] + size[i]; }
+                                         std::vector<CullResult> out(n);
+                                         TestAABBs(frustum, { x.data(), y.data(), z.data() }, { x2.data(), y2.data(), z2.data() }, out.data(), n);
+                                         std::vector<float> values; Append(values, out); return values; } },
+
+
+        //*********************************
+        // MathHelpersSIMD
+        // The wider versions use fused multiply-add so may differ from the plain C++ in the last bit or two
+
+        { "SinCosMany", 2, 1.2e-7f,
+          [](unsigned int seed, int n) { std::mt19937 r(seed); auto x = RandomFloats(r, n, -100, 100);
+                                         std::vector<float> s(n), c(n); SinCosMany(x.data(), s.data(), c.data(), n);
+                                         s.insert(s.end(), c.begin(), c.end()); return s; } },
+
+        { "TanMany", 4, 0,
+          [](unsigned int seed, int n) { std::mt19937 r(seed); auto x = RandomFloats(r, n, -100, 100);
+                                         std::vector<float> out(n); TanMany(x.data(), out.data(), n); return out; } },
+
+        { "Atan2Many", 2, 0,
+          [](unsigned int seed, int n) { std::mt19937 r(seed); auto y = RandomFloats(r, n, -100, 100), x = RandomFloats(r, n, -100, 100);
+                                         std::vector<float> out(n); Atan2Many(y.data(), x.data(), out.data(), n); return out; } },
+
+        { "ExpMany", 2, 0,
+          [](unsigned int seed, int n) { std::mt19937 r(seed); auto x = RandomFloats(r, n, -87, 88);
+                                         std::vector<float> out(n); ExpMany(x.data(), out.data(), n); return out; } },
+    };
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Comparison
+-----------------------------------------------------------------------------------------*/
+
+// Map a float's bits to an integer that increases with the float's value, so the difference of two
+// such integers is the number of representable floats between them. -0 and +0 map to the same value
+int64_t OrderedBits(float f)
+{
+    int32_t bits;
+    std::memcpy(&bits, &f, sizeof(bits));
+    return bits < 0 ? -static_cast<int64_t>(bits & 0x7fffffff) : static_cast<int64_t>(bits);
+}
+
+struct Difference
+{
+    int64_t maxUlps     = 0;
+    float   maxAbsolute = 0;
+    int     failures    = 0; // Values outside both limits
+    int     firstFailure = -1;
+};
+
+Difference Compare(const std::vector<float>& reference, const std::vector<float>& values, const Check& check)
+{
+    Difference difference;
+    if (values.size() != reference.size())
+    {
+        difference.failures = 1;
+        difference.firstFailure = 0;
+        return difference;
+    }
+
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        float a = reference[i];
+        float b = values[i];
+        int64_t ulps;
+        float absolute;
+        if (std::isnan(a) || std::isnan(b))
+        {
+            // NaNs only match NaNs
+            bool match = std::isnan(a) && std::isnan(b);
+            ulps = match ? 0 : INT64_MAX;
+            absolute = match ? 0 : INFINITY;
+        }
+        else
+        {
+            ulps = std::llabs(OrderedBits(a) - OrderedBits(b));
+            absolute = std::fabs(a - b);
+        }
+
+        if (ulps > difference.maxUlps)          difference.maxUlps = ulps;
+        if (absolute > difference.maxAbsolute)  difference.maxAbsolute = absolute;
+        if (ulps > check.maxUlps && absolute > check.maxAbsolute)
+        {
+            if (difference.failures == 0)  difference.firstFailure = static_cast<int>(i);
+            ++difference.failures;
+        }
+    }
+    return difference;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Accuracy
+-----------------------------------------------------------------------------------------*/
+
+struct Accuracy
+{
+    const char* name;
+    bool  relative;    // Error measured relative to the exact result, otherwise absolute
+    float maxError;    // Documented in MathHelpersSIMD.h
+    float min, max;    // Range of the inputs (both inputs for Atan2)
+
+    // Run the function on count values, y is only used by Atan2
+    std::function<void(const float* x, const float* y, float* out, int count)> run;
+    std::function<double(double x, double y)> exact;
+
+    // Return false for inputs to leave out of the measurement, nullptr to include them all
+    std::function<bool(double x)> include;
+};
+
+std::vector<Accuracy> Accuracies()
+{
+    std::vector<Accuracy> accuracies =
+    {
+        { "SinMany",   false, 8e-8f, -8192, 8192,
+          [](const float* x, const float*, float* out, int n) { SinMany(x, out, n); },
+          [](double x, double) { return std::sin(x); }, nullptr },
+
+        { "CosMany",   false, 8e-8f, -8192, 8192,
+          [](const float* x, const float*, float* out, int n) { CosMany(x, out, n); },
+          [](double x, double) { return std::cos(x); }, nullptr },
+
+        // Relative error grows without limit near the poles, so leave out results larger than 1000
+        { "TanMany",   true,  2e-7f, -8192, 8192,
+          [](const float* x, const float*, float* out, int n) { TanMany(x, out, n); },
+          [](double x, double) { return std::tan(x); },
+          [](double x) { return std::fabs(std::tan(x)) <= 1000; } },
+
+        { "Atan2Many", false, 3e-7f, -100, 100,
+          [](const float* y, const float* x, float* out, int n) { Atan2Many(y, x, out, n); },
+          [](double y, double x) { return std::atan2(y, x); }, nullptr },
+
+        { "ExpMany",   true,  1e-7f, -87, 88,
+          [](const float* x, const float*, float* out, int n) { ExpMany(x, out, n); },
+          [](double x, double) { return std::exp(x); }, nullptr },
+    };
+
+    // Sin, cos and tan again beyond 8192, where angles are reduced by the slower exact method. Up to 65536
+    // most SIMD vectors mix both methods, the largest range covers nearly every float
+    const struct { const char* names[3]; float max; } ranges[] =
+    {
+        { { "SinMany to 65536", "CosMany to 65536", "TanMany to 65536" }, 65536 },
+        { { "SinMany to 1e9",   "CosMany to 1e9",   "TanMany to 1e9"   }, 1e9f  },
+        { { "SinMany to 1e38",  "CosMany to 1e38",  "TanMany to 1e38"  }, 1e38f },
+    };
+    for (const auto& range : ranges)
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            Accuracy accuracy = accuracies[i];
+            accuracy.name = range.names[i];
+            accuracy.min  = -range.max;
+            accuracy.max  =  range.max;
+            accuracies.push_back(accuracy);
+        }
+    }
+    return accuracies;
+}
+
+// Return the largest error of the function against double precision at the current SIMD level
+double MaxError(const Accuracy& accuracy, unsigned int seed, int count)
+{
+    std::mt19937 random(seed);
+    std::vector<float> x = RandomFloats(random, count, accuracy.min, accuracy.max);
+    std::vector<float> y = RandomFloats(random, count, accuracy.min, accuracy.max);
+    std::vector<float> out(count);
+    accuracy.run(x.data(), y.data(), out.data(), count);
+
+    double maxError = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        if (accuracy.include && !accuracy.include(x[i]))  continue;
+        double exact = accuracy.exact(x[i], y[i]);
+        double error = std::fabs(out[i] - exact);
+        if (accuracy.relative && exact != 0)  error /= std::fabs(exact);
+        if (!(error <= maxError))  maxError = error; // Also catches NaN
+    }
+    return maxError;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Main
+-----------------------------------------------------------------------------------------*/
+
+int main(int argc, char* argv[])
+{
+    std::string filter;
+    int count = 10007;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if      (arg == "--filter" && hasValue)  filter = argv[++i];
+        else if (arg == "--count"  && hasValue)  count = std::atoi(argv[++i]);
+        else
+        {
+            std::fprintf(stderr, "Usage: %s [--filter text] [--count values]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (count < 1)
+    {
+        std::fprintf(stderr, "Count must be at least 1\n");
+        return 2;
+    }
+
+    // The SIMD levels to check, each against the plain C++ reference
+    std::vector<SimdLevel> levels;
+    SimdLevel supported = GetSupportedSimdLevel();
+    for (SimdLevel level : { SimdLevel::SSE41, SimdLevel::AVX2, SimdLevel::AVX512 })
+    {
+        if (level <= supported)  levels.push_back(level);
+    }
+    std::printf("Supported SIMD level: %s\n\n", SimdLevelName(supported));
+    if (levels.empty())  std::printf("No SIMD versions to compare on this CPU\n\n");
+
+    std::printf("%-30s %-8s %12s %12s %10s\n", "Check", "SIMD", "Max ulps", "Max abs", "Result");
+    int failed = 0;
+    const unsigned int seed = 1234;
+    for (const Check& check : Checks())
+    {
+        if (!filter.empty() && std::string(check.name).find(filter) == std::string::npos)  continue;
+
+        SetSimdLevel(SimdLevel::None);
+        std::vector<float> reference = check.run(seed, count);
+
+        for (SimdLevel level : levels)
+        {
+            SetSimdLevel(level);
+            std::vector<float> values = check.run(seed, count);
+            Difference difference = Compare(reference, values, check);
+
+            std::printf("%-30s %-8s %12lld %12.3g %10s\n", check.name, SimdLevelName(level),
+                        static_cast<long long>(difference.maxUlps), difference.maxAbsolute, difference.failures == 0 ? "ok" : "FAILED");
+            if (difference.failures > 0)
+            {
+                int i = difference.firstFailure;
+                std::printf("    %d value(s) outside the limits, first is value %d: %.9g, reference %.9g\n", difference.failures, i,
+                            i < static_cast<int>(values.size()) ? values[i] : NAN, i < static_cast<int>(reference.size()) ? reference[i] : NAN);
+                ++failed;
+            }
+        }
+    }
+
+    // Accuracy of the fast functions, including the plain C++ versions
+    std::printf("\n%-30s %-8s %12s %12s %10s\n", "Accuracy (vs double)", "SIMD", "Max error", "Limit", "Result");
+    levels.insert(levels.begin(), SimdLevel::None);
+    for (const Accuracy& accuracy : Accuracies())
+    {
+        if (!filter.empty() && std::string(accuracy.name).find(filter) == std::string::npos)  continue;
+
+        for (SimdLevel level : levels)
+        {
+            SetSimdLevel(level);
+            double maxError = MaxError(accuracy, seed, count * 10);
+            bool passed = maxError <= accuracy.maxError;
+            std::printf("%-30s %-8s %12.3g %12.3g %10s\n", accuracy.name, SimdLevelName(level), maxError, accuracy.maxError, passed ? "ok" : "FAILED");
+            if (!passed)  ++failed;
+        }
+    }
+    SetSimdLevel(supported);
+
+    if (failed > 0)
+    {
+        std::printf("\n%d check(s) failed\n", failed);
+        return 1;
+    }
+    std::printf("\nAll checks passed\n");
+    return 0;
+}
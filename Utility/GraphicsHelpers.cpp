@@ -35,22 +35,12 @@ bool LoadTexture(std::string filename, ID3D11Resource** texture, ID3D11ShaderRes
 //--------------------------------------------------------------------------------------
 // Camera Helpers
 //--------------------------------------------------------------------------------------
+// MakeProjectionMatrix is constexpr and defined in the header. Check it can be evaluated at compile time:
+// a 90 degree FOV has tan(FOV/2) = 1, so the x and y scales are 1 and the aspect ratio
 
-// A "projection matrix" contains properties of a camera. Covered mid-module - the maths is an optional topic (not examinable).
-// - Aspect ratio is screen width / height (like 4:3, 16:9)
-// - FOVx is the viewing angle from left->right (high values give a fish-eye look),
-// - near and far clip are the range of z distances that can be rendered
-CMatrix4x4 MakeProjectionMatrix(float aspectRatio /*= 4.0f / 3.0f*/, float FOVx /*= ToRadians(60)*/,
-                                float nearClip /*= 0.1f*/, float farClip /*= 10000.0f*/)
-{
-    float tanFOVx = std::tan(FOVx * 0.5f);
-    float scaleX = 1.0f / tanFOVx;
-    float scaleY = aspectRatio / tanFOVx;
-    float scaleZa = farClip / (farClip - nearClip);
-    float scaleZb = -nearClip * scaleZa;
-
-    return CMatrix4x4{ scaleX,   0.0f,    0.0f,   0.0f,
-                         0.0f, scaleY,    0.0f,   0.0f,
-                         0.0f,   0.0f, scaleZa,   1.0f,
-                         0.0f,   0.0f, scaleZb,   0.0f };
-}
+static constexpr CMatrix4x4 CHECK_PROJECTION = MakeProjectionMatrix(2.0f, ToRadians(90), 1.0f, 101.0f);
+static_assert(CHECK_PROJECTION.e00 > 0.99999f && CHECK_PROJECTION.e00 < 1.00001f &&
+              CHECK_PROJECTION.e11 > 1.99999f && CHECK_PROJECTION.e11 < 2.00001f, "MakeProjectionMatrix is not constexpr");
+static_assert(CHECK_PROJECTION.e22 > 1.00999f && CHECK_PROJECTION.e22 < 1.01001f && CHECK_PROJECTION.e23 == 1 &&
+              CHECK_PROJECTION.e32 > -1.01001f && CHECK_PROJECTION.e32 < -1.00999f && CHECK_PROJECTION.e33 == 0,
+              "MakeProjectionMatrix is not constexpr");
@@ -27,6 +27,7 @@ void UpdateConstantBuffer(ID3D11Buffer* buffer, const T& bufferData)
     gD3DContext->Map(buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &cb);
     memcpy(cb.pData, &bufferData, sizeof(T));
     gD3DContext->Unmap(buffer, 0);
+    ++gRenderCounts.constantBufferUpdates;
 }
 
 
@@ -49,8 +50,22 @@ bool LoadTexture(std::string filename, ID3D11Resource** texture, ID3D11ShaderRes
 // - Aspect ratio is screen width / height (like 4:3, 16:9)
 // - FOVx is the viewing angle from left->right (high values give a fish-eye look),
 // - near and far clip are the range of z distances that can be rendered
-CMatrix4x4 MakeProjectionMatrix(float aspectRatio = 4.0f / 3.0f, float FOVx = ToRadians(60),
-                                float nearClip = 0.1f, float farClip = 10000.0f);
+// This is constexpr, so a camera or light with a fixed field of view can have its projection matrix
+// calculated at compile time, e.g. constexpr CMatrix4x4 proj = MakeProjectionMatrix(1.0f, ToRadians(90));
+constexpr CMatrix4x4 MakeProjectionMatrix(float aspectRatio = 4.0f / 3.0f, float FOVx = ToRadians(60),
+                                          float nearClip = 0.1f, float farClip = 10000.0f)
+{
+    float tanFOVx = static_cast<float>(ConstexprTan(FOVx * 0.5f));
+    float scaleX = 1.0f / tanFOVx;
+    float scaleY = aspectRatio / tanFOVx;
+    float scaleZa = farClip / (farClip - nearClip);
+    float scaleZb = -nearClip * scaleZa;
+
+    return CMatrix4x4{ scaleX,   0.0f,    0.0f,   0.0f,
+                         0.0f, scaleY,    0.0f,   0.0f,
+                         0.0f,   0.0f, scaleZa,   1.0f,
+                         0.0f,   0.0f, scaleZb,   0.0f };
+}
 
 
 #endif //_SCENE_HELPERS_H_INCLUDED_
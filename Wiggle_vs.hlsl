@@ -4,6 +4,8 @@ LightingPixelShaderInput main(BasicVertex modelVertex)
 {
 	LightingPixelShaderInput output; // This is the data the pixel shader requires from this vertex shader
 
+	DecodeVertex(modelVertex); // Decode compressed vertices if the mesh uses them (see Common.hlsli)
+
 	if (gWiggle > 0)
 	{
 		float sinY = sin(modelVertex.position.y * radians(360.0f) + gWiggle);